@@ -0,0 +1,314 @@
+#include "BooleanService.h"
+#include "Gglobal.h"
+#include "ModelView.h"
+#include "ShapeUtils.h"
+
+#include <QElapsedTimer>
+#include <QRunnable>
+
+#include <sstream>
+
+#include <AIS_ColoredShape.hxx>
+#include <BRepAlgoAPI_BooleanOperation.hxx>
+#include <Message_ProgressIndicator.hxx>
+#include <Message_ProgressScope.hxx>
+#include <Standard_Failure.hxx>
+#include <TopTools_ListOfShape.hxx>
+
+
+namespace
+{
+    //! 没有被取走(Output)的结果最多保留的个数，界面提交的任务不会取走结果
+    const int THE_MAX_OUTPUTS = 64;
+
+    BOPAlgo_Operation algoOperation(const BooleanService::Operation theOp)
+    {
+        switch (theOp)
+        {
+            case BooleanService::Operation_Fuse:
+                return BOPAlgo_FUSE;
+            case BooleanService::Operation_Common:
+                return BOPAlgo_COMMON;
+            default:
+                return BOPAlgo_CUT;
+        }
+    }
+
+    //! 进度每前进1%转发一次，取消标志在运算的进度检查点(UserBreak)生效
+    class BooleanProgress : public Message_ProgressIndicator
+    {
+    public:
+        BooleanProgress(BooleanService *theService, const int theId,
+                        const std::shared_ptr<std::atomic<bool>> &theIsCancelled)
+            : myService(theService)
+            , myId(theId)
+            , myIsCancelled(theIsCancelled)
+            , myLast(0.0)
+        {
+        }
+
+        virtual void Show(const Message_ProgressScope &, const Standard_Boolean isForce) Standard_OVERRIDE
+        {
+            const double aPos = GetPosition();
+            if (!isForce && aPos - myLast < 0.01)
+                return;
+
+            myLast = aPos;
+            QMetaObject::invokeMethod(myService, "progress", Qt::QueuedConnection, Q_ARG(int, myId), Q_ARG(double, aPos));
+        }
+
+        virtual Standard_Boolean UserBreak() Standard_OVERRIDE { return myIsCancelled->load(); }
+
+    private:
+        BooleanService *                   myService;
+        int                                myId;
+        std::shared_ptr<std::atomic<bool>> myIsCancelled;
+        double                             myLast;
+    };
+}    // namespace
+
+
+/// \brief 一个布尔运算的后台任务
+class BooleanTask : public QRunnable
+{
+public:
+    BooleanTask(BooleanService *theService, const int theId, const std::shared_ptr<std::atomic<bool>> &theIsCancelled)
+        : Op(BooleanService::Operation_Cut)
+        , FuzzyValue(0.0)
+        , IsParallel(true)
+        , myService(theService)
+        , myId(theId)
+        , myIsCancelled(theIsCancelled)
+    {
+    }
+
+    BooleanService::Operation Op;
+    TopTools_ListOfShape      Objects;
+    TopTools_ListOfShape      Tools;
+    double                    FuzzyValue;
+    bool                      IsParallel;
+
+    virtual void run() override
+    {
+        QElapsedTimer aTimer;
+        aTimer.start();
+
+        BooleanService::Result aResult;
+        aResult.Id   = myId;
+        aResult.IsOk = false;
+        if (!myIsCancelled->load())
+        {
+            try
+            {
+                Handle(BooleanProgress) aProgress = new BooleanProgress(myService, myId, myIsCancelled);
+
+                BRepAlgoAPI_BooleanOperation anOp;
+                anOp.SetOperation(algoOperation(Op));
+                anOp.SetArguments(Objects);
+                anOp.SetTools(Tools);
+                anOp.SetRunParallel(IsParallel ? Standard_True : Standard_False);
+                anOp.SetFuzzyValue(FuzzyValue);
+                anOp.SetNonDestructive(Standard_True);
+                anOp.Build(aProgress->Start());
+
+                if (myIsCancelled->load())
+                    aResult.Message = "cancelled";
+                else if (anOp.HasErrors() || !anOp.IsDone())
+                {
+                    std::ostringstream aStream;
+                    anOp.DumpErrors(aStream);
+                    aResult.Message = QString::fromStdString(aStream.str()).trimmed();
+                }
+                else
+                {
+                    aResult.IsOk  = true;
+                    aResult.Shape = anOp.Shape();
+                }
+            }
+            catch (const Standard_Failure &theFailure)
+            {
+                aResult.Message = theFailure.GetMessageString();
+            }
+        }
+        else
+            aResult.Message = "cancelled";
+        aResult.Ms = aTimer.nsecsElapsed() / 1.0e6;
+
+        {
+            QMutexLocker aLock(&myService->myReadyMutex);
+            myService->myReady.push_back(aResult);
+        }
+        QMetaObject::invokeMethod(myService, "onJobDone", Qt::QueuedConnection);
+    }
+
+private:
+    BooleanService *                   myService;
+    int                                myId;
+    std::shared_ptr<std::atomic<bool>> myIsCancelled;
+};
+
+
+BooleanService::BooleanService(const Handle(AIS_InteractiveContext) & theContext, ModelView *theView, QObject *parent)
+    : QObject(parent)
+    , myContext(theContext)
+    , myView(theView)
+    , myFuzzyValue(0.0)
+    , myIsParallel(true)
+    , myNextId(0)
+    , myNextBatch(0)
+{
+}
+
+BooleanService::~BooleanService()
+{
+    CancelAll();
+    myPool.waitForDone();
+}
+
+int BooleanService::Submit(const Request &theRequest)
+{
+    return submit(theRequest, -1);
+}
+
+QList<int> BooleanService::SubmitBatch(const QList<Request> &theRequests)
+{
+    const int  aBatch = myNextBatch++;
+    QList<int> anIds;
+    foreach (const Request &aRequest, theRequests)
+        anIds.append(submit(aRequest, aBatch));
+    return anIds;
+}
+
+int BooleanService::submit(const Request &theRequest, const int theBatch)
+{
+    if (theRequest.Object.IsNull() || theRequest.Tools.isEmpty())
+        return -1;
+
+    const int anId = myNextId++;
+    Job       aJob;
+    aJob.Req         = theRequest;
+    aJob.IsCancelled = std::make_shared<std::atomic<bool>>(false);
+    aJob.Batch       = theBatch;
+    myJobs.insert(anId, aJob);
+
+    // 形状在GUI线程中取出，后台只读取形状本身
+    BooleanTask *aTask = new BooleanTask(this, anId, aJob.IsCancelled);
+    aTask->Op          = theRequest.Op;
+    aTask->FuzzyValue  = myFuzzyValue;
+    aTask->IsParallel  = myIsParallel;
+    aTask->Objects.Append(ShapeUtils::WorldShape(theRequest.Object));
+    foreach (const Handle(AIS_Shape) &aTool, theRequest.Tools)
+        aTask->Tools.Append(ShapeUtils::WorldShape(aTool));
+    myPool.start(aTask);
+    return anId;
+}
+
+void BooleanService::Cancel(const int theId)
+{
+    if (myJobs.contains(theId))
+        *myJobs[theId].IsCancelled = true;
+}
+
+void BooleanService::CancelAll()
+{
+    for (QMap<int, Job>::iterator anIter = myJobs.begin(); anIter != myJobs.end(); ++anIter)
+        *anIter.value().IsCancelled = true;
+}
+
+void BooleanService::waitForDone()
+{
+    myPool.waitForDone();
+    onJobDone();
+}
+
+void BooleanService::onJobDone()
+{
+    {
+        QMutexLocker aLock(&myReadyMutex);
+        for (size_t i = 0; i < myReady.size(); ++i)
+            myDone.insert(myReady[i].Id, myReady[i]);
+        myReady.clear();
+    }
+
+    // 批次中的任务全部结束(包括被取消的)后，该批结果才一起应用
+    std::vector<Result> aResults;
+    for (QMap<int, Result>::iterator anIter = myDone.begin(); anIter != myDone.end();)
+    {
+        bool isComplete = true;
+        if (myJobs.contains(anIter.key()) && myJobs[anIter.key()].Batch >= 0)
+        {
+            const int aBatch = myJobs[anIter.key()].Batch;
+            for (QMap<int, Job>::const_iterator aJobIter = myJobs.constBegin(); aJobIter != myJobs.constEnd(); ++aJobIter)
+            {
+                if (aJobIter.value().Batch == aBatch && !myDone.contains(aJobIter.key()))
+                {
+                    isComplete = false;
+                    break;
+                }
+            }
+        }
+
+        if (isComplete)
+        {
+            aResults.push_back(anIter.value());
+            anIter = myDone.erase(anIter);
+        }
+        else
+            ++anIter;
+    }
+    if (aResults.empty())
+        return;
+
+    bool isChanged = false;
+    for (size_t i = 0; i < aResults.size(); ++i)
+    {
+        Result &aResult = aResults[i];
+        if (!myJobs.contains(aResult.Id))
+            continue;
+
+        const Job aJob = myJobs.take(aResult.Id);
+        if (aResult.IsOk && aJob.IsCancelled->load())
+        {
+            aResult.IsOk    = false;
+            aResult.Message = "cancelled";
+        }
+        else if (aResult.IsOk && !myContext->IsDisplayed(aJob.Req.Object))
+        {
+            aResult.IsOk    = false;
+            aResult.Message = "object removed while running";
+        }
+
+        if (aResult.IsOk)
+        {
+            Handle(AIS_Shape) anOutput = new AIS_ColoredShape(aResult.Shape);
+            anOutput->SetDisplayMode(AIS_Shaded);
+
+            const QString aMaterial = myView->getMaterials().Assigned(aJob.Req.Object);
+            myView->removeShape(aJob.Req.Object, false);
+            if (!aJob.Req.ToKeepTools)
+            {
+                foreach (const Handle(AIS_Shape) &aTool, aJob.Req.Tools)
+                {
+                    if (myContext->IsDisplayed(aTool))
+                        myView->removeShape(aTool, false);
+                }
+            }
+            myView->displayShape(anOutput, false);
+            if (!aMaterial.isEmpty())
+                myView->assignMaterial(anOutput, aMaterial);
+
+            myOutputs.insert(aResult.Id, anOutput);
+            while (myOutputs.size() > THE_MAX_OUTPUTS)
+                myOutputs.erase(myOutputs.begin());
+            isChanged = true;
+        }
+        else
+            LOG_WARN("BooleanService", "job " << aResult.Id << ": " << aResult.Message.toStdString());
+
+        emit finished(aResult.Id, aResult.IsOk, aResult.Message, aResult.Ms);
+    }
+
+    // 本批结果的替换一次显示
+    if (isChanged)
+        myContext->UpdateCurrentViewer();
+}
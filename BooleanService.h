@@ -0,0 +1,136 @@
+#ifndef BOOLEANSERVICE_H
+#define BOOLEANSERVICE_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+
+#include <AIS_InteractiveContext.hxx>
+#include <AIS_Shape.hxx>
+#include <TopoDS_Shape.hxx>
+
+class ModelView;
+
+/// \brief BooleanService
+///
+/// 后台布尔运算(融合、切割、求交)。每个请求是线程池中的一个任务，批量提交的多个
+/// 对象/工具组合并发执行；单个运算内部再由BOPAlgo并行(SetRunParallel)。
+///
+/// - 输入形状在提交时按对象的变换转换到世界坐标，运算以非破坏方式进行(SetNonDestructive)，
+///   正在显示的形状不会被修改
+/// - 运行中通过progress信号报告进度，Cancel使运算在下一个进度检查点中止
+/// - 结果在GUI线程中替换输入：移除对象(以及工具)、显示结果、沿用对象的材质；
+///   SubmitBatch提交的一批结果等全部任务结束后一起应用，只更新一次视图，不会显示替换了一半的场景
+/// - 运行期间对象已被删除或隐藏时丢弃结果
+class BooleanService : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Operation
+    {
+        Operation_Fuse,
+        Operation_Cut,
+        Operation_Common
+    };
+
+    struct Request
+    {
+        Operation                Op;
+        Handle(AIS_Shape)        Object;
+        QList<Handle(AIS_Shape)> Tools;
+        bool                     ToKeepTools;    ///< 为false时工具与对象一起被结果替换
+
+        Request()
+            : Op(Operation_Cut)
+            , ToKeepTools(false)
+        {
+        }
+    };
+
+    BooleanService(const Handle(AIS_InteractiveContext) & theContext, ModelView *theView, QObject *parent = nullptr);
+    ~BooleanService();
+
+    /// \brief 模糊容差(mm)，0表示只使用形状自身的容差
+    void   SetFuzzyValue(const double theValue) { myFuzzyValue = theValue; }
+    double FuzzyValue() const { return myFuzzyValue; }
+
+    /// \brief 单个运算内部是否并行，默认为true
+    void SetRunParallel(const bool isOn) { myIsParallel = isOn; }
+
+    /// \brief 同时进行的运算数，默认为CPU核心数
+    void setMaxConcurrency(int theCount) { myPool.setMaxThreadCount(theCount); }
+
+    /// \brief 提交一个运算，必须在GUI线程中调用
+    /// \return 任务编号，与progress/finished信号中的编号对应；请求无效时返回-1
+    int Submit(const Request &theRequest);
+
+    /// \brief 提交一批相互独立的运算，并发执行，结果在整批结束后一起应用
+    QList<int> SubmitBatch(const QList<Request> &theRequests);
+
+    /// \brief 取消任务，已完成但尚未应用的结果也被丢弃
+    void Cancel(const int theId);
+    void CancelAll();
+
+    /// \brief 尚未结束(包括等待应用结果)的任务数
+    int NbPending() const { return myJobs.size(); }
+
+    /// \brief 取走任务的结果对象，任务失败、被取消、尚未完成或已经取走时为空
+    ///
+    /// 结果只保留到被取走为止，没有取走的只保留最近的若干个，不会让替换掉的形状一直驻留内存。
+    Handle(AIS_Shape) Output(const int theId) { return myOutputs.take(theId); }
+
+    /// \brief 等待全部任务结束并应用结果，用于命令行与测试
+    void waitForDone();
+
+signals:
+    void progress(int theId, double theFraction);
+    void finished(int theId, bool isOk, QString theMessage, double theMs);
+
+private slots:
+    void onJobDone();
+
+private:
+    struct Result
+    {
+        int          Id;
+        bool         IsOk;
+        TopoDS_Shape Shape;
+        QString      Message;
+        double       Ms;
+    };
+
+    struct Job
+    {
+        Request                            Req;
+        std::shared_ptr<std::atomic<bool>> IsCancelled;
+        int                                Batch;    ///< 所属批次，单独提交时为-1
+    };
+
+    friend class BooleanTask;
+
+    int submit(const Request &theRequest, const int theBatch);
+
+    Handle(AIS_InteractiveContext) myContext;
+    ModelView *                    myView;
+    double                         myFuzzyValue;
+    bool                           myIsParallel;
+    int                            myNextId;
+    int                            myNextBatch;
+    QMap<int, Job>                 myJobs;
+    QMap<int, Handle(AIS_Shape)>   myOutputs;
+    QThreadPool                    myPool;
+
+    QMutex              myReadyMutex;    ///< 保护后台任务交回的结果
+    std::vector<Result> myReady;
+    QMap<int, Result>   myDone;    ///< 已结束但所在批次还有任务在运行的结果
+};
+
+#endif    // BOOLEANSERVICE_H
@@ -0,0 +1,547 @@
+#include "CommandServer.h"
+#include "FaceStyler.h"
+#include "Gglobal.h"
+#include "ModelView.h"
+#include "ShapeLoader.h"
+
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QStandardPaths>
+
+#include <BRepBndLib.hxx>
+#include <BRepGProp.hxx>
+#include <BRepMesh_IncrementalMesh.hxx>
+#include <Bnd_Box.hxx>
+#include <GProp_GProps.hxx>
+#include <TopTools_MapOfShape.hxx>
+
+#include <vector>
+
+namespace
+{
+    QJsonObject failure(const QString &theError)
+    {
+        QJsonObject aResult;
+        aResult["ok"]    = false;
+        aResult["error"] = theError;
+        return aResult;
+    }
+
+    ShapeHealer::Options healerOptions()
+    {
+        ShapeHealer::Options anOptions;
+        anOptions.CacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/heal";
+        return anOptions;
+    }
+}    // namespace
+
+const char *const CommandServer::THE_DEFAULT_NAME = "occt_learn";
+
+CommandServer::CommandServer(const Handle(AIS_InteractiveContext) & theContext, ModelView *theView, QObject *parent)
+    : QObject(parent)
+    , myContext(theContext)
+    , myView(theView)
+    , myServer(new QLocalServer(this))
+    , myHealer(healerOptions())
+    , myNextId(1)
+    , myNbRequests(0)
+    , myIsDirty(false)
+{
+    myUptime.start();
+    connect(myServer, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+}
+
+CommandServer::~CommandServer()
+{
+    myServer->close();
+}
+
+bool CommandServer::Listen(const QString &theName)
+{
+    // 上次异常退出留下的套接字文件会使listen失败
+    QLocalServer::removeServer(theName);
+    if (!myServer->listen(theName))
+    {
+        LOG_ERROR("CommandServer", "cannot listen on " << theName.toStdString() << ": "
+                                                       << myServer->errorString().toStdString());
+        return false;
+    }
+
+    LOG_INFO("CommandServer", "listening on " << myServer->fullServerName().toStdString());
+    return true;
+}
+
+QString CommandServer::ServerName() const
+{
+    return myServer->fullServerName();
+}
+
+void CommandServer::onNewConnection()
+{
+    while (QLocalSocket *aSocket = myServer->nextPendingConnection())
+    {
+        connect(aSocket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+        connect(aSocket, SIGNAL(disconnected()), aSocket, SLOT(deleteLater()));
+    }
+}
+
+void CommandServer::onReadyRead()
+{
+    QLocalSocket *aSocket = qobject_cast<QLocalSocket *>(sender());
+    if (aSocket == nullptr)
+        return;
+
+    // 已到达的完整请求整批执行，应答一次写出，视图在整批结束后更新一次
+    QByteArray aReplies;
+    while (aSocket->canReadLine())
+    {
+        const QByteArray aLine = aSocket->readLine().trimmed();
+        if (aLine.isEmpty())
+            continue;
+
+        QJsonParseError     anError;
+        const QJsonDocument aDoc = QJsonDocument::fromJson(aLine, &anError);
+        const QJsonObject   aReply =
+            aDoc.isObject() ? Execute(aDoc.object()) : failure("invalid request: " + anError.errorString());
+        aReplies += QJsonDocument(aReply).toJson(QJsonDocument::Compact);
+        aReplies += '\n';
+    }
+
+    if (myIsDirty)
+    {
+        myContext->UpdateCurrentViewer();
+        myIsDirty = false;
+    }
+
+    if (!aReplies.isEmpty())
+        aSocket->write(aReplies);
+}
+
+QJsonObject CommandServer::Execute(const QJsonObject &theRequest)
+{
+    QElapsedTimer aTimer;
+    aTimer.start();
+    ++myNbRequests;
+
+    const QString aCmd = theRequest.value("cmd").toString();
+    QJsonObject   aResult;
+    if (aCmd == "ping")
+        aResult["ok"] = true;
+    else if (aCmd == "load")
+        aResult = load(theRequest);
+    else if (aCmd == "mesh")
+        aResult = mesh(theRequest);
+    else if (aCmd == "material")
+        aResult = material(theRequest);
+    else if (aCmd == "color")
+        aResult = color(theRequest);
+    else if (aCmd == "boolean")
+        aResult = boolean(theRequest);
+    else if (aCmd == "dump")
+        aResult = dump(theRequest);
+    else if (aCmd == "props")
+        aResult = props(theRequest);
+    else if (aCmd == "list")
+        aResult = list();
+    else if (aCmd == "clear")
+        aResult = clear();
+    else if (aCmd == "stats")
+        aResult = stats();
+    else
+        aResult = failure("unknown command: " + aCmd);
+
+    if (theRequest.contains("id"))
+        aResult["id"] = theRequest.value("id");
+    aResult["ms"] = aTimer.nsecsElapsed() / 1.0e6;
+
+    if (!aResult.value("ok").toBool())
+        LOG_WARN("CommandServer", aCmd.toStdString() << ": " << aResult.value("error").toString().toStdString());
+    return aResult;
+}
+
+QJsonObject CommandServer::load(const QJsonObject &theRequest)
+{
+    const QFileInfo anInfo(theRequest.value("file").toString());
+    if (!anInfo.exists())
+        return failure("file not found: " + anInfo.filePath());
+
+    // 同一文件未修改时直接使用上次导入的形状，修复与未修复的形状分别缓存
+    const QString aPath  = anInfo.canonicalFilePath();
+    const bool    toHeal = theRequest.value("heal").toBool(false);
+    const QString aKey   = toHeal ? aPath + "|heal" : aPath;
+    if (!myFiles.contains(aKey) || myFiles[aKey].Modified != anInfo.lastModified())
+    {
+        CachedFile aFile;
+        aFile.Modified     = anInfo.lastModified();
+        aFile.Shapes       = new TopTools_HSequenceOfShape;
+        aFile.IsHealCached = false;
+        if (!ShapeLoader::ReadStep(TCollection_AsciiString(aPath.toUtf8().data()), aFile.Shapes,
+                                   toHeal ? &myHealer : NULL, &aFile.Reports, &aFile.IsHealCached))
+            return failure("cannot read " + aPath);
+        myFiles[aKey] = aFile;
+    }
+
+    const Handle(TopTools_HSequenceOfShape) &aShapes = myFiles[aKey].Shapes;
+    const QString aMaterial = theRequest.value("material").toString();
+    QJsonArray    anIds;
+    for (int i = 1; i <= aShapes->Length(); ++i)
+    {
+        Handle(AIS_Shape) aShape = new AIS_ColoredShape(aShapes->Value(i));
+        aShape->SetDisplayMode(AIS_Shaded);
+        myView->displayShape(aShape, false);
+        if (!aMaterial.isEmpty())
+            myView->assignMaterial(aShape, aMaterial);
+
+        myObjects.insert(myNextId, aShape);
+        anIds.append(myNextId++);
+    }
+    myIsDirty = true;
+
+    QJsonObject aResult;
+    aResult["ok"]  = true;
+    aResult["ids"] = anIds;
+    if (toHeal)
+    {
+        QJsonArray aReports;
+        foreach (const ShapeHealer::Report &aReport, myFiles[aKey].Reports)
+        {
+            QJsonObject anObj;
+            anObj["root"]              = aReport.Root;
+            anObj["part"]              = aReport.Part;
+            anObj["ms"]                = aReport.Ms;
+            anObj["valid_before"]      = aReport.IsValidBefore;
+            anObj["valid_after"]       = aReport.IsValidAfter;
+            anObj["sewn"]              = aReport.IsSewn;
+            anObj["fixed"]             = aReport.IsFixed;
+            anObj["free_edges_before"] = aReport.FreeEdgesBefore;
+            anObj["free_edges_after"]  = aReport.FreeEdgesAfter;
+            anObj["edges_removed"]     = aReport.EdgesRemoved;
+            anObj["faces_removed"]     = aReport.FacesRemoved;
+            aReports.append(anObj);
+        }
+        aResult["heal"]        = aReports;
+        aResult["heal_cached"] = myFiles[aKey].IsHealCached;
+    }
+    return aResult;
+}
+
+QJsonObject CommandServer::mesh(const QJsonObject &theRequest)
+{
+    QList<Handle(AIS_Shape)> anObjects;
+    QString                  anError;
+    if (!objects(theRequest, anObjects, anError))
+        return failure(anError);
+
+    const Standard_Real aDeflection = theRequest.value("deflection").toDouble(0.1);
+    const Standard_Real anAngle     = theRequest.value("angle").toDouble(0.5);
+    if (aDeflection <= 0.0 || anAngle <= 0.0)
+        return failure("deflection and angle must be positive");
+
+    // 同一文件多次导入的对象共享形状，每个形状只剖分一次；
+    // 由网格外存管理的对象换入时会恢复存储的网格，重新剖分不会生效，跳过
+    TopTools_MapOfShape       aVisited;
+    std::vector<TopoDS_Shape> aShapes;
+    QList<Handle(AIS_Shape)>  aMeshed;
+    int                       aNbSkipped = 0;
+    foreach (const Handle(AIS_Shape) &anObj, anObjects)
+    {
+        if (myView->getMeshStore() != NULL && myView->getMeshStore()->Contains(anObj))
+        {
+            ++aNbSkipped;
+            continue;
+        }
+
+        aMeshed.append(anObj);
+        if (aVisited.Add(anObj->Shape()))
+            aShapes.push_back(anObj->Shape());
+    }
+
+    // 不同根形状中的实例共享面的TShape，并行剖分不同形状会同时写同一个面的网格；
+    // 因此逐个形状剖分，由BRepMesh在形状内部按面并行
+    for (size_t i = 0; i < aShapes.size(); ++i)
+        BRepMesh_IncrementalMesh(aShapes[i], aDeflection, Standard_False, anAngle, Standard_True);
+
+    // 显示直接使用新的三角网格，不再按对象自身的精度重新剖分
+    foreach (const Handle(AIS_Shape) &anObj, aMeshed)
+    {
+        anObj->Attributes()->SetAutoTriangulation(Standard_False);
+        myContext->Redisplay(anObj, Standard_False);
+    }
+    myIsDirty = true;
+
+    QJsonObject aResult;
+    aResult["ok"]     = true;
+    aResult["shapes"]  = (int)aShapes.size();
+    aResult["skipped"] = aNbSkipped;
+    return aResult;
+}
+
+QJsonObject CommandServer::material(const QJsonObject &theRequest)
+{
+    QList<Handle(AIS_Shape)> anObjects;
+    QString                  anError;
+    if (!objects(theRequest, anObjects, anError))
+        return failure(anError);
+
+    const QString aName = theRequest.value("name").toString();
+    if (!aName.isEmpty() && !myView->getMaterials().Contains(aName))
+        return failure("unknown material: " + aName);
+
+    foreach (const Handle(AIS_Shape) &anObj, anObjects)
+        myView->assignMaterial(anObj, aName);
+    myIsDirty = true;
+
+    QJsonObject aResult;
+    aResult["ok"] = true;
+    return aResult;
+}
+
+QJsonObject CommandServer::color(const QJsonObject &theRequest)
+{
+    const int anId = theRequest.value("object").toInt();
+    if (!myObjects.contains(anId))
+        return failure(QString("unknown object %1").arg(anId));
+
+    const Handle(AIS_ColoredShape) anObj = Handle(AIS_ColoredShape)::DownCast(myObjects[anId]);
+    if (anObj.IsNull())
+        return failure(QString("object %1 does not support face colors").arg(anId));
+
+    // 面编号与TopologyGraph一致，缺省为全部面
+    const Handle(TopologyGraph) & aGraph = myView->getTopology(anObj);
+    std::vector<TopoDS_Shape> aFaces;
+    if (theRequest.contains("faces"))
+    {
+        foreach (const QJsonValue &aFace, theRequest.value("faces").toArray())
+        {
+            if (aFace.toInt(-1) < 0 || aFace.toInt(-1) >= aGraph->NbFaces())
+                return failure(QString("unknown face %1").arg(aFace.toInt(-1)));
+            aFaces.push_back(aGraph->Face(aFace.toInt()));
+        }
+    }
+    else
+    {
+        for (Standard_Integer i = 0; i < aGraph->NbFaces(); ++i)
+            aFaces.push_back(aGraph->Face(i));
+    }
+
+    QJsonObject aResult;
+    aResult["ok"]    = true;
+    aResult["faces"] = (int)aFaces.size();
+    if (!theRequest.contains("rgb"))
+    {
+        FaceStyler::Reset(myContext, anObj, aFaces);
+        myIsDirty = true;
+        return aResult;
+    }
+
+    const QJsonArray aRgb = theRequest.value("rgb").toArray();
+    if (aRgb.size() != 3)
+        return failure("rgb must have 3 components");
+    const Standard_Real aTransparency = theRequest.value("transparency").toDouble(0.0);
+    if (aTransparency < 0.0 || aTransparency > 1.0)
+        return failure("transparency must be in [0, 1]");
+
+    const Quantity_Color aColor(aRgb[0].toDouble(), aRgb[1].toDouble(), aRgb[2].toDouble(), Quantity_TOC_RGB);
+    aResult["recomputed"] = FaceStyler::Apply(myContext, anObj, aFaces, aColor, aTransparency);
+    myIsDirty             = true;
+    return aResult;
+}
+
+QJsonObject CommandServer::boolean(const QJsonObject &theRequest)
+{
+    const QString anOpName = theRequest.value("op").toString("cut");
+    BooleanService::Operation anOp;
+    if (anOpName == "fuse")
+        anOp = BooleanService::Operation_Fuse;
+    else if (anOpName == "cut")
+        anOp = BooleanService::Operation_Cut;
+    else if (anOpName == "common")
+        anOp = BooleanService::Operation_Common;
+    else
+        return failure("unknown boolean operation: " + anOpName);
+
+    const double aFuzzy = theRequest.value("fuzzy").toDouble(0.0);
+    if (aFuzzy < 0.0)
+        return failure("fuzzy must not be negative");
+
+    // 每一组的第一个为对象，其余为工具；各组相互独立，并发执行
+    QList<BooleanService::Request> aRequests;
+    QList<QList<int>>              aGroups;
+    foreach (const QJsonValue &aGroup, theRequest.value("groups").toArray())
+    {
+        QList<int> anIds;
+        foreach (const QJsonValue &anId, aGroup.toArray())
+        {
+            if (!myObjects.contains(anId.toInt(-1)))
+                return failure(QString("unknown object %1").arg(anId.toInt(-1)));
+            anIds.append(anId.toInt());
+        }
+        if (anIds.size() < 2)
+            return failure("each group needs an object and at least one tool");
+
+        BooleanService::Request aRequest;
+        aRequest.Op          = anOp;
+        aRequest.Object      = myObjects[anIds[0]];
+        aRequest.ToKeepTools = theRequest.value("keep_tools").toBool(false);
+        for (int i = 1; i < anIds.size(); ++i)
+            aRequest.Tools.append(myObjects[anIds[i]]);
+        aRequests.append(aRequest);
+        aGroups.append(anIds);
+    }
+    if (aRequests.isEmpty())
+        return failure("missing groups");
+
+    BooleanService *aService = myView->getBooleans();
+    const double    aFormer  = aService->FuzzyValue();
+    aService->SetFuzzyValue(aFuzzy);
+    const QList<int> aJobs = aService->SubmitBatch(aRequests);
+    aService->SetFuzzyValue(aFormer);
+    aService->waitForDone();
+
+    // 被结果替换的输入不再有id
+    QJsonArray anIds;
+    int        aNbFailed = 0;
+    for (int i = 0; i < aJobs.size(); ++i)
+    {
+        const Handle(AIS_Shape) anOutput = aService->Output(aJobs[i]);
+        if (anOutput.IsNull())
+        {
+            anIds.append(-1);
+            ++aNbFailed;
+            continue;
+        }
+
+        myObjects.remove(aGroups[i][0]);
+        for (int j = 1; j < aGroups[i].size() && !aRequests[i].ToKeepTools; ++j)
+            myObjects.remove(aGroups[i][j]);
+        myObjects.insert(myNextId, anOutput);
+        anIds.append(myNextId++);
+    }
+    myIsDirty = true;
+
+    QJsonObject aResult;
+    aResult["ok"]     = aNbFailed == 0;
+    aResult["ids"]    = anIds;
+    aResult["failed"] = aNbFailed;
+    if (aNbFailed > 0)
+        aResult["error"] = QString("%1 of %2 operations failed").arg(aNbFailed).arg(aJobs.size());
+    return aResult;
+}
+
+QJsonObject CommandServer::dump(const QJsonObject &theRequest)
+{
+    const QString aFile = theRequest.value("file").toString();
+    if (aFile.isEmpty())
+        return failure("missing file");
+
+    // 导出前先完成本批之前的请求对显示的修改
+    if (myIsDirty)
+    {
+        myContext->UpdateCurrentViewer();
+        myIsDirty = false;
+    }
+
+    const int aWidth  = theRequest.value("width").toInt();
+    const int aHeight = theRequest.value("height").toInt();
+    const bool isOk   = aWidth > 0 && aHeight > 0 ? myView->dumpTiled(aFile, aWidth, aHeight)
+                                                  : myView->dump(aFile.toUtf8().data());
+    if (!isOk)
+        return failure("cannot write " + aFile);
+
+    QJsonObject aResult;
+    aResult["ok"] = true;
+    return aResult;
+}
+
+QJsonObject CommandServer::props(const QJsonObject &theRequest)
+{
+    const int anId = theRequest.value("object").toInt();
+    if (!myObjects.contains(anId))
+        return failure(QString("unknown object %1").arg(anId));
+
+    const Handle(AIS_Shape) &anObj   = myObjects[anId];
+    const TopoDS_Shape &     aShape  = anObj->Shape();
+
+    GProp_GProps aVolume, anArea;
+    BRepGProp::VolumeProperties(aShape, aVolume);
+    BRepGProp::SurfaceProperties(aShape, anArea);
+
+    Bnd_Box aBox;
+    BRepBndLib::Add(aShape, aBox);
+
+    std::vector<Standard_Integer> aLabels;
+    const Handle(TopologyGraph) & aGraph = myView->getTopology(anObj);
+
+    QJsonObject aResult;
+    aResult["ok"]         = true;
+    aResult["volume"]     = aVolume.Mass();
+    aResult["area"]       = anArea.Mass();
+    aResult["faces"]      = aGraph->NbFaces();
+    aResult["components"] = aGraph->Components(aLabels);
+    aResult["material"]   = myView->getMaterials().Assigned(anObj);
+    if (!aBox.IsVoid())
+    {
+        Standard_Real aXmin, aYmin, aZmin, aXmax, aYmax, aZmax;
+        aBox.Get(aXmin, aYmin, aZmin, aXmax, aYmax, aZmax);
+        aResult["bbox"] = QJsonArray({ aXmin, aYmin, aZmin, aXmax, aYmax, aZmax });
+    }
+    return aResult;
+}
+
+QJsonObject CommandServer::list()
+{
+    QJsonArray anIds;
+    for (QMap<int, Handle(AIS_Shape)>::const_iterator anIter = myObjects.begin(); anIter != myObjects.end(); ++anIter)
+        anIds.append(anIter.key());
+
+    QJsonObject aResult;
+    aResult["ok"]  = true;
+    aResult["ids"] = anIds;
+    return aResult;
+}
+
+QJsonObject CommandServer::clear()
+{
+    foreach (const Handle(AIS_Shape) &anObj, myObjects)
+        myView->removeShape(anObj, false);
+    myObjects.clear();
+    myIsDirty = true;
+
+    QJsonObject aResult;
+    aResult["ok"] = true;
+    return aResult;
+}
+
+QJsonObject CommandServer::stats()
+{
+    QJsonObject aResult;
+    aResult["ok"]        = true;
+    aResult["requests"]  = myNbRequests;
+    aResult["objects"]   = myObjects.size();
+    aResult["files"]     = myFiles.size();
+    aResult["uptime_ms"] = myUptime.elapsed();
+    return aResult;
+}
+
+bool CommandServer::objects(const QJsonObject &theRequest, QList<Handle(AIS_Shape)> &theObjects, QString &theError) const
+{
+    if (!theRequest.contains("ids"))
+    {
+        theObjects = myObjects.values();
+        return true;
+    }
+
+    foreach (const QJsonValue &anId, theRequest.value("ids").toArray())
+    {
+        if (!myObjects.contains(anId.toInt()))
+        {
+            theError = QString("unknown object %1").arg(anId.toInt());
+            return false;
+        }
+        theObjects.append(myObjects.value(anId.toInt()));
+    }
+    return true;
+}
@@ -0,0 +1,113 @@
+#ifndef COMMANDSERVER_H
+#define COMMANDSERVER_H
+
+#include <vector>
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QMap>
+#include <QObject>
+
+#include <AIS_InteractiveContext.hxx>
+#include <AIS_Shape.hxx>
+#include <TopTools_HSequenceOfShape.hxx>
+
+#include "ShapeHealer.h"
+
+class ModelView;
+class QLocalServer;
+class QLocalSocket;
+
+/// \brief CommandServer
+///
+/// 常驻模式(OpenCascade_Learn --server)的本地命令接口。监听本地套接字(Unix domain socket)，
+/// 命令在已经初始化的AIS_InteractiveContext上执行，省去每个批处理任务的启动和重复导入。
+///
+/// 协议为换行分隔的JSON，每行一个请求，应答同样一行一个，带回请求的id。id只用于客户端对应请求与应答，
+/// 命令操作的对象由object(单个)或ids(多个)给出：
+///
+///     {"id": 1, "cmd": "load", "file": "a.step"}
+///     {"id": 1, "ok": true, "ids": [1, 2], "ms": 35.2}
+///     {"id": 2, "cmd": "props", "object": 1}
+///
+/// 客户端可以连续发送多个请求而不等待应答(流水线)。每次可读时，缓冲区中所有完整的请求依次执行，
+/// 应答合并为一次写出，整批请求结束后才更新一次视图。
+///
+/// 命令:
+/// - ping
+/// - load {file, material?, heal?}: 导入STEP并显示(AIS_ColoredShape)，返回对象id；同一文件未修改时直接使用缓存的形状。
+///   heal为true时导入后修复(见ShapeHealer)，修复结果缓存在磁盘上，应答附带各部件的诊断(heal)以及是否命中缓存
+/// - mesh {ids?, deflection?, angle?}: 重新剖分(ids缺省为全部对象)，逐个形状剖分、形状内部按面并行；
+///   由网格外存管理的对象被跳过，结果中的skipped为其数目
+/// - material {ids?, name}: 分配材质，name为空时取消
+/// - color {object, faces?, rgb?, transparency?}: 设置面的颜色，faces为面编号(见TopologyGraph)，缺省为全部面，
+///   缺少rgb时取消面的颜色；整批面只刷新一次显示
+/// - boolean {op, groups, fuzzy?, keep_tools?}: 布尔运算(fuse/cut/common)，groups的每一组为[对象, 工具...]，
+///   各组并发执行，结果替换输入，返回结果对象的id(失败的组为-1)
+/// - dump {file, width?, height?}: 导出当前视图，给出尺寸时分块导出
+/// - props {object}: 体积、面积、包围盒、面数、连通分量数(按共边)、材质
+/// - list: 全部对象id
+/// - clear: 移除全部对象(形状缓存保留)
+/// - stats: 请求数、缓存的文件数、运行时间
+class CommandServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    //! 默认的本地套接字名
+    static const char *const THE_DEFAULT_NAME;
+
+    CommandServer(const Handle(AIS_InteractiveContext) & theContext, ModelView *theView, QObject *parent = nullptr);
+    ~CommandServer();
+
+    /// \brief 开始监听，theName为本地套接字名(或路径)，已存在的同名残留套接字会被移除
+    bool Listen(const QString &theName);
+
+    QString ServerName() const;
+
+    /// \brief 执行一个请求，不更新视图。应答包含请求的id、ok以及出错时的error
+    QJsonObject Execute(const QJsonObject &theRequest);
+
+    int NbObjects() const { return myObjects.size(); }
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+
+private:
+    struct CachedFile
+    {
+        QDateTime                         Modified;
+        Handle(TopTools_HSequenceOfShape) Shapes;
+        std::vector<ShapeHealer::Report>  Reports;
+        bool                              IsHealCached;
+    };
+
+    QJsonObject load(const QJsonObject &theRequest);
+    QJsonObject mesh(const QJsonObject &theRequest);
+    QJsonObject material(const QJsonObject &theRequest);
+    QJsonObject color(const QJsonObject &theRequest);
+    QJsonObject boolean(const QJsonObject &theRequest);
+    QJsonObject dump(const QJsonObject &theRequest);
+    QJsonObject props(const QJsonObject &theRequest);
+    QJsonObject list();
+    QJsonObject clear();
+    QJsonObject stats();
+
+    /// \brief 请求中的ids，缺省时为全部对象；存在未知id时返回false
+    bool objects(const QJsonObject &theRequest, QList<Handle(AIS_Shape)> &theObjects, QString &theError) const;
+
+    Handle(AIS_InteractiveContext) myContext;
+    ModelView *                    myView;
+    QLocalServer *                 myServer;
+    QMap<int, Handle(AIS_Shape)>   myObjects;
+    QMap<QString, CachedFile>      myFiles;    ///< 键为文件路径，修复过的另加"|heal"
+    ShapeHealer                    myHealer;
+    int                            myNextId;
+    qint64                         myNbRequests;
+    bool                           myIsDirty;    ///< 本批请求改变了显示，结束后更新视图
+    QElapsedTimer                  myUptime;
+};
+
+#endif    // COMMANDSERVER_H
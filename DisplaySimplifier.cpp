@@ -0,0 +1,537 @@
+#include "DisplaySimplifier.h"
+
+#include <QElapsedTimer>
+
+#include <numeric>
+
+#include <BRepAdaptor_Surface.hxx>
+#include <BRepAlgoAPI_Defeaturing.hxx>
+#include <BRepGProp.hxx>
+#include <BRepMesh_IncrementalMesh.hxx>
+#include <BRepTools_ReShape.hxx>
+#include <BRep_Tool.hxx>
+#include <GProp_GProps.hxx>
+#include <OSD_Parallel.hxx>
+#include <Poly_Triangulation.hxx>
+#include <Prs3d_Drawer.hxx>
+#include <Standard_Failure.hxx>
+#include <StdPrs_ShadedShape.hxx>
+#include <StdPrs_ToolTriangulatedShape.hxx>
+#include <StdPrs_WFShape.hxx>
+#include <TopExp.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopTools_IndexedDataMapOfShapeListOfShape.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
+#include <TopTools_ListOfShape.hxx>
+#include <TopoDS.hxx>
+#include <V3d_View.hxx>
+#include <V3d_Viewer.hxx>
+
+
+namespace
+{
+    //! 面积超过实体总面积这一比例的面不当作特征(例如细轴的圆柱面本身)
+    const Standard_Real THE_MAX_FEATURE_AREA = 0.1;
+
+    /// \brief 简化形状的显示，共享源对象的显示属性，不参与选择
+    class DisplayProxy : public AIS_InteractiveObject
+    {
+    public:
+        DisplayProxy(const TopoDS_Shape &theShape, const Handle(AIS_Shape) & theSource)
+            : myShape(theShape)
+        {
+            SetAttributes(theSource->Attributes());
+            SetLocalTransformation(theSource->LocalTransformation());
+        }
+
+        virtual Standard_Boolean AcceptDisplayMode(const Standard_Integer theMode) const Standard_OVERRIDE
+        {
+            return theMode == AIS_WireFrame || theMode == AIS_Shaded;
+        }
+
+        DEFINE_STANDARD_RTTI_INLINE(DisplayProxy, AIS_InteractiveObject)
+
+    protected:
+        virtual void Compute(const Handle(PrsMgr_PresentationManager3d) &, const Handle(Prs3d_Presentation) & thePrs,
+                             const Standard_Integer theMode) Standard_OVERRIDE
+        {
+            if (theMode == AIS_Shaded)
+                StdPrs_ShadedShape::Add(thePrs, myShape, myDrawer);
+            else
+                StdPrs_WFShape::Add(thePrs, myShape, myDrawer);
+        }
+
+        virtual void ComputeSelection(const Handle(SelectMgr_Selection) &, const Standard_Integer) Standard_OVERRIDE {}
+
+    private:
+        TopoDS_Shape myShape;
+    };
+
+    //! 一个实体的去特征
+    struct Part
+    {
+        size_t           Shape;
+        TopoDS_Shape     Input;
+        TopoDS_Shape     Output;
+        Standard_Integer NbRemoved;
+        Standard_Integer NbFailed;
+    };
+
+    //! 面的特征尺寸：圆柱、球按半径，圆环按小半径，其余按2 x 面积/周长(细长条带的宽度、圆面的半径)
+    Standard_Real featureSize(const TopoDS_Face &theFace, const Standard_Real theArea)
+    {
+        BRepAdaptor_Surface aSurface(theFace, Standard_False);
+        switch (aSurface.GetType())
+        {
+            case GeomAbs_Cylinder:
+                return aSurface.Cylinder().Radius();
+            case GeomAbs_Sphere:
+                return aSurface.Sphere().Radius();
+            case GeomAbs_Torus:
+                return aSurface.Torus().MinorRadius();
+            default:
+                break;
+        }
+
+        GProp_GProps aProps;
+        BRepGProp::LinearProperties(theFace, aProps);
+        return aProps.Mass() > 0.0 ? 2.0 * theArea / aProps.Mass() : 0.0;
+    }
+
+    TopTools_IndexedMapOfShape featureFaces(const TopoDS_Shape &theSolid, const Standard_Real theSize)
+    {
+        TopTools_IndexedMapOfShape aFaces;
+        TopExp::MapShapes(theSolid, TopAbs_FACE, aFaces);
+
+        std::vector<Standard_Real> anAreas(aFaces.Extent());
+        Standard_Real              aTotal = 0.0;
+        for (Standard_Integer i = 1; i <= aFaces.Extent(); ++i)
+        {
+            GProp_GProps aProps;
+            BRepGProp::SurfaceProperties(aFaces(i), aProps);
+            anAreas[i - 1] = aProps.Mass();
+            aTotal += aProps.Mass();
+        }
+
+        TopTools_IndexedMapOfShape aFeatures;
+        for (Standard_Integer i = 1; i <= aFaces.Extent(); ++i)
+        {
+            const Standard_Real anArea = anAreas[i - 1];
+            if (anArea < THE_MAX_FEATURE_AREA * aTotal && featureSize(TopoDS::Face(aFaces(i)), anArea) < theSize)
+                aFeatures.Add(aFaces(i));
+        }
+        return aFeatures;
+    }
+
+    //! 按共边把特征面分组，每组是一个特征(一条圆角链、一个孔)
+    std::vector<TopTools_ListOfShape> featureGroups(const TopoDS_Shape &theSolid, const TopTools_IndexedMapOfShape &theFaces)
+    {
+        std::vector<Standard_Integer> aParents(theFaces.Extent());
+        std::iota(aParents.begin(), aParents.end(), 0);
+        auto aRoot = [&aParents](Standard_Integer i) {
+            while (aParents[i] != i)
+                i = aParents[i] = aParents[aParents[i]];
+            return i;
+        };
+
+        TopTools_IndexedDataMapOfShapeListOfShape anEdgeFaces;
+        TopExp::MapShapesAndUniqueAncestors(theSolid, TopAbs_EDGE, TopAbs_FACE, anEdgeFaces);
+        for (Standard_Integer e = 1; e <= anEdgeFaces.Extent(); ++e)
+        {
+            Standard_Integer aFirst = -1;
+            for (TopTools_ListOfShape::Iterator anIter(anEdgeFaces(e)); anIter.More(); anIter.Next())
+            {
+                const Standard_Integer aFace = theFaces.FindIndex(anIter.Value()) - 1;
+                if (aFace < 0)
+                    continue;
+                if (aFirst < 0)
+                    aFirst = aFace;
+                else
+                    aParents[aRoot(aFace)] = aRoot(aFirst);
+            }
+        }
+
+        std::vector<TopTools_ListOfShape> aGroups;
+        std::vector<Standard_Integer>     aGroupOf(theFaces.Extent(), -1);
+        for (Standard_Integer i = 0; i < theFaces.Extent(); ++i)
+        {
+            const Standard_Integer r = aRoot(i);
+            if (aGroupOf[r] < 0)
+            {
+                aGroupOf[r] = (Standard_Integer)aGroups.size();
+                aGroups.push_back(TopTools_ListOfShape());
+            }
+            aGroups[aGroupOf[r]].Append(theFaces(i + 1));
+        }
+        return aGroups;
+    }
+
+    bool removeFaces(const TopoDS_Shape &theSolid, const TopTools_ListOfShape &theFaces, const bool toFillHistory,
+                     BRepAlgoAPI_Defeaturing &theAlgo)
+    {
+        try
+        {
+            theAlgo.SetShape(theSolid);
+            theAlgo.AddFacesToRemove(theFaces);
+            theAlgo.SetRunParallel(Standard_False);
+            theAlgo.SetToFillHistory(toFillHistory ? Standard_True : Standard_False);
+            theAlgo.Build();
+            return theAlgo.IsDone() && !theAlgo.HasErrors();
+        }
+        catch (const Standard_Failure &)
+        {
+            return false;
+        }
+    }
+
+    void defeature(Part &thePart, const Standard_Real theSize)
+    {
+        thePart.Output = thePart.Input;
+
+        const TopTools_IndexedMapOfShape aFeatures = featureFaces(thePart.Input, theSize);
+        if (aFeatures.IsEmpty())
+            return;
+
+        TopTools_ListOfShape anAll;
+        for (Standard_Integer i = 1; i <= aFeatures.Extent(); ++i)
+            anAll.Append(aFeatures(i));
+
+        BRepAlgoAPI_Defeaturing anAlgo;
+        if (removeFaces(thePart.Input, anAll, false, anAlgo))
+        {
+            thePart.Output    = anAlgo.Shape();
+            thePart.NbRemoved = aFeatures.Extent();
+            return;
+        }
+
+        // 整组失败：逐个特征移除，之后的特征面按历史映射到当前形状
+        std::vector<TopTools_ListOfShape> aGroups = featureGroups(thePart.Input, aFeatures);
+        for (size_t g = 0; g < aGroups.size(); ++g)
+        {
+            const Standard_Integer aNbFaces = aGroups[g].Extent();
+            if (aGroups[g].IsEmpty())
+                continue;
+
+            BRepAlgoAPI_Defeaturing aStep;
+            if (!removeFaces(thePart.Output, aGroups[g], true, aStep))
+            {
+                thePart.NbFailed += aNbFaces;
+                continue;
+            }
+
+            for (size_t h = g + 1; h < aGroups.size(); ++h)
+            {
+                TopTools_ListOfShape aTracked;
+                for (TopTools_ListOfShape::Iterator anIter(aGroups[h]); anIter.More(); anIter.Next())
+                {
+                    if (aStep.IsDeleted(anIter.Value()))
+                        continue;
+
+                    const TopTools_ListOfShape &aModified = aStep.Modified(anIter.Value());
+                    if (aModified.IsEmpty())
+                        aTracked.Append(anIter.Value());
+                    for (TopTools_ListOfShape::Iterator aNew(aModified); aNew.More(); aNew.Next())
+                        aTracked.Append(aNew.Value());
+                }
+                aGroups[h] = aTracked;
+            }
+            thePart.Output = aStep.Shape();
+            thePart.NbRemoved += aNbFaces;
+        }
+    }
+
+    //! theShapes中全部实体并行去特征，结果替换回各自的形状
+    void simplifyShapes(std::vector<TopoDS_Shape> &theShapes, const Standard_Real theSize, std::vector<Part> &theParts)
+    {
+        for (size_t i = 0; i < theShapes.size(); ++i)
+        {
+            TopTools_IndexedMapOfShape aSolids;
+            TopExp::MapShapes(theShapes[i], TopAbs_SOLID, aSolids);
+            for (Standard_Integer j = 1; j <= aSolids.Extent(); ++j)
+            {
+                Part aPart;
+                aPart.Shape     = i;
+                aPart.Input     = aSolids(j);
+                aPart.NbRemoved = 0;
+                aPart.NbFailed  = 0;
+                theParts.push_back(aPart);
+            }
+        }
+
+        OSD_Parallel::For(0, (Standard_Integer)theParts.size(),
+                          [&](const Standard_Integer theIndex) { defeature(theParts[theIndex], theSize); });
+
+        for (size_t i = 0; i < theParts.size();)
+        {
+            const size_t              aShape    = theParts[i].Shape;
+            Handle(BRepTools_ReShape) aReShape  = new BRepTools_ReShape();
+            bool                      isWhole   = false;
+            bool                      isChanged = false;
+            for (; i < theParts.size() && theParts[i].Shape == aShape; ++i)
+            {
+                if (theParts[i].NbRemoved == 0)
+                    continue;
+
+                isChanged = true;
+                isWhole   = theParts[i].Input.IsSame(theShapes[aShape]);
+                if (isWhole)
+                    theShapes[aShape] = theParts[i].Output;
+                else
+                    aReShape->Replace(theParts[i].Input, theParts[i].Output);
+            }
+            if (isChanged && !isWhole)
+                theShapes[aShape] = aReShape->Apply(theShapes[aShape]);
+        }
+    }
+
+    qint64 nbTriangles(const TopoDS_Shape &theShape)
+    {
+        qint64 aNb = 0;
+        for (TopExp_Explorer anExp(theShape, TopAbs_FACE); anExp.More(); anExp.Next())
+        {
+            TopLoc_Location                   aLoc;
+            const Handle(Poly_Triangulation) &aTri = BRep_Tool::Triangulation(TopoDS::Face(anExp.Current()), aLoc);
+            if (!aTri.IsNull())
+                aNb += aTri->NbTriangles();
+        }
+        return aNb;
+    }
+
+    //! 设置对象全部显示结构的可见性，返回是否有变化
+    bool setVisible(const Handle(AIS_InteractiveObject) & theObject, const bool isVisible)
+    {
+        bool isChanged = false;
+        for (PrsMgr_Presentations::Iterator anIter(theObject->Presentations()); anIter.More(); anIter.Next())
+        {
+            const Handle(PrsMgr_Presentation) &aPrs = anIter.Value();
+            if ((aPrs->IsVisible() == Standard_True) != isVisible)
+            {
+                aPrs->SetVisible(isVisible ? Standard_True : Standard_False);
+                isChanged = true;
+            }
+        }
+        return isChanged;
+    }
+}    // namespace
+
+
+DisplaySimplifier::DisplaySimplifier(const Handle(AIS_InteractiveContext) & theContext)
+    : myContext(theContext)
+    , myFeatureSize(3.0)
+    , mySwitchPixels(2.0)
+    , myMode(Mode_Auto)
+{
+    updateStats();
+    myStats.BuildMs = 0.0;
+}
+
+TopoDS_Shape DisplaySimplifier::Simplify(const TopoDS_Shape &theShape, const Standard_Real theFeatureSize,
+                                         Standard_Integer &theNbRemoved)
+{
+    std::vector<TopoDS_Shape> aShapes(1, theShape);
+    std::vector<Part>         aParts;
+    simplifyShapes(aShapes, theFeatureSize, aParts);
+
+    theNbRemoved = 0;
+    for (size_t i = 0; i < aParts.size(); ++i)
+        theNbRemoved += aParts[i].NbRemoved;
+    return aShapes[0];
+}
+
+void DisplaySimplifier::Add(const std::vector<Handle(AIS_Shape)> &theShapes)
+{
+    QElapsedTimer aTimer;
+    aTimer.start();
+
+    std::vector<TopoDS_Shape> aShapes;
+    for (size_t i = 0; i < theShapes.size(); ++i)
+        aShapes.push_back(theShapes[i]->Shape());
+
+    std::vector<Part> aParts;
+    simplifyShapes(aShapes, myFeatureSize, aParts);
+
+    std::vector<Entry> anEntries(theShapes.size());
+    for (size_t i = 0; i < anEntries.size(); ++i)
+    {
+        anEntries[i].FeatureSize         = myFeatureSize;
+        anEntries[i].IsShown             = false;
+        anEntries[i].NbFacesRemoved      = 0;
+        anEntries[i].NbFailed            = 0;
+        anEntries[i].NbSolids            = 0;
+        anEntries[i].TrianglesExact      = 0;
+        anEntries[i].TrianglesSimplified = 0;
+    }
+    for (size_t i = 0; i < aParts.size(); ++i)
+    {
+        Entry &anEntry = anEntries[aParts[i].Shape];
+        anEntry.NbFacesRemoved += aParts[i].NbRemoved;
+        anEntry.NbFailed += aParts[i].NbFailed;
+        ++anEntry.NbSolids;
+    }
+
+    // 精确与简化形状按源对象的显示精度剖分(已经剖分过的精确形状不再重复)，统计三角形数
+    std::vector<Standard_Real> aDeflections(theShapes.size());
+    std::vector<Standard_Real> anAngles(theShapes.size());
+    for (size_t i = 0; i < theShapes.size(); ++i)
+    {
+        const Handle(Prs3d_Drawer) &aDrawer = theShapes[i]->Attributes();
+        aDeflections[i]                     = StdPrs_ToolTriangulatedShape::GetDeflection(theShapes[i]->Shape(), aDrawer);
+        anAngles[i]                         = aDrawer->DeviationAngle();
+    }
+    // 对象之间可能共享TShape(装配实例)，简化形状也沿用未修改的面，不同对象并行剖分会同时写同一个面的网格；
+    // 因此逐个对象剖分，由BRepMesh在对象内部按面并行
+    for (size_t i = 0; i < theShapes.size(); ++i)
+    {
+        if (anEntries[i].NbFacesRemoved == 0)
+            continue;
+
+        BRepMesh_IncrementalMesh(theShapes[i]->Shape(), aDeflections[i], Standard_False, anAngles[i], Standard_True);
+        BRepMesh_IncrementalMesh(aShapes[i], aDeflections[i], Standard_False, anAngles[i], Standard_True);
+    }
+    OSD_Parallel::For(0, (Standard_Integer)theShapes.size(), [&](const Standard_Integer i) {
+        if (anEntries[i].NbFacesRemoved == 0)
+            return;
+
+        anEntries[i].TrianglesExact      = nbTriangles(theShapes[i]->Shape());
+        anEntries[i].TrianglesSimplified = nbTriangles(aShapes[i]);
+    });
+
+    for (size_t i = 0; i < theShapes.size(); ++i)
+    {
+        release(theShapes[i]);
+        if (anEntries[i].NbFacesRemoved == 0)
+            continue;
+
+        anEntries[i].Proxy = new DisplayProxy(aShapes[i], theShapes[i]);
+        myEntries.Bind(theShapes[i], anEntries[i]);
+    }
+
+    updateStats();
+    myStats.BuildMs = aTimer.nsecsElapsed() / 1.0e6;
+}
+
+void DisplaySimplifier::Remove(const Handle(AIS_Shape) & theShape)
+{
+    if (release(theShape))
+        updateStats();
+}
+
+bool DisplaySimplifier::release(const Handle(AIS_Shape) & theShape)
+{
+    if (!myEntries.IsBound(theShape))
+        return false;
+
+    const Entry &anEntry = myEntries.Find(theShape);
+    if (anEntry.IsShown)
+        setVisible(theShape, true);
+    myContext->Remove(anEntry.Proxy, Standard_False);
+    myEntries.UnBind(theShape);
+    return true;
+}
+
+void DisplaySimplifier::Clear()
+{
+    for (EntryMap::Iterator anIter(myEntries); anIter.More(); anIter.Next())
+    {
+        if (anIter.Value().IsShown)
+            setVisible(anIter.Key(), true);
+        myContext->Remove(anIter.Value().Proxy, Standard_False);
+    }
+    myEntries.Clear();
+    updateStats();
+}
+
+Standard_Integer DisplaySimplifier::NbShown() const
+{
+    Standard_Integer aNb = 0;
+    for (EntryMap::Iterator anIter(myEntries); anIter.More(); anIter.Next())
+    {
+        if (anIter.Value().IsShown)
+            ++aNb;
+    }
+    return aNb;
+}
+
+Standard_Real DisplaySimplifier::pixelSize() const
+{
+    Standard_Real             aSize   = 0.0;
+    const Handle(V3d_Viewer) &aViewer = myContext->CurrentViewer();
+    for (V3d_ListOfView::Iterator anIter(aViewer->ActiveViews()); anIter.More(); anIter.Next())
+    {
+        const Handle(V3d_View) &aView = anIter.Value();
+        if (!aView->View()->IsActive() || aView->Window().IsNull())
+            continue;
+
+        const Standard_Real aPixel = aView->Convert(1);
+        if (aPixel > 0.0 && (aSize == 0.0 || aPixel < aSize))
+            aSize = aPixel;
+    }
+    return aSize;
+}
+
+bool DisplaySimplifier::UpdateView()
+{
+    if (myEntries.IsEmpty())
+        return false;
+
+    const Standard_Real                 aPixel    = myMode == Mode_Auto ? pixelSize() : 0.0;
+    const Handle(AIS_InteractiveObject) aDetected = myContext->HasDetected() ? myContext->DetectedInteractive()
+                                                                            : Handle(AIS_InteractiveObject)();
+
+    bool isChanged = false;
+    for (EntryMap::Iterator anIter(myEntries); anIter.More(); anIter.Next())
+    {
+        const Handle(AIS_Shape) &aShape  = anIter.Key();
+        Entry &                  anEntry = anIter.ChangeValue();
+
+        bool toSimplify = myMode == Mode_Simplified
+                          || (myMode == Mode_Auto && aPixel > 0.0 && anEntry.FeatureSize < mySwitchPixels * aPixel);
+        toSimplify = toSimplify && myContext->IsDisplayed(aShape) && !myContext->IsSelected(aShape) && aShape != aDetected;
+        if (show(aShape, anEntry, toSimplify))
+            isChanged = true;
+    }
+    return isChanged;
+}
+
+bool DisplaySimplifier::show(const Handle(AIS_Shape) & theShape, Entry &theEntry, const bool toSimplify)
+{
+    if (theEntry.IsShown == toSimplify)
+    {
+        // 源对象重新计算(例如改变颜色)后显示结构恢复可见，再次隐藏
+        return toSimplify && setVisible(theShape, false);
+    }
+
+    if (toSimplify)
+    {
+        theEntry.Proxy->SetLocalTransformation(theShape->LocalTransformation());
+        myContext->Display(theEntry.Proxy, theShape->DisplayMode(), -1, Standard_False);
+        setVisible(theShape, false);
+    }
+    else
+    {
+        // 代理只是隐藏，显示结构保留，下次切换时不再重新计算
+        myContext->Erase(theEntry.Proxy, Standard_False);
+        setVisible(theShape, true);
+    }
+    theEntry.IsShown = toSimplify;
+    return true;
+}
+
+void DisplaySimplifier::updateStats()
+{
+    myStats.NbObjects           = myEntries.Extent();
+    myStats.NbSolids            = 0;
+    myStats.NbFacesRemoved      = 0;
+    myStats.NbFailed            = 0;
+    myStats.TrianglesExact      = 0;
+    myStats.TrianglesSimplified = 0;
+    for (EntryMap::Iterator anIter(myEntries); anIter.More(); anIter.Next())
+    {
+        const Entry &anEntry = anIter.Value();
+        myStats.NbSolids += anEntry.NbSolids;
+        myStats.NbFacesRemoved += anEntry.NbFacesRemoved;
+        myStats.NbFailed += anEntry.NbFailed;
+        myStats.TrianglesExact += anEntry.TrianglesExact;
+        myStats.TrianglesSimplified += anEntry.TrianglesSimplified;
+    }
+}
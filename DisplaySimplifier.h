@@ -0,0 +1,117 @@
+#ifndef DISPLAYSIMPLIFIER_H
+#define DISPLAYSIMPLIFIER_H
+
+#include <vector>
+
+#include <QtGlobal>
+
+#include <AIS_InteractiveContext.hxx>
+#include <AIS_Shape.hxx>
+#include <NCollection_DataMap.hxx>
+#include <TColStd_MapTransientHasher.hxx>
+#include <TopoDS_Shape.hxx>
+
+/// \brief DisplaySimplifier
+///
+/// 只用于显示的去特征简化。小圆角、倒角和孔占了模型的大部分三角形，看整个装配时却看不出来：
+///
+/// - 每个实体中特征尺寸小于FeatureSize的面(圆柱、球、圆环按半径，其余按2 x 面积/周长)
+///   由BRepAlgoAPI_Defeaturing移除，全部对象的实体并行(OSD_Parallel)处理；整组移除失败时
+///   按共边的特征逐个移除，仍然失败的特征保留
+/// - 简化形状由一个不参与选择的代理对象显示，共享源对象的显示属性和变换(面的单独颜色不保留)
+/// - 每次重绘前(见ModelView::paintEvent)按当前视图判断：所有视图中特征都小于SwitchPixels个像素时
+///   隐藏源对象的显示、显示代理；被选中或被检测到(鼠标悬停)的对象始终显示精确形状，
+///   选择、测量和高亮都使用源对象的精确B-rep
+class DisplaySimplifier
+{
+public:
+    enum Mode
+    {
+        Mode_Auto,          ///< 按视图的缩放切换
+        Mode_Exact,         ///< 总是显示精确形状
+        Mode_Simplified     ///< 总是显示简化形状(用于测量与测试)
+    };
+
+    struct Statistics
+    {
+        Standard_Integer NbObjects;              ///< 有简化形状的对象
+        Standard_Integer NbSolids;
+        Standard_Integer NbFacesRemoved;
+        Standard_Integer NbFailed;               ///< 没能移除的特征(面)
+        qint64           TrianglesExact;         ///< 精确形状的三角形数
+        qint64           TrianglesSimplified;
+        double           BuildMs;                ///< 最近一次Add的耗时(去特征与剖分)
+    };
+
+    explicit DisplaySimplifier(const Handle(AIS_InteractiveContext) & theContext);
+
+    /// \brief 被移除的特征尺寸上限(mm)，只影响之后的Add
+    void          SetFeatureSize(const Standard_Real theSize) { myFeatureSize = theSize; }
+    Standard_Real FeatureSize() const { return myFeatureSize; }
+
+    /// \brief 特征在屏幕上小于该像素数时显示简化形状
+    void SetSwitchPixels(const Standard_Real thePixels) { mySwitchPixels = thePixels; }
+
+    void SetMode(const Mode theMode) { myMode = theMode; }
+    Mode GetMode() const { return myMode; }
+
+    /// \brief 计算对象的简化形状并剖分，已有的被替换；没有可移除特征的对象不加入
+    void Add(const std::vector<Handle(AIS_Shape)> &theShapes);
+
+    /// \brief 移除对象的简化形状，源对象恢复显示，不更新视图
+    void Remove(const Handle(AIS_Shape) & theShape);
+    void Clear();
+
+    bool Contains(const Handle(AIS_Shape) & theShape) const { return myEntries.IsBound(theShape); }
+
+    /// \brief 当前显示代理的对象数
+    Standard_Integer NbShown() const;
+
+    /// \brief 每次重绘前调用，按视图和选择切换显示
+    ///
+    /// \return 显示有变化，视图需要整体重绘
+    bool UpdateView();
+
+    const Statistics &Stats() const { return myStats; }
+
+    /// \brief 移除theShape中特征尺寸小于theFeatureSize的面，各实体并行处理
+    ///
+    /// \param theNbRemoved，移除的面数
+    static TopoDS_Shape Simplify(const TopoDS_Shape &theShape, const Standard_Real theFeatureSize,
+                                 Standard_Integer &theNbRemoved);
+
+private:
+    struct Entry
+    {
+        Handle(AIS_InteractiveObject) Proxy;
+        Standard_Real                 FeatureSize;
+        bool                          IsShown;
+        Standard_Integer              NbFacesRemoved;
+        Standard_Integer              NbFailed;
+        Standard_Integer              NbSolids;
+        qint64                        TrianglesExact;
+        qint64                        TrianglesSimplified;
+    };
+
+    typedef NCollection_DataMap<Handle(AIS_Shape), Entry, TColStd_MapTransientHasher> EntryMap;
+
+    /// \brief 全部视图中一个像素对应的最小模型长度，没有可用的视图时为0
+    Standard_Real pixelSize() const;
+
+    /// \brief 移除对象的代理并恢复源对象的显示，不更新统计
+    bool release(const Handle(AIS_Shape) & theShape);
+
+    /// \brief 切换一个对象的显示，返回是否有变化
+    bool show(const Handle(AIS_Shape) & theShape, Entry &theEntry, const bool toSimplify);
+
+    void updateStats();
+
+    Handle(AIS_InteractiveContext) myContext;
+    EntryMap                       myEntries;
+    Standard_Real                  myFeatureSize;
+    Standard_Real                  mySwitchPixels;
+    Mode                           myMode;
+    Statistics                     myStats;
+};
+
+#endif    // DISPLAYSIMPLIFIER_H
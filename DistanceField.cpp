@@ -0,0 +1,618 @@
+#include "DistanceField.h"
+#include "ShapeUtils.h"
+
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <AIS_Shape.hxx>
+#include <BRepBndLib.hxx>
+#include <BRepClass3d_SolidClassifier.hxx>
+#include <BRepExtrema_TriangleSet.hxx>
+#include <BRepMesh_IncrementalMesh.hxx>
+#include <BRep_Tool.hxx>
+#include <Bnd_Box.hxx>
+#include <OSD_Parallel.hxx>
+#include <Precision.hxx>
+#include <StdPrs_ToolTriangulatedShape.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopoDS.hxx>
+
+
+namespace
+{
+    //! 每块的单元数(每个方向)，节点数为其加1
+    const Standard_Integer THE_BRICK      = 8;
+    const Standard_Integer THE_BRICK_NODE = THE_BRICK + 1;
+    const Standard_Integer THE_BRICK_SIZE = THE_BRICK_NODE * THE_BRICK_NODE * THE_BRICK_NODE;
+
+    //! 批量查询时每个并行任务处理的点数
+    const Standard_Integer THE_QUERY_CHUNK = 4096;
+
+    //! 点到三角形的最近距离的平方(Ericson, Real-Time Collision Detection 5.1.5)
+    Standard_Real pointTriangleSq(const BVH_Vec3d &p, const BVH_Vec3d &a, const BVH_Vec3d &b, const BVH_Vec3d &c)
+    {
+        const BVH_Vec3d ab = b - a;
+        const BVH_Vec3d ac = c - a;
+        const BVH_Vec3d ap = p - a;
+        const double    d1 = ab.Dot(ap);
+        const double    d2 = ac.Dot(ap);
+        if (d1 <= 0.0 && d2 <= 0.0)
+            return ap.Dot(ap);
+
+        const BVH_Vec3d bp = p - b;
+        const double    d3 = ab.Dot(bp);
+        const double    d4 = ac.Dot(bp);
+        if (d3 >= 0.0 && d4 <= d3)
+            return bp.Dot(bp);
+
+        const double vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+        {
+            const BVH_Vec3d q = ap - ab * (d1 / (d1 - d3));
+            return q.Dot(q);
+        }
+
+        const BVH_Vec3d cp = p - c;
+        const double    d5 = ab.Dot(cp);
+        const double    d6 = ac.Dot(cp);
+        if (d6 >= 0.0 && d5 <= d6)
+            return cp.Dot(cp);
+
+        const double vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+        {
+            const BVH_Vec3d q = ap - ac * (d2 / (d2 - d6));
+            return q.Dot(q);
+        }
+
+        const double va = d3 * d6 - d5 * d4;
+        if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0)
+        {
+            const BVH_Vec3d q = bp - (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+            return q.Dot(q);
+        }
+
+        const double    aDenom = 1.0 / (va + vb + vc);
+        const BVH_Vec3d q      = ap - ab * (vb * aDenom) - ac * (vc * aDenom);
+        return q.Dot(q);
+    }
+
+    Standard_Real pointBoxSq(const BVH_Vec3d &p, const BVH_Vec3d &theMin, const BVH_Vec3d &theMax)
+    {
+        Standard_Real aSq = 0.0;
+        for (int i = 0; i < 3; ++i)
+        {
+            const Standard_Real d = std::max(std::max(theMin[i] - p[i], p[i] - theMax[i]), 0.0);
+            aSq += d * d;
+        }
+        return aSq;
+    }
+
+    //! 在三角形集合的BVH上求点到表面的最近距离，theBound为已知的上界(可以是RealLast)
+    Standard_Real nearestDistance(const Handle(BRepExtrema_TriangleSet) & theSet, const BVH_Vec3d &p,
+                                  const Standard_Real theBound)
+    {
+        const opencascade::handle<BVH_Tree<Standard_Real, 3>> &aBVH = theSet->BVH();
+        if (aBVH.IsNull() || aBVH->Length() == 0)
+            return theBound;
+
+        Standard_Real    aBest = theBound < RealLast() ? theBound * theBound : RealLast();
+        // 深度优先遍历时栈中最多有Depth()+1个节点，按深度预留，栈满时扩容而不是跳过子节点
+        std::vector<Standard_Integer> aStack;
+        aStack.reserve(aBVH->Depth() + 2);
+        aStack.push_back(0);
+        while (!aStack.empty())
+        {
+            const Standard_Integer aNode = aStack.back();
+            aStack.pop_back();
+            if (pointBoxSq(p, aBVH->MinPoint(aNode), aBVH->MaxPoint(aNode)) >= aBest)
+                continue;
+
+            if (aBVH->IsOuter(aNode))
+            {
+                for (Standard_Integer i = aBVH->BegPrimitive(aNode); i <= aBVH->EndPrimitive(aNode); ++i)
+                {
+                    BVH_Vec3d a, b, c;
+                    theSet->GetVertices(i, a, b, c);
+                    aBest = std::min(aBest, pointTriangleSq(p, a, b, c));
+                }
+                continue;
+            }
+
+            // 近的子节点后入栈，先被处理
+            const Standard_Integer c0 = aBVH->Child<0>(aNode);
+            const Standard_Integer c1 = aBVH->Child<1>(aNode);
+            const Standard_Real    d0 = pointBoxSq(p, aBVH->MinPoint(c0), aBVH->MaxPoint(c0));
+            const Standard_Real    d1 = pointBoxSq(p, aBVH->MinPoint(c1), aBVH->MaxPoint(c1));
+            aStack.push_back(d0 < d1 ? c1 : c0);
+            aStack.push_back(d0 < d1 ? c0 : c1);
+        }
+        return std::sqrt(aBest);
+    }
+}    // namespace
+
+
+struct DistanceField::Grid
+{
+    TopoDS_Shape     Solid;
+    Standard_Real    Origin[3];
+    Standard_Real    Cell;
+    Standard_Integer Dims[3];      ///< 单元数，为THE_BRICK的整数倍
+    Standard_Integer Bricks[3];
+    Standard_Real    Max[3];       ///< 网格范围的上界
+
+    std::vector<Standard_Integer> BrickIndex;    ///< >=0为Nodes中的块序号，-1为只有块中心距离
+    std::vector<float>            Coarse;        ///< 每块中心的有向距离
+    std::vector<float>            Nodes;         ///< 窄带块的节点距离，每块THE_BRICK_SIZE个
+
+    qint64 MemoryBytes() const
+    {
+        return (qint64)(BrickIndex.size() * sizeof(Standard_Integer) + Coarse.size() * sizeof(float)
+                        + Nodes.size() * sizeof(float));
+    }
+
+    //! 点在网格中的有向距离，不在网格范围内时返回false
+    bool Sample(const Standard_Real p[3], float &theDist, bool &isFine) const
+    {
+        Standard_Real    u[3];
+        Standard_Integer c[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            u[i] = (p[i] - Origin[i]) / Cell;
+            if (u[i] < 0.0 || u[i] > Dims[i])
+                return false;
+            c[i] = std::min((Standard_Integer)u[i], Dims[i] - 1);
+        }
+
+        const Standard_Integer b[3]   = { c[0] / THE_BRICK, c[1] / THE_BRICK, c[2] / THE_BRICK };
+        const Standard_Integer anIdx  = BrickIndex[(b[2] * Bricks[1] + b[1]) * Bricks[0] + b[0]];
+        if (anIdx < 0)
+        {
+            theDist = Coarse[(b[2] * Bricks[1] + b[1]) * Bricks[0] + b[0]];
+            isFine  = false;
+            return true;
+        }
+
+        const float *          aNodes = &Nodes[(size_t)anIdx * THE_BRICK_SIZE];
+        const Standard_Integer l[3]   = { c[0] - b[0] * THE_BRICK, c[1] - b[1] * THE_BRICK, c[2] - b[2] * THE_BRICK };
+        const float            f[3]   = { (float)(u[0] - c[0]), (float)(u[1] - c[1]), (float)(u[2] - c[2]) };
+
+        float aValue = 0.0f;
+        for (int k = 0; k < 2; ++k)
+        {
+            for (int j = 0; j < 2; ++j)
+            {
+                const float *aRow = aNodes + ((l[2] + k) * THE_BRICK_NODE + (l[1] + j)) * THE_BRICK_NODE + l[0];
+                const float  w    = (k ? f[2] : 1.0f - f[2]) * (j ? f[1] : 1.0f - f[1]);
+                aValue += w * (aRow[0] * (1.0f - f[0]) + aRow[1] * f[0]);
+            }
+        }
+        theDist = aValue;
+        isFine  = true;
+        return true;
+    }
+};
+
+namespace
+{
+    //! 沿X方向的扫描线，记录与三角网格交点的X坐标，用于确定节点在实体内还是外
+    class ScanLines
+    {
+    public:
+        ScanLines(const Standard_Real theOrigin[3], const Standard_Real theCell, const Standard_Integer theNy,
+                  const Standard_Integer theNz)
+            : myNy(theNy)
+            , myNz(theNz)
+            , myLines((size_t)theNy * theNz)
+        {
+            // 扫描线略微偏离节点，避免正好穿过三角形的边或顶点
+            myY0   = theOrigin[1] + theCell * 1.0e-3 * 0.7071067812;
+            myZ0   = theOrigin[2] + theCell * 1.0e-3 * 0.5773502692;
+            myCell = theCell;
+        }
+
+        void AddTriangle(const BVH_Vec3d &a, const BVH_Vec3d &b, const BVH_Vec3d &c)
+        {
+            const double d = (b.y() - a.y()) * (c.z() - a.z()) - (c.y() - a.y()) * (b.z() - a.z());
+            if (std::fabs(d) < 1.0e-300)
+                return;
+
+            const Standard_Integer j0 = std::max(0, (Standard_Integer)std::ceil((std::min(a.y(), std::min(b.y(), c.y())) - myY0) / myCell));
+            const Standard_Integer j1 = std::min(myNy - 1, (Standard_Integer)std::floor((std::max(a.y(), std::max(b.y(), c.y())) - myY0) / myCell));
+            const Standard_Integer k0 = std::max(0, (Standard_Integer)std::ceil((std::min(a.z(), std::min(b.z(), c.z())) - myZ0) / myCell));
+            const Standard_Integer k1 = std::min(myNz - 1, (Standard_Integer)std::floor((std::max(a.z(), std::max(b.z(), c.z())) - myZ0) / myCell));
+            for (Standard_Integer k = k0; k <= k1; ++k)
+            {
+                const double z = myZ0 + k * myCell;
+                for (Standard_Integer j = j0; j <= j1; ++j)
+                {
+                    const double y  = myY0 + j * myCell;
+                    const double w1 = ((y - a.y()) * (c.z() - a.z()) - (c.y() - a.y()) * (z - a.z())) / d;
+                    const double w2 = ((b.y() - a.y()) * (z - a.z()) - (y - a.y()) * (b.z() - a.z())) / d;
+                    const double w0 = 1.0 - w1 - w2;
+                    if (w0 < 0.0 || w1 < 0.0 || w2 < 0.0)
+                        continue;
+                    myLines[(size_t)k * myNy + j].push_back((float)(w0 * a.x() + w1 * b.x() + w2 * c.x()));
+                }
+            }
+        }
+
+        void Sort()
+        {
+            for (size_t i = 0; i < myLines.size(); ++i)
+                std::sort(myLines[i].begin(), myLines[i].end());
+        }
+
+        //! 节点(x, j, k)在实体内：其左侧的交点数为奇数
+        bool IsInside(const Standard_Real x, const Standard_Integer j, const Standard_Integer k) const
+        {
+            const std::vector<float> &aLine = myLines[(size_t)k * myNy + j];
+            return ((std::lower_bound(aLine.begin(), aLine.end(), (float)x) - aLine.begin()) & 1) != 0;
+        }
+
+    private:
+        Standard_Integer                myNy;
+        Standard_Integer                myNz;
+        Standard_Real                   myY0;
+        Standard_Real                   myZ0;
+        Standard_Real                   myCell;
+        std::vector<std::vector<float>> myLines;
+    };
+}    // namespace
+
+
+DistanceField::DistanceField(const Options &theOptions)
+    : myOptions(theOptions)
+    , mySceneCell(1.0)
+{
+    Clear();
+}
+
+DistanceField::~DistanceField()
+{
+    Clear();
+}
+
+void DistanceField::Clear()
+{
+    for (size_t i = 0; i < myGrids.size(); ++i)
+        delete myGrids[i];
+    myGrids.clear();
+    mySceneCells.clear();
+    for (int i = 0; i < 3; ++i)
+    {
+        mySceneMin[i]  = 0.0;
+        mySceneDims[i] = 0;
+    }
+    memset(&myStats, 0, sizeof(myStats));
+}
+
+Standard_Integer DistanceField::Build(const Handle(AIS_InteractiveContext) & theContext)
+{
+    AIS_ListOfInteractive aList;
+    theContext->DisplayedObjects(AIS_KOI_Shape, -1, aList);
+
+    TopTools_ListOfShape aSolids;
+    for (AIS_ListOfInteractive::Iterator anIter(aList); anIter.More(); anIter.Next())
+    {
+        const Handle(AIS_Shape) aShape = Handle(AIS_Shape)::DownCast(anIter.Value());
+        if (aShape.IsNull())
+            continue;
+
+        // 没有三角网格的形状先剖分，与显示使用相同的精度
+        for (TopExp_Explorer anExp(aShape->Shape(), TopAbs_FACE); anExp.More(); anExp.Next())
+        {
+            TopLoc_Location aLoc;
+            if (BRep_Tool::Triangulation(TopoDS::Face(anExp.Current()), aLoc).IsNull())
+            {
+                const Standard_Real aDeflection =
+                    StdPrs_ToolTriangulatedShape::GetDeflection(aShape->Shape(), aShape->Attributes());
+                BRepMesh_IncrementalMesh(aShape->Shape(), aDeflection, Standard_False,
+                                         aShape->Attributes()->DeviationAngle(), Standard_True);
+                break;
+            }
+        }
+
+        for (TopExp_Explorer anExp(ShapeUtils::WorldShape(aShape), TopAbs_SOLID); anExp.More(); anExp.Next())
+            aSolids.Append(anExp.Current());
+    }
+    return Build(aSolids);
+}
+
+Standard_Integer DistanceField::Build(const TopTools_ListOfShape &theSolids)
+{
+    Clear();
+
+    QElapsedTimer aTimer;
+    aTimer.start();
+
+    std::vector<TopoDS_Shape> aSolids;
+    for (TopTools_ListOfShape::Iterator anIter(theSolids); anIter.More(); anIter.Next())
+        aSolids.push_back(anIter.Value());
+    myGrids.assign(aSolids.size(), NULL);
+
+    const Options &anOptions = myOptions;
+    // 实体多时按实体并行，否则在单个实体内按块并行
+    const bool isPerSolid = aSolids.size() >= 16;
+    auto       buildGrid  = [&anOptions, isPerSolid](const TopoDS_Shape &theSolid) -> Grid * {
+        BRepExtrema_ShapeList aFaces;
+        for (TopExp_Explorer anExp(theSolid, TopAbs_FACE); anExp.More(); anExp.Next())
+            aFaces.Append(TopoDS::Face(anExp.Current()));
+
+        Handle(BRepExtrema_TriangleSet) aSet = new BRepExtrema_TriangleSet(aFaces);
+        if (aSet->Size() == 0)
+            return NULL;
+        aSet->BVH();
+
+        Bnd_Box aBox;
+        BRepBndLib::Add(theSolid, aBox, Standard_True);
+        Standard_Real aMin[3], aMax[3];
+        aBox.Get(aMin[0], aMin[1], aMin[2], aMax[0], aMax[1], aMax[2]);
+
+        Grid *aGrid = new Grid();
+        aGrid->Solid = theSolid;
+
+        const Standard_Real aLongest = std::max(aMax[0] - aMin[0], std::max(aMax[1] - aMin[1], aMax[2] - aMin[2]));
+        aGrid->Cell = std::min(1000.0 / anOptions.Resolution, aLongest / std::max(1, anOptions.MinCells));
+        aGrid->Cell = std::max(aGrid->Cell, Precision::Confusion());
+
+        const Standard_Real aMargin = (anOptions.BandCells + 1) * aGrid->Cell;
+        for (int i = 0; i < 3; ++i)
+        {
+            const Standard_Integer aCells = (Standard_Integer)std::ceil((aMax[i] - aMin[i] + 2.0 * aMargin) / aGrid->Cell);
+            aGrid->Bricks[i] = std::max(1, (aCells + THE_BRICK - 1) / THE_BRICK);
+            aGrid->Dims[i]   = aGrid->Bricks[i] * THE_BRICK;
+            aGrid->Origin[i] = aMin[i] - aMargin;
+            aGrid->Max[i]    = aGrid->Origin[i] + aGrid->Dims[i] * aGrid->Cell;
+        }
+
+        // 符号：节点所在的扫描线
+        ScanLines aLines(aGrid->Origin, aGrid->Cell, aGrid->Dims[1] + 1, aGrid->Dims[2] + 1);
+        const Standard_Integer aNbBricks = aGrid->Bricks[0] * aGrid->Bricks[1] * aGrid->Bricks[2];
+        std::vector<char>      isFine(aNbBricks, 0);
+        const Standard_Real    aBand = anOptions.BandCells * aGrid->Cell;
+        for (Standard_Integer t = 0; t < aSet->Size(); ++t)
+        {
+            BVH_Vec3d a, b, c;
+            aSet->GetVertices(t, a, b, c);
+            aLines.AddTriangle(a, b, c);
+
+            // 三角形包围盒扩展窄带宽度后覆盖的块都是精细块
+            Standard_Integer b0[3], b1[3];
+            for (int i = 0; i < 3; ++i)
+            {
+                const Standard_Real lo = std::min(a[i], std::min(b[i], c[i])) - aBand;
+                const Standard_Real hi = std::max(a[i], std::max(b[i], c[i])) + aBand;
+                b0[i] = std::max(0, (Standard_Integer)((lo - aGrid->Origin[i]) / aGrid->Cell) / THE_BRICK);
+                b1[i] = std::min(aGrid->Bricks[i] - 1, (Standard_Integer)((hi - aGrid->Origin[i]) / aGrid->Cell) / THE_BRICK);
+            }
+            for (Standard_Integer z = b0[2]; z <= b1[2]; ++z)
+                for (Standard_Integer y = b0[1]; y <= b1[1]; ++y)
+                    for (Standard_Integer x = b0[0]; x <= b1[0]; ++x)
+                        isFine[(z * aGrid->Bricks[1] + y) * aGrid->Bricks[0] + x] = 1;
+        }
+        aLines.Sort();
+
+        aGrid->BrickIndex.assign(aNbBricks, -1);
+        aGrid->Coarse.assign(aNbBricks, 0.0f);
+        Standard_Integer aNbFine = 0;
+        for (Standard_Integer i = 0; i < aNbBricks; ++i)
+        {
+            if (isFine[i])
+                aGrid->BrickIndex[i] = aNbFine++;
+        }
+        aGrid->Nodes.resize((size_t)aNbFine * THE_BRICK_SIZE);
+
+        Grid *aTarget = aGrid;
+        OSD_Parallel::For(0, aNbBricks, [&](const Standard_Integer theBrick) {
+            const Standard_Integer bx = theBrick % aTarget->Bricks[0];
+            const Standard_Integer by = (theBrick / aTarget->Bricks[0]) % aTarget->Bricks[1];
+            const Standard_Integer bz = theBrick / (aTarget->Bricks[0] * aTarget->Bricks[1]);
+            const Standard_Real    h  = aTarget->Cell;
+
+            const Standard_Integer anIdx = aTarget->BrickIndex[theBrick];
+            if (anIdx < 0)
+            {
+                // 块中心正好是一个节点
+                const Standard_Integer i = bx * THE_BRICK + THE_BRICK / 2;
+                const Standard_Integer j = by * THE_BRICK + THE_BRICK / 2;
+                const Standard_Integer k = bz * THE_BRICK + THE_BRICK / 2;
+                const BVH_Vec3d        p(aTarget->Origin[0] + i * h, aTarget->Origin[1] + j * h, aTarget->Origin[2] + k * h);
+                const Standard_Real    d = nearestDistance(aSet, p, RealLast());
+                aTarget->Coarse[theBrick] = (float)(aLines.IsInside(p.x(), j, k) ? -d : d);
+                return;
+            }
+
+            float *       aNodes = &aTarget->Nodes[(size_t)anIdx * THE_BRICK_SIZE];
+            Standard_Real aPrev  = RealLast();
+            for (Standard_Integer c = 0; c < THE_BRICK_NODE; ++c)
+            {
+                for (Standard_Integer b = 0; b < THE_BRICK_NODE; ++b)
+                {
+                    for (Standard_Integer a = 0; a < THE_BRICK_NODE; ++a)
+                    {
+                        const Standard_Integer i = bx * THE_BRICK + a;
+                        const Standard_Integer j = by * THE_BRICK + b;
+                        const Standard_Integer k = bz * THE_BRICK + c;
+                        const BVH_Vec3d p(aTarget->Origin[0] + i * h, aTarget->Origin[1] + j * h, aTarget->Origin[2] + k * h);
+
+                        // 相邻节点的距离相差不超过一个对角线，作为BVH遍历的上界
+                        const Standard_Real d = nearestDistance(aSet, p, aPrev < RealLast() ? aPrev + h * 1.8 : RealLast());
+                        aPrev = d;
+                        aNodes[(c * THE_BRICK_NODE + b) * THE_BRICK_NODE + a] = (float)(aLines.IsInside(p.x(), j, k) ? -d : d);
+                    }
+                    aPrev = RealLast();
+                }
+            }
+        }, isPerSolid);
+
+        return aGrid;
+    };
+
+    std::vector<Grid *> &aGrids = myGrids;
+    OSD_Parallel::For(0, (Standard_Integer)aSolids.size(), [&](const Standard_Integer theIndex) {
+        aGrids[theIndex] = buildGrid(aSolids[theIndex]);
+    }, !isPerSolid);
+
+    myGrids.erase(std::remove(myGrids.begin(), myGrids.end(), (Grid *)NULL), myGrids.end());
+    buildSceneGrid();
+
+    myStats.NbSolids = (Standard_Integer)myGrids.size();
+    for (size_t i = 0; i < myGrids.size(); ++i)
+    {
+        myStats.NbBricks += myGrids[i]->BrickIndex.size();
+        myStats.NbFineBricks += myGrids[i]->Nodes.size() / THE_BRICK_SIZE;
+        myStats.MemoryBytes += myGrids[i]->MemoryBytes();
+    }
+    myStats.BuildMs = aTimer.elapsed();
+
+    LOG_INFO("DistanceField", "距离场: " << myStats.NbSolids << " solids, " << myStats.NbFineBricks << "/"
+                                         << myStats.NbBricks << " fine bricks, "
+                                         << myStats.MemoryBytes / 1048576.0 << " MB, " << myStats.BuildMs << " ms");
+    return myStats.NbSolids;
+}
+
+void DistanceField::buildSceneGrid()
+{
+    mySceneCells.clear();
+    if (myGrids.empty())
+        return;
+
+    Standard_Real aMax[3];
+    Standard_Real anAvg = 0.0;
+    for (int i = 0; i < 3; ++i)
+    {
+        mySceneMin[i] = RealLast();
+        aMax[i]       = RealFirst();
+    }
+    for (size_t g = 0; g < myGrids.size(); ++g)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            mySceneMin[i] = std::min(mySceneMin[i], myGrids[g]->Origin[i]);
+            aMax[i]       = std::max(aMax[i], myGrids[g]->Max[i]);
+        }
+        anAvg += myGrids[g]->Dims[0] * myGrids[g]->Cell;
+    }
+
+    // 场景单元取实体网格的平均尺寸，每个方向最多64个单元
+    mySceneCell = anAvg / myGrids.size();
+    for (int i = 0; i < 3; ++i)
+        mySceneCell = std::max(mySceneCell, (aMax[i] - mySceneMin[i]) / 64.0);
+    for (int i = 0; i < 3; ++i)
+        mySceneDims[i] = std::max(1, (Standard_Integer)std::ceil((aMax[i] - mySceneMin[i]) / mySceneCell));
+
+    mySceneCells.resize((size_t)mySceneDims[0] * mySceneDims[1] * mySceneDims[2]);
+    for (size_t g = 0; g < myGrids.size(); ++g)
+    {
+        Standard_Integer c0[3], c1[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            c0[i] = std::min(mySceneDims[i] - 1, (Standard_Integer)((myGrids[g]->Origin[i] - mySceneMin[i]) / mySceneCell));
+            c1[i] = std::min(mySceneDims[i] - 1, (Standard_Integer)((myGrids[g]->Max[i] - mySceneMin[i]) / mySceneCell));
+        }
+        for (Standard_Integer z = c0[2]; z <= c1[2]; ++z)
+            for (Standard_Integer y = c0[1]; y <= c1[1]; ++y)
+                for (Standard_Integer x = c0[0]; x <= c1[0]; ++x)
+                    mySceneCells[((size_t)z * mySceneDims[1] + y) * mySceneDims[0] + x].push_back((Standard_Integer)g);
+    }
+}
+
+Standard_Real DistanceField::Distance(const gp_Pnt &thePnt)
+{
+    const float x = (float)thePnt.X();
+    const float y = (float)thePnt.Y();
+    const float z = (float)thePnt.Z();
+    float       d = 0.0f;
+    Query(&x, &y, &z, 1, &d);
+    return d;
+}
+
+void DistanceField::Query(const float *theX, const float *theY, const float *theZ, const Standard_Integer theNb,
+                          float *theDistances)
+{
+    QElapsedTimer aTimer;
+    aTimer.start();
+
+    const Standard_Integer aNbChunks = (theNb + THE_QUERY_CHUNK - 1) / THE_QUERY_CHUNK;
+    std::vector<qint64>    aNbExact(aNbChunks, 0);
+    OSD_Parallel::For(0, aNbChunks, [&](const Standard_Integer theChunk) {
+        std::vector<std::unique_ptr<BRepClass3d_SolidClassifier>> aClassifiers(myGrids.size());
+        const Standard_Integer                                    aFirst = theChunk * THE_QUERY_CHUNK;
+        queryRange(theX, theY, theZ, aFirst, std::min(aFirst + THE_QUERY_CHUNK, theNb), theDistances,
+                   aClassifiers, aNbExact[theChunk]);
+    }, aNbChunks < 2);
+
+    myStats.NbQueries += theNb;
+    for (size_t i = 0; i < aNbExact.size(); ++i)
+        myStats.NbExact += aNbExact[i];
+    myStats.QueryMs += aTimer.nsecsElapsed() / 1.0e6;
+}
+
+void DistanceField::queryRange(const float *theX, const float *theY, const float *theZ,
+                               const Standard_Integer theFirst, const Standard_Integer theLast,
+                               float *theDistances,
+                               std::vector<std::unique_ptr<BRepClass3d_SolidClassifier>> &theClassifiers,
+                               qint64 &theNbExact) const
+{
+    const Standard_Integer aNb = theLast - theFirst;
+
+    // 先按列计算全部点的场景单元(可向量化)，不在场景内的为-1
+    std::vector<Standard_Integer> aCells(aNb);
+    const float                   anInv = (float)(1.0 / mySceneCell);
+    const float                   ox    = (float)mySceneMin[0];
+    const float                   oy    = (float)mySceneMin[1];
+    const float                   oz    = (float)mySceneMin[2];
+    const Standard_Integer        nx    = mySceneDims[0];
+    const Standard_Integer        ny    = mySceneDims[1];
+    const Standard_Integer        nz    = mySceneDims[2];
+    for (Standard_Integer i = 0; i < aNb; ++i)
+    {
+        const float            fx = (theX[theFirst + i] - ox) * anInv;
+        const float            fy = (theY[theFirst + i] - oy) * anInv;
+        const float            fz = (theZ[theFirst + i] - oz) * anInv;
+        const Standard_Integer cx = (Standard_Integer)fx;
+        const Standard_Integer cy = (Standard_Integer)fy;
+        const Standard_Integer cz = (Standard_Integer)fz;
+        const bool isIn = (fx >= 0.0f) & (fy >= 0.0f) & (fz >= 0.0f) & (cx < nx) & (cy < ny) & (cz < nz);
+        aCells[i]       = isIn ? (cz * ny + cy) * nx + cx : -1;
+    }
+
+    const float aFar = (float)myOptions.MaxDistance;
+    for (Standard_Integer i = 0; i < aNb; ++i)
+    {
+        float aBest = aFar;
+        if (aCells[i] >= 0 && !mySceneCells.empty())
+        {
+            const Standard_Real                  p[3]       = { theX[theFirst + i], theY[theFirst + i], theZ[theFirst + i] };
+            const std::vector<Standard_Integer> &aCandidates = mySceneCells[aCells[i]];
+            for (size_t c = 0; c < aCandidates.size(); ++c)
+            {
+                const Grid *aGrid  = myGrids[aCandidates[c]];
+                float       aDist  = 0.0f;
+                bool        isFine = false;
+                if (!aGrid->Sample(p, aDist, isFine))
+                    continue;
+
+                // 插值得到的符号在表面附近不可靠，改用精确分类
+                if (isFine && myOptions.ExactNearSurface && std::fabs(aDist) < aGrid->Cell)
+                {
+                    std::unique_ptr<BRepClass3d_SolidClassifier> &aClassifier = theClassifiers[aCandidates[c]];
+                    if (!aClassifier)
+                        aClassifier.reset(new BRepClass3d_SolidClassifier(aGrid->Solid));
+                    aClassifier->Perform(gp_Pnt(p[0], p[1], p[2]), Precision::Confusion());
+                    const TopAbs_State aState = aClassifier->State();
+                    aDist = aState == TopAbs_ON ? 0.0f : (aState == TopAbs_IN ? -std::fabs(aDist) : std::fabs(aDist));
+                    ++theNbExact;
+                }
+                aBest = std::min(aBest, aDist);
+            }
+        }
+        theDistances[theFirst + i] = aBest;
+    }
+}
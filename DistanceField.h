@@ -0,0 +1,112 @@
+#ifndef DISTANCEFIELD_H
+#define DISTANCEFIELD_H
+
+#include <memory>
+#include <vector>
+
+#include <QtGlobal>
+
+#include <AIS_InteractiveContext.hxx>
+#include <TopTools_ListOfShape.hxx>
+#include <TopoDS_Shape.hxx>
+#include <gp_Pnt.hxx>
+
+#include "Gglobal.h"
+
+class BRepClass3d_SolidClassifier;
+
+/// \brief DistanceField
+///
+/// 实体的稀疏有向距离场(SDF)，用于大批量的点在实体内判断与到表面的距离查询，
+/// 代替逐点的BRepClass3d_SolidClassifier。
+///
+/// 每个实体一个规则网格，网格按8x8x8个单元分块(brick)：
+/// - 与三角网格距离在窄带(BandCells个单元)内的块保存9x9x9个节点上的距离，查询时三线性插值
+/// - 其余块只保存块中心的距离，查询结果是近似值(误差不超过块的半对角线)
+/// - 网格在实体包围盒外扩展窄带宽度再加一个单元，不在任何网格内的点返回MaxDistance，作为"远处"的标记
+///
+/// 距离由三角网格(BRepExtrema_TriangleSet的BVH)计算，符号由沿X方向的扫描线奇偶性确定；
+/// 距离表面不到一个单元的点可以改用BRepClass3d_SolidClassifier精确判断内外。
+/// 多个实体的结果取并集(最小值)，内部为负。
+class DistanceField
+{
+public:
+    struct Options
+    {
+        Standard_Real    Resolution;          ///< 采样密度(采样点数目/米)，默认SAMPLE_RESOLUTIONS
+        Standard_Integer MinCells;            ///< 实体最长边上至少的单元数，小零件不会只有一两个单元
+        Standard_Integer BandCells;           ///< 保存精细距离的窄带宽度(单元数)
+        Standard_Real    MaxDistance;         ///< 不在任何网格内的点返回的距离(mm)
+        Standard_Boolean ExactNearSurface;    ///< 靠近表面的点用精确分类确定内外
+
+        Options()
+            : Resolution(SAMPLE_RESOLUTIONS)
+            , MinCells(32)
+            , BandCells(2)
+            , MaxDistance(50.0)
+            , ExactNearSurface(Standard_True)
+        {
+        }
+    };
+
+    struct Statistics
+    {
+        Standard_Integer NbSolids;
+        qint64           NbBricks;
+        qint64           NbFineBricks;    ///< 保存节点距离的窄带块数
+        qint64           MemoryBytes;
+        double           BuildMs;
+        qint64           NbQueries;
+        qint64           NbExact;         ///< 改用精确分类的查询数
+        double           QueryMs;
+
+        /// \brief 查询吞吐率(点/秒)
+        double Throughput() const { return QueryMs > 0.0 ? NbQueries / (QueryMs / 1000.0) : 0.0; }
+    };
+
+    explicit DistanceField(const Options &theOptions = Options());
+    ~DistanceField();
+
+    void Clear();
+
+    /// \brief 为已显示的AIS_Shape中的全部实体建立距离场，没有三角网格的先剖分
+    Standard_Integer Build(const Handle(AIS_InteractiveContext) & theContext);
+
+    /// \brief 为给定实体(世界坐标，须已剖分)建立距离场，替换已有内容
+    Standard_Integer Build(const TopTools_ListOfShape &theSolids);
+
+    /// \brief 单点查询，内部为负
+    Standard_Real Distance(const gp_Pnt &thePnt);
+    bool          IsInside(const gp_Pnt &thePnt) { return Distance(thePnt) < 0.0; }
+
+    /// \brief 批量查询，坐标按列传入，结果写入theDistances，内部并行
+    void Query(const float *theX, const float *theY, const float *theZ, const Standard_Integer theNb,
+               float *theDistances);
+
+    const Statistics &Stats() const { return myStats; }
+    const Options &   GetOptions() const { return myOptions; }
+
+private:
+    struct Grid;
+
+    /// \brief 查询theFirst到theLast之间的点，theClassifiers为本线程的精确分类器缓存
+    void queryRange(const float *theX, const float *theY, const float *theZ,
+                    const Standard_Integer theFirst, const Standard_Integer theLast,
+                    float *theDistances, std::vector<std::unique_ptr<BRepClass3d_SolidClassifier>> &theClassifiers,
+                    qint64 &theNbExact) const;
+
+    void buildSceneGrid();
+
+    Options             myOptions;
+    std::vector<Grid *> myGrids;
+
+    // 实体网格的粗粒度哈希，点先定位到场景单元再只检查其中的实体
+    Standard_Real                              mySceneMin[3];
+    Standard_Real                              mySceneCell;
+    Standard_Integer                           mySceneDims[3];
+    std::vector<std::vector<Standard_Integer>> mySceneCells;
+
+    Statistics myStats;
+};
+
+#endif    // DISTANCEFIELD_H
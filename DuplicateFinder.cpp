@@ -0,0 +1,489 @@
+#include "DuplicateFinder.h"
+
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include <BRepAdaptor_Surface.hxx>
+#include <BRepBndLib.hxx>
+#include <BRepGProp.hxx>
+#include <BRepTools_ReShape.hxx>
+#include <BRep_Tool.hxx>
+#include <Bnd_OBB.hxx>
+#include <GProp_GProps.hxx>
+#include <GProp_PrincipalProps.hxx>
+#include <OSD_Parallel.hxx>
+#include <Poly_Triangulation.hxx>
+#include <Precision.hxx>
+#include <TopExp.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
+#include <TopTools_MapOfShape.hxx>
+#include <TopoDS.hxx>
+#include <gp_Ax3.hxx>
+#include <gp_Pnt2d.hxx>
+
+
+namespace
+{
+    //! 质量属性的相对容差
+    const Standard_Real THE_PRINT_TOLERANCE = 1.0e-4;
+
+    //! 主惯性矩的相对差小于此值时视为相同，主轴不再可靠
+    const Standard_Real THE_DEGENERATE_MOMENTS = 1.0e-4;
+
+    //! 以顶点定标架时一对实体最多尝试的候选变换数
+    const size_t THE_MAX_CANDIDATES = 64;
+
+    bool isClose(const Standard_Real theA, const Standard_Real theB, const Standard_Real theTolerance)
+    {
+        return std::abs(theA - theB) <= theTolerance * std::max(std::abs(theA), std::abs(theB)) + Precision::Confusion();
+    }
+
+    //! 从theOrigin出发、X方向为theX、XY平面过theY的标架，返回世界坐标到标架坐标的变换
+    gp_Trsf frame(const gp_Pnt &theOrigin, const gp_Dir &theX, const gp_Vec &theY)
+    {
+        gp_Trsf aTrsf;
+        aTrsf.SetTransformation(gp_Ax3(theOrigin, gp_Dir(gp_Vec(theX).Crossed(theY)), theX));
+        return aTrsf;
+    }
+
+    //! 由两个标架得到theFrom标架到theTo标架的变换
+    gp_Trsf between(const gp_Trsf &theFrom, const gp_Trsf &theTo)
+    {
+        gp_Trsf aTrsf = theTo.Inverted();
+        aTrsf.Multiply(theFrom);
+        return aTrsf;
+    }
+
+    //! theFrom中的每个点经theTrsf变换后，在theTo中都有一个距离不超过theTol且theAccept的点，一一对应
+    template <typename Accept>
+    bool matchPoints(const std::vector<gp_Pnt> &theFrom, const std::vector<gp_Pnt> &theTo, const gp_Trsf &theTrsf,
+                     const Standard_Real theTol, Accept theAccept)
+    {
+        if (theFrom.size() != theTo.size())
+            return false;
+
+        // theTo按X排序，每个点只扫描X在容差内的一段
+        std::vector<size_t> anOrder(theTo.size());
+        std::iota(anOrder.begin(), anOrder.end(), 0);
+        std::sort(anOrder.begin(), anOrder.end(),
+                  [&theTo](const size_t a, const size_t b) { return theTo[a].X() < theTo[b].X(); });
+        std::vector<Standard_Real> aXs(anOrder.size());
+        for (size_t i = 0; i < anOrder.size(); ++i)
+            aXs[i] = theTo[anOrder[i]].X();
+
+        std::vector<char> isUsed(theTo.size(), 0);
+        for (size_t i = 0; i < theFrom.size(); ++i)
+        {
+            const gp_Pnt aPnt   = theFrom[i].Transformed(theTrsf);
+            bool         isFound = false;
+            for (size_t k = std::lower_bound(aXs.begin(), aXs.end(), aPnt.X() - theTol) - aXs.begin();
+                 k < aXs.size() && aXs[k] <= aPnt.X() + theTol; ++k)
+            {
+                const size_t j = anOrder[k];
+                if (!isUsed[j] && aPnt.Distance(theTo[j]) <= theTol && theAccept(i, j))
+                {
+                    isUsed[j] = 1;
+                    isFound   = true;
+                    break;
+                }
+            }
+            if (!isFound)
+                return false;
+        }
+        return true;
+    }
+}    // namespace
+
+
+bool DuplicateFinder::Fingerprint::IsSimilar(const Fingerprint &theOther, const Standard_Real theTolerance) const
+{
+    if (NbFaces != theOther.NbFaces || NbEdges != theOther.NbEdges || NbVertices != theOther.NbVertices)
+        return false;
+    for (Standard_Integer i = 0; i < THE_NB_SURFACE_TYPES; ++i)
+    {
+        if (SurfaceTypes[i] != theOther.SurfaceTypes[i])
+            return false;
+    }
+
+    if (!isClose(Volume, theOther.Volume, theTolerance) || !isClose(Area, theOther.Area, theTolerance))
+        return false;
+
+    const Standard_Real anObbTolerance = std::max(theTolerance, 0.01);
+    for (int i = 0; i < 3; ++i)
+    {
+        if (!isClose(Moments[i], theOther.Moments[i], theTolerance)
+            || !isClose(Extents[i], theOther.Extents[i], anObbTolerance))
+            return false;
+    }
+    return true;
+}
+
+DuplicateFinder::DuplicateFinder(const Standard_Real theTolerance)
+    : myTolerance(theTolerance)
+{
+    Perform(std::vector<TopoDS_Shape>());
+}
+
+void DuplicateFinder::compute(Record &theRecord)
+{
+    const TopoDS_Shape &aSolid = theRecord.Solid;
+    Fingerprint &       aPrint = theRecord.Print;
+
+    GProp_GProps aVolume;
+    BRepGProp::VolumeProperties(aSolid, aVolume);
+    aPrint.Volume     = aVolume.Mass();
+    theRecord.Center  = aVolume.CentreOfMass();
+
+    // 主惯性矩升序排列，主轴随之排列
+    const GProp_PrincipalProps aPrincipal = aVolume.PrincipalProperties();
+    Standard_Real              aMoments[3];
+    aPrincipal.Moments(aMoments[0], aMoments[1], aMoments[2]);
+    const gp_Vec anAxes[3] = { aPrincipal.FirstAxisOfInertia(), aPrincipal.SecondAxisOfInertia(),
+                               aPrincipal.ThirdAxisOfInertia() };
+    int anOrder[3] = { 0, 1, 2 };
+    std::sort(anOrder, anOrder + 3, [&aMoments](const int a, const int b) { return aMoments[a] < aMoments[b]; });
+    for (int i = 0; i < 3; ++i)
+        aPrint.Moments[i] = aMoments[anOrder[i]];
+    theRecord.AxisX        = gp_Dir(anAxes[anOrder[0]]);
+    theRecord.AxisY        = gp_Dir(anAxes[anOrder[1]]);
+    theRecord.IsDegenerate = isClose(aPrint.Moments[0], aPrint.Moments[1], THE_DEGENERATE_MOMENTS)
+                             || isClose(aPrint.Moments[1], aPrint.Moments[2], THE_DEGENERATE_MOMENTS);
+
+    Bnd_OBB anObb;
+    BRepBndLib::AddOBB(aSolid, anObb, Standard_False, Standard_False, Standard_False);
+    aPrint.Extents[0] = anObb.XHSize();
+    aPrint.Extents[1] = anObb.YHSize();
+    aPrint.Extents[2] = anObb.ZHSize();
+    std::sort(aPrint.Extents, aPrint.Extents + 3);
+
+    TopTools_IndexedMapOfShape aFaces, anEdges, aVertices;
+    TopExp::MapShapes(aSolid, TopAbs_FACE, aFaces);
+    TopExp::MapShapes(aSolid, TopAbs_EDGE, anEdges);
+    TopExp::MapShapes(aSolid, TopAbs_VERTEX, aVertices);
+    aPrint.NbFaces    = aFaces.Extent();
+    aPrint.NbEdges    = anEdges.Extent();
+    aPrint.NbVertices = aVertices.Extent();
+
+    std::fill(aPrint.SurfaceTypes, aPrint.SurfaceTypes + THE_NB_SURFACE_TYPES, 0);
+    aPrint.Area = 0.0;
+    theRecord.Faces.resize(aFaces.Extent());
+    for (Standard_Integer i = 1; i <= aFaces.Extent(); ++i)
+    {
+        const TopoDS_Face &aFace = TopoDS::Face(aFaces(i));
+        GProp_GProps       aProps;
+        BRepGProp::SurfaceProperties(aFace, aProps);
+
+        FaceSignature &aSignature = theRecord.Faces[i - 1];
+        aSignature.Type           = BRepAdaptor_Surface(aFace, Standard_False).GetType();
+        aSignature.Area           = aProps.Mass();
+        aSignature.Centroid       = aProps.CentreOfMass();
+        ++aPrint.SurfaceTypes[aSignature.Type];
+        aPrint.Area += aSignature.Area;
+    }
+
+    theRecord.Vertices.resize(aVertices.Extent());
+    for (Standard_Integer i = 1; i <= aVertices.Extent(); ++i)
+        theRecord.Vertices[i - 1] = BRep_Tool::Pnt(TopoDS::Vertex(aVertices(i)));
+}
+
+void DuplicateFinder::candidates(const Record &theFrom, const Record &theTo, std::vector<gp_Trsf> &theResult) const
+{
+    // 主轴确定时只差符号，保持右手系共4种
+    if (!theFrom.IsDegenerate && !theTo.IsDegenerate)
+    {
+        const gp_Trsf aFrom = frame(theFrom.Center, theFrom.AxisX, gp_Vec(theFrom.AxisY));
+        for (int s = 0; s < 4; ++s)
+        {
+            const gp_Dir aX = (s & 1) ? theTo.AxisX.Reversed() : theTo.AxisX;
+            const gp_Vec aY = (s & 2) ? gp_Vec(theTo.AxisY.Reversed()) : gp_Vec(theTo.AxisY);
+            theResult.push_back(between(aFrom, frame(theTo.Center, aX, aY)));
+        }
+        return;
+    }
+
+    // 主轴不确定：取theFrom中离质心最远的顶点a1，以及离直线(质心, a1)最远的顶点a2定标架，
+    // theTo中到质心距离与投影都相符的顶点对逐一作为候选
+    const std::vector<gp_Pnt> &aFromPnts = theFrom.Vertices;
+    size_t                     a1 = 0, a2 = 0;
+    Standard_Real              aD1 = -1.0, aH2 = -1.0;
+    for (size_t i = 0; i < aFromPnts.size(); ++i)
+    {
+        const Standard_Real aD = aFromPnts[i].Distance(theFrom.Center);
+        if (aD > aD1)
+        {
+            aD1 = aD;
+            a1  = i;
+        }
+    }
+
+    gp_Trsf aTranslation;
+    aTranslation.SetTranslation(theFrom.Center, theTo.Center);
+    if (aD1 <= myTolerance)
+    {
+        theResult.push_back(aTranslation);
+        return;
+    }
+
+    const gp_Dir aDir1(gp_Vec(theFrom.Center, aFromPnts[a1]));
+    for (size_t i = 0; i < aFromPnts.size(); ++i)
+    {
+        const Standard_Real aH = gp_Vec(theFrom.Center, aFromPnts[i]).Crossed(gp_Vec(aDir1)).Magnitude();
+        if (aH > aH2)
+        {
+            aH2 = aH;
+            a2  = i;
+        }
+    }
+    if (aH2 <= myTolerance)
+    {
+        theResult.push_back(aTranslation);
+        return;
+    }
+
+    const gp_Vec        aV2(theFrom.Center, aFromPnts[a2]);
+    const Standard_Real aD2    = aV2.Magnitude();
+    const Standard_Real aT2    = aV2.Dot(gp_Vec(aDir1));
+    const gp_Trsf       aFrom  = frame(theFrom.Center, aDir1, aV2);
+    const std::vector<gp_Pnt> &aToPnts = theTo.Vertices;
+    for (size_t i = 0; i < aToPnts.size(); ++i)
+    {
+        if (std::abs(aToPnts[i].Distance(theTo.Center) - aD1) > myTolerance)
+            continue;
+
+        const gp_Dir aToDir1(gp_Vec(theTo.Center, aToPnts[i]));
+        for (size_t j = 0; j < aToPnts.size(); ++j)
+        {
+            const gp_Vec aToV2(theTo.Center, aToPnts[j]);
+            if (j == i || std::abs(aToV2.Magnitude() - aD2) > myTolerance
+                || std::abs(aToV2.Dot(gp_Vec(aToDir1)) - aT2) > myTolerance
+                || aToV2.Crossed(gp_Vec(aToDir1)).Magnitude() <= myTolerance)
+                continue;
+
+            theResult.push_back(between(aFrom, frame(theTo.Center, aToDir1, aToV2)));
+            if (theResult.size() >= THE_MAX_CANDIDATES)
+                return;
+        }
+    }
+}
+
+bool DuplicateFinder::verify(const Record &theFrom, const Record &theTo, const gp_Trsf &theTrsf) const
+{
+    if (!matchPoints(theFrom.Vertices, theTo.Vertices, theTrsf, myTolerance,
+                     [](const size_t, const size_t) { return true; }))
+        return false;
+
+    std::vector<gp_Pnt> aFromCentroids(theFrom.Faces.size()), aToCentroids(theTo.Faces.size());
+    for (size_t i = 0; i < theFrom.Faces.size(); ++i)
+        aFromCentroids[i] = theFrom.Faces[i].Centroid;
+    for (size_t i = 0; i < theTo.Faces.size(); ++i)
+        aToCentroids[i] = theTo.Faces[i].Centroid;
+
+    return matchPoints(aFromCentroids, aToCentroids, theTrsf, myTolerance, [&](const size_t i, const size_t j) {
+        return theFrom.Faces[i].Type == theTo.Faces[j].Type
+               && isClose(theFrom.Faces[i].Area, theTo.Faces[j].Area, THE_PRINT_TOLERANCE);
+    });
+}
+
+void DuplicateFinder::Perform(const std::vector<TopoDS_Shape> &theShapes)
+{
+    myShapes = theShapes;
+    mySolids.clear();
+    myStats.NbSolids      = 0;
+    myStats.NbGroups      = 0;
+    myStats.NbDuplicates  = 0;
+    myStats.NbRejected    = 0;
+    myStats.FingerprintMs = 0.0;
+    myStats.VerifyMs      = 0.0;
+    myStats.SavedBytes    = 0;
+
+    for (size_t i = 0; i < theShapes.size(); ++i)
+    {
+        TopTools_IndexedMapOfShape aSolids;
+        TopExp::MapShapes(theShapes[i], TopAbs_SOLID, aSolids);
+        for (Standard_Integer j = 1; j <= aSolids.Extent(); ++j)
+        {
+            Record aRecord;
+            aRecord.Shape          = (Standard_Integer)i;
+            aRecord.Solid          = aSolids(j);
+            aRecord.Representative = (Standard_Integer)mySolids.size();
+            mySolids.push_back(aRecord);
+        }
+    }
+    myStats.NbSolids = (Standard_Integer)mySolids.size();
+    if (mySolids.empty())
+        return;
+
+    QElapsedTimer aTimer;
+    aTimer.start();
+    OSD_Parallel::For(0, (Standard_Integer)mySolids.size(),
+                      [this](const Standard_Integer theIndex) { compute(mySolids[theIndex]); });
+    myStats.FingerprintMs = aTimer.nsecsElapsed() / 1.0e6;
+
+    // 按体积排序后扫描，指纹一致的实体归入同一候选组
+    aTimer.restart();
+    std::vector<Standard_Integer> anOrder(mySolids.size());
+    std::iota(anOrder.begin(), anOrder.end(), 0);
+    std::sort(anOrder.begin(), anOrder.end(), [this](const Standard_Integer a, const Standard_Integer b) {
+        return mySolids[a].Print.Volume < mySolids[b].Print.Volume;
+    });
+
+    std::vector<std::vector<Standard_Integer>> aClusters;
+    std::vector<char>                          isAssigned(mySolids.size(), 0);
+    for (size_t a = 0; a < anOrder.size(); ++a)
+    {
+        const Standard_Integer i = anOrder[a];
+        if (isAssigned[i])
+            continue;
+
+        std::vector<Standard_Integer> aCluster(1, i);
+        for (size_t b = a + 1; b < anOrder.size(); ++b)
+        {
+            const Standard_Integer j = anOrder[b];
+            if (!isClose(mySolids[i].Print.Volume, mySolids[j].Print.Volume, THE_PRINT_TOLERANCE))
+                break;
+            if (!isAssigned[j] && mySolids[i].Print.IsSimilar(mySolids[j].Print, THE_PRINT_TOLERANCE))
+            {
+                isAssigned[j] = 1;
+                aCluster.push_back(j);
+            }
+        }
+        if (aCluster.size() > 1)
+            aClusters.push_back(aCluster);
+    }
+
+    // 每组的其余实体与代表并行校验，未通过的另成一组，直到没有候选组
+    struct Pair
+    {
+        Standard_Integer From;
+        Standard_Integer To;
+        bool             IsMatch;
+        gp_Trsf          Trsf;
+    };
+    while (!aClusters.empty())
+    {
+        std::vector<Pair> aPairs;
+        for (size_t c = 0; c < aClusters.size(); ++c)
+        {
+            for (size_t k = 1; k < aClusters[c].size(); ++k)
+            {
+                Pair aPair;
+                aPair.From    = aClusters[c][0];
+                aPair.To      = aClusters[c][k];
+                aPair.IsMatch = false;
+                aPairs.push_back(aPair);
+            }
+        }
+
+        OSD_Parallel::For(0, (Standard_Integer)aPairs.size(), [&](const Standard_Integer theIndex) {
+            Pair &        aPair = aPairs[theIndex];
+            const Record &aFrom = mySolids[aPair.From];
+            const Record &aTo   = mySolids[aPair.To];
+
+            // 已经共享TShape的实体只差位置
+            if (aFrom.Solid.IsPartner(aTo.Solid))
+            {
+                aPair.Trsf = aTo.Solid.Location().Transformation();
+                aPair.Trsf.Multiply(aFrom.Solid.Location().Transformation().Inverted());
+                aPair.IsMatch = true;
+                return;
+            }
+
+            std::vector<gp_Trsf> aCandidates;
+            candidates(aFrom, aTo, aCandidates);
+            for (size_t i = 0; i < aCandidates.size() && !aPair.IsMatch; ++i)
+            {
+                if (verify(aFrom, aTo, aCandidates[i]))
+                {
+                    aPair.IsMatch = true;
+                    aPair.Trsf    = aCandidates[i];
+                }
+            }
+        });
+
+        std::vector<std::vector<Standard_Integer>> aNext;
+        size_t                                     p = 0;
+        for (size_t c = 0; c < aClusters.size(); ++c)
+        {
+            std::vector<Standard_Integer> aRest;
+            bool                          hasMatch = false;
+            for (size_t k = 1; k < aClusters[c].size(); ++k, ++p)
+            {
+                const Pair &aPair = aPairs[p];
+                if (!aPair.IsMatch)
+                {
+                    aRest.push_back(aPair.To);
+                    ++myStats.NbRejected;
+                    continue;
+                }
+
+                Record &aTo        = mySolids[aPair.To];
+                aTo.Representative = aPair.From;
+                aTo.Placement      = aPair.Trsf;
+                hasMatch           = true;
+                ++myStats.NbDuplicates;
+                if (!aTo.Solid.IsPartner(mySolids[aPair.From].Solid))
+                    myStats.SavedBytes += MeshBytes(aTo.Solid);
+            }
+            if (hasMatch)
+                ++myStats.NbGroups;
+            if (aRest.size() > 1)
+                aNext.push_back(aRest);
+        }
+        aClusters.swap(aNext);
+    }
+    myStats.VerifyMs = aTimer.nsecsElapsed() / 1.0e6;
+}
+
+TopoDS_Shape DuplicateFinder::Share(const Standard_Integer theShape) const
+{
+    const TopoDS_Shape &      aShape    = myShapes[theShape];
+    Handle(BRepTools_ReShape) aReShape  = new BRepTools_ReShape();
+    bool                      isChanged = false;
+    for (size_t i = 0; i < mySolids.size(); ++i)
+    {
+        const Record &aRecord = mySolids[i];
+        if (aRecord.Shape != theShape || aRecord.Representative == (Standard_Integer)i
+            || aRecord.Solid.IsPartner(mySolids[aRecord.Representative].Solid))
+            continue;
+
+        const TopoDS_Shape anInstance =
+            mySolids[aRecord.Representative].Solid.Moved(TopLoc_Location(aRecord.Placement));
+        if (aRecord.Solid.IsSame(aShape))
+            return anInstance;
+
+        aReShape->Replace(aRecord.Solid, anInstance);
+        isChanged = true;
+    }
+    return isChanged ? aReShape->Apply(aShape) : aShape;
+}
+
+qint64 DuplicateFinder::MeshBytes(const TopoDS_Shape &theShape)
+{
+    TopTools_IndexedMapOfShape aFaces;
+    TopExp::MapShapes(theShape, TopAbs_FACE, aFaces);
+
+    TopTools_MapOfShape aVisited;
+    qint64              aBytes = 0;
+    for (Standard_Integer i = 1; i <= aFaces.Extent(); ++i)
+    {
+        const TopoDS_Face &aFace = TopoDS::Face(aFaces(i));
+        if (!aVisited.Add(aFace.Located(TopLoc_Location())))
+            continue;
+
+        TopLoc_Location                   aLoc;
+        const Handle(Poly_Triangulation) &aTri = BRep_Tool::Triangulation(aFace, aLoc);
+        if (aTri.IsNull())
+            continue;
+
+        qint64 aNodeBytes = sizeof(gp_Pnt);
+        if (aTri->HasUVNodes())
+            aNodeBytes += sizeof(gp_Pnt2d);
+        if (aTri->HasNormals())
+            aNodeBytes += 3 * sizeof(Standard_ShortReal);
+        aBytes += aTri->NbNodes() * aNodeBytes + aTri->NbTriangles() * (qint64)sizeof(Poly_Triangle);
+    }
+    return aBytes;
+}
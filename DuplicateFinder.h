@@ -0,0 +1,124 @@
+#ifndef DUPLICATEFINDER_H
+#define DUPLICATEFINDER_H
+
+#include <vector>
+
+#include <QtGlobal>
+
+#include <GeomAbs_SurfaceType.hxx>
+#include <TopoDS_Shape.hxx>
+#include <gp_Dir.hxx>
+#include <gp_Pnt.hxx>
+#include <gp_Trsf.hxx>
+
+/// \brief DuplicateFinder
+///
+/// 按几何查找重复的实体。导出的文件中许多零件几何相同，却作为不同的产品分别定义，
+/// 彼此不共享TShape，剖分和显示都要重复做：
+///
+/// - 每个实体并行(OSD_Parallel)计算指纹：体积、面积、主惯性矩、有向包围盒(Bnd_OBB)的尺寸、
+///   面/边/顶点数以及曲面类型直方图；指纹与刚体变换无关
+/// - 指纹一致的实体以第一个为代表，求代表到其余实体的刚体变换(不含镜像)：主惯性矩互不相同时
+///   取主轴的4种符号组合，有相同的主惯性矩(回转体、立方体)时以离质心最远的两个顶点定标架
+/// - 候选变换逐一精确校验，全部顶点、全部面(曲面类型、面积、质心)在容差内一一对应才算重复，
+///   校验同样并行；未通过的实体另成一组继续比较
+/// - Share把重复实体替换为代表实体带位置的副本，共享TShape，三角网格只剖分、存储一份
+class DuplicateFinder
+{
+public:
+    //! 曲面类型直方图的长度
+    static const Standard_Integer THE_NB_SURFACE_TYPES = GeomAbs_OtherSurface + 1;
+
+    struct Fingerprint
+    {
+        Standard_Real    Volume;
+        Standard_Real    Area;
+        Standard_Real    Moments[3];       ///< 主惯性矩，升序
+        Standard_Real    Extents[3];       ///< 有向包围盒的半尺寸，升序
+        Standard_Integer NbFaces;
+        Standard_Integer NbEdges;
+        Standard_Integer NbVertices;
+        Standard_Integer SurfaceTypes[THE_NB_SURFACE_TYPES];
+
+        /// \brief 质量属性在相对误差theTolerance内一致，有向包围盒是近似的，至少按1%比较；
+        /// 直方图与拓扑数目须完全相同
+        bool IsSimilar(const Fingerprint &theOther, const Standard_Real theTolerance) const;
+    };
+
+    struct Statistics
+    {
+        Standard_Integer NbSolids;
+        Standard_Integer NbGroups;         ///< 有重复的组数
+        Standard_Integer NbDuplicates;     ///< 可以由代表替换的实体数
+        Standard_Integer NbRejected;       ///< 指纹一致但校验未通过的次数
+        double           FingerprintMs;
+        double           VerifyMs;
+        qint64           SavedBytes;       ///< 重复实体现有三角网格的字节数，共享后释放
+    };
+
+    /// \param theTolerance，校验时顶点、面质心的距离容差(mm)
+    explicit DuplicateFinder(const Standard_Real theTolerance = 1.0e-3);
+
+    /// \brief 查找theShapes中全部实体之间的重复，结果覆盖上一次
+    void Perform(const std::vector<TopoDS_Shape> &theShapes);
+
+    Standard_Integer NbSolids() const { return (Standard_Integer)mySolids.size(); }
+
+    /// \brief 实体所在形状的序号与实体本身(在所在形状的坐标系中)
+    Standard_Integer    ShapeOf(const Standard_Integer theSolid) const { return mySolids[theSolid].Shape; }
+    const TopoDS_Shape &Solid(const Standard_Integer theSolid) const { return mySolids[theSolid].Solid; }
+
+    const Fingerprint &GetFingerprint(const Standard_Integer theSolid) const { return mySolids[theSolid].Print; }
+
+    /// \brief 所在组的代表实体，没有重复或本身是代表时为自身
+    Standard_Integer Representative(const Standard_Integer theSolid) const { return mySolids[theSolid].Representative; }
+
+    /// \brief 代表实体到该实体的刚体变换
+    const gp_Trsf &Placement(const Standard_Integer theSolid) const { return mySolids[theSolid].Placement; }
+
+    /// \brief 第theShape个形状中的重复实体替换为代表实体带位置的副本，没有重复时原样返回
+    TopoDS_Shape Share(const Standard_Integer theShape) const;
+
+    const Statistics &Stats() const { return myStats; }
+
+    /// \brief 形状的三角网格字节数，共享TShape的面只计一次
+    static qint64 MeshBytes(const TopoDS_Shape &theShape);
+
+private:
+    struct FaceSignature
+    {
+        Standard_Integer Type;
+        Standard_Real    Area;
+        gp_Pnt           Centroid;
+    };
+
+    struct Record
+    {
+        Standard_Integer           Shape;
+        TopoDS_Shape               Solid;
+        Fingerprint                Print;
+        gp_Pnt                     Center;         ///< 质心
+        gp_Dir                     AxisX;          ///< 最小、中间主惯性矩的主轴
+        gp_Dir                     AxisY;
+        bool                       IsDegenerate;   ///< 有相同的主惯性矩，主轴不确定
+        std::vector<gp_Pnt>        Vertices;
+        std::vector<FaceSignature> Faces;
+        Standard_Integer           Representative;
+        gp_Trsf                    Placement;
+    };
+
+    static void compute(Record &theRecord);
+
+    /// \brief theFrom到theTo的候选刚体变换
+    void candidates(const Record &theFrom, const Record &theTo, std::vector<gp_Trsf> &theResult) const;
+
+    /// \brief theFrom经theTrsf变换后与theTo的顶点、面一一对应
+    bool verify(const Record &theFrom, const Record &theTo, const gp_Trsf &theTrsf) const;
+
+    Standard_Real             myTolerance;
+    std::vector<TopoDS_Shape> myShapes;
+    std::vector<Record>       mySolids;
+    Statistics                myStats;
+};
+
+#endif    // DUPLICATEFINDER_H
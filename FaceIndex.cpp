@@ -0,0 +1,386 @@
+#include "FaceIndex.h"
+#include "ShapeUtils.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include <BRepAdaptor_Surface.hxx>
+#include <BRepBndLib.hxx>
+#include <BRepGProp.hxx>
+#include <BRepLProp_SLProps.hxx>
+#include <BRepTools.hxx>
+#include <BRep_Tool.hxx>
+#include <Bnd_Box.hxx>
+#include <GProp_GProps.hxx>
+#include <OSD_Parallel.hxx>
+#include <Poly_Triangulation.hxx>
+#include <Precision.hxx>
+#include <StdSelect_BRepOwner.hxx>
+#include <TopExp.hxx>
+#include <TopoDS.hxx>
+
+
+namespace
+{
+    //! 每个扫描块的行数，块内先生成掩码再收集行号，掩码循环可以被编译器向量化
+    const Standard_Integer THE_SCAN_BLOCK = 65536;
+
+    //! 有三角网格时用三角形面积之和，避免对曲面做数值积分
+    Standard_Real faceArea(const TopoDS_Face &theFace)
+    {
+        TopLoc_Location                  aLoc;
+        const Handle(Poly_Triangulation) &aTris = BRep_Tool::Triangulation(theFace, aLoc);
+        if (aTris.IsNull())
+        {
+            GProp_GProps aProps;
+            BRepGProp::SurfaceProperties(theFace, aProps);
+            return aProps.Mass();
+        }
+
+        const gp_Trsf &aTrsf = aLoc.Transformation();
+        Standard_Real  anArea = 0.0;
+        for (Standard_Integer i = 1; i <= aTris->NbTriangles(); ++i)
+        {
+            Standard_Integer n1, n2, n3;
+            aTris->Triangle(i).Get(n1, n2, n3);
+            const gp_Pnt p1 = aTris->Node(n1).Transformed(aTrsf);
+            const gp_Pnt p2 = aTris->Node(n2).Transformed(aTrsf);
+            const gp_Pnt p3 = aTris->Node(n3).Transformed(aTrsf);
+            anArea += 0.5 * gp_Vec(p1, p2).Crossed(gp_Vec(p1, p3)).Magnitude();
+        }
+        return anArea;
+    }
+}    // namespace
+
+
+FaceIndex::Query::Query()
+    : SurfaceType(-1)
+    , MinArea(0.0)
+    , MaxArea(RealLast())
+    , UseNormal(Standard_False)
+    , Normal(0.0, 0.0, 1.0)
+    , MaxAngle(0.0)
+    , Material(-2)
+{
+}
+
+FaceIndex::Query FaceIndex::Query::Similar(const FaceIndex &theIndex, const Standard_Integer theRow,
+                                           const Standard_Real theTolerance)
+{
+    Query aQuery;
+    aQuery.SurfaceType = theIndex.SurfaceType(theRow);
+    aQuery.MinArea     = theIndex.Area(theRow) * (1.0 - theTolerance);
+    aQuery.MaxArea     = theIndex.Area(theRow) * (1.0 + theTolerance);
+    aQuery.Material    = theIndex.Material(theRow);
+    if (aQuery.SurfaceType == GeomAbs_Plane)
+    {
+        aQuery.UseNormal = Standard_True;
+        aQuery.Normal    = theIndex.Normal(theRow);
+        aQuery.MaxAngle  = theTolerance;
+    }
+    return aQuery;
+}
+
+FaceIndex::FaceIndex()
+    : myNbComputed(0)
+{
+}
+
+void FaceIndex::Add(const Handle(AIS_Shape) & theShape, const Standard_Integer theMaterial)
+{
+    if (theShape.IsNull())
+        return;
+
+    Remove(theShape);
+
+    ObjectRange aRange;
+    aRange.Shape          = theShape;
+    aRange.First          = Size();
+    aRange.Transformation = theShape->LocalTransformationGeom();
+    TopExp::MapShapes(theShape->Shape(), TopAbs_FACE, aRange.Faces);
+
+    const Standard_Integer anId    = (Standard_Integer)myObjects.size();
+    const Standard_Integer aNbRows = aRange.Faces.Extent();
+    const size_t           aSize   = myFaces.size() + aNbRows;
+
+    // 属性用世界坐标的面计算，其面的顺序与aRange.Faces一致
+    TopTools_IndexedMapOfShape aWorldFaces;
+    TopExp::MapShapes(ShapeUtils::WorldShape(theShape), TopAbs_FACE, aWorldFaces);
+    for (Standard_Integer i = 1; i <= aWorldFaces.Extent(); ++i)
+        myFaces.push_back(TopoDS::Face(aWorldFaces(i)));
+
+    myOwners.resize(aSize, anId);
+    myTypes.resize(aSize, (unsigned char)GeomAbs_OtherSurface);
+    myAreas.resize(aSize, 0.0f);
+    myNormalX.resize(aSize, 0.0f);
+    myNormalY.resize(aSize, 0.0f);
+    myNormalZ.resize(aSize, 1.0f);
+    myBoxes.resize(aSize * 6, 0.0f);
+    myMaterials.resize(aSize, (short)theMaterial);
+
+    myObjects.push_back(aRange);
+    myObjectIds.Bind(theShape, anId);
+}
+
+void FaceIndex::Remove(const Handle(AIS_Shape) & theShape)
+{
+    const Standard_Integer *anIdPtr = myObjectIds.Seek(theShape);
+    if (anIdPtr == NULL)
+        return;
+
+    const Standard_Integer anId    = *anIdPtr;
+    const Standard_Integer aFirst  = myObjects[anId].First;
+    const Standard_Integer aNbRows = myObjects[anId].Faces.Extent();
+    const Standard_Integer aLast   = aFirst + aNbRows;
+
+    myFaces.erase(myFaces.begin() + aFirst, myFaces.begin() + aLast);
+    myOwners.erase(myOwners.begin() + aFirst, myOwners.begin() + aLast);
+    myTypes.erase(myTypes.begin() + aFirst, myTypes.begin() + aLast);
+    myAreas.erase(myAreas.begin() + aFirst, myAreas.begin() + aLast);
+    myNormalX.erase(myNormalX.begin() + aFirst, myNormalX.begin() + aLast);
+    myNormalY.erase(myNormalY.begin() + aFirst, myNormalY.begin() + aLast);
+    myNormalZ.erase(myNormalZ.begin() + aFirst, myNormalZ.begin() + aLast);
+    myBoxes.erase(myBoxes.begin() + aFirst * 6, myBoxes.begin() + aLast * 6);
+    myMaterials.erase(myMaterials.begin() + aFirst, myMaterials.begin() + aLast);
+
+    // 已计算的部分是前缀，减去被删除行中落在前缀内的数目
+    myNbComputed -= std::max(0, std::min(myNbComputed, aLast) - aFirst);
+
+    myObjects.erase(myObjects.begin() + anId);
+    myObjectIds.UnBind(theShape);
+    for (size_t i = anId; i < myObjects.size(); ++i)
+    {
+        myObjects[i].First -= aNbRows;
+        myObjectIds.ChangeFind(myObjects[i].Shape) = (Standard_Integer)i;
+    }
+    for (size_t i = aFirst; i < myOwners.size(); ++i)
+        --myOwners[i];
+}
+
+void FaceIndex::Clear()
+{
+    myObjects.clear();
+    myObjectIds.Clear();
+    myNbComputed = 0;
+
+    myFaces.clear();
+    myOwners.clear();
+    myTypes.clear();
+    myAreas.clear();
+    myNormalX.clear();
+    myNormalY.clear();
+    myNormalZ.clear();
+    myBoxes.clear();
+    myMaterials.clear();
+}
+
+void FaceIndex::SetMaterial(const Handle(AIS_Shape) & theShape, const Standard_Integer theMaterial)
+{
+    const Standard_Integer *anIdPtr = myObjectIds.Seek(theShape);
+    if (anIdPtr == NULL)
+        return;
+
+    const ObjectRange &aRange = myObjects[*anIdPtr];
+    std::fill(myMaterials.begin() + aRange.First, myMaterials.begin() + aRange.First + aRange.Faces.Extent(),
+              (short)theMaterial);
+}
+
+void FaceIndex::Update()
+{
+    // SetLocalTransformation每次都替换变换对象，只比较句柄即可发现过期的对象；重新登记后其行移到表尾
+    std::vector<Handle(AIS_Shape)> aMoved;
+    for (size_t i = 0; i < myObjects.size(); ++i)
+    {
+        if (myObjects[i].Transformation != myObjects[i].Shape->LocalTransformationGeom())
+            aMoved.push_back(myObjects[i].Shape);
+    }
+    for (size_t i = 0; i < aMoved.size(); ++i)
+    {
+        const ObjectRange &    aRange    = myObjects[myObjectIds.Find(aMoved[i])];
+        const Standard_Integer aMaterial = aRange.Faces.IsEmpty() ? -1 : myMaterials[aRange.First];
+        Add(aMoved[i], aMaterial);
+    }
+
+    const Standard_Integer aFirst = myNbComputed;
+    const Standard_Integer aCount = Size() - aFirst;
+    if (aCount <= 0)
+        return;
+
+    OSD_Parallel::For(0, aCount, [&](const Standard_Integer theIndex) {
+        computeRow(aFirst + theIndex);
+    });
+    myNbComputed = Size();
+}
+
+void FaceIndex::computeRow(const Standard_Integer theRow)
+{
+    const TopoDS_Face &aFace = myFaces[theRow];
+
+    BRepAdaptor_Surface aSurf(aFace);
+    myTypes[theRow] = (unsigned char)aSurf.GetType();
+    myAreas[theRow] = (float)faceArea(aFace);
+
+    gp_Dir aNormal(0.0, 0.0, 1.0);
+    if (aSurf.GetType() == GeomAbs_Plane)
+    {
+        aNormal = aSurf.Plane().Axis().Direction();
+    }
+    else
+    {
+        Standard_Real u1, u2, v1, v2;
+        BRepTools::UVBounds(aFace, u1, u2, v1, v2);
+        BRepLProp_SLProps aProps(aSurf, 0.5 * (u1 + u2), 0.5 * (v1 + v2), 1, Precision::Confusion());
+        if (aProps.IsNormalDefined())
+            aNormal = aProps.Normal();
+    }
+    if (aFace.Orientation() == TopAbs_REVERSED)
+        aNormal.Reverse();
+    myNormalX[theRow] = (float)aNormal.X();
+    myNormalY[theRow] = (float)aNormal.Y();
+    myNormalZ[theRow] = (float)aNormal.Z();
+
+    Bnd_Box aBox;
+    BRepBndLib::Add(aFace, aBox, Standard_True);
+    if (!aBox.IsVoid())
+    {
+        Standard_Real aMin[3], aMax[3];
+        aBox.Get(aMin[0], aMin[1], aMin[2], aMax[0], aMax[1], aMax[2]);
+        float *aDst = &myBoxes[theRow * 6];
+        for (int i = 0; i < 3; ++i)
+        {
+            aDst[i]     = (float)aMin[i];
+            aDst[i + 3] = (float)aMax[i];
+        }
+    }
+}
+
+Standard_Integer FaceIndex::Row(const Handle(AIS_Shape) & theShape, const TopoDS_Shape &theFace) const
+{
+    const Standard_Integer *anIdPtr = myObjectIds.Seek(theShape);
+    if (anIdPtr == NULL)
+        return -1;
+
+    const ObjectRange &    aRange = myObjects[*anIdPtr];
+    const Standard_Integer anIdx  = aRange.Faces.FindIndex(theFace);
+    return anIdx > 0 ? aRange.First + anIdx - 1 : -1;
+}
+
+gp_Dir FaceIndex::Normal(const Standard_Integer theRow) const
+{
+    return gp_Dir(myNormalX[theRow], myNormalY[theRow], myNormalZ[theRow]);
+}
+
+bool FaceIndex::Matches(const Standard_Integer theRow, const Query &theQuery) const
+{
+    if (theQuery.SurfaceType >= 0 && myTypes[theRow] != theQuery.SurfaceType)
+        return false;
+    if (myAreas[theRow] < theQuery.MinArea || myAreas[theRow] > theQuery.MaxArea)
+        return false;
+    if (theQuery.Material != -2 && myMaterials[theRow] != theQuery.Material)
+        return false;
+    if (!theQuery.Box.IsVoid())
+    {
+        Bnd_Box       aBox;
+        const float *aSrc = &myBoxes[theRow * 6];
+        aBox.Update(aSrc[0], aSrc[1], aSrc[2], aSrc[3], aSrc[4], aSrc[5]);
+        if (theQuery.Box.IsOut(aBox))
+            return false;
+    }
+    if (theQuery.UseNormal)
+    {
+        const Standard_Real aDot = myNormalX[theRow] * theQuery.Normal.X() + myNormalY[theRow] * theQuery.Normal.Y()
+                                   + myNormalZ[theRow] * theQuery.Normal.Z();
+        if (std::fabs(aDot) < std::cos(theQuery.MaxAngle))
+            return false;
+    }
+    return true;
+}
+
+std::vector<Standard_Integer> FaceIndex::Find(const Query &theQuery)
+{
+    Update();
+
+    const Standard_Integer                     aNbBlocks = (Size() + THE_SCAN_BLOCK - 1) / THE_SCAN_BLOCK;
+    std::vector<std::vector<Standard_Integer>> aBlocks(aNbBlocks);
+    OSD_Parallel::For(0, aNbBlocks, [&](const Standard_Integer theBlock) {
+        const Standard_Integer aFirst = theBlock * THE_SCAN_BLOCK;
+        scan(theQuery, aFirst, std::min(aFirst + THE_SCAN_BLOCK, Size()), aBlocks[theBlock]);
+    });
+
+    std::vector<Standard_Integer> aRows;
+    for (size_t i = 0; i < aBlocks.size(); ++i)
+        aRows.insert(aRows.end(), aBlocks[i].begin(), aBlocks[i].end());
+    return aRows;
+}
+
+void FaceIndex::scan(const Query &theQuery, const Standard_Integer theFirst, const Standard_Integer theLast,
+                     std::vector<Standard_Integer> &theRows) const
+{
+    // 条件统一成不分支的比较，不限制的条件取恒真的参数
+    const int   aType    = theQuery.SurfaceType;
+    const float aMinArea = (float)std::max(theQuery.MinArea, 0.0);
+    const float aMaxArea = theQuery.MaxArea < FLT_MAX ? (float)theQuery.MaxArea : FLT_MAX;
+    const int   aMat     = theQuery.Material;
+    const float nx       = theQuery.UseNormal ? (float)theQuery.Normal.X() : 0.0f;
+    const float ny       = theQuery.UseNormal ? (float)theQuery.Normal.Y() : 0.0f;
+    const float nz       = theQuery.UseNormal ? (float)theQuery.Normal.Z() : 0.0f;
+    const float aMinDot  = theQuery.UseNormal ? (float)std::cos(theQuery.MaxAngle) : 0.0f;
+
+    float aBoxMin[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    float aBoxMax[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    if (!theQuery.Box.IsVoid())
+    {
+        Standard_Real aMin[3], aMax[3];
+        theQuery.Box.Get(aMin[0], aMin[1], aMin[2], aMax[0], aMax[1], aMax[2]);
+        for (int i = 0; i < 3; ++i)
+        {
+            aBoxMin[i] = (float)std::max(aMin[i], (Standard_Real)-FLT_MAX);
+            aBoxMax[i] = (float)std::min(aMax[i], (Standard_Real)FLT_MAX);
+        }
+    }
+
+    const unsigned char *aTypes = myTypes.data();
+    const float *        anAreas = myAreas.data();
+    const float *        aNx    = myNormalX.data();
+    const float *        aNy    = myNormalY.data();
+    const float *        aNz    = myNormalZ.data();
+    const short *        aMats  = myMaterials.data();
+    const float *        aBoxes = myBoxes.data();
+
+    std::vector<unsigned char> aMask(theLast - theFirst);
+    for (Standard_Integer r = theFirst; r < theLast; ++r)
+    {
+        const float  aDot = std::fabs(aNx[r] * nx + aNy[r] * ny + aNz[r] * nz);
+        const float *aBox = aBoxes + r * 6;
+        const bool   isIn = (aBox[0] <= aBoxMax[0]) & (aBox[1] <= aBoxMax[1]) & (aBox[2] <= aBoxMax[2])
+                          & (aBox[3] >= aBoxMin[0]) & (aBox[4] >= aBoxMin[1]) & (aBox[5] >= aBoxMin[2]);
+        aMask[r - theFirst] = (unsigned char)((aType < 0 || aTypes[r] == aType) & (anAreas[r] >= aMinArea)
+                                              & (anAreas[r] <= aMaxArea) & (aMat == -2 || aMats[r] == aMat)
+                                              & (aDot >= aMinDot) & isIn);
+    }
+
+    for (Standard_Integer r = theFirst; r < theLast; ++r)
+    {
+        if (aMask[r - theFirst])
+            theRows.push_back(r);
+    }
+}
+
+// =======================================================================
+// FaceIndexFilter
+// =======================================================================
+
+Standard_Boolean FaceIndexFilter::IsOk(const Handle(SelectMgr_EntityOwner) & theOwner) const
+{
+    const Handle(StdSelect_BRepOwner) aBRepOwner = Handle(StdSelect_BRepOwner)::DownCast(theOwner);
+    if (aBRepOwner.IsNull() || !aBRepOwner->HasShape() || aBRepOwner->Shape().ShapeType() != TopAbs_FACE)
+        return Standard_True;
+
+    const Handle(AIS_Shape) aShape = Handle(AIS_Shape)::DownCast(aBRepOwner->Selectable());
+    const Standard_Integer  aRow   = myIndex->Row(aShape, aBRepOwner->Shape());
+    if (aRow < 0 || !myIndex->IsComputed(aRow))
+        return Standard_True;
+
+    return myIndex->Matches(aRow, myQuery);
+}
@@ -0,0 +1,146 @@
+#ifndef FACEINDEX_H
+#define FACEINDEX_H
+
+#include <vector>
+
+#include <AIS_Shape.hxx>
+#include <Bnd_Box.hxx>
+#include <GeomAbs_SurfaceType.hxx>
+#include <NCollection_DataMap.hxx>
+#include <SelectMgr_Filter.hxx>
+#include <TColStd_MapTransientHasher.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
+#include <TopoDS_Face.hxx>
+#include <gp_Dir.hxx>
+
+/// \brief FaceIndex
+///
+/// 已显示对象全部面的属性表：曲面类型、面积、法向、包围盒(世界坐标)以及材质。
+/// 属性按列(structure of arrays)连续存放，选择过滤与"选择相似面"只扫描需要的列，
+/// 不再在拾取时遍历B-rep几何。
+///
+/// - 加入对象时只登记面(TopExp::MapShapes)，属性在下一次查询前(或显式调用Update)
+///   用OSD_Parallel对所有新加入的面一次性并行计算
+/// - 面的行号 = 对象的起始行 + 面在对象中的序号，由StdSelect_BRepOwner查行号是O(1)的
+/// - 法向对平面是平面法向，对其他曲面是参数域中点处的法向，只用于相似性比较
+/// - 对象的局部变换改变后，其世界坐标的属性(包围盒、法向)在下一次Update时重新计算
+class FaceIndex
+{
+public:
+    /// \brief 查询条件，默认值表示不限制
+    struct Query
+    {
+        Standard_Integer SurfaceType;    ///< GeomAbs_SurfaceType，-1为任意
+        Standard_Real    MinArea;
+        Standard_Real    MaxArea;
+        Standard_Boolean UseNormal;
+        gp_Dir           Normal;
+        Standard_Real    MaxAngle;      ///< 与Normal的最大夹角(弧度)，正反方向都算
+        Standard_Integer Material;      ///< 材质编号，-2为任意，-1为未分配
+        Bnd_Box          Box;           ///< 面的包围盒须与之相交，为空时不限制
+
+        Query();
+
+        /// \brief 与给定行"相似"的面：曲面类型与材质相同，面积相对误差在theTolerance内，
+        /// 平面还要求法向平行
+        static Query Similar(const FaceIndex &theIndex, const Standard_Integer theRow,
+                             const Standard_Real theTolerance = 0.01);
+    };
+
+    FaceIndex();
+
+    /// \brief 登记一个已显示对象的全部面，已存在时先移除
+    void Add(const Handle(AIS_Shape) & theShape, const Standard_Integer theMaterial = -1);
+
+    void Remove(const Handle(AIS_Shape) & theShape);
+
+    void Clear();
+
+    /// \brief 对象的材质改变后更新其全部面的材质列
+    void SetMaterial(const Handle(AIS_Shape) & theShape, const Standard_Integer theMaterial);
+
+    /// \brief 重新登记局部变换已改变的对象，并行计算尚未计算的面属性；查询会自动调用。
+    /// 拾取时不调用(见FaceIndexFilter)，由视图在处理鼠标事件前调用
+    void Update();
+
+    /// \brief 行属性已经计算
+    bool IsComputed(const Standard_Integer theRow) const { return theRow < myNbComputed; }
+
+    Standard_Integer Size() const { return (Standard_Integer)myFaces.size(); }
+
+    /// \brief 面所在的行，不在索引中时返回-1
+    Standard_Integer Row(const Handle(AIS_Shape) & theShape, const TopoDS_Shape &theFace) const;
+
+    const TopoDS_Face &       Face(const Standard_Integer theRow) const { return myFaces[theRow]; }
+    const Handle(AIS_Shape) & Object(const Standard_Integer theRow) const { return myObjects[myOwners[theRow]].Shape; }
+
+    GeomAbs_SurfaceType SurfaceType(const Standard_Integer theRow) const { return (GeomAbs_SurfaceType)myTypes[theRow]; }
+    Standard_Real       Area(const Standard_Integer theRow) const { return myAreas[theRow]; }
+    gp_Dir              Normal(const Standard_Integer theRow) const;
+    Standard_Integer    Material(const Standard_Integer theRow) const { return myMaterials[theRow]; }
+
+    /// \brief 单行判断，供选择过滤器使用
+    bool Matches(const Standard_Integer theRow, const Query &theQuery) const;
+
+    /// \brief 扫描全表，返回满足条件的行
+    std::vector<Standard_Integer> Find(const Query &theQuery);
+
+private:
+    struct ObjectRange
+    {
+        Handle(AIS_Shape)          Shape;
+        Standard_Integer           First;    ///< 起始行
+        TopTools_IndexedMapOfShape Faces;
+        Handle(Standard_Transient) Transformation;    ///< 登记时的局部变换，对象的变换对象被替换即为过期
+    };
+
+    void computeRow(const Standard_Integer theRow);
+    void scan(const Query &theQuery, const Standard_Integer theFirst, const Standard_Integer theLast,
+              std::vector<Standard_Integer> &theRows) const;
+
+    std::vector<ObjectRange> myObjects;
+    Standard_Integer         myNbComputed;    ///< [0, myNbComputed)的行属性已计算
+
+    // 按列存放的属性
+    std::vector<TopoDS_Face>      myFaces;
+    std::vector<Standard_Integer> myOwners;    ///< myObjects下标
+    std::vector<unsigned char>    myTypes;
+    std::vector<float>            myAreas;
+    std::vector<float>            myNormalX;
+    std::vector<float>            myNormalY;
+    std::vector<float>            myNormalZ;
+    std::vector<float>            myBoxes;     ///< 每行6个值：xmin ymin zmin xmax ymax zmax
+    std::vector<short>            myMaterials;
+
+    NCollection_DataMap<Handle(AIS_Shape), Standard_Integer, TColStd_MapTransientHasher> myObjectIds;
+};
+
+/// \brief FaceIndexFilter
+///
+/// 基于FaceIndex的面选择过滤器，IsOk只是一次行号查找和一次行判断，不更新索引。
+/// 不在索引中、属性尚未计算的面(或非面的owner)按原样放行。
+class FaceIndexFilter : public SelectMgr_Filter
+{
+public:
+    FaceIndexFilter(FaceIndex *theIndex, const FaceIndex::Query &theQuery)
+        : myIndex(theIndex)
+        , myQuery(theQuery)
+    {
+    }
+
+    void                    SetQuery(const FaceIndex::Query &theQuery) { myQuery = theQuery; }
+    const FaceIndex::Query &GetQuery() const { return myQuery; }
+
+    virtual Standard_Boolean IsOk(const Handle(SelectMgr_EntityOwner) & theOwner) const Standard_OVERRIDE;
+    virtual Standard_Boolean ActsOn(const TopAbs_ShapeEnum theType) const Standard_OVERRIDE { return theType == TopAbs_FACE; }
+
+    DEFINE_STANDARD_RTTI_INLINE(FaceIndexFilter, SelectMgr_Filter)
+
+private:
+    FaceIndex *      myIndex;
+    FaceIndex::Query myQuery;
+};
+
+DEFINE_STANDARD_HANDLE(FaceIndexFilter, SelectMgr_Filter)
+
+#endif    // FACEINDEX_H
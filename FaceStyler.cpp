@@ -0,0 +1,108 @@
+#include "FaceStyler.h"
+
+#include <AIS_ColoredDrawer.hxx>
+#include <NCollection_Map.hxx>
+#include <Prs3d_ShadingAspect.hxx>
+#include <TColStd_MapTransientHasher.hxx>
+
+
+namespace
+{
+    //! 外观的颜色和透明度是否与给定的样式相同
+    bool isStyle(const Handle(AIS_ColoredDrawer) & theDrawer, const Quantity_Color &theColor,
+                 const Standard_Real theTransparency)
+    {
+        const Handle(Prs3d_ShadingAspect) &anAspect = theDrawer->ShadingAspect();
+        return anAspect->Color().IsEqual(theColor) && Abs(anAspect->Transparency() - theTransparency) < 1.0e-6;
+    }
+
+    //! 绑定到theDrawer的子形状数目
+    Standard_Integer nbBound(const Handle(AIS_ColoredShape) & theShape, const Handle(AIS_ColoredDrawer) & theDrawer)
+    {
+        Standard_Integer aNb = 0;
+        for (AIS_DataMapOfShapeDrawer::Iterator anIter(theShape->CustomAspectsMap()); anIter.More(); anIter.Next())
+        {
+            if (anIter.Value() == theDrawer)
+                ++aNb;
+        }
+        return aNb;
+    }
+}    // namespace
+
+
+bool FaceStyler::Apply(const Handle(AIS_InteractiveContext) & theContext, const Handle(AIS_ColoredShape) & theShape,
+                       const std::vector<TopoDS_Shape> &theFaces, const Quantity_Color &theColor,
+                       const Standard_Real theTransparency)
+{
+    if (theShape.IsNull() || theFaces.empty())
+        return false;
+
+    // 这批面正好构成一个样式分组时原地改写外观，图元组引用的仍是同一个外观对象
+    Handle(AIS_ColoredDrawer) aCurrent;
+    bool                      isOneGroup = true;
+    for (size_t i = 0; i < theFaces.size() && isOneGroup; ++i)
+    {
+        Handle(AIS_ColoredDrawer) aDrawer;
+        isOneGroup = theShape->CustomAspectsMap().Find(theFaces[i], aDrawer) && (i == 0 || aDrawer == aCurrent);
+        aCurrent   = aDrawer;
+    }
+    if (isOneGroup && nbBound(theShape, aCurrent) == (Standard_Integer)theFaces.size()
+        && (aCurrent->ShadingAspect()->Transparency() > 0.0) == (theTransparency > 0.0))
+    {
+        theShape->SetCustomColor(theFaces.front(), theColor);
+        theShape->SetCustomTransparency(theFaces.front(), theTransparency);
+        theShape->SynchronizeAspects();
+        return false;
+    }
+
+    // 否则全部面绑定到同一个样式相同的外观上(没有时新建)，AIS_ColoredShape按外观分组，样式相同的面只占一个图元组
+    Handle(AIS_ColoredDrawer) aShared;
+    for (AIS_DataMapOfShapeDrawer::Iterator anIter(theShape->CustomAspectsMap()); anIter.More(); anIter.Next())
+    {
+        if (isStyle(anIter.Value(), theColor, theTransparency))
+        {
+            aShared = anIter.Value();
+            break;
+        }
+    }
+    if (aShared.IsNull())
+    {
+        // 先解除第一个面原来的外观，避免改写与其它面共享的外观
+        theShape->ChangeCustomAspectsMap().UnBind(theFaces.front());
+        theShape->SetCustomColor(theFaces.front(), theColor);
+        theShape->SetCustomTransparency(theFaces.front(), theTransparency);
+        aShared = theShape->CustomAspectsMap().Find(theFaces.front());
+    }
+    for (size_t i = 0; i < theFaces.size(); ++i)
+        theShape->ChangeCustomAspectsMap().Bind(theFaces[i], aShared);
+
+    theContext->Redisplay(theShape, Standard_False);
+    return true;
+}
+
+void FaceStyler::Reset(const Handle(AIS_InteractiveContext) & theContext, const Handle(AIS_ColoredShape) & theShape,
+                       const std::vector<TopoDS_Shape> &theFaces)
+{
+    if (theShape.IsNull())
+        return;
+
+    bool isChanged = false;
+    for (size_t i = 0; i < theFaces.size(); ++i)
+    {
+        if (theShape->CustomAspectsMap().IsBound(theFaces[i]))
+        {
+            theShape->UnsetCustomAspects(theFaces[i], Standard_True);
+            isChanged = true;
+        }
+    }
+    if (isChanged)
+        theContext->Redisplay(theShape, Standard_False);
+}
+
+Standard_Integer FaceStyler::NbDrawers(const Handle(AIS_ColoredShape) & theShape)
+{
+    NCollection_Map<Handle(AIS_ColoredDrawer), TColStd_MapTransientHasher> aDrawers;
+    for (AIS_DataMapOfShapeDrawer::Iterator anIter(theShape->CustomAspectsMap()); anIter.More(); anIter.Next())
+        aDrawers.Add(anIter.Value());
+    return aDrawers.Extent();
+}
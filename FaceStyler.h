@@ -0,0 +1,46 @@
+#ifndef FACESTYLER_H
+#define FACESTYLER_H
+
+#include <vector>
+
+#include <AIS_ColoredShape.hxx>
+#include <AIS_InteractiveContext.hxx>
+#include <Quantity_Color.hxx>
+#include <TopoDS_Shape.hxx>
+
+/// \brief FaceStyler
+///
+/// 单个面的颜色与透明度。面的样式保存在对象(AIS_ColoredShape)自身的子形状外观中，
+/// 每个实体仍然只有一个显示对象，样式相同的面合并在同一个图元组里，
+/// 不再需要把形状拆成每个面一个AIS_Shape。
+///
+/// 一次调用处理一批面，整批只刷新一次显示：
+/// - 这批面正好是一个样式分组且不透明/透明的状态不变时，只改写外观并同步(SynchronizeAspects)，不重新计算
+/// - 否则全部面绑定到一个样式相同的共享外观上(没有时新建)，重新计算一次对象的显示
+class FaceStyler
+{
+public:
+    /// \brief 批量设置面的颜色和透明度，不更新视图
+    ///
+    /// \param theFaces，theShape的形状中的面
+    /// \param theTransparency，[0, 1]，0为不透明
+    /// \return 是否重新计算了显示(false表示只同步了外观)
+    static bool Apply(const Handle(AIS_InteractiveContext) & theContext, const Handle(AIS_ColoredShape) & theShape,
+                      const std::vector<TopoDS_Shape> &theFaces, const Quantity_Color &theColor,
+                      const Standard_Real theTransparency = 0.0);
+
+    /// \brief 取消面的自定义样式，恢复为对象的颜色，不更新视图
+    static void Reset(const Handle(AIS_InteractiveContext) & theContext, const Handle(AIS_ColoredShape) & theShape,
+                      const std::vector<TopoDS_Shape> &theFaces);
+
+    /// \brief 对象中带有自定义样式的子形状数目
+    static Standard_Integer NbStyled(const Handle(AIS_ColoredShape) & theShape)
+    {
+        return theShape->CustomAspectsMap().Extent();
+    }
+
+    /// \brief 对象中不同的自定义外观数目，即样式分组(图元组)的数目
+    static Standard_Integer NbDrawers(const Handle(AIS_ColoredShape) & theShape);
+};
+
+#endif    // FACESTYLER_H
@@ -9,16 +9,19 @@
 
 #include <iostream>
 
+#include "Logger.h"
+
 // 用于提示dbg信息，在编译时使用
 
 #ifdef DEBUG
 #define dbginfo
-#define dbgFunTrace(x) std::cout << x << "@[" << __FILE__ << ":" << __FUNCTION__ << "]" << std::endl
 #else
 #define dbginfo 0 &&
-#define dbgFunTrace(x)
 #endif
 
+// 调试跟踪信息写入异步日志(DEBUG级别)，Release构建中在编译期被移除
+#define dbgFunTrace(x) LOG_DEBUG("trace", x << "@[" << __FILE__ << ":" << __FUNCTION__ << "]")
+
 // 用于提示API弃用情况
 #define G_DEPRECATED(theMsg) __attribute__((deprecated(theMsg)))
 
@@ -0,0 +1,538 @@
+#include "GltfExporter.h"
+
+#include "Gglobal.h"
+#include "MaterialLibrary.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QtEndian>
+
+#include <AIS_Shape.hxx>
+#include <BRepMesh_IncrementalMesh.hxx>
+#include <BRep_Tool.hxx>
+#include <OSD_Parallel.hxx>
+#include <Poly_Triangulation.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopoDS.hxx>
+
+
+namespace
+{
+    // glTF常量
+    const int GLTF_FLOAT          = 5126;
+    const int GLTF_BYTE           = 5120;
+    const int GLTF_UNSIGNED_INT   = 5125;
+    const int GLTF_ARRAY_BUFFER   = 34962;
+    const int GLTF_ELEMENT_BUFFER = 34963;
+
+    struct MaterialDef
+    {
+        QString        Name;
+        Quantity_Color Color;
+        double         Alpha;
+        double         Metallic;
+        double         Roughness;
+    };
+
+    //! 合并网格的键：(TShape, (方向, 材质))
+    typedef std::pair<const void *, std::pair<int, int>> SourceKey;
+
+    struct MeshSource
+    {
+        TopoDS_Shape     Shape;       ///< 不带Location的形状，Location放到节点矩阵中
+        Standard_Integer Material;
+    };
+
+    struct Instance
+    {
+        Standard_Integer Mesh;
+        gp_Trsf          Trsf;
+        QString          Name;
+    };
+
+    struct EncodedMesh
+    {
+        std::vector<float>   Positions;    ///< 每个顶点3个float
+        std::vector<qint8>   Normals;      ///< 每个顶点4个字节(第4个为对齐填充)
+        std::vector<quint32> Indices;
+        float                Min[3];
+        float                Max[3];
+        Standard_Integer     NbRaw;
+    };
+
+    //! 顶点去重的键：位置按位比较，法向使用量化后的值
+    struct VertexKey
+    {
+        quint32 P[3];
+        qint8   N[3];
+
+        bool operator==(const VertexKey &theOther) const
+        {
+            return P[0] == theOther.P[0] && P[1] == theOther.P[1] && P[2] == theOther.P[2]
+                   && N[0] == theOther.N[0] && N[1] == theOther.N[1] && N[2] == theOther.N[2];
+        }
+    };
+
+    struct VertexKeyHasher
+    {
+        size_t operator()(const VertexKey &theKey) const
+        {
+            size_t aHash = theKey.P[0];
+            aHash        = aHash * 31 + theKey.P[1];
+            aHash        = aHash * 31 + theKey.P[2];
+            aHash        = aHash * 31 + (quint8)theKey.N[0];
+            aHash        = aHash * 31 + (quint8)theKey.N[1];
+            aHash        = aHash * 31 + (quint8)theKey.N[2];
+            return aHash;
+        }
+    };
+
+    qint8 quantize(const double theValue)
+    {
+        return (qint8)std::lround(qBound(-1.0, theValue, 1.0) * 127.0);
+    }
+
+    //! 编码一个形状的全部三角网格。只读访问三角网格，法向在本地计算，不修改共享数据
+    void encode(const TopoDS_Shape &theShape, EncodedMesh &theMesh)
+    {
+        theMesh.NbRaw = 0;
+        for (int i = 0; i < 3; ++i)
+        {
+            theMesh.Min[i] = FLT_MAX;
+            theMesh.Max[i] = -FLT_MAX;
+        }
+
+        std::unordered_map<VertexKey, quint32, VertexKeyHasher> aVertexMap;
+        std::vector<gp_Pnt>                                     aPoints;
+        std::vector<gp_XYZ>                                     aNormals;
+        std::vector<quint32>                                    aRemap;
+
+        for (TopExp_Explorer anExp(theShape, TopAbs_FACE); anExp.More(); anExp.Next())
+        {
+            const TopoDS_Face &              aFace = TopoDS::Face(anExp.Current());
+            TopLoc_Location                  aLoc;
+            const Handle(Poly_Triangulation) &aTri = BRep_Tool::Triangulation(aFace, aLoc);
+            if (aTri.IsNull())
+                continue;
+
+            const bool                 isReversed = aFace.Orientation() == TopAbs_REVERSED;
+            const gp_Trsf &            aTrsf      = aLoc.Transformation();
+            const TColgp_Array1OfPnt & aNodes     = aTri->Nodes();
+            const Poly_Array1OfTriangle &aTris    = aTri->Triangles();
+            const Standard_Integer     aNbNodes   = aTri->NbNodes();
+
+            aPoints.resize(aNbNodes);
+            aNormals.assign(aNbNodes, gp_XYZ(0.0, 0.0, 0.0));
+            for (Standard_Integer i = 0; i < aNbNodes; ++i)
+                aPoints[i] = aNodes(aNodes.Lower() + i).Transformed(aTrsf);
+
+            // 按面积加权累加三角形法向
+            for (Standard_Integer t = aTris.Lower(); t <= aTris.Upper(); ++t)
+            {
+                Standard_Integer n1, n2, n3;
+                aTris(t).Get(n1, n2, n3);
+                if (isReversed)
+                    std::swap(n2, n3);
+
+                const gp_XYZ aCross = (aPoints[n2 - 1].XYZ() - aPoints[n1 - 1].XYZ())
+                                          .Crossed(aPoints[n3 - 1].XYZ() - aPoints[n1 - 1].XYZ());
+                aNormals[n1 - 1] += aCross;
+                aNormals[n2 - 1] += aCross;
+                aNormals[n3 - 1] += aCross;
+            }
+
+            aRemap.resize(aNbNodes);
+            for (Standard_Integer i = 0; i < aNbNodes; ++i)
+            {
+                const Standard_Real aLen = aNormals[i].Modulus();
+                const gp_XYZ        aN   = aLen > gp::Resolution() ? aNormals[i] / aLen : gp_XYZ(0.0, 0.0, 1.0);
+                const float         aP[3] = {(float)aPoints[i].X(), (float)aPoints[i].Y(), (float)aPoints[i].Z()};
+
+                VertexKey aKey;
+                std::memcpy(aKey.P, aP, sizeof(aP));
+                aKey.N[0] = quantize(aN.X());
+                aKey.N[1] = quantize(aN.Y());
+                aKey.N[2] = quantize(aN.Z());
+
+                std::pair<std::unordered_map<VertexKey, quint32, VertexKeyHasher>::iterator, bool> anIns =
+                    aVertexMap.insert(std::make_pair(aKey, (quint32)aVertexMap.size()));
+                if (anIns.second)
+                {
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        theMesh.Positions.push_back(aP[c]);
+                        theMesh.Normals.push_back(aKey.N[c]);
+                        theMesh.Min[c] = std::min(theMesh.Min[c], aP[c]);
+                        theMesh.Max[c] = std::max(theMesh.Max[c], aP[c]);
+                    }
+                    theMesh.Normals.push_back(0);
+                }
+                aRemap[i] = anIns.first->second;
+            }
+            theMesh.NbRaw += aNbNodes;
+
+            for (Standard_Integer t = aTris.Lower(); t <= aTris.Upper(); ++t)
+            {
+                Standard_Integer n1, n2, n3;
+                aTris(t).Get(n1, n2, n3);
+                if (isReversed)
+                    std::swap(n2, n3);
+
+                theMesh.Indices.push_back(aRemap[n1 - 1]);
+                theMesh.Indices.push_back(aRemap[n2 - 1]);
+                theMesh.Indices.push_back(aRemap[n3 - 1]);
+            }
+        }
+    }
+
+    bool hasTriangulation(const TopoDS_Shape &theShape)
+    {
+        for (TopExp_Explorer anExp(theShape, TopAbs_FACE); anExp.More(); anExp.Next())
+        {
+            TopLoc_Location aLoc;
+            if (BRep_Tool::Triangulation(TopoDS::Face(anExp.Current()), aLoc).IsNull())
+                return false;
+        }
+        return true;
+    }
+
+    QJsonArray toMatrix(const gp_Trsf &theTrsf)
+    {
+        // glTF矩阵按列存储
+        QJsonArray aMatrix;
+        for (int aCol = 1; aCol <= 4; ++aCol)
+        {
+            for (int aRow = 1; aRow <= 3; ++aRow)
+                aMatrix.append(theTrsf.Value(aRow, aCol));
+            aMatrix.append(aCol == 4 ? 1.0 : 0.0);
+        }
+        return aMatrix;
+    }
+
+    QJsonObject bufferView(const qint64 theOffset, const qint64 theLength, const int theTarget, const int theStride)
+    {
+        QJsonObject aView;
+        aView["buffer"]     = 0;
+        aView["byteOffset"] = theOffset;
+        aView["byteLength"] = theLength;
+        aView["target"]     = theTarget;
+        if (theStride > 0)
+            aView["byteStride"] = theStride;
+        return aView;
+    }
+}    // namespace
+
+
+GltfExporter::GltfExporter()
+    : myLinDeflection(0.1)
+    , myAngDeflection(0.5)
+{
+}
+
+bool GltfExporter::Export(const Handle(AIS_InteractiveContext) & theContext,
+                          const MaterialLibrary &theMaterials,
+                          const QString &        theFile,
+                          Statistics *           theStats) const
+{
+    QElapsedTimer aTimer;
+    aTimer.start();
+
+    // 1. 收集显示对象，按(TShape, 方向, 材质)合并网格
+    std::vector<MaterialDef>                                   aMaterials;
+    QMap<QString, Standard_Integer>                            aMaterialIds;
+    std::vector<MeshSource>                                    aSources;
+    std::map<SourceKey, Standard_Integer>                      aSourceIds;
+    std::vector<Instance>                                      anInstances;
+
+    AIS_ListOfInteractive aList;
+    theContext->DisplayedObjects(aList);
+    for (AIS_ListOfInteractive::Iterator anIter(aList); anIter.More(); anIter.Next())
+    {
+        Handle(AIS_Shape) aShape = Handle(AIS_Shape)::DownCast(anIter.Value());
+        if (aShape.IsNull() || aShape->Shape().IsNull())
+            continue;
+
+        MaterialDef aMat;
+        aMat.Color     = Quantity_Color(0.8, 0.8, 0.8, Quantity_TOC_RGB);
+        aMat.Alpha     = 1.0 - aShape->Transparency();
+        aMat.Metallic  = 0.0;
+        aMat.Roughness = 1.0;
+        if (aShape->HasColor())
+            aShape->Color(aMat.Color);
+
+        const QString aMatName = theMaterials.Assigned(aShape);
+        if (theMaterials.Contains(aMatName))
+        {
+            const MaterialLibrary::Material aLibMat = theMaterials.Value(aMatName);
+            aMat.Name      = aMatName;
+            aMat.Color     = aLibMat.Color();
+            aMat.Alpha     = 1.0 - aLibMat.Transparency();
+            aMat.Metallic  = aLibMat.Reflectivity;
+            aMat.Roughness = 1.0 - aLibMat.Reflectivity;
+        }
+
+        const QString aMatKey = QString("%1|%2|%3|%4|%5")
+                                    .arg(aMat.Name)
+                                    .arg(aMat.Color.Red())
+                                    .arg(aMat.Color.Green())
+                                    .arg(aMat.Color.Blue())
+                                    .arg(aMat.Alpha);
+        if (!aMaterialIds.contains(aMatKey))
+        {
+            aMaterialIds[aMatKey] = (Standard_Integer)aMaterials.size();
+            aMaterials.push_back(aMat);
+        }
+        const Standard_Integer aMatId = aMaterialIds[aMatKey];
+
+        TopoDS_Shape aWorld = aShape->Shape();
+        if (aShape->HasTransformation())
+            aWorld.Move(TopLoc_Location(aShape->LocalTransformation()));
+
+        const TopoDS_Shape aLocal = aWorld.Located(TopLoc_Location());
+        const SourceKey    aKey(aLocal.TShape().get(), std::make_pair((int)aLocal.Orientation(), aMatId));
+        std::map<SourceKey, Standard_Integer>::iterator aFound = aSourceIds.find(aKey);
+        if (aFound == aSourceIds.end())
+        {
+            MeshSource aSource;
+            aSource.Shape    = aLocal;
+            aSource.Material = aMatId;
+            aFound           = aSourceIds.insert(std::make_pair(aKey, (Standard_Integer)aSources.size())).first;
+            aSources.push_back(aSource);
+        }
+
+        Instance anInst;
+        anInst.Mesh = aFound->second;
+        anInst.Trsf = aWorld.Location().Transformation();
+        anInst.Name = QString("Part_%1").arg(anInstances.size() + 1);
+        anInstances.push_back(anInst);
+    }
+
+    // 2. 缺少三角网格的TShape逐个剖分，每个TShape只剖分一次。不同的根形状可能以带位置的实例共享同一个面，
+    //    并行剖分会有两个线程同时向同一个面写入三角网格，因此这里串行
+    std::vector<TopoDS_Shape>  aToMesh;
+    std::map<const void *, bool> aMeshed;
+    for (size_t i = 0; i < aSources.size(); ++i)
+    {
+        const void *aTShape = aSources[i].Shape.TShape().get();
+        if (aMeshed.count(aTShape) == 0)
+        {
+            aMeshed[aTShape] = true;
+            if (!hasTriangulation(aSources[i].Shape))
+                aToMesh.push_back(aSources[i].Shape);
+        }
+    }
+
+    for (size_t i = 0; i < aToMesh.size(); ++i)
+        BRepMesh_IncrementalMesh(aToMesh[i], myLinDeflection, Standard_False, myAngDeflection, Standard_False);
+    const double aMeshMs = aTimer.nsecsElapsed() / 1.0e6;
+
+    // 3. 并行编码
+    aTimer.restart();
+    std::vector<EncodedMesh> aMeshes(aSources.size());
+    OSD_Parallel::For(0, (Standard_Integer)aSources.size(), [&](const Standard_Integer theIndex) {
+        encode(aSources[theIndex].Shape, aMeshes[theIndex]);
+    });
+    const double anEncodeMs = aTimer.nsecsElapsed() / 1.0e6;
+
+    // 4. 组装JSON，并计算各缓冲区在BIN块中的偏移。没有三角形的网格不输出(count为0的访问器不合法)，
+    //    引用它的节点也一并跳过
+    aTimer.restart();
+    QJsonArray aJsonMeshes, anAccessors, aViews, aJsonMaterials, aNodes, aRootChildren;
+    std::vector<int> aMeshIds(aMeshes.size(), -1);
+    qint64           aBinLength = 0;
+
+    Standard_Integer aNbTriangles = 0, aNbVertices = 0, aNbRaw = 0;
+    for (size_t i = 0; i < aMeshes.size(); ++i)
+    {
+        const EncodedMesh &aMesh     = aMeshes[i];
+        if (aMesh.Indices.empty())
+            continue;
+
+        const qint64       aNbVerts  = (qint64)aMesh.Positions.size() / 3;
+        const qint64       aPosBytes = (qint64)aMesh.Positions.size() * sizeof(float);
+        const qint64       aNrmBytes = (qint64)aMesh.Normals.size();
+        const qint64       anIdxBytes = (qint64)aMesh.Indices.size() * sizeof(quint32);
+
+        aNbTriangles += (Standard_Integer)aMesh.Indices.size() / 3;
+        aNbVertices += (Standard_Integer)aNbVerts;
+        aNbRaw += aMesh.NbRaw;
+
+        aMeshIds[i] = aJsonMeshes.size();
+
+        const int aViewBase = aViews.size();
+        aViews.append(bufferView(aBinLength, aPosBytes, GLTF_ARRAY_BUFFER, 12));
+        aViews.append(bufferView(aBinLength + aPosBytes, aNrmBytes, GLTF_ARRAY_BUFFER, 4));
+        aViews.append(bufferView(aBinLength + aPosBytes + aNrmBytes, anIdxBytes, GLTF_ELEMENT_BUFFER, 0));
+        aBinLength += aPosBytes + aNrmBytes + anIdxBytes;
+
+        const int   anAccBase = anAccessors.size();
+        QJsonObject aPos;
+        aPos["bufferView"]    = aViewBase;
+        aPos["componentType"] = GLTF_FLOAT;
+        aPos["count"]         = aNbVerts;
+        aPos["type"]          = QString("VEC3");
+        if (aNbVerts > 0)
+        {
+            aPos["min"] = QJsonArray() << aMesh.Min[0] << aMesh.Min[1] << aMesh.Min[2];
+            aPos["max"] = QJsonArray() << aMesh.Max[0] << aMesh.Max[1] << aMesh.Max[2];
+        }
+        anAccessors.append(aPos);
+
+        QJsonObject aNrm;
+        aNrm["bufferView"]    = aViewBase + 1;
+        aNrm["componentType"] = GLTF_BYTE;
+        aNrm["normalized"]    = true;
+        aNrm["count"]         = aNbVerts;
+        aNrm["type"]          = QString("VEC3");
+        anAccessors.append(aNrm);
+
+        QJsonObject anIdx;
+        anIdx["bufferView"]    = aViewBase + 2;
+        anIdx["componentType"] = GLTF_UNSIGNED_INT;
+        anIdx["count"]         = (qint64)aMesh.Indices.size();
+        anIdx["type"]          = QString("SCALAR");
+        anAccessors.append(anIdx);
+
+        QJsonObject anAttribs;
+        anAttribs["POSITION"] = anAccBase;
+        anAttribs["NORMAL"]   = anAccBase + 1;
+
+        QJsonObject aPrim;
+        aPrim["attributes"] = anAttribs;
+        aPrim["indices"]    = anAccBase + 2;
+        aPrim["material"]   = aSources[i].Material;
+
+        QJsonObject aJsonMesh;
+        aJsonMesh["primitives"] = QJsonArray() << aPrim;
+        aJsonMeshes.append(aJsonMesh);
+    }
+
+    for (size_t i = 0; i < aMaterials.size(); ++i)
+    {
+        const MaterialDef &aMat = aMaterials[i];
+        Standard_Real      r, g, b;
+        aMat.Color.Values(r, g, b, Quantity_TOC_RGB);    // 线性RGB，与glTF约定一致
+
+        QJsonObject aPbr;
+        aPbr["baseColorFactor"] = QJsonArray() << r << g << b << aMat.Alpha;
+        aPbr["metallicFactor"]  = aMat.Metallic;
+        aPbr["roughnessFactor"] = aMat.Roughness;
+
+        QJsonObject aJsonMat;
+        aJsonMat["pbrMetallicRoughness"] = aPbr;
+        if (!aMat.Name.isEmpty())
+            aJsonMat["name"] = aMat.Name;
+        if (aMat.Alpha < 1.0)
+            aJsonMat["alphaMode"] = QString("BLEND");
+        aJsonMaterials.append(aJsonMat);
+    }
+
+    // 根节点：OCCT为Z轴向上、单位mm，glTF为Y轴向上、单位m
+    QJsonObject aRoot;
+    aRoot["name"]     = QString("root");
+    aRoot["rotation"] = QJsonArray() << -0.7071068 << 0.0 << 0.0 << 0.7071068;
+    aRoot["scale"]    = QJsonArray() << 0.001 << 0.001 << 0.001;
+    aNodes.append(aRoot);
+    for (size_t i = 0; i < anInstances.size(); ++i)
+    {
+        const int aMeshId = aMeshIds[anInstances[i].Mesh];
+        if (aMeshId < 0)
+            continue;
+
+        QJsonObject aNode;
+        aNode["name"] = anInstances[i].Name;
+        aNode["mesh"] = aMeshId;
+        if (anInstances[i].Trsf.Form() != gp_Identity)
+            aNode["matrix"] = toMatrix(anInstances[i].Trsf);
+        aRootChildren.append(aNodes.size());
+        aNodes.append(aNode);
+    }
+    if (!aRootChildren.isEmpty())
+    {
+        aRoot["children"] = aRootChildren;
+        aNodes[0]         = aRoot;
+    }
+
+    QJsonObject anAsset;
+    anAsset["version"]   = QString("2.0");
+    anAsset["generator"] = QString("OpenCascade_Learn");
+
+    QJsonObject aBuffer;
+    aBuffer["byteLength"] = aBinLength;
+
+    QJsonObject aScene;
+    aScene["nodes"] = QJsonArray() << 0;
+
+    QJsonObject aGltf;
+    aGltf["asset"]              = anAsset;
+    aGltf["extensionsUsed"]     = QJsonArray() << QString("KHR_mesh_quantization");
+    aGltf["extensionsRequired"] = QJsonArray() << QString("KHR_mesh_quantization");
+    aGltf["scene"]              = 0;
+    aGltf["scenes"]             = QJsonArray() << aScene;
+    aGltf["nodes"]              = aNodes;
+    aGltf["meshes"]             = aJsonMeshes;
+    aGltf["materials"]          = aJsonMaterials;
+    aGltf["accessors"]          = anAccessors;
+    aGltf["bufferViews"]        = aViews;
+    aGltf["buffers"]            = QJsonArray() << aBuffer;
+
+    QByteArray aJson = QJsonDocument(aGltf).toJson(QJsonDocument::Compact);
+    while (aJson.size() % 4 != 0)
+        aJson.append(' ');
+
+    // 5. 写出GLB：文件头 + JSON块 + BIN块
+    QFile aFile(theFile);
+    if (!aFile.open(QIODevice::WriteOnly))
+    {
+        LOG_ERROR("GltfExporter", "无法写入glTF文件: " << theFile.toStdString());
+        return false;
+    }
+
+    const quint32 aTotal    = 12 + 8 + aJson.size() + 8 + (quint32)aBinLength;
+    const quint32 aHeader[] = {qToLittleEndian<quint32>(0x46546C67),    // "glTF"
+                               qToLittleEndian<quint32>(2),
+                               qToLittleEndian<quint32>(aTotal),
+                               qToLittleEndian<quint32>(aJson.size()),
+                               qToLittleEndian<quint32>(0x4E4F534A)};    // "JSON"
+    aFile.write((const char *)aHeader, sizeof(aHeader));
+    aFile.write(aJson);
+
+    const quint32 aBinHeader[] = {qToLittleEndian<quint32>((quint32)aBinLength),
+                                  qToLittleEndian<quint32>(0x004E4942)};    // "BIN"
+    aFile.write((const char *)aBinHeader, sizeof(aBinHeader));
+
+    // glTF要求小端字节序，这里假定运行平台为小端
+    for (size_t i = 0; i < aMeshes.size(); ++i)
+    {
+        const EncodedMesh &aMesh = aMeshes[i];
+        aFile.write((const char *)aMesh.Positions.data(), (qint64)aMesh.Positions.size() * sizeof(float));
+        aFile.write((const char *)aMesh.Normals.data(), (qint64)aMesh.Normals.size());
+        aFile.write((const char *)aMesh.Indices.data(), (qint64)aMesh.Indices.size() * sizeof(quint32));
+    }
+    aFile.close();
+
+    if (theStats != NULL)
+    {
+        theStats->NbNodes       = aRootChildren.size();
+        theStats->NbMeshes      = aJsonMeshes.size();
+        theStats->NbTriangles   = aNbTriangles;
+        theStats->NbVertices    = aNbVertices;
+        theStats->NbRawVertices = aNbRaw;
+        theStats->Bytes         = aTotal;
+        theStats->MeshMs        = aMeshMs;
+        theStats->EncodeMs      = anEncodeMs;
+        theStats->WriteMs       = aTimer.nsecsElapsed() / 1.0e6;
+    }
+    return aFile.error() == QFile::NoError;
+}
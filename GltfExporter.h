@@ -0,0 +1,55 @@
+#ifndef GLTFEXPORTER_H
+#define GLTFEXPORTER_H
+
+#include <QString>
+
+#include <AIS_InteractiveContext.hxx>
+
+class MaterialLibrary;
+
+/// \brief GltfExporter
+///
+/// 把所有显示的AIS_Shape的三角网格导出为glTF 2.0二进制文件(.glb)，供网页端查看。
+///
+/// - 共享同一TShape的对象只编码一次网格，通过节点矩阵实例化
+/// - 同一网格内位置与(量化后)法向相同的顶点合并
+/// - 法向量化为归一化的BYTE分量(KHR_mesh_quantization)
+/// - 材质颜色来自MaterialLibrary(res/Material.json)的分配，其次是对象自身的颜色
+/// - 缺失的三角网格按TShape逐个剖分(实例可能共享面，不能并行写入)，各网格的编码并行进行；
+///   没有三角形的形状不输出
+class GltfExporter
+{
+public:
+    struct Statistics
+    {
+        Standard_Integer NbNodes;        ///< glTF节点(有三角形的显示对象)数目
+        Standard_Integer NbMeshes;       ///< 去重后的网格数目
+        Standard_Integer NbTriangles;
+        Standard_Integer NbVertices;     ///< 合并后的顶点数
+        Standard_Integer NbRawVertices;  ///< 合并前(三角网格节点)的顶点数
+        qint64           Bytes;
+        double           MeshMs;
+        double           EncodeMs;
+        double           WriteMs;
+    };
+
+    GltfExporter();
+
+    /// \brief 缺少三角网格时使用的剖分参数
+    void SetDeflection(const Standard_Real theLinear, const Standard_Real theAngular)
+    {
+        myLinDeflection = theLinear;
+        myAngDeflection = theAngular;
+    }
+
+    bool Export(const Handle(AIS_InteractiveContext) & theContext,
+                const MaterialLibrary &theMaterials,
+                const QString &        theFile,
+                Statistics *           theStats = NULL) const;
+
+private:
+    Standard_Real myLinDeflection;
+    Standard_Real myAngDeflection;
+};
+
+#endif    // GLTFEXPORTER_H
@@ -0,0 +1,420 @@
+#include "ImageDumper.h"
+
+#include "Gglobal.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRunnable>
+
+#include <Aspect_Window.hxx>
+#include <Graphic3d_Camera.hxx>
+#include <Graphic3d_CameraTile.hxx>
+#include <Graphic3d_GraphicDriver.hxx>
+#include <OSD_OpenStream.hxx>
+#include <V3d_ImageDumpOptions.hxx>
+#include <V3d_Viewer.hxx>
+
+#include <zlib.h>
+
+
+namespace
+{
+    //! 逐行写出图像的接口，行按从上到下的顺序给出，每行为RGB三通道
+    class RowWriter
+    {
+    public:
+        virtual ~RowWriter() {}
+        virtual bool WriteRow(const Standard_Byte *theRow) = 0;
+        virtual bool Finish()                               = 0;
+    };
+
+    //! 流式PNG编码：每行加上滤波字节后送入deflate，输出缓冲区满时写出一个IDAT块
+    class PngRowWriter : public RowWriter
+    {
+    public:
+        PngRowWriter(std::ofstream &theStream, const Standard_Integer theWidth, const Standard_Integer theHeight)
+            : myStream(theStream)
+            , myRowBytes(theWidth * 3)
+            , myIsOk(true)
+        {
+            static const unsigned char THE_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+            myStream.write((const char *)THE_SIGNATURE, sizeof(THE_SIGNATURE));
+
+            unsigned char anIhdr[13];
+            putUInt32(anIhdr, (quint32)theWidth);
+            putUInt32(anIhdr + 4, (quint32)theHeight);
+            anIhdr[8]  = 8;    // 每通道8位
+            anIhdr[9]  = 2;    // RGB
+            anIhdr[10] = 0;
+            anIhdr[11] = 0;
+            anIhdr[12] = 0;
+            writeChunk("IHDR", anIhdr, sizeof(anIhdr));
+
+            myZStream = z_stream();
+            myIsOk    = deflateInit(&myZStream, 6) == Z_OK;
+            myRow.resize(myRowBytes + 1);
+            myOut.resize(1 << 18);
+            myZStream.next_out  = myOut.data();
+            myZStream.avail_out = (uInt)myOut.size();
+        }
+
+        ~PngRowWriter() { deflateEnd(&myZStream); }
+
+        virtual bool WriteRow(const Standard_Byte *theRow) override
+        {
+            // 滤波方式0(None)：截图中大面积纯色背景已经可以被deflate很好地压缩
+            myRow[0] = 0;
+            std::copy(theRow, theRow + myRowBytes, myRow.begin() + 1);
+            return deflateData(myRow.data(), myRow.size(), Z_NO_FLUSH);
+        }
+
+        virtual bool Finish() override
+        {
+            if (!deflateData(NULL, 0, Z_FINISH))
+                return false;
+
+            writeChunk("IEND", NULL, 0);
+            return myIsOk && myStream.good();
+        }
+
+    private:
+        bool deflateData(unsigned char *theData, const size_t theSize, const int theFlush)
+        {
+            if (!myIsOk)
+                return false;
+
+            myZStream.next_in  = theData;
+            myZStream.avail_in = (uInt)theSize;
+            for (;;)
+            {
+                const int aRes = deflate(&myZStream, theFlush);
+                if (aRes == Z_STREAM_ERROR)
+                    return myIsOk = false;
+
+                if (myZStream.avail_out == 0 || (theFlush == Z_FINISH && aRes == Z_STREAM_END))
+                {
+                    writeChunk("IDAT", myOut.data(), myOut.size() - myZStream.avail_out);
+                    myZStream.next_out  = myOut.data();
+                    myZStream.avail_out = (uInt)myOut.size();
+                }
+
+                if (theFlush == Z_FINISH ? aRes == Z_STREAM_END : myZStream.avail_in == 0)
+                    return myStream.good();
+            }
+        }
+
+        void writeChunk(const char *theType, const unsigned char *theData, const size_t theSize)
+        {
+            unsigned char aHeader[8];
+            putUInt32(aHeader, (quint32)theSize);
+            std::copy(theType, theType + 4, aHeader + 4);
+            myStream.write((const char *)aHeader, sizeof(aHeader));
+            if (theSize > 0)
+                myStream.write((const char *)theData, theSize);
+
+            uLong aCrc = crc32(0L, aHeader + 4, 4);
+            if (theSize > 0)
+                aCrc = crc32(aCrc, theData, (uInt)theSize);
+
+            unsigned char aCrcBytes[4];
+            putUInt32(aCrcBytes, (quint32)aCrc);
+            myStream.write((const char *)aCrcBytes, sizeof(aCrcBytes));
+        }
+
+        static void putUInt32(unsigned char *theDst, const quint32 theValue)
+        {
+            theDst[0] = (unsigned char)(theValue >> 24);
+            theDst[1] = (unsigned char)(theValue >> 16);
+            theDst[2] = (unsigned char)(theValue >> 8);
+            theDst[3] = (unsigned char)theValue;
+        }
+
+        std::ofstream &            myStream;
+        const size_t               myRowBytes;
+        bool                       myIsOk;
+        z_stream                   myZStream;
+        std::vector<unsigned char> myRow;
+        std::vector<unsigned char> myOut;
+    };
+
+    //! 二进制PPM(P6)，行数据直接写出
+    class PpmRowWriter : public RowWriter
+    {
+    public:
+        PpmRowWriter(std::ofstream &theStream, const Standard_Integer theWidth, const Standard_Integer theHeight)
+            : myStream(theStream)
+            , myRowBytes(theWidth * 3)
+        {
+            myStream << "P6\n" << theWidth << " " << theHeight << "\n255\n";
+        }
+
+        virtual bool WriteRow(const Standard_Byte *theRow) override
+        {
+            myStream.write((const char *)theRow, myRowBytes);
+            return myStream.good();
+        }
+
+        virtual bool Finish() override { return myStream.good(); }
+
+    private:
+        std::ofstream &myStream;
+        const size_t   myRowBytes;
+    };
+
+    class EncodeTask : public QRunnable
+    {
+    public:
+        EncodeTask(ImageDumper *                     theDumper,
+                   const Handle(Image_AlienPixMap) & theImage,
+                   const int                         theId,
+                   const QString &                   theFile,
+                   const double                      theReadbackMs)
+            : myDumper(theDumper)
+            , myImage(theImage)
+            , myId(theId)
+            , myFile(theFile)
+            , myReadbackMs(theReadbackMs)
+        {
+            myQueueTimer.start();
+        }
+
+        virtual void run() override
+        {
+            const double aQueueMs = myQueueTimer.nsecsElapsed() / 1.0e6;
+
+            QElapsedTimer aTimer;
+            aTimer.start();
+            const bool   isOk       = myImage->Save(TCollection_AsciiString(myFile.toUtf8().data())) == Standard_True;
+            const double anEncodeMs = aTimer.nsecsElapsed() / 1.0e6;
+
+            myDumper->release(myImage);
+            myImage.Nullify();
+
+            QMetaObject::invokeMethod(myDumper, "imageDumped", Qt::QueuedConnection,
+                                      Q_ARG(int, myId),
+                                      Q_ARG(QString, myFile),
+                                      Q_ARG(bool, isOk),
+                                      Q_ARG(double, myReadbackMs),
+                                      Q_ARG(double, aQueueMs),
+                                      Q_ARG(double, anEncodeMs));
+        }
+
+    private:
+        ImageDumper *             myDumper;
+        Handle(Image_AlienPixMap) myImage;
+        int                       myId;
+        QString                   myFile;
+        double                    myReadbackMs;
+        QElapsedTimer             myQueueTimer;
+    };
+}    // namespace
+
+
+ImageDumper::ImageDumper(QObject *parent)
+    : QObject(parent)
+    , myMaxBuffers(4)
+    , myPending(0)
+    , myNextId(0)
+{
+}
+
+ImageDumper::~ImageDumper()
+{
+    myPool.waitForDone();
+}
+
+int ImageDumper::Dump(const Handle(V3d_View) & theView, const QString &theFile)
+{
+    if (theView.IsNull() || theView->Window().IsNull())
+        return -1;
+
+    QElapsedTimer aTimer;
+    aTimer.start();
+
+    // 复用的缓冲区保留了上次的尺寸，这里显式给出窗口尺寸
+    Standard_Integer aWidth = 0, aHeight = 0;
+    theView->Window()->Size(aWidth, aHeight);
+
+    V3d_ImageDumpOptions aParams;
+    aParams.Width      = aWidth;
+    aParams.Height     = aHeight;
+    aParams.BufferType = Graphic3d_BT_RGB;
+
+    Handle(Image_AlienPixMap) anImage = acquire();
+    ++myPending;
+    if (!theView->ToPixMap(*anImage, aParams))
+    {
+        release(anImage);
+        dbgFunTrace("读取帧缓冲失败: " << theFile.toStdString());
+        return -1;
+    }
+    const double aReadbackMs = aTimer.nsecsElapsed() / 1.0e6;
+
+    const int anId = myNextId++;
+    myPool.start(new EncodeTask(this, anImage, anId, theFile, aReadbackMs));
+    return anId;
+}
+
+bool ImageDumper::DumpTiled(const Handle(V3d_View) & theView,
+                            const QString &          theFile,
+                            const Standard_Integer   theWidth,
+                            const Standard_Integer   theHeight,
+                            const Standard_Integer   theTileSize,
+                            const qint64             theMemoryBudget,
+                            TiledReport *            theReport)
+{
+    if (theView.IsNull() || theWidth <= 0 || theHeight <= 0)
+        return false;
+
+    const bool isPng = theFile.endsWith(".png", Qt::CaseInsensitive);
+    if (!isPng && !theFile.endsWith(".ppm", Qt::CaseInsensitive))
+    {
+        dbgFunTrace("分块导出只支持png和ppm格式: " << theFile.toStdString());
+        return false;
+    }
+
+    // 分块尺寸受显卡离屏缓冲区尺寸的限制
+    const Handle(Graphic3d_GraphicDriver) &aDriver = theView->Viewer()->Driver();
+    Standard_Integer aTileW = aDriver->InquireLimit(Graphic3d_TypeOfLimit_MaxViewDumpSizeX);
+    Standard_Integer aTileH = aDriver->InquireLimit(Graphic3d_TypeOfLimit_MaxViewDumpSizeY);
+    if (theTileSize > 0)
+    {
+        aTileW = std::min(aTileW, theTileSize);
+        aTileH = std::min(aTileH, theTileSize);
+    }
+    aTileW = std::min(aTileW, theWidth);
+
+    // 条带高度由内存预算决定：一行条带包含整幅宽度的全部分块
+    const qint64 aRowBytes = (qint64)theWidth * 3;
+    aTileH                 = (Standard_Integer)std::max<qint64>(1, std::min<qint64>(aTileH, theMemoryBudget / aRowBytes));
+    aTileH                 = std::min(aTileH, theHeight);
+
+    const Standard_Integer aNbCols   = (theWidth + aTileW - 1) / aTileW;
+    const Standard_Integer aNbStrips = (theHeight + aTileH - 1) / aTileH;
+
+    // 先写入临时文件，全部分块成功后才替换目标文件，失败时不留下不完整的图像
+    const QString aTemp = theFile + ".part";
+    std::ofstream aStream;
+    OSD_OpenStream(aStream, aTemp.toUtf8().data(), std::ios::out | std::ios::binary);
+    if (!aStream.is_open())
+    {
+        dbgFunTrace("无法写入图像文件: " << aTemp.toStdString());
+        return false;
+    }
+
+    RowWriter *aWriter = isPng ? (RowWriter *)new PngRowWriter(aStream, theWidth, theHeight)
+                               : (RowWriter *)new PpmRowWriter(aStream, theWidth, theHeight);
+
+    // ToPixMap结束时只恢复到调用时的相机，这里保存原始相机，导出结束后恢复
+    Handle(Graphic3d_Camera) aSavedCamera = new Graphic3d_Camera();
+    aSavedCamera->Copy(theView->Camera());
+
+    // 每列一个缓冲区，各条带之间复用
+    std::vector<Image_AlienPixMap> aTiles(aNbCols);
+
+    double        aRenderMs = 0.0, anEncodeMs = 0.0;
+    QElapsedTimer aTimer;
+    bool          isOk = true;
+    for (Standard_Integer aStrip = 0; aStrip < aNbStrips && isOk; ++aStrip)
+    {
+        const Standard_Integer aY = aStrip * aTileH;
+        const Standard_Integer aH = std::min(aTileH, theHeight - aY);
+
+        aTimer.start();
+        for (Standard_Integer aCol = 0; aCol < aNbCols && isOk; ++aCol)
+        {
+            Graphic3d_CameraTile aTile;
+            aTile.TotalSize = Graphic3d_Vec2i(theWidth, theHeight);
+            aTile.TileSize  = Graphic3d_Vec2i(std::min(aTileW, theWidth - aCol * aTileW), aH);
+            aTile.Offset    = Graphic3d_Vec2i(aCol * aTileW, aY);
+            aTile.IsTopDown = true;
+
+            theView->Camera()->Copy(aSavedCamera);
+            theView->Camera()->SetAspect(Standard_Real(theWidth) / Standard_Real(theHeight));
+            theView->Camera()->SetTile(aTile);
+
+            V3d_ImageDumpOptions aParams;
+            aParams.Width          = aTile.TileSize.x();
+            aParams.Height         = aTile.TileSize.y();
+            aParams.BufferType     = Graphic3d_BT_RGB;
+            aParams.ToAdjustAspect = Standard_False;
+            isOk = theView->ToPixMap(aTiles[aCol], aParams) == Standard_True;
+        }
+        aRenderMs += aTimer.nsecsElapsed() / 1.0e6;
+
+        aTimer.start();
+        std::vector<Standard_Byte> aRow(aRowBytes);
+        for (Standard_Integer aLine = 0; aLine < aH && isOk; ++aLine)
+        {
+            for (Standard_Integer aCol = 0; aCol < aNbCols; ++aCol)
+            {
+                const Image_AlienPixMap &aTile = aTiles[aCol];
+                const Standard_Byte *    aSrc  = aTile.Row(aLine);
+                std::copy(aSrc, aSrc + aTile.SizeX() * 3, aRow.begin() + (size_t)aCol * aTileW * 3);
+            }
+            isOk = aWriter->WriteRow(aRow.data());
+        }
+        anEncodeMs += aTimer.nsecsElapsed() / 1.0e6;
+    }
+
+    isOk = aWriter->Finish() && isOk;
+    delete aWriter;
+    aStream.close();
+
+    theView->Camera()->Copy(aSavedCamera);
+    theView->Invalidate();
+    theView->Redraw();
+
+    if (theReport != NULL)
+    {
+        theReport->NbTiles   = aNbCols * aNbStrips;
+        theReport->NbStrips  = aNbStrips;
+        theReport->PeakBytes = aRowBytes * aTileH;
+        theReport->RenderMs  = aRenderMs;
+        theReport->EncodeMs  = anEncodeMs;
+    }
+    isOk = isOk && !aStream.fail();
+    if (isOk)
+    {
+        QFile::remove(theFile);
+        isOk = QFile::rename(aTemp, theFile);
+    }
+    if (!isOk)
+    {
+        dbgFunTrace("分块导出失败: " << theFile.toStdString());
+        QFile::remove(aTemp);
+    }
+    return isOk;
+}
+
+void ImageDumper::waitForDone()
+{
+    myPool.waitForDone();
+}
+
+Handle(Image_AlienPixMap) ImageDumper::acquire()
+{
+    {
+        std::lock_guard<std::mutex> aLock(myMutex);
+        if (!myFreeImages.empty())
+        {
+            Handle(Image_AlienPixMap) anImage = myFreeImages.back();
+            myFreeImages.pop_back();
+            return anImage;
+        }
+    }
+    return new Image_AlienPixMap();
+}
+
+void ImageDumper::release(const Handle(Image_AlienPixMap) & theImage)
+{
+    {
+        std::lock_guard<std::mutex> aLock(myMutex);
+        if ((int)myFreeImages.size() < myMaxBuffers)
+            myFreeImages.push_back(theImage);
+    }
+    --myPending;
+}
@@ -0,0 +1,94 @@
+#ifndef IMAGEDUMPER_H
+#define IMAGEDUMPER_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+
+#include <Image_AlienPixMap.hxx>
+#include <V3d_View.hxx>
+
+/// \brief ImageDumper
+///
+/// 异步导出视图图像。V3d_View::Dump在GUI线程中同时完成帧缓冲读回与图像编码，
+/// 编码(PNG/JPG/EXR)往往占大部分时间；这里GUI线程只负责读回，编码放到线程池中。
+///
+/// - 像素缓冲区复用，连续导出时不反复分配；缓冲区不足时临时新建，不阻塞GUI线程
+/// - 每次导出完成后发出imageDumped信号，给出读回、排队、编码三个阶段的耗时
+/// - DumpTiled按相机分块离屏渲染任意尺寸(超过窗口大小)的图像，逐条带写出，不在内存中拼接整幅图像
+class ImageDumper : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct TiledReport
+    {
+        Standard_Integer NbTiles;
+        Standard_Integer NbStrips;
+        qint64           PeakBytes;     ///< 条带缓冲区占用的最大内存
+        double           RenderMs;      ///< 渲染与读回耗时
+        double           EncodeMs;      ///< 压缩与写文件耗时
+    };
+
+    explicit ImageDumper(QObject *parent = nullptr);
+    ~ImageDumper();
+
+    /// \brief 读回视图的帧缓冲并提交编码任务
+    ///
+    /// \param theView，要导出的视图，必须在GUI线程中调用
+    /// \param theFile，输出文件，格式由扩展名决定
+    /// \return 任务编号，与imageDumped信号中的编号对应；读回失败时返回-1
+    int Dump(const Handle(V3d_View) & theView, const QString &theFile);
+
+    /// \brief 分块导出超大尺寸图像，同步执行，必须在GUI线程中调用
+    ///
+    /// 相机通过Graphic3d_CameraTile划分为若干块，每次渲染一行条带，条带读回后立即按行写入
+    /// 输出文件；内存占用只与条带大小有关(theMemoryBudget)，与图像总尺寸无关。
+    /// 支持光栅化与光线追踪两种渲染方式，使用视图当前的渲染参数。
+    ///
+    /// \param theFile，输出文件，支持.png和.ppm；先写入theFile.part，成功后改名，失败时不留下文件
+    /// \param theWidth，theHeight，图像尺寸(像素)
+    /// \param theTileSize，分块的最大边长，0表示使用显卡允许的最大尺寸
+    /// \param theMemoryBudget，条带缓冲区的内存上限(字节)
+    static bool DumpTiled(const Handle(V3d_View) & theView,
+                          const QString &          theFile,
+                          const Standard_Integer   theWidth,
+                          const Standard_Integer   theHeight,
+                          const Standard_Integer   theTileSize     = 0,
+                          const qint64             theMemoryBudget = 64 * 1024 * 1024,
+                          TiledReport *            theReport       = NULL);
+
+    /// \brief 等待全部编码任务结束
+    void waitForDone();
+
+    /// \brief 尚未完成的编码任务数
+    int pendingCount() const { return myPending; }
+
+    /// \brief 同时进行的编码任务数，默认为CPU核心数
+    void setMaxConcurrency(int theCount) { myPool.setMaxThreadCount(theCount); }
+
+    /// \brief 保留复用的像素缓冲区数目，默认为4
+    void setMaxBuffers(int theCount) { myMaxBuffers = theCount; }
+
+    /// \brief 归还像素缓冲区，编码任务结束时在工作线程中调用
+    void release(const Handle(Image_AlienPixMap) & theImage);
+
+signals:
+    void imageDumped(int theId, QString theFile, bool isOk, double theReadbackMs, double theQueueMs, double theEncodeMs);
+
+private:
+    Handle(Image_AlienPixMap) acquire();
+
+    QThreadPool                            myPool;
+    std::mutex                             myMutex;
+    std::vector<Handle(Image_AlienPixMap)> myFreeImages;
+    int                                    myMaxBuffers;
+    std::atomic<int>                       myPending;
+    int                                    myNextId;
+};
+
+#endif    // IMAGEDUMPER_H
@@ -0,0 +1,345 @@
+#include "InputReplay.h"
+#include "Gglobal.h"
+#include "ModelView.h"
+
+#include <QAction>
+#include <QCoreApplication>
+#include <QMouseEvent>
+#include <QWheelEvent>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    //! ViewAction/RaytraceAction的数目
+    const int THE_NB_VIEW_ACTIONS     = ModelView::ViewHlrOnId + 1;
+    const int THE_NB_RAYTRACE_ACTIONS = ModelView::ToolAntialiasingId + 1;
+
+    //! 有序帧时间的p分位数(最近秩)
+    double percentile(const std::vector<double> &theSorted, const double p)
+    {
+        if (theSorted.empty())
+            return 0.0;
+
+        const size_t anIndex = (size_t)std::max(0.0, std::ceil(p * theSorted.size()) - 1.0);
+        return theSorted[std::min(anIndex, theSorted.size() - 1)];
+    }
+}    // namespace
+
+// =======================================================================
+// InputRecorder
+// =======================================================================
+
+InputRecorder::InputRecorder(ModelView *theView, QObject *parent)
+    : QObject(parent)
+    , myView(theView)
+    , myNbEvents(0)
+{
+}
+
+InputRecorder::~InputRecorder()
+{
+    Stop();
+}
+
+bool InputRecorder::Start(const QString &theFile)
+{
+    Stop();
+
+    myFile.setFileName(theFile);
+    if (!myFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    {
+        LOG_ERROR("InputRecorder", "cannot open " << theFile.toStdString());
+        return false;
+    }
+
+    myStream.setDevice(&myFile);
+    myStream << "# ModelView input recording\n";
+    myStream << "size " << myView->width() << " " << myView->height() << "\n";
+    myNbEvents = 0;
+    myClock.start();
+
+    // 视图操作按QAction记录，勾选状态为触发后的状态
+    for (int i = 0; i < THE_NB_VIEW_ACTIONS + THE_NB_RAYTRACE_ACTIONS; ++i)
+    {
+        const bool     isView = i < THE_NB_VIEW_ACTIONS;
+        const int      anId   = isView ? i : i - THE_NB_VIEW_ACTIONS;
+        QAction *const anAction =
+            isView ? myView->getViewAction((ModelView::ViewAction)anId) : myView->getRaytraceAction((ModelView::RaytraceAction)anId);
+        if (anAction == nullptr)
+            continue;
+
+        myConnections.append(connect(anAction, &QAction::triggered, this, [this, isView, anId, anAction]() {
+            write(QString("%1 %2 %3 %4")
+                      .arg(myClock.elapsed())
+                      .arg(isView ? "view" : "raytrace")
+                      .arg(anId)
+                      .arg(anAction->isChecked() ? 1 : 0));
+        }));
+    }
+
+    myView->installEventFilter(this);
+    LOG_INFO("InputRecorder", "recording to " << theFile.toStdString());
+    return true;
+}
+
+void InputRecorder::Stop()
+{
+    if (!myFile.isOpen())
+        return;
+
+    myView->removeEventFilter(this);
+    foreach (const QMetaObject::Connection &aConnection, myConnections)
+        disconnect(aConnection);
+    myConnections.clear();
+
+    myStream.flush();
+    myStream.setDevice(nullptr);
+    myFile.close();
+    LOG_INFO("InputRecorder", "recorded " << myNbEvents << " events to " << myFile.fileName().toStdString());
+}
+
+bool InputRecorder::eventFilter(QObject *theObject, QEvent *theEvent)
+{
+    if (theObject != myView)
+        return QObject::eventFilter(theObject, theEvent);
+
+    switch (theEvent->type())
+    {
+    case QEvent::MouseButtonPress:
+    case QEvent::MouseButtonRelease:
+    {
+        const QMouseEvent *anEvent = static_cast<QMouseEvent *>(theEvent);
+        write(QString("%1 %2 %3 %4 %5 %6 %7")
+                  .arg(myClock.elapsed())
+                  .arg(theEvent->type() == QEvent::MouseButtonPress ? "press" : "release")
+                  .arg(anEvent->pos().x())
+                  .arg(anEvent->pos().y())
+                  .arg((int)anEvent->button())
+                  .arg((int)anEvent->buttons())
+                  .arg((int)anEvent->modifiers()));
+        break;
+    }
+    case QEvent::MouseMove:
+    {
+        const QMouseEvent *anEvent = static_cast<QMouseEvent *>(theEvent);
+        write(QString("%1 move %2 %3 %4 %5")
+                  .arg(myClock.elapsed())
+                  .arg(anEvent->pos().x())
+                  .arg(anEvent->pos().y())
+                  .arg((int)anEvent->buttons())
+                  .arg((int)anEvent->modifiers()));
+        break;
+    }
+    case QEvent::Wheel:
+    {
+        const QWheelEvent *anEvent = static_cast<QWheelEvent *>(theEvent);
+        write(QString("%1 wheel %2 %3 %4 %5")
+                  .arg(myClock.elapsed())
+                  .arg((int)anEvent->position().x())
+                  .arg((int)anEvent->position().y())
+                  .arg(anEvent->angleDelta().y())
+                  .arg((int)anEvent->modifiers()));
+        break;
+    }
+    default:
+        break;
+    }
+    return QObject::eventFilter(theObject, theEvent);
+}
+
+void InputRecorder::write(const QString &theLine)
+{
+    if (!myFile.isOpen())
+        return;
+
+    myStream << theLine << "\n";
+    ++myNbEvents;
+}
+
+// =======================================================================
+// InputReplayer
+// =======================================================================
+
+QJsonObject InputReplayer::Report::ToJson() const
+{
+    QJsonObject aResult;
+    aResult["events"]   = NbEvents;
+    aResult["frames"]   = NbFrames;
+    aResult["dropped"]  = Dropped;
+    aResult["total_ms"] = TotalMs;
+    aResult["p50_ms"]   = P50Ms;
+    aResult["p90_ms"]   = P90Ms;
+    aResult["p99_ms"]   = P99Ms;
+    aResult["max_ms"]   = MaxMs;
+    return aResult;
+}
+
+InputReplayer::InputReplayer()
+    : myBudget(1000.0 / 60.0)
+{
+}
+
+bool InputReplayer::Load(const QString &theFile)
+{
+    myEvents.clear();
+    mySize = QSize();
+
+    QFile aFile(theFile);
+    if (!aFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        LOG_ERROR("InputReplayer", "cannot open " << theFile.toStdString());
+        return false;
+    }
+
+    QTextStream aStream(&aFile);
+    int         aLineNo = 0;
+    while (!aStream.atEnd())
+    {
+        const QString     aLine   = aStream.readLine().trimmed();
+        const QStringList aFields = aLine.split(' ', Qt::SkipEmptyParts);
+        ++aLineNo;
+        if (aFields.isEmpty() || aLine.startsWith('#'))
+            continue;
+
+        if (aFields[0] == "size" && aFields.size() == 3)
+        {
+            mySize = QSize(aFields[1].toInt(), aFields[2].toInt());
+            continue;
+        }
+
+        Event anEvent = Event();
+        anEvent.Time  = aFields[0].toLongLong();
+
+        const QString aKind   = aFields.value(1);
+        bool          isValid = true;
+        if ((aKind == "press" || aKind == "release") && aFields.size() == 7)
+        {
+            anEvent.Kind      = aKind == "press" ? Type_Press : Type_Release;
+            anEvent.X         = aFields[2].toInt();
+            anEvent.Y         = aFields[3].toInt();
+            anEvent.Button    = aFields[4].toInt();
+            anEvent.Buttons   = aFields[5].toInt();
+            anEvent.Modifiers = aFields[6].toInt();
+        }
+        else if (aKind == "move" && aFields.size() == 6)
+        {
+            anEvent.Kind      = Type_Move;
+            anEvent.X         = aFields[2].toInt();
+            anEvent.Y         = aFields[3].toInt();
+            anEvent.Buttons   = aFields[4].toInt();
+            anEvent.Modifiers = aFields[5].toInt();
+        }
+        else if (aKind == "wheel" && aFields.size() == 6)
+        {
+            anEvent.Kind      = Type_Wheel;
+            anEvent.X         = aFields[2].toInt();
+            anEvent.Y         = aFields[3].toInt();
+            anEvent.Value     = aFields[4].toInt();
+            anEvent.Modifiers = aFields[5].toInt();
+        }
+        else if ((aKind == "view" || aKind == "raytrace") && aFields.size() == 4)
+        {
+            anEvent.Kind    = aKind == "view" ? Type_View : Type_Raytrace;
+            anEvent.Value   = aFields[2].toInt();
+            anEvent.Checked = aFields[3].toInt() != 0;
+            isValid         = anEvent.Value >= 0
+                      && anEvent.Value < (anEvent.Kind == Type_View ? THE_NB_VIEW_ACTIONS : THE_NB_RAYTRACE_ACTIONS);
+        }
+        else
+        {
+            isValid = false;
+        }
+
+        if (!isValid)
+        {
+            LOG_ERROR("InputReplayer", theFile.toStdString() << ":" << aLineNo << ": invalid event");
+            myEvents.clear();
+            return false;
+        }
+        myEvents.push_back(anEvent);
+    }
+    return true;
+}
+
+InputReplayer::Report InputReplayer::Run(ModelView *theView)
+{
+    Report aReport   = Report();
+    aReport.NbEvents = NbEvents();
+
+    const double aScaleX = mySize.isValid() && mySize.width() > 0 ? (double)theView->width() / mySize.width() : 1.0;
+    const double aScaleY = mySize.isValid() && mySize.height() > 0 ? (double)theView->height() / mySize.height() : 1.0;
+
+    // 先处理完挂起的事件，计时只包含回放的事件
+    QCoreApplication::processEvents();
+    theView->setPopupEnabled(false);
+
+    std::vector<double> aFrames;
+    aFrames.reserve(myEvents.size());
+    QElapsedTimer aTotal;
+    aTotal.start();
+    for (size_t i = 0; i < myEvents.size(); ++i)
+    {
+        QElapsedTimer aTimer;
+        aTimer.start();
+        dispatch(theView, myEvents[i], aScaleX, aScaleY);
+        theView->repaint();
+        aFrames.push_back(aTimer.nsecsElapsed() / 1.0e6);
+    }
+    aReport.TotalMs = aTotal.nsecsElapsed() / 1.0e6;
+
+    theView->setPopupEnabled(true);
+    QCoreApplication::processEvents();
+
+    for (size_t i = 0; i < aFrames.size(); ++i)
+        aReport.Dropped += (int)(aFrames[i] / myBudget);
+
+    std::sort(aFrames.begin(), aFrames.end());
+    aReport.NbFrames = (int)aFrames.size();
+    aReport.P50Ms    = percentile(aFrames, 0.50);
+    aReport.P90Ms    = percentile(aFrames, 0.90);
+    aReport.P99Ms    = percentile(aFrames, 0.99);
+    aReport.MaxMs    = aFrames.empty() ? 0.0 : aFrames.back();
+    return aReport;
+}
+
+void InputReplayer::dispatch(ModelView *theView, const Event &theEvent, const double theScaleX, const double theScaleY)
+{
+    const QPointF aPos(theEvent.X * theScaleX, theEvent.Y * theScaleY);
+    const Qt::KeyboardModifiers aModifiers = (Qt::KeyboardModifiers)theEvent.Modifiers;
+    switch (theEvent.Kind)
+    {
+    case Type_Press:
+    case Type_Release:
+    {
+        QMouseEvent anEvent(theEvent.Kind == Type_Press ? QEvent::MouseButtonPress : QEvent::MouseButtonRelease, aPos,
+                            (Qt::MouseButton)theEvent.Button, (Qt::MouseButtons)theEvent.Buttons, aModifiers);
+        QCoreApplication::sendEvent(theView, &anEvent);
+        break;
+    }
+    case Type_Move:
+    {
+        QMouseEvent anEvent(QEvent::MouseMove, aPos, Qt::NoButton, (Qt::MouseButtons)theEvent.Buttons, aModifiers);
+        QCoreApplication::sendEvent(theView, &anEvent);
+        break;
+    }
+    case Type_Wheel:
+    {
+        QWheelEvent anEvent(aPos, theView->mapToGlobal(aPos.toPoint()), QPoint(), QPoint(0, theEvent.Value),
+                            Qt::NoButton, aModifiers, Qt::NoScrollPhase, false);
+        QCoreApplication::sendEvent(theView, &anEvent);
+        break;
+    }
+    case Type_View:
+    case Type_Raytrace:
+    {
+        // 可勾选的动作只在状态不同时触发，使回放后的状态与录制时一致
+        QAction *anAction = theEvent.Kind == Type_View ? theView->getViewAction((ModelView::ViewAction)theEvent.Value)
+                                                       : theView->getRaytraceAction((ModelView::RaytraceAction)theEvent.Value);
+        if (anAction != nullptr && (!anAction->isCheckable() || anAction->isChecked() != theEvent.Checked))
+            anAction->trigger();
+        break;
+    }
+    }
+}
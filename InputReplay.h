@@ -0,0 +1,127 @@
+#ifndef INPUTREPLAY_H
+#define INPUTREPLAY_H
+
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonObject>
+#include <QList>
+#include <QObject>
+#include <QSize>
+#include <QTextStream>
+
+class ModelView;
+
+/// \brief InputRecorder
+///
+/// 记录ModelView收到的鼠标、滚轮输入以及视图操作(FitAll、旋转、HLR开关、光线追踪开关等QAction)，
+/// 按时间顺序写入文本文件，每行一个事件：
+///
+///     size <宽> <高>
+///     <毫秒> press|release <x> <y> <按键> <按键状态> <修饰键>
+///     <毫秒> move <x> <y> <按键状态> <修饰键>
+///     <毫秒> wheel <x> <y> <角度增量> <修饰键>
+///     <毫秒> view|raytrace <动作编号> <勾选状态>
+///
+/// 以#开头的行是注释。按键与修饰键为Qt的枚举值，动作编号为ModelView::ViewAction/RaytraceAction。
+class InputRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit InputRecorder(ModelView *theView, QObject *parent = nullptr);
+    ~InputRecorder();
+
+    /// \brief 开始记录，覆盖theFile
+    bool Start(const QString &theFile);
+    void Stop();
+
+    bool IsRecording() const { return myFile.isOpen(); }
+    int  NbEvents() const { return myNbEvents; }
+
+protected:
+    virtual bool eventFilter(QObject *theObject, QEvent *theEvent) override;
+
+private:
+    void write(const QString &theLine);
+
+    ModelView *                    myView;
+    QFile                          myFile;
+    QTextStream                    myStream;
+    QElapsedTimer                  myClock;
+    int                            myNbEvents;
+    QList<QMetaObject::Connection> myConnections;
+};
+
+/// \brief InputReplayer
+///
+/// 把InputRecorder记录的事件确定性地回放到ModelView，用于交互性能的回归测试(可以在Xvfb下运行)。
+///
+/// 回放不按记录的时间间隔等待：每个事件同步发送(QCoreApplication::sendEvent)，随后立即同步重绘一帧
+/// (QWidget::repaint)，事件处理与重绘的总耗时作为一帧的帧时间。这样同一场景、同一录像每次产生完全相同的
+/// 帧序列，与机器负载下事件合并的时机无关。坐标按录制与回放时视图尺寸的比例缩放。
+/// 回放期间关闭ModelView的右键菜单，避免模态菜单阻塞。
+///
+/// 帧时间超过预算(默认60Hz)的帧按超出的整帧数计为掉帧。帧时间只包含CPU端提交与SwapBuffers，
+/// 不等待GPU完成。
+class InputReplayer
+{
+public:
+    struct Report
+    {
+        int    NbEvents;
+        int    NbFrames;
+        int    Dropped;
+        double TotalMs;
+        double P50Ms;
+        double P90Ms;
+        double P99Ms;
+        double MaxMs;
+
+        /// \brief 与bench_occt相同的格式，"_ms"结尾的指标参与基线比较
+        QJsonObject ToJson() const;
+    };
+
+    InputReplayer();
+
+    bool Load(const QString &theFile);
+    int  NbEvents() const { return (int)myEvents.size(); }
+
+    /// \brief 每帧的时间预算(毫秒)
+    void SetFrameBudget(const double theMs) { myBudget = theMs; }
+
+    Report Run(ModelView *theView);
+
+private:
+    enum Type
+    {
+        Type_Press,
+        Type_Release,
+        Type_Move,
+        Type_Wheel,
+        Type_View,
+        Type_Raytrace
+    };
+
+    struct Event
+    {
+        qint64 Time;
+        Type   Kind;
+        int    X;
+        int    Y;
+        int    Button;
+        int    Buttons;
+        int    Modifiers;
+        int    Value;      ///< 滚轮角度增量或动作编号
+        bool   Checked;
+    };
+
+    void dispatch(ModelView *theView, const Event &theEvent, const double theScaleX, const double theScaleY);
+
+    std::vector<Event> myEvents;
+    QSize              mySize;
+    double             myBudget;
+};
+
+#endif    // INPUTREPLAY_H
@@ -0,0 +1,446 @@
+#include "Logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMap>
+#include <QStringList>
+#include <QTextStream>
+
+
+namespace
+{
+    const size_t THE_CAPACITY = 8192;
+
+    //! theMessage不超过theMax字节的最长前缀，截断时不拆开UTF-8多字节字符
+    size_t utf8Prefix(const std::string &theMessage, const size_t theMax)
+    {
+        if (theMessage.size() <= theMax)
+            return theMessage.size();
+
+        // 退回到首字节(不是10xxxxxx的后续字节)，该字符整个丢弃
+        size_t aLength = theMax;
+        while (aLength > 0 && (static_cast<unsigned char>(theMessage[aLength]) & 0xC0) == 0x80)
+            --aLength;
+        return aLength;
+    }
+
+    int parseLevel(const QString &theName)
+    {
+        const QString aName = theName.trimmed().toUpper();
+        if (aName == "DEBUG" || aName == "NOTSET")
+            return LOG_LEVEL_DEBUG;
+        if (aName == "INFO" || aName == "NOTICE")
+            return LOG_LEVEL_INFO;
+        if (aName == "WARN" || aName == "WARNING")
+            return LOG_LEVEL_WARN;
+        if (aName == "ERROR" || aName == "CRIT" || aName == "ALERT" || aName == "FATAL" || aName == "EMERG")
+            return LOG_LEVEL_ERROR;
+        return LOG_LEVEL_OFF;
+    }
+
+    //! log4cpp的PatternLayout子集：%p %d{...} %c %m %n %%；日期格式支持%Y %m %d %H %M %S %l
+    class PatternLayout
+    {
+    public:
+        explicit PatternLayout(const QString &thePattern = "[%p] %d{%H:%M:%S.%l} (%c): %m%n")
+            : myPattern(thePattern)
+        {
+        }
+
+        QByteArray Format(const Logger::Record &theRecord) const
+        {
+            QString aResult;
+            for (int i = 0; i < myPattern.size(); ++i)
+            {
+                const QChar aChar = myPattern.at(i);
+                if (aChar != '%' || i + 1 >= myPattern.size())
+                {
+                    aResult.append(aChar);
+                    continue;
+                }
+
+                const QChar aSpec = myPattern.at(++i);
+                if (aSpec == 'p')
+                    aResult.append(Logger::LevelName(theRecord.Level));
+                else if (aSpec == 'c')
+                    aResult.append(QString::fromUtf8(theRecord.Category));
+                else if (aSpec == 'm')
+                    aResult.append(QString::fromUtf8(theRecord.Message, theRecord.Length));
+                else if (aSpec == 'n')
+                    aResult.append('\n');
+                else if (aSpec == '%')
+                    aResult.append('%');
+                else if (aSpec == 'd')
+                {
+                    QString aDateFormat = "%Y-%m-%d %H:%M:%S.%l";
+                    if (i + 1 < myPattern.size() && myPattern.at(i + 1) == '{')
+                    {
+                        const int anEnd = myPattern.indexOf('}', i + 1);
+                        if (anEnd > 0)
+                        {
+                            aDateFormat = myPattern.mid(i + 2, anEnd - i - 2);
+                            i           = anEnd;
+                        }
+                    }
+                    aResult.append(formatDate(aDateFormat, theRecord.Time));
+                }
+            }
+            return aResult.toUtf8();
+        }
+
+    private:
+        static QString formatDate(const QString &theFormat, const qint64 theTime)
+        {
+            const QDateTime aTime = QDateTime::fromMSecsSinceEpoch(theTime);
+            const QDate     aDate = aTime.date();
+            const QTime     aDay  = aTime.time();
+
+            QString aResult;
+            for (int i = 0; i < theFormat.size(); ++i)
+            {
+                const QChar aChar = theFormat.at(i);
+                if (aChar != '%' || i + 1 >= theFormat.size())
+                {
+                    aResult.append(aChar);
+                    continue;
+                }
+
+                switch (theFormat.at(++i).toLatin1())
+                {
+                case 'Y': aResult.append(QString::number(aDate.year())); break;
+                case 'm': aResult.append(QString("%1").arg(aDate.month(), 2, 10, QChar('0'))); break;
+                case 'd': aResult.append(QString("%1").arg(aDate.day(), 2, 10, QChar('0'))); break;
+                case 'H': aResult.append(QString("%1").arg(aDay.hour(), 2, 10, QChar('0'))); break;
+                case 'M': aResult.append(QString("%1").arg(aDay.minute(), 2, 10, QChar('0'))); break;
+                case 'S': aResult.append(QString("%1").arg(aDay.second(), 2, 10, QChar('0'))); break;
+                case 'l': aResult.append(QString("%1").arg(aDay.msec(), 3, 10, QChar('0'))); break;
+                default: aResult.append(theFormat.at(i)); break;
+                }
+            }
+            return aResult;
+        }
+
+        QString myPattern;
+    };
+}    // namespace
+
+
+/// \brief 日志输出目标，只在写线程中调用
+class LogAppender
+{
+public:
+    explicit LogAppender(const PatternLayout &theLayout)
+        : myLayout(theLayout)
+    {
+    }
+    virtual ~LogAppender() {}
+
+    void Append(const Logger::Record &theRecord) { write(myLayout.Format(theRecord)); }
+
+    virtual void Flush() {}
+
+protected:
+    virtual void write(const QByteArray &theLine) = 0;
+
+private:
+    PatternLayout myLayout;
+};
+
+namespace
+{
+    class ConsoleAppender : public LogAppender
+    {
+    public:
+        explicit ConsoleAppender(const PatternLayout &theLayout)
+            : LogAppender(theLayout)
+        {
+        }
+
+        virtual void Flush() override { std::cout.flush(); }
+
+    protected:
+        virtual void write(const QByteArray &theLine) override { std::cout.write(theLine.constData(), theLine.size()); }
+    };
+
+    //! FileAppender与RollingFileAppender，theMaxSize为0时不回卷
+    class RollingFileAppender : public LogAppender
+    {
+    public:
+        RollingFileAppender(const PatternLayout &theLayout, const QString &theFile, const qint64 theMaxSize,
+                            const int theMaxBackup, const bool toAppend)
+            : LogAppender(theLayout)
+            , myFile(theFile)
+            , myMaxSize(theMaxSize)
+            , myMaxBackup(theMaxBackup)
+        {
+            QDir().mkpath(QFileInfo(theFile).absolutePath());
+            myFile.open(toAppend ? QIODevice::Append : QIODevice::WriteOnly | QIODevice::Truncate);
+        }
+
+        virtual void Flush() override { myFile.flush(); }
+
+    protected:
+        virtual void write(const QByteArray &theLine) override
+        {
+            if (myMaxSize > 0 && myFile.size() + theLine.size() > myMaxSize)
+                roll();
+            myFile.write(theLine);
+        }
+
+    private:
+        //! name.(N-1) -> name.N, ..., name -> name.1
+        void roll()
+        {
+            const QString aName = myFile.fileName();
+            myFile.close();
+
+            if (myMaxBackup > 0)
+            {
+                QFile::remove(QString("%1.%2").arg(aName).arg(myMaxBackup));
+                for (int i = myMaxBackup - 1; i >= 1; --i)
+                    QFile::rename(QString("%1.%2").arg(aName).arg(i), QString("%1.%2").arg(aName).arg(i + 1));
+                QFile::rename(aName, aName + ".1");
+            }
+            myFile.open(QIODevice::WriteOnly | QIODevice::Truncate);
+        }
+
+        QFile  myFile;
+        qint64 myMaxSize;
+        int    myMaxBackup;
+    };
+}    // namespace
+
+
+// 运行期级别默认与编译期级别相同：Debug构建输出dbgFunTrace，与原来的行为一致
+std::atomic<int> Logger::ourThreshold(LOG_ACTIVE_LEVEL);
+
+Logger &Logger::Instance()
+{
+    static Logger aLogger;
+    return aLogger;
+}
+
+Logger::Logger()
+    : myRecords(THE_CAPACITY)
+    , myMask(THE_CAPACITY - 1)
+    , myTail(0)
+    , myHead(0)
+    , myDropped(0)
+    , myIsRunning(true)
+    , myIsWaiting(false)
+{
+    for (size_t i = 0; i < myRecords.size(); ++i)
+        myRecords[i].Sequence.store(i, std::memory_order_relaxed);
+
+    myAppenders.push_back(new ConsoleAppender(PatternLayout()));
+    myThread = std::thread(&Logger::run, this);
+}
+
+Logger::~Logger()
+{
+    Shutdown();
+    clearAppenders();
+}
+
+const char *Logger::LevelName(const int theLevel)
+{
+    switch (theLevel)
+    {
+    case LOG_LEVEL_DEBUG: return "DEBUG";
+    case LOG_LEVEL_INFO: return "INFO";
+    case LOG_LEVEL_WARN: return "WARN";
+    case LOG_LEVEL_ERROR: return "ERROR";
+    default: return "OFF";
+    }
+}
+
+bool Logger::Configure(const QString &theFile)
+{
+    QFile aFile(theFile);
+    if (!aFile.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+
+    QMap<QString, QString> aProps;
+    QTextStream            aStream(&aFile);
+    aStream.setCodec("UTF-8");
+    while (!aStream.atEnd())
+    {
+        const QString aLine = aStream.readLine().trimmed();
+        const int     anEq  = aLine.indexOf('=');
+        if (aLine.isEmpty() || aLine.startsWith('#') || anEq < 0)
+            continue;
+        aProps[aLine.left(anEq).trimmed()] = aLine.mid(anEq + 1).trimmed();
+    }
+
+    // log4cpp.rootCategory=LEVEL, appender1, appender2
+    QStringList aRoot = aProps.value("log4cpp.rootCategory").split(',');
+    if (aRoot.isEmpty() || aRoot.first().trimmed().isEmpty())
+        return false;
+
+    const int                  aLevel = parseLevel(aRoot.takeFirst());
+    std::vector<LogAppender *> anAppenders;
+    foreach (const QString &aName, aRoot)
+    {
+        const QString aPrefix  = "log4cpp.appender." + aName.trimmed();
+        const QString aType    = aProps.value(aPrefix);
+        const QString aPattern = aProps.value(aPrefix + ".layout.ConversionPattern");
+        const PatternLayout aLayout = aPattern.isEmpty() ? PatternLayout() : PatternLayout(aPattern);
+
+        if (aType == "ConsoleAppender")
+        {
+            anAppenders.push_back(new ConsoleAppender(aLayout));
+        }
+        else if (aType == "FileAppender" || aType == "RollingFileAppender")
+        {
+            const bool   isRolling = aType == "RollingFileAppender";
+            const qint64 aMaxSize  = isRolling ? aProps.value(aPrefix + ".maxFileSize", "10485760").toLongLong() : 0;
+            anAppenders.push_back(new RollingFileAppender(aLayout,
+                                                          aProps.value(aPrefix + ".fileName", "logs/log.txt"),
+                                                          aMaxSize,
+                                                          aProps.value(aPrefix + ".maxBackupIndex", "1").toInt(),
+                                                          aProps.value(aPrefix + ".append", "true") == "true"));
+        }
+        else
+        {
+            std::cerr << "Logger: unsupported appender type " << aType.toStdString() << std::endl;
+        }
+    }
+
+    // 先写出旧配置下已经提交的日志，再替换输出目标
+    Flush();
+    {
+        std::lock_guard<std::mutex> aLock(myMutex);
+        clearAppenders();
+        myAppenders = anAppenders;
+    }
+    SetLevel(aLevel);
+    return true;
+}
+
+bool Logger::Push(const int theLevel, const char *theCategory, const std::string &theMessage)
+{
+    // 有界MPSC队列：每个槽位的Sequence等于写入位置时可写，等于写入位置+1时可读
+    size_t  aPos = myTail.load(std::memory_order_relaxed);
+    Record *aRecord;
+    for (;;)
+    {
+        aRecord            = &myRecords[aPos & myMask];
+        const size_t aSeq  = aRecord->Sequence.load(std::memory_order_acquire);
+        const qint64 aDiff = (qint64)aSeq - (qint64)aPos;
+        if (aDiff == 0)
+        {
+            if (myTail.compare_exchange_weak(aPos, aPos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (aDiff < 0)
+        {
+            myDropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else
+        {
+            aPos = myTail.load(std::memory_order_relaxed);
+        }
+    }
+
+    aRecord->Level    = theLevel;
+    aRecord->Category = theCategory;
+    aRecord->Time     = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::system_clock::now().time_since_epoch())
+                        .count();
+    aRecord->Length = (int)utf8Prefix(theMessage, sizeof(aRecord->Message));
+    std::memcpy(aRecord->Message, theMessage.data(), aRecord->Length);
+    aRecord->Sequence.store(aPos + 1, std::memory_order_release);
+
+    // 写线程休眠时才需要唤醒，正常情况下不进入内核
+    if (myIsWaiting.load(std::memory_order_relaxed))
+        myWakeUp.notify_one();
+    return true;
+}
+
+bool Logger::pop(Record &theRecord)
+{
+    const size_t aPos    = myHead.load(std::memory_order_relaxed);
+    Record &     aRecord = myRecords[aPos & myMask];
+    if (aRecord.Sequence.load(std::memory_order_acquire) != aPos + 1)
+        return false;
+
+    theRecord.Level    = aRecord.Level;
+    theRecord.Category = aRecord.Category;
+    theRecord.Time     = aRecord.Time;
+    theRecord.Length   = aRecord.Length;
+    std::memcpy(theRecord.Message, aRecord.Message, aRecord.Length);
+
+    aRecord.Sequence.store(aPos + myRecords.size(), std::memory_order_release);
+    myHead.store(aPos + 1, std::memory_order_release);
+    return true;
+}
+
+void Logger::run()
+{
+    Record aRecord;
+    for (;;)
+    {
+        bool isWritten = false;
+        {
+            std::lock_guard<std::mutex> aLock(myMutex);
+            while (pop(aRecord))
+            {
+                for (size_t i = 0; i < myAppenders.size(); ++i)
+                    myAppenders[i]->Append(aRecord);
+                isWritten = true;
+            }
+            if (isWritten)
+            {
+                for (size_t i = 0; i < myAppenders.size(); ++i)
+                    myAppenders[i]->Flush();
+            }
+        }
+
+        if (!myIsRunning.load() && myHead.load() == myTail.load())
+            break;
+
+        if (!isWritten)
+        {
+            // 超时等待：唤醒标志与写入之间的竞争最多带来一个周期的延迟
+            std::unique_lock<std::mutex> aLock(myMutex);
+            myIsWaiting.store(true);
+            myWakeUp.wait_for(aLock, std::chrono::milliseconds(20));
+            myIsWaiting.store(false);
+        }
+    }
+}
+
+void Logger::Flush()
+{
+    const size_t aTail = myTail.load();
+    while (myIsRunning.load() && myHead.load() < aTail)
+    {
+        myWakeUp.notify_one();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void Logger::Shutdown()
+{
+    if (!myIsRunning.exchange(false))
+        return;
+
+    myWakeUp.notify_one();
+    if (myThread.joinable())
+        myThread.join();
+}
+
+void Logger::clearAppenders()
+{
+    for (size_t i = 0; i < myAppenders.size(); ++i)
+        delete myAppenders[i];
+    myAppenders.clear();
+}
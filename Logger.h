@@ -0,0 +1,155 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <QString>
+
+/// 日志级别，数值越大越重要
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO  1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_OFF   4
+
+/// 编译期的最低日志级别，低于该级别的日志语句在编译时被整体移除。
+/// 默认Debug构建保留全部日志，Release构建移除DEBUG日志(与原dbgFunTrace的行为一致)
+#ifndef LOG_ACTIVE_LEVEL
+#ifdef DEBUG
+#define LOG_ACTIVE_LEVEL LOG_LEVEL_DEBUG
+#else
+#define LOG_ACTIVE_LEVEL LOG_LEVEL_INFO
+#endif
+#endif
+
+class LogAppender;
+
+/// \brief Logger
+///
+/// 异步日志。日志语句在调用线程中只做级别判断、格式化消息并写入无锁环形缓冲区，
+/// 时间格式化、布局与文件输出全部由后台写线程完成。
+///
+/// - 运行期级别关闭时，LOG_XXX宏只有一次原子读，不会求值消息表达式
+/// - 编译期级别(LOG_ACTIVE_LEVEL)以下的宏展开为空语句
+/// - 缓冲区满时丢弃新日志并计数，不阻塞调用线程
+/// - 超过Message长度的消息按UTF-8字符边界截断
+/// - 运行期级别默认等于编译期级别(Debug构建为DEBUG)，可由配置文件或SetLevel修改
+/// - 配置使用res/log4cpp.conf的格式，支持rootCategory级别、ConsoleAppender、
+///   FileAppender、RollingFileAppender以及PatternLayout(%p %d{...} %c %m %n %%)
+///
+/// 用法: LOG_INFO("StepExporter", "导出完成: " << aBytes << " bytes");
+/// 分类名必须是字符串常量，只保存其指针。
+class Logger
+{
+public:
+    struct Record
+    {
+        std::atomic<size_t> Sequence;
+        int                 Level;
+        const char *        Category;
+        qint64              Time;       ///< 毫秒，自1970-01-01 UTC
+        int                 Length;
+        char                Message[240];
+    };
+
+    static Logger &Instance();
+
+    /// \brief 运行期级别判断，内联且只有一次原子读
+    static inline bool IsEnabled(const int theLevel)
+    {
+        return theLevel >= ourThreshold.load(std::memory_order_relaxed);
+    }
+
+    /// \brief 读取log4cpp格式的配置文件，替换当前的输出目标；失败时保留默认的控制台输出
+    bool Configure(const QString &theFile);
+
+    /// \brief 运行期级别
+    void SetLevel(const int theLevel) { ourThreshold.store(theLevel, std::memory_order_relaxed); }
+    int  Level() const { return ourThreshold.load(std::memory_order_relaxed); }
+
+    /// \brief 写入一条日志，缓冲区满时返回false
+    bool Push(const int theLevel, const char *theCategory, const std::string &theMessage);
+
+    /// \brief 等待缓冲区中已有的日志全部写出
+    void Flush();
+
+    /// \brief 写出剩余日志并结束写线程，程序退出前调用
+    void Shutdown();
+
+    /// \brief 因缓冲区满被丢弃的日志条数
+    qint64 Dropped() const { return myDropped.load(std::memory_order_relaxed); }
+
+    static const char *LevelName(const int theLevel);
+
+private:
+    Logger();
+    ~Logger();
+    Logger(const Logger &);
+    Logger &operator=(const Logger &);
+
+    bool pop(Record &theRecord);
+    void run();
+    void clearAppenders();
+
+    static std::atomic<int> ourThreshold;
+
+    std::vector<Record>   myRecords;     ///< 容量为2的幂，有界MPSC队列
+    size_t                myMask;
+    std::atomic<size_t>   myTail;        ///< 生产者写入位置
+    std::atomic<size_t>   myHead;        ///< 消费者(写线程)读取位置
+    std::atomic<qint64>   myDropped;
+    std::atomic<bool>     myIsRunning;
+    std::atomic<bool>     myIsWaiting;
+
+    std::mutex                 myMutex;       ///< 只用于写线程休眠与输出目标的替换
+    std::condition_variable    myWakeUp;
+    std::vector<LogAppender *> myAppenders;
+    std::thread                myThread;
+};
+
+#define LOG_AT(theLevel, theCategory, x)                                            \
+    do                                                                              \
+    {                                                                               \
+        if (Logger::IsEnabled(theLevel))                                            \
+        {                                                                           \
+            std::ostringstream aLogStream_;                                         \
+            aLogStream_ << x;                                                       \
+            Logger::Instance().Push(theLevel, theCategory, aLogStream_.str());      \
+        }                                                                           \
+    } while (0)
+
+#define LOG_DISCARD(x) \
+    do                 \
+    {                  \
+    } while (0)
+
+#if LOG_ACTIVE_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(theCategory, x) LOG_AT(LOG_LEVEL_DEBUG, theCategory, x)
+#else
+#define LOG_DEBUG(theCategory, x) LOG_DISCARD(x)
+#endif
+
+#if LOG_ACTIVE_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(theCategory, x) LOG_AT(LOG_LEVEL_INFO, theCategory, x)
+#else
+#define LOG_INFO(theCategory, x) LOG_DISCARD(x)
+#endif
+
+#if LOG_ACTIVE_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(theCategory, x) LOG_AT(LOG_LEVEL_WARN, theCategory, x)
+#else
+#define LOG_WARN(theCategory, x) LOG_DISCARD(x)
+#endif
+
+#if LOG_ACTIVE_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(theCategory, x) LOG_AT(LOG_LEVEL_ERROR, theCategory, x)
+#else
+#define LOG_ERROR(theCategory, x) LOG_DISCARD(x)
+#endif
+
+#endif    // LOGGER_H
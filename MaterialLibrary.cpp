@@ -0,0 +1,74 @@
+#include "MaterialLibrary.h"
+
+#include "Gglobal.h"
+
+#include <QColor>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+
+Quantity_Color MaterialLibrary::Material::Color() const
+{
+    unsigned int aHash = 0;
+    for (int i = 0; i < Name.size(); ++i)
+        aHash = aHash * 31 + Name.at(i).unicode();
+
+    const QColor aColor = QColor::fromHsvF((aHash % 360) / 360.0,
+                                           0.3 + 0.5 * qBound(0.0, Absorptivity, 1.0),
+                                           0.5 + 0.5 * qBound(0.0, Reflectivity, 1.0));
+    return Quantity_Color(aColor.redF(), aColor.greenF(), aColor.blueF(), Quantity_TOC_sRGB);
+}
+
+MaterialLibrary::MaterialLibrary()
+{
+}
+
+bool MaterialLibrary::Load(const QString &theFile)
+{
+    QFile aFile(theFile);
+    if (!aFile.open(QIODevice::ReadOnly))
+    {
+        dbgFunTrace("无法打开材质文件: " << theFile.toStdString());
+        return false;
+    }
+
+    const QJsonDocument aDoc = QJsonDocument::fromJson(aFile.readAll());
+    if (!aDoc.isObject())
+        return false;
+
+    myMaterials.clear();
+    const QJsonObject aRoot = aDoc.object();
+    for (QJsonObject::const_iterator anIter = aRoot.begin(); anIter != aRoot.end(); ++anIter)
+    {
+        const QJsonObject aProps = anIter.value().toObject();
+
+        Material aMat;
+        aMat.Name           = anIter.key();
+        aMat.Absorptivity   = aProps.value("Absorptivity").toDouble();
+        aMat.Reflectivity   = aProps.value("Reflectivity").toDouble();
+        aMat.Refractivity   = aProps.value("Refractivity").toDouble();
+        aMat.Transmissivity = aProps.value("Transmissivity").toDouble();
+        myMaterials.insert(aMat.Name, aMat);
+    }
+    return true;
+}
+
+void MaterialLibrary::Assign(const Handle(AIS_InteractiveObject) & theObject, const QString &theName)
+{
+    if (theObject.IsNull())
+        return;
+
+    if (theName.isEmpty())
+        myAssignments.UnBind(theObject);
+    else if (!myAssignments.IsBound(theObject))
+        myAssignments.Bind(theObject, theName);
+    else
+        myAssignments.ChangeFind(theObject) = theName;
+}
+
+QString MaterialLibrary::Assigned(const Handle(AIS_InteractiveObject) & theObject) const
+{
+    const QString *aName = myAssignments.Seek(theObject);
+    return aName != NULL ? *aName : QString();
+}
@@ -0,0 +1,57 @@
+#ifndef MATERIALLIBRARY_H
+#define MATERIALLIBRARY_H
+
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+#include <AIS_InteractiveObject.hxx>
+#include <NCollection_DataMap.hxx>
+#include <Quantity_Color.hxx>
+#include <TColStd_MapTransientHasher.hxx>
+
+/// \brief MaterialLibrary
+///
+/// res/Material.json中定义的物理材质，以及显示对象到材质的分配关系。
+/// 导出(STEP/glTF)与仿真结果显示都从这里读取材质信息。
+class MaterialLibrary
+{
+public:
+    struct Material
+    {
+        QString Name;
+        double  Absorptivity;
+        double  Reflectivity;
+        double  Refractivity;
+        double  Transmissivity;
+
+        /// \brief 用于显示/导出的颜色
+        ///
+        /// Material.json中没有颜色，这里由物理属性推导：反射率越高越亮，吸收率越高饱和度越高；
+        /// 色相只由名称散列得到，保证同一材质在任何地方颜色一致
+        Quantity_Color Color() const;
+
+        /// \brief 透明度(0为不透明)，取自透射率
+        double Transparency() const { return Transmissivity; }
+    };
+
+    MaterialLibrary();
+
+    /// \brief 读取材质定义文件，默认读取资源中的res/Material.json
+    bool Load(const QString &theFile = QString(":/data/res/Material.json"));
+
+    bool        Contains(const QString &theName) const { return myMaterials.contains(theName); }
+    Material    Value(const QString &theName) const { return myMaterials.value(theName); }
+    QStringList Names() const { return myMaterials.keys(); }
+
+    /// \brief 给显示对象分配材质，theName为空时取消分配
+    void    Assign(const Handle(AIS_InteractiveObject) & theObject, const QString &theName);
+    QString Assigned(const Handle(AIS_InteractiveObject) & theObject) const;
+
+private:
+    QMap<QString, Material> myMaterials;
+
+    NCollection_DataMap<Handle(AIS_InteractiveObject), QString, TColStd_MapTransientHasher> myAssignments;
+};
+
+#endif    // MATERIALLIBRARY_H
@@ -0,0 +1,498 @@
+#include "MeshStore.h"
+
+#include "Gglobal.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QElapsedTimer>
+
+#include <BRepBndLib.hxx>
+#include <BRepMesh_IncrementalMesh.hxx>
+#include <BRepTools.hxx>
+#include <BRep_Builder.hxx>
+#include <BRep_Tool.hxx>
+#include <Graphic3d_Camera.hxx>
+#include <Poly_Triangulation.hxx>
+#include <Precision.hxx>
+#include <StdPrs_ToolTriangulatedShape.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopoDS.hxx>
+#include <V3d_View.hxx>
+#include <V3d_Viewer.hxx>
+
+
+namespace
+{
+    const qint64 THE_CHUNK_ALIGN = 4096;
+
+    //! 面记录在文件中的头部，之后依次为节点(float xyz)、UV(float uv，可选)、三角形(int32 x3)
+    struct FaceHeader
+    {
+        qint32 NbNodes;
+        qint32 NbTriangles;
+        qint32 HasUV;
+        qint32 Reserved;
+        double Deflection;
+    };
+
+    //! 内存中Poly_Triangulation的估计大小
+    qint64 memBytes(const FaceHeader &theHeader)
+    {
+        return qint64(theHeader.NbNodes) * (sizeof(gp_Pnt) + (theHeader.HasUV ? sizeof(gp_Pnt2d) : 0))
+               + qint64(theHeader.NbTriangles) * sizeof(Poly_Triangle) + sizeof(Poly_Triangulation);
+    }
+
+    //! 包围盒是否与视锥相交：8个角点全部位于同一裁剪面外侧时不可见
+    bool isInFrustum(const Bnd_Box &theBox, const Graphic3d_Mat4d &theViewProj)
+    {
+        if (theBox.IsVoid())
+            return false;
+
+        Standard_Real aMin[3], aMax[3];
+        theBox.Get(aMin[0], aMin[1], aMin[2], aMax[0], aMax[1], aMax[2]);
+
+        int anOutside[6] = {0, 0, 0, 0, 0, 0};
+        for (int i = 0; i < 8; ++i)
+        {
+            const Graphic3d_Vec4d aCorner((i & 1) ? aMax[0] : aMin[0], (i & 2) ? aMax[1] : aMin[1],
+                                          (i & 4) ? aMax[2] : aMin[2], 1.0);
+            const Graphic3d_Vec4d aClip = theViewProj * aCorner;
+            anOutside[0] += aClip.x() < -aClip.w() ? 1 : 0;
+            anOutside[1] += aClip.x() > aClip.w() ? 1 : 0;
+            anOutside[2] += aClip.y() < -aClip.w() ? 1 : 0;
+            anOutside[3] += aClip.y() > aClip.w() ? 1 : 0;
+            anOutside[4] += aClip.z() < -aClip.w() ? 1 : 0;
+            anOutside[5] += aClip.z() > aClip.w() ? 1 : 0;
+        }
+        for (int i = 0; i < 6; ++i)
+        {
+            if (anOutside[i] == 8)
+                return false;
+        }
+        return true;
+    }
+}    // namespace
+
+
+MeshStore::MeshStore(const Handle(AIS_InteractiveContext) & theContext)
+    : myContext(theContext)
+    , myMap(NULL)
+    , myMapSize(0)
+    , myBudget(512 * 1024 * 1024LL)
+    , myClock(0)
+    , myIsDirty(true)
+{
+    std::memset(&myStats, 0, sizeof(myStats));
+}
+
+MeshStore::~MeshStore()
+{
+    if (myMap != NULL)
+        myFile.unmap(myMap);
+    myFile.close();
+    myFile.remove();
+}
+
+bool MeshStore::Open(const QString &theFile)
+{
+    Clear();
+    if (myMap != NULL)
+        myFile.unmap(myMap);
+    myMap     = NULL;
+    myMapSize = 0;
+    myFile.close();
+
+    myFile.setFileName(theFile);
+    if (!myFile.open(QIODevice::ReadWrite | QIODevice::Truncate))
+    {
+        dbgFunTrace("无法创建网格存储文件: " << theFile.toStdString());
+        return false;
+    }
+    return true;
+}
+
+bool MeshStore::Add(const Handle(AIS_Shape) & theShape)
+{
+    if (theShape.IsNull() || myEntries.IsBound(theShape) || !myFile.isOpen())
+        return false;
+
+    const TopoDS_Shape &aShape = theShape->Shape();
+    if (!BRepTools::Triangulation(aShape, Precision::Infinite()))
+    {
+        const Standard_Real aDeflection = StdPrs_ToolTriangulatedShape::GetDeflection(aShape, theShape->Attributes());
+        BRepMesh_IncrementalMesh(aShape, aDeflection, Standard_False, theShape->Attributes()->DeviationAngle(),
+                                 Standard_False);
+    }
+
+    // 显示时只使用存储的网格，换出后不会被重新剖分
+    theShape->Attributes()->SetAutoTriangulation(Standard_False);
+
+    // 每个对象的数据从4KB边界开始，换入时连续读取
+    const qint64 aPad = (THE_CHUNK_ALIGN - myFile.size() % THE_CHUNK_ALIGN) % THE_CHUNK_ALIGN;
+    if (aPad > 0)
+    {
+        myFile.seek(myFile.size());
+        myFile.write(QByteArray((int)aPad, '\0'));
+    }
+
+    Entry anEntry;
+    anEntry.IsResident = true;
+    anEntry.LastUse    = ++myClock;
+    anEntry.Pins       = 0;
+    for (TopExp_Explorer anExp(aShape, TopAbs_FACE); anExp.More(); anExp.Next())
+    {
+        const TopoDS_Face &aFace = TopoDS::Face(anExp.Current());
+        const void *       aKey  = aFace.TShape().get();
+
+        std::map<const void *, int>::iterator aFound = myFaceIds.find(aKey);
+        if (aFound == myFaceIds.end())
+        {
+            FaceRecord aRecord;
+            if (!writeFace(aFace, aRecord))
+                continue;
+
+            aFound = myFaceIds.insert(std::make_pair(aKey, (int)myFaces.size())).first;
+            myFaces.push_back(aRecord);
+        }
+
+        // 同一对象中重复引用的面只计一次
+        if (std::find(anEntry.Faces.begin(), anEntry.Faces.end(), aFound->second) != anEntry.Faces.end())
+            continue;
+
+        FaceRecord &aRecord = myFaces[aFound->second];
+        if (aRecord.Users++ == 0)
+            myStats.ResidentBytes += aRecord.MemBytes;
+        anEntry.Faces.push_back(aFound->second);
+    }
+
+    TopoDS_Shape aWorld = aShape;
+    if (theShape->HasTransformation())
+        aWorld.Move(TopLoc_Location(theShape->LocalTransformation()));
+    BRepBndLib::Add(aWorld, anEntry.Box);
+
+    myEntries.Bind(theShape, anEntry);
+    myStats.NbObjects   = myEntries.Extent();
+    myStats.NbResident += 1;
+    myStats.StoredBytes = myFile.size();
+    myIsDirty           = true;
+    return true;
+}
+
+void MeshStore::Remove(const Handle(AIS_Shape) & theShape)
+{
+    Entry *anEntry = myEntries.ChangeSeek(theShape);
+    if (anEntry == NULL)
+        return;
+
+    if (!anEntry->IsResident)
+        pageIn(theShape, *anEntry);
+
+    // 面的三角网格保留在形状上，只是不再被存储管理
+    for (size_t i = 0; i < anEntry->Faces.size(); ++i)
+    {
+        FaceRecord &aRecord = myFaces[anEntry->Faces[i]];
+        if (--aRecord.Users == 0)
+            myStats.ResidentBytes -= aRecord.MemBytes;
+    }
+
+    theShape->Attributes()->SetAutoTriangulation(Standard_True);
+    myEntries.UnBind(theShape);
+    myStats.NbObjects = myEntries.Extent();
+    myStats.NbResident -= 1;
+}
+
+bool MeshStore::Pin(const Handle(AIS_Shape) & theShape)
+{
+    Entry *anEntry = myEntries.ChangeSeek(theShape);
+    if (anEntry == NULL)
+        return true;
+
+    ++anEntry->Pins;
+    anEntry->LastUse = ++myClock;
+    if (anEntry->IsResident)
+        return true;
+
+    ++myStats.PageFaults;
+    return pageIn(theShape, *anEntry);
+}
+
+void MeshStore::Unpin(const Handle(AIS_Shape) & theShape)
+{
+    Entry *anEntry = myEntries.ChangeSeek(theShape);
+    if (anEntry == NULL || anEntry->Pins == 0)
+        return;
+
+    // 解除固定后可能超出预算，下次UpdateVisibility重新判断
+    if (--anEntry->Pins == 0)
+        myIsDirty = true;
+}
+
+void MeshStore::Clear()
+{
+    std::vector<Handle(AIS_Shape)> aShapes;
+    for (NCollection_DataMap<Handle(AIS_Shape), Entry, TColStd_MapTransientHasher>::Iterator anIter(myEntries);
+         anIter.More(); anIter.Next())
+        aShapes.push_back(anIter.Key());
+
+    for (size_t i = 0; i < aShapes.size(); ++i)
+        Remove(aShapes[i]);
+
+    myFaces.clear();
+    myFaceIds.clear();
+    myViewStates.clear();
+}
+
+bool MeshStore::UpdateVisibility()
+{
+    if (myEntries.IsEmpty())
+        return false;
+
+    // 收集激活视图的相机，隐藏或最小化的视图(见ModelView::hideEvent)不参与判断
+    std::vector<Graphic3d_Mat4d>              aViewProjs;
+    std::vector<Graphic3d_WorldViewProjState> aStates;
+    const Handle(V3d_Viewer) &                aViewer = myContext->CurrentViewer();
+    for (V3d_ListOfView::Iterator anIter(aViewer->ActiveViews()); anIter.More(); anIter.Next())
+    {
+        const Handle(V3d_View) &aView = anIter.Value();
+        if (!aView->View()->IsActive())
+            continue;
+
+        const Handle(Graphic3d_Camera) &aCamera = aView->Camera();
+        aViewProjs.push_back(aCamera->ProjectionMatrix() * aCamera->OrientationMatrix());
+        aStates.push_back(aCamera->WorldViewProjState());
+    }
+
+    bool isSame = !myIsDirty && aStates.size() == myViewStates.size();
+    for (size_t i = 0; isSame && i < aStates.size(); ++i)
+        isSame = !(aStates[i] != myViewStates[i]);
+    if (isSame)
+        return false;
+
+    myViewStates = aStates;
+    myIsDirty    = false;
+
+    bool                                             isChanged = false;
+    std::vector<std::pair<qint64, Handle(AIS_Shape)>> aCandidates;
+    for (NCollection_DataMap<Handle(AIS_Shape), Entry, TColStd_MapTransientHasher>::Iterator anIter(myEntries);
+         anIter.More(); anIter.Next())
+    {
+        Entry &anEntry   = anIter.ChangeValue();
+        bool   isVisible = false;
+        for (size_t i = 0; i < aViewProjs.size() && !isVisible; ++i)
+            isVisible = isInFrustum(anEntry.Box, aViewProjs[i]);
+
+        if (!isVisible)
+        {
+            if (anEntry.IsResident && anEntry.Pins == 0)
+                aCandidates.push_back(std::make_pair(anEntry.LastUse, anIter.Key()));
+            continue;
+        }
+
+        anEntry.LastUse = ++myClock;
+        if (anEntry.IsResident)
+        {
+            ++myStats.Hits;
+        }
+        else
+        {
+            ++myStats.PageFaults;
+            isChanged = pageIn(anIter.Key(), anEntry) || isChanged;
+        }
+    }
+
+    // 超出预算时，按最近使用时间从旧到新换出不可见的对象
+    std::sort(aCandidates.begin(), aCandidates.end(),
+              [](const std::pair<qint64, Handle(AIS_Shape)> &theA, const std::pair<qint64, Handle(AIS_Shape)> &theB) {
+                  return theA.first < theB.first;
+              });
+    for (size_t i = 0; i < aCandidates.size() && myStats.ResidentBytes > myBudget; ++i)
+    {
+        pageOut(aCandidates[i].second, myEntries.ChangeFind(aCandidates[i].second));
+        isChanged = true;
+    }
+    return isChanged;
+}
+
+bool MeshStore::writeFace(const TopoDS_Face &theFace, FaceRecord &theRecord)
+{
+    TopLoc_Location                   aLoc;
+    const Handle(Poly_Triangulation) &aTri = BRep_Tool::Triangulation(theFace, aLoc);
+    if (aTri.IsNull())
+        return false;
+
+    // 节点保存在TFace的局部坐标系中，与Poly_Triangulation一致
+    FaceHeader aHeader;
+    aHeader.NbNodes     = aTri->NbNodes();
+    aHeader.NbTriangles = aTri->NbTriangles();
+    aHeader.HasUV       = aTri->HasUVNodes() ? 1 : 0;
+    aHeader.Reserved    = 0;
+    aHeader.Deflection  = aTri->Deflection();
+
+    QByteArray aData;
+    aData.reserve(int(sizeof(FaceHeader) + aHeader.NbNodes * (3 + 2 * aHeader.HasUV) * sizeof(float)
+                      + aHeader.NbTriangles * 3 * sizeof(qint32)));
+    aData.append((const char *)&aHeader, sizeof(aHeader));
+
+    const TColgp_Array1OfPnt &aNodes = aTri->Nodes();
+    for (Standard_Integer i = aNodes.Lower(); i <= aNodes.Upper(); ++i)
+    {
+        const float aXYZ[3] = {(float)aNodes(i).X(), (float)aNodes(i).Y(), (float)aNodes(i).Z()};
+        aData.append((const char *)aXYZ, sizeof(aXYZ));
+    }
+    if (aHeader.HasUV)
+    {
+        const TColgp_Array1OfPnt2d &aUVs = aTri->UVNodes();
+        for (Standard_Integer i = aUVs.Lower(); i <= aUVs.Upper(); ++i)
+        {
+            const float aUV[2] = {(float)aUVs(i).X(), (float)aUVs(i).Y()};
+            aData.append((const char *)aUV, sizeof(aUV));
+        }
+    }
+    const Poly_Array1OfTriangle &aTris = aTri->Triangles();
+    for (Standard_Integer i = aTris.Lower(); i <= aTris.Upper(); ++i)
+    {
+        Standard_Integer n1, n2, n3;
+        aTris(i).Get(n1, n2, n3);
+        const qint32 anIdx[3] = {n1, n2, n3};
+        aData.append((const char *)anIdx, sizeof(anIdx));
+    }
+
+    theRecord.Face     = theFace;
+    theRecord.Offset   = myFile.size();
+    theRecord.MemBytes = memBytes(aHeader);
+    theRecord.Users    = 0;
+
+    myFile.seek(theRecord.Offset);
+    return myFile.write(aData) == aData.size();
+}
+
+const uchar *MeshStore::mapped(const qint64 theOffset)
+{
+    // 文件只会追加，映射范围不足时重新映射整个文件
+    if (myMap == NULL || theOffset >= myMapSize)
+    {
+        if (myMap != NULL)
+            myFile.unmap(myMap);
+
+        myFile.flush();
+        myMapSize = myFile.size();
+        myMap     = myFile.map(0, myMapSize);
+        if (myMap == NULL)
+        {
+            myMapSize = 0;
+            return NULL;
+        }
+    }
+    return myMap + theOffset;
+}
+
+bool MeshStore::pageIn(const Handle(AIS_Shape) & theShape, Entry &theEntry)
+{
+    QElapsedTimer aTimer;
+    aTimer.start();
+
+    BRep_Builder aBuilder;
+    for (size_t i = 0; i < theEntry.Faces.size(); ++i)
+    {
+        FaceRecord &aRecord = myFaces[theEntry.Faces[i]];
+        if (aRecord.Users++ > 0)
+            continue;
+
+        const uchar *aData = mapped(aRecord.Offset);
+        if (aData == NULL)
+        {
+            // 撤销已经换入的面，对象仍然处于换出状态，pageOut不会再平衡这些计数
+            --aRecord.Users;
+            for (size_t j = 0; j < i; ++j)
+            {
+                FaceRecord &aLoaded = myFaces[theEntry.Faces[j]];
+                if (--aLoaded.Users > 0)
+                    continue;
+
+                aBuilder.UpdateFace(aLoaded.Face, Handle(Poly_Triangulation)());
+                myStats.ResidentBytes -= aLoaded.MemBytes;
+            }
+            return false;
+        }
+
+        FaceHeader aHeader;
+        std::memcpy(&aHeader, aData, sizeof(aHeader));
+        const float * aXYZ  = (const float *)(aData + sizeof(aHeader));
+        const float * aUV   = aXYZ + 3 * aHeader.NbNodes;
+        const qint32 *anIdx = (const qint32 *)(aUV + (aHeader.HasUV ? 2 * aHeader.NbNodes : 0));
+
+        Handle(Poly_Triangulation) aTri =
+            new Poly_Triangulation(aHeader.NbNodes, aHeader.NbTriangles, aHeader.HasUV != 0);
+        TColgp_Array1OfPnt &aNodes = aTri->ChangeNodes();
+        for (Standard_Integer n = 0; n < aHeader.NbNodes; ++n)
+            aNodes.SetValue(aNodes.Lower() + n, gp_Pnt(aXYZ[3 * n], aXYZ[3 * n + 1], aXYZ[3 * n + 2]));
+        if (aHeader.HasUV)
+        {
+            TColgp_Array1OfPnt2d &aUVs = aTri->ChangeUVNodes();
+            for (Standard_Integer n = 0; n < aHeader.NbNodes; ++n)
+                aUVs.SetValue(aUVs.Lower() + n, gp_Pnt2d(aUV[2 * n], aUV[2 * n + 1]));
+        }
+        Poly_Array1OfTriangle &aTris = aTri->ChangeTriangles();
+        for (Standard_Integer t = 0; t < aHeader.NbTriangles; ++t)
+            aTris.SetValue(aTris.Lower() + t, Poly_Triangle(anIdx[3 * t], anIdx[3 * t + 1], anIdx[3 * t + 2]));
+        aTri->Deflection(aHeader.Deflection);
+
+        aBuilder.UpdateFace(aRecord.Face, aTri);
+        myStats.ResidentBytes += aRecord.MemBytes;
+    }
+
+    theEntry.IsResident = true;
+    myStats.NbResident += 1;
+
+    myContext->Redisplay(theShape, Standard_False);
+    for (TColStd_ListOfInteger::Iterator aMode(theEntry.Modes); aMode.More(); aMode.Next())
+        myContext->Activate(theShape, aMode.Value());
+    theEntry.Modes.Clear();
+
+    myStats.PageInMs += aTimer.nsecsElapsed() / 1.0e6;
+    return true;
+}
+
+void MeshStore::pageOut(const Handle(AIS_Shape) & theShape, Entry &theEntry)
+{
+    // 先释放显示和选择数据，它们各自持有三角网格或由其生成的顶点缓冲
+    myContext->ActivatedModes(theShape, theEntry.Modes);
+    myContext->Deactivate(theShape);
+    theShape->ClearSelections(Standard_True);
+    myContext->ClearPrs(theShape, AIS_WireFrame, Standard_False);
+    myContext->ClearPrs(theShape, AIS_Shaded, Standard_False);
+
+    BRep_Builder aBuilder;
+    for (size_t i = 0; i < theEntry.Faces.size(); ++i)
+    {
+        FaceRecord &aRecord = myFaces[theEntry.Faces[i]];
+        if (--aRecord.Users > 0)
+            continue;
+
+        aBuilder.UpdateFace(aRecord.Face, Handle(Poly_Triangulation)());
+        myStats.ResidentBytes -= aRecord.MemBytes;
+    }
+
+    theEntry.IsResident = false;
+    myStats.NbResident -= 1;
+    ++myStats.Evictions;
+}
+
+
+MeshStorePin::MeshStorePin(MeshStore *theStore, const std::vector<Handle(AIS_Shape)> &theShapes)
+    : myStore(theStore)
+{
+    if (myStore == NULL)
+        return;
+
+    myShapes = theShapes;
+    for (size_t i = 0; i < myShapes.size(); ++i)
+        myStore->Pin(myShapes[i]);
+}
+
+MeshStorePin::~MeshStorePin()
+{
+    for (size_t i = 0; myStore != NULL && i < myShapes.size(); ++i)
+        myStore->Unpin(myShapes[i]);
+}
@@ -0,0 +1,137 @@
+#ifndef MESHSTORE_H
+#define MESHSTORE_H
+
+#include <map>
+#include <vector>
+
+#include <QFile>
+#include <QString>
+
+#include <AIS_InteractiveContext.hxx>
+#include <AIS_Shape.hxx>
+#include <Bnd_Box.hxx>
+#include <Graphic3d_WorldViewProjState.hxx>
+#include <NCollection_DataMap.hxx>
+#include <TColStd_ListOfInteger.hxx>
+#include <TColStd_MapTransientHasher.hxx>
+#include <TopoDS_Face.hxx>
+
+/// \brief MeshStore
+///
+/// 三角网格的外存存储。加入的对象的面三角网格写入一个文件(每个对象的数据连续存放并按4KB对齐)，
+/// 读取时通过QFile::map映射整个文件；不在任何视图视锥内的对象按LRU顺序换出，直到常驻内存
+/// 不超过预算，换出时同时清除其显示和选择数据。对象重新进入视锥时从映射文件中换入三角网格并重新显示。
+///
+/// - 共享TShape的面只存储一次，按引用计数决定是否释放
+/// - 加入的对象关闭自动剖分(Prs3d_Drawer::SetAutoTriangulation)，显示时只使用存储的网格
+/// - 节点坐标以float存储，用于显示的精度足够
+/// - 直接使用形状三角网格的计算(干涉、标量场、导出、重新剖分)之前须固定对象(Pin或MeshStorePin)，
+///   否则换出的面没有网格会被重新剖分，常驻内存的统计失准
+class MeshStore
+{
+public:
+    struct Statistics
+    {
+        Standard_Integer NbObjects;
+        Standard_Integer NbResident;      ///< 三角网格在内存中的对象数
+        qint64           PageFaults;      ///< 可见但不在内存中、需要换入的次数
+        qint64           Hits;            ///< 可见且已在内存中的次数
+        qint64           Evictions;
+        qint64           ResidentBytes;   ///< 内存中三角网格的估计大小
+        qint64           StoredBytes;     ///< 存储文件大小
+        double           PageInMs;        ///< 换入的累计耗时(读取、重建网格、重新显示)
+    };
+
+    explicit MeshStore(const Handle(AIS_InteractiveContext) & theContext);
+
+    /// \brief 删除存储文件。已换出的对象不会被换入，需要恢复时先调用Clear
+    ~MeshStore();
+
+    /// \brief 创建(覆盖)存储文件
+    bool Open(const QString &theFile);
+
+    /// \brief 常驻内存预算(字节)，可见对象不受预算限制
+    void   SetBudget(const qint64 theBytes) { myBudget = theBytes; }
+    qint64 Budget() const { return myBudget; }
+
+    /// \brief 加入一个已显示的对象，缺少的三角网格先剖分，然后写入存储文件
+    bool Add(const Handle(AIS_Shape) & theShape);
+
+    /// \brief 移除对象，若已换出则先换入，恢复对象原有的状态
+    void Remove(const Handle(AIS_Shape) & theShape);
+
+    /// \brief 换入全部对象并清空存储
+    void Clear();
+
+    Standard_Boolean Contains(const Handle(AIS_Shape) & theShape) const { return myEntries.IsBound(theShape); }
+
+    /// \brief 固定对象的三角网格：已换出时立即换入，固定期间不会被换出；不由存储管理的对象忽略
+    ///
+    /// 与Unpin成对调用，可以嵌套。
+    /// \return 对象的三角网格在内存中(或对象不由存储管理)时返回true
+    bool Pin(const Handle(AIS_Shape) & theShape);
+    void Unpin(const Handle(AIS_Shape) & theShape);
+
+    /// \brief 按视图的视锥更新对象的换入/换出
+    ///
+    /// 所有激活的视图都参与判断，相机与对象都没有变化时直接返回。
+    /// \return 有对象被换入或换出时返回true，调用者需要重绘
+    bool UpdateVisibility();
+
+    const Statistics &Stats() const { return myStats; }
+
+private:
+    struct FaceRecord
+    {
+        TopoDS_Face      Face;
+        qint64           Offset;
+        qint64           MemBytes;
+        Standard_Integer Users;      ///< 引用该面且常驻内存的对象数
+    };
+
+    struct Entry
+    {
+        std::vector<int>      Faces;
+        Bnd_Box               Box;
+        bool                  IsResident;
+        qint64                LastUse;
+        Standard_Integer      Pins;     ///< Pin的嵌套次数，大于0时不会被换出
+        TColStd_ListOfInteger Modes;    ///< 换出前激活的选择模式
+    };
+
+    bool         writeFace(const TopoDS_Face &theFace, FaceRecord &theRecord);
+    bool         pageIn(const Handle(AIS_Shape) & theShape, Entry &theEntry);
+    void         pageOut(const Handle(AIS_Shape) & theShape, Entry &theEntry);
+    const uchar *mapped(const qint64 theOffset);
+
+    Handle(AIS_InteractiveContext) myContext;
+    QFile                          myFile;
+    uchar *                        myMap;
+    qint64                         myMapSize;
+    qint64                         myBudget;
+    qint64                         myClock;
+    bool                           myIsDirty;
+    std::vector<FaceRecord>        myFaces;
+    std::map<const void *, int>    myFaceIds;    ///< TShape -> myFaces中的序号
+
+    NCollection_DataMap<Handle(AIS_Shape), Entry, TColStd_MapTransientHasher> myEntries;
+    std::vector<Graphic3d_WorldViewProjState>                                 myViewStates;
+    Statistics                                                                myStats;
+};
+
+/// \brief 作用域内固定一组对象的三角网格(见MeshStore::Pin)，store为空时不做任何事
+class MeshStorePin
+{
+public:
+    MeshStorePin(MeshStore *theStore, const std::vector<Handle(AIS_Shape)> &theShapes);
+    ~MeshStorePin();
+
+private:
+    MeshStorePin(const MeshStorePin &);
+    MeshStorePin &operator=(const MeshStorePin &);
+
+    MeshStore *                    myStore;
+    std::vector<Handle(AIS_Shape)> myShapes;
+};
+
+#endif    // MESHSTORE_H
@@ -3,19 +3,33 @@
 #endif
 
 #include "ModelView.h"
+#include "Gglobal.h"
+#include "DuplicateFinder.h"
+#include "FaceStyler.h"
 #include "OcctWindow.h"
+#include "ShapeUtils.h"
+#include "StartupTrace.h"
+#include "WireframeBuffer.h"
 
+#include <QActionGroup>
 #include <QApplication>
 #include <QColorDialog>
 #include <QCursor>
+#include <QElapsedTimer>
 #include <QFileDialog>
 #include <QFileInfo>
+#include <QIcon>
+#include <QInputDialog>
 #include <QMdiSubWindow>
 #include <QMenu>
 #include <QMouseEvent>
 #include <QPainter>
 #include <QRubberBand>
 #include <QStyleFactory>
+#include <QTimer>
+
+#include <algorithm>
+#include <map>
 
 #include <Standard_WarningsDisable.hxx>
 #include <Standard_WarningsRestore.hxx>
@@ -23,14 +37,19 @@
 #include <QX11Info>
 #endif
 
+#include <AIS_ConnectedInteractive.hxx>
 #include <AIS_Shape.hxx>
 #include <AIS_ViewCube.hxx>
 #include <Aspect_DisplayConnection.hxx>
 #include <Graphic3d_GraphicDriver.hxx>
 #include <Graphic3d_TextureEnv.hxx>
+#include <SelectMgr_Selection.hxx>
 #include <StdSelect_BRepOwner.hxx>
 #include <StdSelect_FaceFilter.hxx>
+#include <TopExp.hxx>
 #include <TopExp_Explorer.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
+#include <TopTools_ListOfShape.hxx>
 
 
 namespace
@@ -74,6 +93,9 @@ namespace
         }
         return aFlags;
     }
+
+    //! 选中对象的边数达到该值时，线框显示合并为一个WireframeBuffer
+    const Standard_Integer THE_MERGED_WIREFRAME_EDGES = 10000;
 }    // namespace
 
 static QCursor *defCursor     = NULL;
@@ -83,12 +105,20 @@ static QCursor *globPanCursor = NULL;
 static QCursor *zoomCursor    = NULL;
 static QCursor *rotCursor     = NULL;
 
-ModelView::ModelView(const Handle(AIS_InteractiveContext) & theContext, bool with_viewcube, QWidget *parent)
+ModelView::ModelView(const Handle(AIS_InteractiveContext) & theContext, bool with_viewcube, QWidget *parent,
+                     ModelView *theMaster)
     : QWidget(parent)
     , myIsRaytracing(false)
     , myIsShadowsEnabled(true)
     , myIsReflectionsEnabled(false)
     , myIsAntialiasingEnabled(false)
+    , myIsPopupEnabled(true)
+    , myDumper(theMaster == NULL ? new ImageDumper(this) : NULL)
+    , myBooleans(theMaster == NULL ? new BooleanService(theContext, this, this) : NULL)
+    , mySimplifier(theContext)
+    , myMeshStore(NULL)
+    , myPointCloud(theMaster == NULL ? new PointCloudLayer(theContext, this) : NULL)
+    , myMaster(theMaster)
     , myBackMenu(NULL)
 {
 #if !defined(_WIN32) && (!defined(__APPLE__) || defined(MACOSX_USE_GLX)) && QT_VERSION < 0x050000
@@ -104,16 +134,13 @@ ModelView::ModelView(const Handle(AIS_InteractiveContext) & theContext, bool wit
     myCurrentMode     = CurAction3d_Nothing;
     setMouseTracking(true);
 
+    // ViewCube在第一帧之后才显示(见paintEvent)，其文字需要初始化字体管理器(扫描系统字体)
     if (with_viewcube)
-    {
-        Handle(AIS_ViewCube) viewcube = new AIS_ViewCube();
-        myContext->Display(viewcube, Standard_False);
-    }
+        myViewCube = new AIS_ViewCube();
 
     myContext->SelectionManager();
 
     initViewActions();
-    initCursors();
 
     setBackgroundRole(QPalette::NoRole);    //NoBackground );
     // set focus policy to threat QContextMenuEvent from keyboard
@@ -122,11 +149,17 @@ ModelView::ModelView(const Handle(AIS_InteractiveContext) & theContext, bool wit
     setAttribute(Qt::WA_NoSystemBackground);
 
     init();
+    StartupTrace::Mark("view window");
     initSelectionModeActions();
+
+    // 辅助视图使用主视图的材质库，不重复加载
+    if (myMaster == NULL)
+        myMaterials.Load();
 }
 
 ModelView::~ModelView()
 {
+    delete myMeshStore;
     delete myBackMenu;
 }
 
@@ -155,7 +188,35 @@ void ModelView::paintEvent(QPaintEvent *)
 {
     //  QApplication::syncX();
     myV3dView->InvalidateImmediate();
+
+    // 相机变化后按视锥换入/换出三角网格，有变化时整个视图需要重绘
+    if (getMeshStore() != NULL && getMeshStore()->UpdateVisibility())
+        myV3dView->Invalidate();
+
+    // 相机移动期间点云切换到抽稀显示
+    if (getPointCloud()->UpdateView())
+        myV3dView->Invalidate();
+
+    // 缩放到特征看不清时以简化形状代替显示
+    if (getSimplifier().UpdateView())
+        myV3dView->Invalidate();
+
+    // 拾取在FlushViewEvents中进行，面属性表在此之前更新，选择过滤器中不再计算
+    getFaceIndex().Update();
+
     FlushViewEvents(myContext, myV3dView, true);
+
+    if (!myViewCube.IsNull())
+    {
+        StartupTrace::FirstFrame();
+
+        Handle(AIS_ViewCube) aViewCube = myViewCube;
+        myViewCube.Nullify();
+        QTimer::singleShot(0, this, [this, aViewCube]() {
+            myContext->Display(aViewCube, Standard_False);
+            myContext->UpdateCurrentViewer();
+        });
+    }
 }
 
 void ModelView::resizeEvent(QResizeEvent *)
@@ -167,6 +228,26 @@ void ModelView::resizeEvent(QResizeEvent *)
     }
 }
 
+// 隐藏或最小化的视图不参与重绘：V3d_Viewer更新时会跳过未激活的视图
+void ModelView::showEvent(QShowEvent *)
+{
+    if (!myV3dView.IsNull() && !myV3dView->View()->IsActive())
+    {
+        myV3dView->View()->Activate();
+        myV3dView->MustBeResized();
+        myV3dView->Invalidate();
+        update();
+    }
+}
+
+void ModelView::hideEvent(QHideEvent *)
+{
+    if (!myV3dView.IsNull() && myV3dView->View()->IsActive())
+    {
+        myV3dView->View()->Deactivate();
+    }
+}
+
 /// \brief 复写被选择的物体变化后，用于处理的事件
 void ModelView::OnSelectionChanged(const Handle(AIS_InteractiveContext) & ctx,
                                    const Handle(V3d_View) & theView)
@@ -387,8 +468,45 @@ void ModelView::onRaytraceAction()
 void ModelView::onWireframe()
 {
     QApplication::setOverrideCursor(Qt::WaitCursor);
+
+    // 边数多时选中的对象合并为一个线框缓冲，其余情况逐对象切换到AIS_WireFrame
+    std::vector<Handle(AIS_Shape)> aShapes;
+    Standard_Integer               aNbEdges = 0;
     for (myContext->InitSelected(); myContext->MoreSelected(); myContext->NextSelected())
-        myContext->SetDisplayMode(myContext->SelectedInteractive(), AIS_WireFrame, false);
+    {
+        Handle(AIS_Shape) aShape = Handle(AIS_Shape)::DownCast(myContext->SelectedInteractive());
+        if (aShape.IsNull())
+            continue;
+
+        TopTools_IndexedMapOfShape anEdges;
+        TopExp::MapShapes(aShape->Shape(), TopAbs_EDGE, anEdges);
+        aNbEdges += anEdges.Extent();
+        aShapes.push_back(aShape);
+    }
+
+    if (aNbEdges >= THE_MERGED_WIREFRAME_EDGES)
+    {
+        Standard_Integer aNbGroups = 0;
+        for (size_t i = 0; i < aShapes.size(); ++i)
+            aNbGroups += WireframeBuffer::CountGroups(aShapes[i]);
+
+        Handle(WireframeBuffer) aBuffer = new WireframeBuffer(aShapes);
+        myContext->ClearSelected(Standard_False);
+        for (size_t i = 0; i < aShapes.size(); ++i)
+            myContext->Erase(aShapes[i], Standard_False);
+        myContext->Display(aBuffer, 0, 0, Standard_False);
+
+        const WireframeBuffer::Stats &aStats = aBuffer->GetStats();
+        LOG_INFO("ModelView", "合并线框: " << aStats.NbSources << " 个对象, 边 " << aStats.NbEdgeUses << " -> "
+                                           << aStats.NbEdges << ", 线段 " << aStats.NbSegments << ", 图元组 "
+                                           << aNbGroups << " -> " << aStats.NbGroups << ", " << aStats.BuildMs
+                                           << " ms");
+    }
+    else
+    {
+        for (myContext->InitSelected(); myContext->MoreSelected(); myContext->NextSelected())
+            myContext->SetDisplayMode(myContext->SelectedInteractive(), AIS_WireFrame, false);
+    }
     myContext->UpdateCurrentViewer();
     OnSelectionChanged();
     QApplication::restoreOverrideCursor();
@@ -397,8 +515,29 @@ void ModelView::onWireframe()
 void ModelView::onShading()
 {
     QApplication::setOverrideCursor(Qt::WaitCursor);
+
+    // 合并的线框恢复为各个源对象
+    std::vector<Handle(WireframeBuffer)> aBuffers;
     for (myContext->InitSelected(); myContext->MoreSelected(); myContext->NextSelected())
-        myContext->SetDisplayMode(myContext->SelectedInteractive(), AIS_Shaded, false);
+    {
+        Handle(WireframeBuffer) aBuffer = Handle(WireframeBuffer)::DownCast(myContext->SelectedInteractive());
+        if (!aBuffer.IsNull())
+        {
+            if (std::find(aBuffers.begin(), aBuffers.end(), aBuffer) == aBuffers.end())
+                aBuffers.push_back(aBuffer);
+        }
+        else
+            myContext->SetDisplayMode(myContext->SelectedInteractive(), AIS_Shaded, false);
+    }
+
+    if (!aBuffers.empty())
+        myContext->ClearSelected(Standard_False);
+    for (size_t i = 0; i < aBuffers.size(); ++i)
+    {
+        for (size_t j = 0; j < aBuffers[i]->Sources().size(); ++j)
+            myContext->Display(aBuffers[i]->Sources()[j], AIS_Shaded, 0, Standard_False);
+        myContext->Remove(aBuffers[i], Standard_False);
+    }
     myContext->UpdateCurrentViewer();
     OnSelectionChanged();
     QApplication::restoreOverrideCursor();
@@ -436,15 +575,766 @@ void ModelView::onTransparency(int theTrans)
 
 void ModelView::onDelete()
 {
-    myContext->EraseSelected(Standard_False);
+    // 先取出选择集，移除对象会改变上下文的选择，不能边遍历边移除
+    std::vector<Handle(AIS_InteractiveObject)> aSelected;
+    for (myContext->InitSelected(); myContext->MoreSelected(); myContext->NextSelected())
+        aSelected.push_back(myContext->SelectedInteractive());
     myContext->ClearSelected(Standard_False);
+
+    for (size_t i = 0; i < aSelected.size(); ++i)
+    {
+        // 合并线框的源对象已经隐藏，随之移除
+        const Handle(WireframeBuffer) aBuffer = Handle(WireframeBuffer)::DownCast(aSelected[i]);
+        if (!aBuffer.IsNull())
+        {
+            for (size_t j = 0; j < aBuffer->Sources().size(); ++j)
+                removeShape(aBuffer->Sources()[j], false);
+            myContext->Remove(aBuffer, Standard_False);
+            continue;
+        }
+
+        // 与程序中移除对象走同一条路径：索引、材质分配、拓扑缓存等随对象一起释放
+        const Handle(AIS_Shape) aShape = Handle(AIS_Shape)::DownCast(aSelected[i]);
+        if (!aShape.IsNull())
+        {
+            removeShape(aShape, false);
+            continue;
+        }
+
+        // 共享重复实体的连接对象，登记在索引中的是它替换掉的对象(见onShareDuplicates)
+        const Handle(AIS_Shape) aSource = Handle(AIS_Shape)::DownCast(aSelected[i]->GetOwner());
+        if (!aSource.IsNull())
+            removeShape(aSource, false);
+        myContext->Remove(aSelected[i], Standard_False);
+    }
     myContext->UpdateCurrentViewer();
 
     // 已选择部分更新
     OnSelectionChanged();
 }
 
+void ModelView::displayShape(const Handle(AIS_Shape) & theShape, bool theToUpdate)
+{
+    myContext->Display(theShape, theToUpdate);
+    getShapeIndex().Add(theShape);
+    getFaceIndex().Add(theShape, getMaterials().Names().indexOf(getMaterials().Assigned(theShape)));
+    if (getMeshStore() != NULL)
+        getMeshStore()->Add(theShape);
+}
+
+void ModelView::removeShape(const Handle(AIS_Shape) & theShape, bool theToUpdate)
+{
+    getShapeIndex().Remove(theShape);
+    getFaceIndex().Remove(theShape);
+    getMaterials().Assign(theShape, QString());
+    getSimplifier().Remove(theShape);
+    if (getMeshStore() != NULL)
+        getMeshStore()->Remove(theShape);
+    if (getScalarFields().IsBound(theShape))
+    {
+        myContext->Remove(getScalarFields().Find(theShape), Standard_False);
+        getScalarFields().UnBind(theShape);
+    }
+    if (myMaster == NULL)
+        myTopologies.UnBind(theShape);
+    else
+        myMaster->myTopologies.UnBind(theShape);
+    myContext->Remove(theShape, theToUpdate);
+}
+
+const Handle(TopologyGraph) & ModelView::getTopology(const Handle(AIS_Shape) & theShape)
+{
+    if (myMaster != NULL)
+        return myMaster->getTopology(theShape);
+
+    if (!myTopologies.IsBound(theShape))
+    {
+        Handle(TopologyGraph) aGraph = new TopologyGraph(theShape->Shape());
+        LOG_INFO("ModelView", tr("拓扑邻接图: %1 faces, %2 edges, %3 vertices, %4 KB, %5 ms")
+                                  .arg(aGraph->NbFaces())
+                                  .arg(aGraph->NbEdges())
+                                  .arg(aGraph->NbVertices())
+                                  .arg((qulonglong)(aGraph->MemorySize() / 1024))
+                                  .arg(aGraph->BuildMs(), 0, 'f', 1)
+                                  .toStdString());
+        myTopologies.Bind(theShape, aGraph);
+    }
+    return myTopologies.Find(theShape);
+}
+
+bool ModelView::enableMeshStore(const QString &theFile, qint64 theBudget)
+{
+    if (myMaster != NULL)
+        return myMaster->enableMeshStore(theFile, theBudget);
+
+    disableMeshStore();
+
+    myMeshStore = new MeshStore(myContext);
+    if (!myMeshStore->Open(theFile))
+    {
+        delete myMeshStore;
+        myMeshStore = NULL;
+        return false;
+    }
+    myMeshStore->SetBudget(theBudget);
+
+    AIS_ListOfInteractive aList;
+    myContext->DisplayedObjects(AIS_KOI_Shape, -1, aList);
+    for (AIS_ListOfInteractive::Iterator anIter(aList); anIter.More(); anIter.Next())
+        myMeshStore->Add(Handle(AIS_Shape)::DownCast(anIter.Value()));
+
+    myV3dView->Invalidate();
+    update();
+    return true;
+}
+
+void ModelView::disableMeshStore()
+{
+    if (myMaster != NULL)
+    {
+        myMaster->disableMeshStore();
+        return;
+    }
+
+    if (myMeshStore == NULL)
+        return;
+
+    const MeshStore::Statistics &aStats = myMeshStore->Stats();
+    LOG_INFO("ModelView", "网格存储: " << aStats.NbObjects << " objects, " << aStats.NbResident << " resident, "
+                                      << aStats.PageFaults << " page faults, " << aStats.Hits << " hits, "
+                                      << aStats.Evictions << " evictions, "
+                                      << aStats.ResidentBytes / 1048576 << "/" << aStats.StoredBytes / 1048576
+                                      << " MB resident/stored, page-in " << aStats.PageInMs << " ms");
+
+    myMeshStore->Clear();
+    delete myMeshStore;
+    myMeshStore = NULL;
+    myContext->UpdateCurrentViewer();
+}
+
+std::vector<Handle(AIS_Shape)> ModelView::displayedShapes() const
+{
+    AIS_ListOfInteractive aList;
+    myContext->DisplayedObjects(AIS_KOI_Shape, -1, aList);
+
+    std::vector<Handle(AIS_Shape)> aShapes;
+    for (AIS_ListOfInteractive::Iterator anIter(aList); anIter.More(); anIter.Next())
+    {
+        Handle(AIS_Shape) aShape = Handle(AIS_Shape)::DownCast(anIter.Value());
+        if (!aShape.IsNull())
+            aShapes.push_back(aShape);
+    }
+    return aShapes;
+}
+
+void ModelView::highlightShapes(const std::vector<Handle(AIS_Shape)> &theShapes)
+{
+    myContext->ClearSelected(Standard_False);
+    for (size_t i = 0; i < theShapes.size(); ++i)
+    {
+        if (!myContext->IsSelected(theShapes[i]))
+            myContext->AddOrRemoveSelected(theShapes[i], Standard_False);
+    }
+    myContext->UpdateCurrentViewer();
+
+    OnSelectionChanged();
+}
+
+void ModelView::onClashCheck()
+{
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    std::vector<ShapeIndex::ClashPair> aClashes;
+    {
+        // 细筛读取全部对象的三角网格，换出的对象先换入
+        MeshStorePin aPin(getMeshStore(), displayedShapes());
+        aClashes = getShapeIndex().Clashes(0.0);
+    }
+
+    std::vector<Handle(AIS_Shape)> aShapes;
+    for (size_t i = 0; i < aClashes.size(); ++i)
+    {
+        aShapes.push_back(aClashes[i].First);
+        aShapes.push_back(aClashes[i].Second);
+    }
+    highlightShapes(aShapes);
+    QApplication::restoreOverrideCursor();
+
+    LOG_INFO("ModelView", tr("干涉检查: %1 对对象发生干涉").arg((int)aClashes.size()).toStdString());
+}
+
+void ModelView::onSelectNearby()
+{
+    bool                aOk       = false;
+    const Standard_Real aDistance = QInputDialog::getDouble(this, tr("Select Nearby"), tr("距离(mm):"),
+                                                            10.0, 0.0, 1.0e6, 2, &aOk);
+    if (!aOk)
+        return;
+
+    std::vector<Handle(AIS_Shape)> aSources;
+    for (myContext->InitSelected(); myContext->MoreSelected(); myContext->NextSelected())
+    {
+        Handle(AIS_Shape) aShape = Handle(AIS_Shape)::DownCast(myContext->SelectedInteractive());
+        if (!aShape.IsNull())
+            aSources.push_back(aShape);
+    }
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    std::vector<Handle(AIS_Shape)> aResult = aSources;
+    {
+        MeshStorePin aPin(getMeshStore(), displayedShapes());
+        for (size_t i = 0; i < aSources.size(); ++i)
+        {
+            std::vector<Handle(AIS_Shape)> aNear = getShapeIndex().Proximity(aSources[i], aDistance);
+            aResult.insert(aResult.end(), aNear.begin(), aNear.end());
+        }
+    }
+    highlightShapes(aResult);
+    QApplication::restoreOverrideCursor();
+}
+
+void ModelView::onAssignMaterial()
+{
+    QAction *     aSentBy = (QAction *)sender();
+    const QString aName   = aSentBy->data().toString();
+
+    for (myContext->InitSelected(); myContext->MoreSelected(); myContext->NextSelected())
+        assignMaterial(myContext->SelectedInteractive(), aName);
+    myContext->UpdateCurrentViewer();
+}
+
+void ModelView::assignMaterial(const Handle(AIS_InteractiveObject) & theObject, const QString &theName)
+{
+    getMaterials().Assign(theObject, theName);
+    getFaceIndex().SetMaterial(Handle(AIS_Shape)::DownCast(theObject), getMaterials().Names().indexOf(theName));
+    if (getMaterials().Contains(theName))
+    {
+        const MaterialLibrary::Material aMat = getMaterials().Value(theName);
+        myContext->SetColor(theObject, aMat.Color(), Standard_False);
+        myContext->SetTransparency(theObject, aMat.Transparency(), Standard_False);
+    }
+}
+
+void ModelView::onSamplePointCloud()
+{
+    TopTools_ListOfShape aShapes;
+    for (myContext->InitSelected(); myContext->MoreSelected(); myContext->NextSelected())
+    {
+        Handle(AIS_Shape) aShape = Handle(AIS_Shape)::DownCast(myContext->SelectedInteractive());
+        if (aShape.IsNull())
+            continue;
+
+        aShapes.Append(ShapeUtils::WorldShape(aShape));
+    }
+    if (aShapes.IsEmpty())
+        return;
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const qint64 aFirst = getPointCloud()->NbPoints();
+    for (TopTools_ListOfShape::Iterator anIter(aShapes); anIter.More(); anIter.Next())
+        getPointCloud()->AddShape(anIter.Value());
+    QApplication::restoreOverrideCursor();
+
+    LOG_INFO("ModelView", "sampled " << getPointCloud()->NbPoints() - aFirst << " points from "
+                                     << aShapes.Extent() << " shapes");
+}
+
+void ModelView::onClearPointCloud()
+{
+    getPointCloud()->Clear();
+}
+
+void ModelView::onAbsorbedEnergy()
+{
+    std::vector<Handle(AIS_Shape)> aShapes;
+    for (myContext->InitSelected(); myContext->MoreSelected(); myContext->NextSelected())
+    {
+        Handle(AIS_Shape) aShape = Handle(AIS_Shape)::DownCast(myContext->SelectedInteractive());
+        if (!aShape.IsNull())
+            aShapes.push_back(aShape);
+    }
+    myContext->ClearSelected(Standard_False);
+
+    // 入射方向取当前视线方向，面吸收的能量 = 吸收率 x 面积 x 入射余弦；未分配材质的对象按全吸收计
+    Standard_Real aDx, aDy, aDz;
+    myV3dView->Proj(aDx, aDy, aDz);
+    const gp_Dir anIncident(aDx, aDy, aDz);
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    getFaceIndex().Update();
+    for (size_t i = 0; i < aShapes.size(); ++i)
+    {
+        // 显示标量场的对象已隐藏，不会再被选中；标量场由onClearScalarFields统一移除
+        const Handle(AIS_Shape) &aShape = aShapes[i];
+        if (getScalarFields().IsBound(aShape))
+            continue;
+
+        const QString       aMat          = getMaterials().Assigned(aShape);
+        const Standard_Real aAbsorptivity = getMaterials().Contains(aMat) ? getMaterials().Value(aMat).Absorptivity : 1.0;
+
+        Handle(ScalarField) aField;
+        {
+            MeshStorePin aPin(getMeshStore(), std::vector<Handle(AIS_Shape)>(1, aShape));
+            aField = new ScalarField(aShape);
+        }
+        std::vector<float>  aValues(aField->NbFaces(), 0.0f);
+        for (Standard_Integer f = 1; f <= aField->NbFaces(); ++f)
+        {
+            const Standard_Integer aRow = getFaceIndex().Row(aShape, aField->Face(f));
+            if (aRow < 0)
+                continue;
+
+            const Standard_Real aCos = std::max(0.0, getFaceIndex().Normal(aRow).Dot(anIncident));
+            aValues[f - 1]           = (float)(aAbsorptivity * getFaceIndex().Area(aRow) * aCos);
+        }
+        aField->SetFaceValues(aValues.data(), Standard_False);
+        aField->FitRange(Standard_False);
+
+        getScalarFields().Bind(aShape, aField);
+        myContext->Erase(aShape, Standard_False);
+        myContext->Display(aField, 0, -1, Standard_False);
+    }
+    QApplication::restoreOverrideCursor();
+    myContext->UpdateCurrentViewer();
+}
+
+void ModelView::onClearScalarFields()
+{
+    for (ScalarFieldMap::Iterator anIter(getScalarFields()); anIter.More(); anIter.Next())
+    {
+        myContext->Remove(anIter.Value(), Standard_False);
+        myContext->Display(anIter.Key(), Standard_False);
+    }
+    getScalarFields().Clear();
+    myContext->UpdateCurrentViewer();
+}
+
+void ModelView::onSelectSimilar()
+{
+    FaceIndex &anIndex = getFaceIndex();
+
+    // 以选择集中的第一个面为样本
+    Standard_Integer aSample = -1;
+    for (myContext->InitSelected(); myContext->MoreSelected() && aSample < 0; myContext->NextSelected())
+    {
+        const Handle(StdSelect_BRepOwner) anOwner = Handle(StdSelect_BRepOwner)::DownCast(myContext->SelectedOwner());
+        if (!anOwner.IsNull() && anOwner->HasShape() && anOwner->Shape().ShapeType() == TopAbs_FACE)
+            aSample = anIndex.Row(Handle(AIS_Shape)::DownCast(anOwner->Selectable()), anOwner->Shape());
+    }
+    if (aSample < 0)
+        return;
+
+    QElapsedTimer aTimer;
+    aTimer.start();
+    anIndex.Update();
+    const std::vector<Standard_Integer> aRows = anIndex.Find(FaceIndex::Query::Similar(anIndex, aSample));
+    const qint64                        aScanMs = aTimer.elapsed();
+
+    // 按对象分组，再在对象的面选择中找到对应的owner
+    std::map<AIS_Shape *, std::vector<Standard_Integer>> aByObject;
+    for (size_t i = 0; i < aRows.size(); ++i)
+        aByObject[anIndex.Object(aRows[i]).get()].push_back(aRows[i]);
+
+    const Standard_Integer aFaceMode = AIS_Shape::SelectionMode(TopAbs_FACE);
+    myContext->ClearSelected(Standard_False);
+    for (std::map<AIS_Shape *, std::vector<Standard_Integer>>::const_iterator anIter = aByObject.begin();
+         anIter != aByObject.end(); ++anIter)
+    {
+        const Handle(AIS_Shape) aShape = anIter->first;
+        if (!myContext->IsDisplayed(aShape))
+            continue;
+        myContext->Activate(aShape, aFaceMode);
+
+        const std::vector<Standard_Integer> &aWanted = anIter->second;
+        const Handle(SelectMgr_Selection) &  aSel    = aShape->Selection(aFaceMode);
+        if (aSel.IsNull())
+            continue;
+        for (NCollection_Vector<Handle(SelectMgr_SensitiveEntity)>::Iterator anEntIter(aSel->Entities());
+             anEntIter.More(); anEntIter.Next())
+        {
+            const Handle(StdSelect_BRepOwner) anOwner =
+                Handle(StdSelect_BRepOwner)::DownCast(anEntIter.Value()->BaseSensitive()->OwnerId());
+            if (anOwner.IsNull() || anOwner->IsSelected())
+                continue;
+
+            const Standard_Integer aRow = anIndex.Row(aShape, anOwner->Shape());
+            if (std::binary_search(aWanted.begin(), aWanted.end(), aRow))
+                myContext->AddOrRemoveSelected(anOwner, Standard_False);
+        }
+    }
+    myContext->UpdateCurrentViewer();
+    OnSelectionChanged();
+
+    LOG_INFO("ModelView", tr("相似面: %1/%2 faces, scan %3 ms, total %4 ms")
+                              .arg((int)aRows.size())
+                              .arg(anIndex.Size())
+                              .arg(aScanMs)
+                              .arg(aTimer.elapsed())
+                              .toStdString());
+}
+
+std::map<AIS_Shape *, std::vector<Standard_Integer>> ModelView::selectedFaces()
+{
+    std::map<AIS_Shape *, std::vector<Standard_Integer>> aByObject;
+    for (myContext->InitSelected(); myContext->MoreSelected(); myContext->NextSelected())
+    {
+        const Handle(StdSelect_BRepOwner) anOwner = Handle(StdSelect_BRepOwner)::DownCast(myContext->SelectedOwner());
+        if (anOwner.IsNull() || !anOwner->HasShape() || anOwner->Shape().ShapeType() != TopAbs_FACE)
+            continue;
+
+        const Handle(AIS_Shape) aShape = Handle(AIS_Shape)::DownCast(anOwner->Selectable());
+        if (aShape.IsNull())
+            continue;
+
+        const Standard_Integer aFace = getTopology(aShape)->FaceId(anOwner->Shape());
+        if (aFace >= 0)
+            aByObject[aShape.get()].push_back(aFace);
+    }
+    return aByObject;
+}
+
+void ModelView::selectFaces(const Handle(AIS_Shape) & theShape, const std::vector<Standard_Integer> &theFaces)
+{
+    const Standard_Integer aFaceMode = AIS_Shape::SelectionMode(TopAbs_FACE);
+    myContext->Activate(theShape, aFaceMode);
+
+    const Handle(SelectMgr_Selection) &aSel = theShape->Selection(aFaceMode);
+    if (aSel.IsNull())
+        return;
+
+    const Handle(TopologyGraph) &aGraph = getTopology(theShape);
+    for (NCollection_Vector<Handle(SelectMgr_SensitiveEntity)>::Iterator anEntIter(aSel->Entities()); anEntIter.More();
+         anEntIter.Next())
+    {
+        const Handle(StdSelect_BRepOwner) anOwner =
+            Handle(StdSelect_BRepOwner)::DownCast(anEntIter.Value()->BaseSensitive()->OwnerId());
+        if (anOwner.IsNull() || anOwner->IsSelected())
+            continue;
+
+        if (std::binary_search(theFaces.begin(), theFaces.end(), aGraph->FaceId(anOwner->Shape())))
+            myContext->AddOrRemoveSelected(anOwner, Standard_False);
+    }
+}
+
+void ModelView::onGrowSelection()
+{
+    QElapsedTimer aTimer;
+    aTimer.start();
+
+    const std::map<AIS_Shape *, std::vector<Standard_Integer>> aByObject = selectedFaces();
+    Standard_Integer aNbFaces = 0;
+    for (std::map<AIS_Shape *, std::vector<Standard_Integer>>::const_iterator anIter = aByObject.begin();
+         anIter != aByObject.end(); ++anIter)
+    {
+        const Handle(AIS_Shape)             aShape = anIter->first;
+        const std::vector<Standard_Integer> aFaces = getTopology(aShape)->Grow(anIter->second);
+        selectFaces(aShape, aFaces);
+        aNbFaces += (Standard_Integer)aFaces.size();
+    }
+    myContext->UpdateCurrentViewer();
+    OnSelectionChanged();
+
+    LOG_INFO("ModelView", tr("扩展选择: %1 faces, %2 ms").arg(aNbFaces).arg(aTimer.elapsed()).toStdString());
+}
+
+void ModelView::onSelectTangent()
+{
+    QElapsedTimer aTimer;
+    aTimer.start();
+
+    const std::map<AIS_Shape *, std::vector<Standard_Integer>> aByObject = selectedFaces();
+    Standard_Integer aNbFaces = 0;
+    for (std::map<AIS_Shape *, std::vector<Standard_Integer>>::const_iterator anIter = aByObject.begin();
+         anIter != aByObject.end(); ++anIter)
+    {
+        const Handle(AIS_Shape)      aShape = anIter->first;
+        const Handle(TopologyGraph) &aGraph = getTopology(aShape);
+
+        std::vector<Standard_Integer> aFaces;
+        for (size_t i = 0; i < anIter->second.size(); ++i)
+        {
+            const std::vector<Standard_Integer> aChain = aGraph->TangentChain(anIter->second[i]);
+            aFaces.insert(aFaces.end(), aChain.begin(), aChain.end());
+        }
+        std::sort(aFaces.begin(), aFaces.end());
+        aFaces.erase(std::unique(aFaces.begin(), aFaces.end()), aFaces.end());
+
+        selectFaces(aShape, aFaces);
+        aNbFaces += (Standard_Integer)aFaces.size();
+    }
+    myContext->UpdateCurrentViewer();
+    OnSelectionChanged();
+
+    LOG_INFO("ModelView", tr("相切面: %1 faces, %2 ms").arg(aNbFaces).arg(aTimer.elapsed()).toStdString());
+}
+
+void ModelView::onFaceColor()
+{
+    const std::map<AIS_Shape *, std::vector<Standard_Integer>> aByObject = selectedFaces();
+    if (aByObject.empty())
+        return;
+
+    const QColor aColor = QColorDialog::getColor(Qt::white, this, tr("Face Color"), QColorDialog::ShowAlphaChannel);
+    if (!aColor.isValid())
+        return;
+
+    QElapsedTimer aTimer;
+    aTimer.start();
+    const Quantity_Color aFaceColor(aColor.redF(), aColor.greenF(), aColor.blueF(), Quantity_TOC_RGB);
+    Standard_Integer     aNbFaces = 0, aNbRecomputed = 0;
+    for (std::map<AIS_Shape *, std::vector<Standard_Integer>>::const_iterator anIter = aByObject.begin();
+         anIter != aByObject.end(); ++anIter)
+    {
+        const Handle(AIS_ColoredShape) aShape = Handle(AIS_ColoredShape)::DownCast(anIter->first);
+        if (aShape.IsNull())
+        {
+            LOG_WARN("ModelView", "face colors need an AIS_ColoredShape, skipped one object");
+            continue;
+        }
+
+        const Handle(TopologyGraph) &aGraph = getTopology(aShape);
+        std::vector<TopoDS_Shape>    aFaces;
+        for (size_t i = 0; i < anIter->second.size(); ++i)
+            aFaces.push_back(aGraph->Face(anIter->second[i]));
+
+        if (FaceStyler::Apply(myContext, aShape, aFaces, aFaceColor, 1.0 - aColor.alphaF()))
+            ++aNbRecomputed;
+        aNbFaces += (Standard_Integer)aFaces.size();
+    }
+    myContext->UpdateCurrentViewer();
+
+    LOG_INFO("ModelView", tr("面颜色: %1 faces, %2 objects recomputed, %3 ms")
+                              .arg(aNbFaces)
+                              .arg(aNbRecomputed)
+                              .arg(aTimer.elapsed())
+                              .toStdString());
+}
+
+void ModelView::onResetFaceColor()
+{
+    const std::map<AIS_Shape *, std::vector<Standard_Integer>> aByObject = selectedFaces();
+    for (std::map<AIS_Shape *, std::vector<Standard_Integer>>::const_iterator anIter = aByObject.begin();
+         anIter != aByObject.end(); ++anIter)
+    {
+        const Handle(AIS_ColoredShape) aShape = Handle(AIS_ColoredShape)::DownCast(anIter->first);
+        if (aShape.IsNull())
+            continue;
+
+        const Handle(TopologyGraph) &aGraph = getTopology(aShape);
+        std::vector<TopoDS_Shape>    aFaces;
+        for (size_t i = 0; i < anIter->second.size(); ++i)
+            aFaces.push_back(aGraph->Face(anIter->second[i]));
+        FaceStyler::Reset(myContext, aShape, aFaces);
+    }
+    myContext->UpdateCurrentViewer();
+}
+
+void ModelView::onBoolean()
+{
+    QAction *aSentBy = (QAction *)sender();
+
+    // 选择的顺序决定对象与工具
+    BooleanService::Request aRequest;
+    aRequest.Op = (BooleanService::Operation)aSentBy->data().toInt();
+    for (myContext->InitSelected(); myContext->MoreSelected(); myContext->NextSelected())
+    {
+        const Handle(AIS_Shape) aShape = Handle(AIS_Shape)::DownCast(myContext->SelectedInteractive());
+        if (aShape.IsNull() || aShape == aRequest.Object || aRequest.Tools.contains(aShape))
+            continue;
+
+        if (aRequest.Object.IsNull())
+            aRequest.Object = aShape;
+        else
+            aRequest.Tools.append(aShape);
+    }
+
+    const int anId = getBooleans()->Submit(aRequest);
+    if (anId >= 0)
+        LOG_INFO("ModelView", "boolean job " << anId << " submitted with " << aRequest.Tools.size() << " tools");
+}
+
+void ModelView::onCancelBooleans()
+{
+    getBooleans()->CancelAll();
+}
+
+void ModelView::onSimplifyDisplay()
+{
+    bool                aOk   = false;
+    const Standard_Real aSize = QInputDialog::getDouble(this, tr("Simplify Display"), tr("特征尺寸(mm):"),
+                                                        getSimplifier().FeatureSize(), 0.01, 1.0e4, 2, &aOk);
+    if (!aOk)
+        return;
+
+    std::vector<Handle(AIS_Shape)> aShapes;
+    for (myContext->InitSelected(); myContext->MoreSelected(); myContext->NextSelected())
+    {
+        Handle(AIS_Shape) aShape = Handle(AIS_Shape)::DownCast(myContext->SelectedInteractive());
+        if (!aShape.IsNull())
+            aShapes.push_back(aShape);
+    }
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    getSimplifier().SetFeatureSize(aSize);
+    getSimplifier().Add(aShapes);
+    QApplication::restoreOverrideCursor();
+
+    // 被选择的对象显示精确形状，取消选择后才会以简化形状显示
+    myContext->ClearSelected(Standard_False);
+    myContext->UpdateCurrentViewer();
+
+    const DisplaySimplifier::Statistics &aStats = getSimplifier().Stats();
+    LOG_INFO("ModelView", tr("显示简化: %1 objects, %2 faces removed, %3 failed, triangles %4 -> %5, %6 ms")
+                              .arg(aStats.NbObjects)
+                              .arg(aStats.NbFacesRemoved)
+                              .arg(aStats.NbFailed)
+                              .arg(aStats.TrianglesExact)
+                              .arg(aStats.TrianglesSimplified)
+                              .arg(aStats.BuildMs, 0, 'f', 1)
+                              .toStdString());
+}
+
+void ModelView::onExactDisplay()
+{
+    for (myContext->InitSelected(); myContext->MoreSelected(); myContext->NextSelected())
+        getSimplifier().Remove(Handle(AIS_Shape)::DownCast(myContext->SelectedInteractive()));
+    myContext->UpdateCurrentViewer();
+}
+
+void ModelView::onShareDuplicates()
+{
+    std::vector<Handle(AIS_Shape)> anObjects;
+    for (myContext->InitSelected(); myContext->MoreSelected(); myContext->NextSelected())
+    {
+        Handle(AIS_Shape) aShape = Handle(AIS_Shape)::DownCast(myContext->SelectedInteractive());
+        if (!aShape.IsNull())
+            anObjects.push_back(aShape);
+    }
+    if (anObjects.empty())
+    {
+        AIS_ListOfInteractive aList;
+        myContext->DisplayedObjects(AIS_KOI_Shape, -1, aList);
+        for (AIS_ListOfInteractive::Iterator anIter(aList); anIter.More(); anIter.Next())
+            anObjects.push_back(Handle(AIS_Shape)::DownCast(anIter.Value()));
+    }
 
+    std::vector<TopoDS_Shape> aShapes;
+    for (size_t i = 0; i < anObjects.size(); ++i)
+        aShapes.push_back(anObjects[i]->Shape());
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    DuplicateFinder aFinder;
+    aFinder.Perform(aShapes);
+
+    // 整个对象就是一个重复实体且都没有局部变换时，以AIS_ConnectedInteractive引用代表对象，连显示结构也共享；
+    // 其余有重复实体的对象替换形状，共享TShape上的三角网格
+    std::vector<char> isChanged(anObjects.size(), 0);
+    for (Standard_Integer i = 0; i < aFinder.NbSolids(); ++i)
+    {
+        if (aFinder.Representative(i) != i)
+            isChanged[aFinder.ShapeOf(i)] = 1;
+    }
+
+    Standard_Integer aNbConnected = 0;
+    for (Standard_Integer i = 0; i < aFinder.NbSolids(); ++i)
+    {
+        const Standard_Integer aRep    = aFinder.Representative(i);
+        const Standard_Integer anIndex = aFinder.ShapeOf(i);
+        if (aRep == i || !isChanged[anIndex])
+            continue;
+
+        const Handle(AIS_Shape) &anObject = anObjects[anIndex];
+        const Handle(AIS_Shape) &aRepObject = anObjects[aFinder.ShapeOf(aRep)];
+        if (!aFinder.Solid(i).IsSame(aShapes[anIndex]) || !aFinder.Solid(aRep).IsSame(aShapes[aFinder.ShapeOf(aRep)])
+            || anObject->HasTransformation() || aRepObject->HasTransformation()
+            || isChanged[aFinder.ShapeOf(aRep)])
+            continue;
+
+        // 连接对象沿用代表对象的显示结构(包括颜色)，材质不同时只共享三角网格
+        const QString aMaterial = getMaterials().Assigned(anObject);
+        if (aMaterial != getMaterials().Assigned(aRepObject))
+            continue;
+
+        Handle(AIS_ConnectedInteractive) aConnected = new AIS_ConnectedInteractive();
+        aConnected->Connect(aRepObject, aFinder.Placement(i));
+        const Standard_Integer aMode = anObject->DisplayMode();
+
+        // 重复对象不再显示，但换成共享的实体后重新登记到索引中，近邻、干涉和面过滤照常覆盖它；
+        // 连接对象通过Owner找回它，删除时一并注销
+        removeShape(anObject, false);
+        anObject->SetShape(aFinder.Share(anIndex));
+        if (!aMaterial.isEmpty())
+            getMaterials().Assign(anObject, aMaterial);
+        getShapeIndex().Add(anObject);
+        getFaceIndex().Add(anObject, getMaterials().Names().indexOf(aMaterial));
+        aConnected->SetOwner(anObject);
+        myContext->Display(aConnected, aMode, 0, Standard_False);
+        isChanged[anIndex] = 0;
+        ++aNbConnected;
+    }
+
+    for (size_t i = 0; i < anObjects.size(); ++i)
+    {
+        if (!isChanged[i])
+            continue;
+
+        const Handle(AIS_Shape) &anObject   = anObjects[i];
+        const QString            aMaterial = getMaterials().Assigned(anObject);
+        removeShape(anObject, false);
+        anObject->SetShape(aFinder.Share((Standard_Integer)i));
+        displayShape(anObject, false);
+        if (!aMaterial.isEmpty())
+            assignMaterial(anObject, aMaterial);
+    }
+    QApplication::restoreOverrideCursor();
+    myContext->UpdateCurrentViewer();
+
+    const DuplicateFinder::Statistics &aStats = aFinder.Stats();
+    LOG_INFO("ModelView", tr("重复实体: %1 solids, %2 groups, %3 duplicates (%4 connected), %5 rejected, "
+                             "%6 MB mesh shared, fingerprint %7 ms, verify %8 ms")
+                              .arg(aStats.NbSolids)
+                              .arg(aStats.NbGroups)
+                              .arg(aStats.NbDuplicates)
+                              .arg(aNbConnected)
+                              .arg(aStats.NbRejected)
+                              .arg(aStats.SavedBytes / (1024.0 * 1024.0), 0, 'f', 2)
+                              .arg(aStats.FingerprintMs, 0, 'f', 1)
+                              .arg(aStats.VerifyMs, 0, 'f', 1)
+                              .toStdString());
+}
+
+void ModelView::onFaceFilter()
+{
+    QAction *              aSentBy = (QAction *)sender();
+    const Standard_Integer aType   = aSentBy->data().toInt();
+
+    if (!myFaceFilter.IsNull())
+    {
+        myContext->RemoveFilter(myFaceFilter);
+        myFaceFilter.Nullify();
+    }
+    if (aType < 0)
+        return;
+
+    FaceIndex::Query aQuery;
+    aQuery.SurfaceType = aType;
+    getFaceIndex().Update();
+    myFaceFilter = new FaceIndexFilter(&getFaceIndex(), aQuery);
+    myContext->AddFilter(myFaceFilter);
+}
+
+void ModelView::onSelectionModeChange()
+{
+    QAction *aSentBy = (QAction *)sender();
+    const TopAbs_ShapeEnum aType = mySelectionModeActions.key(aSentBy, TopAbs_SHAPE);
+
+    AIS_ListOfInteractive aList;
+    myContext->DisplayedObjects(AIS_KOI_Shape, -1, aList);
+    for (AIS_ListOfInteractive::Iterator anIter(aList); anIter.More(); anIter.Next())
+    {
+        myContext->Deactivate(anIter.Value());
+        myContext->Activate(anIter.Value(), AIS_Shape::SelectionMode(aType));
+    }
+}
 
 void ModelView::onToolAction()
 {
@@ -517,6 +1407,7 @@ void ModelView::updateToggled(bool isOn)
             }
             else
             {
+                initCursors();
                 if (sentBy == getViewAction(ViewFitAreaId))
                     setCursor(*handCursor);
                 else if (sentBy == getViewAction(ViewZoomId))
@@ -589,14 +1480,14 @@ void ModelView::initViewActions()
 
     QAction *a;
 
-    a = new QAction(QPixmap(QString::fromUtf8(":/common/res/common/view_fitall.png")),
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/view_fitall.png")),
                     QObject::tr("FitAll"), this);
     a->setToolTip(QObject::tr("FitAll"));
     a->setStatusTip(QObject::tr("FitAll"));
     connect(a, SIGNAL(triggered()), this, SLOT(fitAll()));
     myViewActions[ViewFitAllId] = a;
 
-    a = new QAction(QPixmap(QString::fromUtf8(":/common/res/common/view_fitarea.png")),
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/view_fitarea.png")),
                     QObject::tr("FitArea"), this);
     a->setToolTip(QObject::tr("FitArea"));
     a->setStatusTip(QObject::tr("FitArea"));
@@ -605,7 +1496,7 @@ void ModelView::initViewActions()
     connect(a, SIGNAL(toggled(bool)), this, SLOT(updateToggled(bool)));
     myViewActions[ViewFitAreaId] = a;
 
-    a = new QAction(QPixmap(QString::fromUtf8(":/common/res/common/view_zoom.png")),
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/view_zoom.png")),
                     QObject::tr("Dynamic Zooming"), this);
     a->setToolTip(QObject::tr("Dynamic Zooming"));
     a->setStatusTip(QObject::tr("Dynamic Zooming"));
@@ -614,7 +1505,7 @@ void ModelView::initViewActions()
     connect(a, SIGNAL(toggled(bool)), this, SLOT(updateToggled(bool)));
     myViewActions[ViewZoomId] = a;
 
-    a = new QAction(QPixmap(QString::fromUtf8(":/common/res/common/view_pan.png")),
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/view_pan.png")),
                     QObject::tr("Dynamic Panning"), this);
     a->setToolTip(QObject::tr("Dynamic Panning"));
     a->setStatusTip(QObject::tr("Dynamic Panning"));
@@ -623,7 +1514,7 @@ void ModelView::initViewActions()
     connect(a, SIGNAL(toggled(bool)), this, SLOT(updateToggled(bool)));
     myViewActions[ViewPanId] = a;
 
-    a = new QAction(QPixmap(QString::fromUtf8(":/common/res/common/view_glpan.png")),
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/view_glpan.png")),
                     QObject::tr("Global Panning"), this);
     a->setToolTip(QObject::tr("Global Panning"));
     a->setStatusTip(QObject::tr("Global Panning"));
@@ -632,56 +1523,56 @@ void ModelView::initViewActions()
     connect(a, SIGNAL(toggled(bool)), this, SLOT(updateToggled(bool)));
     myViewActions[ViewGlobalPanId] = a;
 
-    a = new QAction(QPixmap(QString::fromUtf8(":/common/res/common/view_front.png")),
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/view_front.png")),
                     QObject::tr("Front"), this);
     a->setToolTip(QObject::tr("Front"));
     a->setStatusTip(QObject::tr("Front"));
     connect(a, SIGNAL(triggered()), this, SLOT(front()));
     myViewActions[ViewFrontId] = a;
 
-    a = new QAction(QPixmap(QString::fromUtf8(":/common/res/common/view_back.png")),
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/view_back.png")),
                     QObject::tr("Back"), this);
     a->setToolTip(QObject::tr("Back"));
     a->setStatusTip(QObject::tr("Back"));
     connect(a, SIGNAL(triggered()), this, SLOT(back()));
     myViewActions[ViewBackId] = a;
 
-    a = new QAction(QPixmap(QString::fromUtf8(":/common/res/common/view_top.png")),
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/view_top.png")),
                     QObject::tr("Top"), this);
     a->setToolTip(QObject::tr("Top"));
     a->setStatusTip(QObject::tr("Top"));
     connect(a, SIGNAL(triggered()), this, SLOT(top()));
     myViewActions[ViewTopId] = a;
 
-    a = new QAction(QPixmap(QString::fromUtf8(":/common/res/common/view_bottom.png")),
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/view_bottom.png")),
                     QObject::tr("Bottom"), this);
     a->setToolTip(QObject::tr("Bottom"));
     a->setStatusTip(QObject::tr("Bottom"));
     connect(a, SIGNAL(triggered()), this, SLOT(bottom()));
     myViewActions[ViewBottomId] = a;
 
-    a = new QAction(QPixmap(QString::fromUtf8(":/common/res/common/view_left.png")),
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/view_left.png")),
                     QObject::tr("Left"), this);
     a->setToolTip(QObject::tr("Left"));
     a->setStatusTip(QObject::tr("Left"));
     connect(a, SIGNAL(triggered()), this, SLOT(left()));
     myViewActions[ViewLeftId] = a;
 
-    a = new QAction(QPixmap(QString::fromUtf8(":/common/res/common/view_right.png")),
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/view_right.png")),
                     QObject::tr("Right"), this);
     a->setToolTip(QObject::tr("Right"));
     a->setStatusTip(QObject::tr("Right"));
     connect(a, SIGNAL(triggered()), this, SLOT(right()));
     myViewActions[ViewRightId] = a;
 
-    a = new QAction(QPixmap(QString::fromUtf8(":/common/res/common/view_axo.png")),
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/view_axo.png")),
                     QObject::tr("Axo"), this);
     a->setToolTip(QObject::tr("Axo"));
     a->setStatusTip(QObject::tr("Axo"));
     connect(a, SIGNAL(triggered()), this, SLOT(axo()));
     myViewActions[ViewAxoId] = a;
 
-    a = new QAction(QPixmap(QString::fromUtf8(":/common/res/common/view_rotate.png")),
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/view_rotate.png")),
                     QObject::tr("Dynamic Rotation"), this);
     a->setToolTip(QObject::tr("Dynamic Rotation"));
     a->setStatusTip(QObject::tr("Dynamic Rotation"));
@@ -690,7 +1581,7 @@ void ModelView::initViewActions()
     connect(a, SIGNAL(toggled(bool)), this, SLOT(updateToggled(bool)));
     myViewActions[ViewRotationId] = a;
 
-    a = new QAction(QPixmap(QString::fromUtf8(":/common/res/common/view_reset.png")),
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/view_reset.png")),
                     QObject::tr("Reset"), this);
     a->setToolTip(QObject::tr("Reset"));
     a->setStatusTip(QObject::tr("Reset"));
@@ -699,7 +1590,7 @@ void ModelView::initViewActions()
 
     QActionGroup *ag = new QActionGroup(this);
 
-    a = new QAction(QPixmap(QString::fromUtf8(":/common/res/common/view_comp_off.png")),
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/view_comp_off.png")),
                     QObject::tr("Hidden Off"), this);
     a->setToolTip(QObject::tr("Hidden Off"));
     a->setStatusTip(QObject::tr("Hidden Off"));
@@ -708,7 +1599,7 @@ void ModelView::initViewActions()
     ag->addAction(a);
     myViewActions[ViewHlrOffId] = a;
 
-    a = new QAction(QPixmap(QString::fromUtf8(":/common/res/common/view_comp_on.png")),
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/view_comp_on.png")),
                     QObject::tr("Hidden On"), this);
     a->setToolTip(QObject::tr("Hidden On"));
     a->setStatusTip(QObject::tr("Hidden On"));
@@ -724,7 +1615,7 @@ void ModelView::initRaytraceActions()
         return;
 
     QAction *a;
-    a = new QAction(QPixmap(QString::fromUtf8(":/common/res/common/raytracing.png")),
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/raytracing.png")),
                     QObject::tr("Enable Ray-tracing"), this);
     a->setToolTip(QObject::tr("Enable Ray-tracing"));
     a->setStatusTip(QObject::tr("Enable Ray-tracing"));
@@ -733,7 +1624,7 @@ void ModelView::initRaytraceActions()
     connect(a, SIGNAL(triggered()), this, SLOT(onRaytraceAction()));
     myRaytraceActions[ToolRaytracingId] = a;
 
-    a = new QAction(QPixmap(QString::fromUtf8(":/common/res/common/shadows.png")),
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/shadows.png")),
                     QObject::tr("Enable Shadows"), this);
     a->setToolTip(QObject::tr("Enable Shadows"));
     a->setStatusTip(QObject::tr("Enable Shadows"));
@@ -742,7 +1633,7 @@ void ModelView::initRaytraceActions()
     connect(a, SIGNAL(triggered()), this, SLOT(onRaytraceAction()));
     myRaytraceActions[ToolShadowsId] = a;
 
-    a = new QAction(QPixmap(QString::fromUtf8(":/common/res/common/reflections.png")),
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/reflections.png")),
                     QObject::tr("Enable Reflections"), this);
     a->setToolTip(QObject::tr("Enable Reflections"));
     a->setStatusTip(QObject::tr("Enable Reflections"));
@@ -751,7 +1642,7 @@ void ModelView::initRaytraceActions()
     connect(a, SIGNAL(triggered()), this, SLOT(onRaytraceAction()));
     myRaytraceActions[ToolReflectionsId] = a;
 
-    a = new QAction(QPixmap(QString::fromUtf8(":/common/res/common/antialiasing.png")),
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/antialiasing.png")),
                     QObject::tr("Enable Anti-aliasing"), this);
     a->setToolTip(QObject::tr("Enable Anti-aliasing"));
     a->setStatusTip(QObject::tr("Enable Anti-aliasing"));
@@ -769,31 +1660,31 @@ void ModelView::initDisplaymodeActions()
     QString  icon_prefix(":/common/res/common/");
     QAction *a;
 
-    a = new QAction(QPixmap(icon_prefix + "tool_wireframe.png"), QObject::tr("Wireframe"), this);
+    a = new QAction(QIcon(icon_prefix + "tool_wireframe.png"), QObject::tr("Wireframe"), this);
     a->setToolTip(QObject::tr("Wireframe"));
     a->setStatusTip(QObject::tr("Wireframe"));
     connect(a, SIGNAL(triggered()), this, SLOT(onToolAction()));
     myDisplaymodesActions[ToolWireframeId] = a;
 
-    a = new QAction(QPixmap(icon_prefix + "tool_shading.png"), QObject::tr("Shadows"), this);
+    a = new QAction(QIcon(icon_prefix + "tool_shading.png"), QObject::tr("Shadows"), this);
     a->setToolTip(QObject::tr("Shadows"));
     a->setStatusTip(QObject::tr("Shadows"));
     connect(a, SIGNAL(triggered()), this, SLOT(onToolAction()));
     myDisplaymodesActions[ToolShadingId] = a;
 
-    //    a = new QAction(QPixmap(icon_prefix + "tool_material.png"), QObject::tr("MNU_TOOL_MATER"), this);
+    //    a = new QAction(QIcon(icon_prefix + "tool_material.png"), QObject::tr("MNU_TOOL_MATER"), this);
     //    a->setToolTip(QObject::tr("TBR_TOOL_MATER"));
     //    a->setStatusTip(QObject::tr("TBR_TOOL_MATER"));
     //    connect(a, SIGNAL(triggered()), this, SLOT(onToolAction()));
     //    myDisplaymodesActions[ToolMaterialId] = a;
 
-    //    a = new QAction(QPixmap(icon_prefix + "tool_transparency.png"), QObject::tr("MNU_TOOL_TRANS"), this);
+    //    a = new QAction(QIcon(icon_prefix + "tool_transparency.png"), QObject::tr("MNU_TOOL_TRANS"), this);
     //    a->setToolTip(QObject::tr("TBR_TOOL_TRANS"));
     //    a->setStatusTip(QObject::tr("TBR_TOOL_TRANS"));
     //    connect(a, SIGNAL(triggered()), this, SLOT(onToolAction()));
     //    myDisplaymodesActions[ToolTransparencyId] = a;
 
-    a = new QAction(QPixmap(icon_prefix + "tool_delete.png"), QObject::tr("Delete"), this);
+    a = new QAction(QIcon(icon_prefix + "tool_delete.png"), QObject::tr("Delete"), this);
     a->setToolTip(QObject::tr("Delete"));
     a->setStatusTip(QObject::tr("Delete"));
     a->setShortcut(QKeySequence::Delete);
@@ -823,6 +1714,8 @@ void ModelView::initSelectionModeActions()
 
 void ModelView::activateCursor(const CurrentAction3d mode)
 {
+    // 光标在首次使用时创建，可能在工具栏切换之前直接进入平移、缩放等操作
+    initCursors();
     switch (mode)
     {
         case CurAction3d_DynamicPanning:
@@ -882,7 +1775,8 @@ void ModelView::mouseReleaseEvent(QMouseEvent *theEvent)
     {
         setCurrentAction(CurAction3d_Nothing);
     }
-    if (theEvent->button() == Qt::RightButton && (aFlags & Aspect_VKeyFlags_CTRL) == 0 && (myClickPos - aPnt).cwiseAbs().maxComp() <= 4)
+    if (myIsPopupEnabled && theEvent->button() == Qt::RightButton && (aFlags & Aspect_VKeyFlags_CTRL) == 0
+        && (myClickPos - aPnt).cwiseAbs().maxComp() <= 4)
     {
         Popup(aPnt.x(), aPnt.y());
     }
@@ -970,6 +1864,72 @@ void ModelView::Popup(const int /*x*/, const int /*y*/)
         myToolMenu->addAction(getDisplaymodeAction(ModelView::ToolTransparencyId));
         myToolMenu->addAction(getDisplaymodeAction(ModelView::ToolDeleteId));
 
+        QAction *aNearby = myToolMenu->addAction(QObject::tr("Select Nearby..."));
+        connect(aNearby, SIGNAL(triggered()), this, SLOT(onSelectNearby()));
+
+        myContext->InitSelected();
+        const Handle(StdSelect_BRepOwner) anOwner = Handle(StdSelect_BRepOwner)::DownCast(myContext->SelectedOwner());
+        if (!anOwner.IsNull() && anOwner->HasShape() && anOwner->Shape().ShapeType() == TopAbs_FACE)
+        {
+            QAction *aSimilar = myToolMenu->addAction(QObject::tr("Select Similar Faces"));
+            connect(aSimilar, SIGNAL(triggered()), this, SLOT(onSelectSimilar()));
+
+            QAction *aGrow = myToolMenu->addAction(QObject::tr("Grow Selection"));
+            connect(aGrow, SIGNAL(triggered()), this, SLOT(onGrowSelection()));
+
+            QAction *aTangent = myToolMenu->addAction(QObject::tr("Select Tangent Faces"));
+            connect(aTangent, SIGNAL(triggered()), this, SLOT(onSelectTangent()));
+
+            QAction *aFaceColor = myToolMenu->addAction(QObject::tr("Face Color..."));
+            connect(aFaceColor, SIGNAL(triggered()), this, SLOT(onFaceColor()));
+
+            QAction *aResetColor = myToolMenu->addAction(QObject::tr("Reset Face Color"));
+            connect(aResetColor, SIGNAL(triggered()), this, SLOT(onResetFaceColor()));
+        }
+
+        if (myContext->NbSelected() > 1)
+        {
+            QMenu *     aBoolMenu = myToolMenu->addMenu(QObject::tr("Boolean"));
+            const char *aNames[]  = { "Fuse", "Cut", "Common" };
+            const int   anOps[]   = { BooleanService::Operation_Fuse, BooleanService::Operation_Cut,
+                                      BooleanService::Operation_Common };
+            for (int i = 0; i < 3; ++i)
+            {
+                QAction *anOp = aBoolMenu->addAction(QObject::tr(aNames[i]));
+                anOp->setData(anOps[i]);
+                connect(anOp, SIGNAL(triggered()), this, SLOT(onBoolean()));
+            }
+        }
+        if (getBooleans()->NbPending() > 0)
+        {
+            QAction *aCancel = myToolMenu->addAction(QObject::tr("Cancel Booleans"));
+            connect(aCancel, SIGNAL(triggered()), this, SLOT(onCancelBooleans()));
+        }
+
+        QAction *aSimplify = myToolMenu->addAction(QObject::tr("Simplify Display..."));
+        connect(aSimplify, SIGNAL(triggered()), this, SLOT(onSimplifyDisplay()));
+
+        QAction *anExact = myToolMenu->addAction(QObject::tr("Exact Display"));
+        connect(anExact, SIGNAL(triggered()), this, SLOT(onExactDisplay()));
+
+        QAction *aShare = myToolMenu->addAction(QObject::tr("Share Duplicates"));
+        connect(aShare, SIGNAL(triggered()), this, SLOT(onShareDuplicates()));
+
+        QAction *aSample = myToolMenu->addAction(QObject::tr("Sample Point Cloud"));
+        connect(aSample, SIGNAL(triggered()), this, SLOT(onSamplePointCloud()));
+
+        QAction *anEnergy = myToolMenu->addAction(QObject::tr("Absorbed Energy"));
+        connect(anEnergy, SIGNAL(triggered()), this, SLOT(onAbsorbedEnergy()));
+
+        // 材质分配子菜单，材质列表来自res/Material.json
+        QMenu *aMatMenu = myToolMenu->addMenu(QObject::tr("Material"));
+        foreach (const QString &aName, getMaterials().Names())
+        {
+            QAction *aMat = aMatMenu->addAction(aName);
+            aMat->setData(aName);
+            connect(aMat, SIGNAL(triggered()), this, SLOT(onAssignMaterial()));
+        }
+
 
         // 添加目标物体的选择模式
         //        myToolMenu->addSeparator();    //添加一个分割线
@@ -999,6 +1959,43 @@ void ModelView::Popup(const int /*x*/, const int /*y*/)
             a->setChecked(false);
             myBackMenu->addAction(a);
             addItemInPopup(myBackMenu);
+
+            a = new QAction(QObject::tr("Clash Check"), this);
+            a->setToolTip(QObject::tr("Clash Check"));
+            connect(a, SIGNAL(triggered()), this, SLOT(onClashCheck()));
+            myBackMenu->addAction(a);
+
+            a = new QAction(QObject::tr("Clear Point Cloud"), this);
+            a->setToolTip(QObject::tr("Clear Point Cloud"));
+            connect(a, SIGNAL(triggered()), this, SLOT(onClearPointCloud()));
+            myBackMenu->addAction(a);
+
+            // 标量场不参与选择，只能在这里统一移除并恢复源对象的显示
+            a = new QAction(QObject::tr("Clear Scalar Fields"), this);
+            a->setToolTip(QObject::tr("Clear Scalar Fields"));
+            connect(a, SIGNAL(triggered()), this, SLOT(onClearScalarFields()));
+            myBackMenu->addAction(a);
+
+            myBackMenu->addSeparator();
+            myBackMenu->addAction(getSelectionModeAction(TopAbs_FACE));
+            myBackMenu->addAction(getSelectionModeAction(TopAbs_SHAPE));
+
+            // 面选择过滤，属性来自FaceIndex
+            QMenu *       aFilterMenu = myBackMenu->addMenu(QObject::tr("Face Filter"));
+            QActionGroup *aGroup      = new QActionGroup(aFilterMenu);
+            const char *  aNames[]    = { QT_TR_NOOP("Any"), QT_TR_NOOP("Plane"), QT_TR_NOOP("Cylinder"), QT_TR_NOOP("Cone"),
+                                       QT_TR_NOOP("Sphere"), QT_TR_NOOP("Torus"), QT_TR_NOOP("BSpline") };
+            const int     aTypes[]    = { -1, GeomAbs_Plane, GeomAbs_Cylinder, GeomAbs_Cone,
+                                   GeomAbs_Sphere, GeomAbs_Torus, GeomAbs_BSplineSurface };
+            for (int i = 0; i < 7; ++i)
+            {
+                a = aFilterMenu->addAction(QObject::tr(aNames[i]));
+                a->setData(aTypes[i]);
+                a->setCheckable(true);
+                a->setChecked(i == 0);
+                aGroup->addAction(a);
+                connect(a, SIGNAL(triggered()), this, SLOT(onFaceFilter()));
+            }
         }
 
         myBackMenu->exec(QCursor::pos());
@@ -1012,6 +2009,7 @@ void ModelView::addItemInPopup(QMenu *menu)
 
 void ModelView::noActiveActions()
 {
+    initCursors();
     foreach (QAction *anAction, myViewActions)
     {
         if ((anAction == getViewAction(ViewFitAreaId)) ||
@@ -1074,6 +2072,25 @@ bool ModelView::dump(Standard_CString theFile)
     return myV3dView->Dump(theFile);
 }
 
+int ModelView::dumpAsync(const QString &theFile)
+{
+    return getDumper()->Dump(myV3dView, theFile);
+}
+
+bool ModelView::dumpTiled(const QString &theFile, int theWidth, int theHeight)
+{
+    // 光线追踪每个像素需要多张浮点纹理，分块取小一些以限制显存占用
+    const int aTileSize = myIsRaytracing ? 2048 : 0;
+
+    ImageDumper::TiledReport aReport;
+    const bool               isOk = ImageDumper::DumpTiled(myV3dView, theFile, theWidth, theHeight, aTileSize,
+                                                           64 * 1024 * 1024, &aReport);
+    dbgFunTrace("分块导出 " << theWidth << "x" << theHeight << ": " << aReport.NbTiles << " tiles, render "
+                           << aReport.RenderMs << " ms, encode " << aReport.EncodeMs << " ms, peak "
+                           << aReport.PeakBytes / 1048576 << " MB");
+    return isOk;
+}
+
 Handle(V3d_View) & ModelView::getView()
 {
     return myV3dView;
@@ -4,12 +4,27 @@
 #include <QAction>
 #include <QWidget>
 
+#include <map>
+#include <vector>
+
 #include <AIS_InteractiveContext.hxx>
 #include <AIS_ViewController.hxx>
+#include <AIS_ViewCube.hxx>
 #include <Standard_WarningsDisable.hxx>
 #include <Standard_WarningsRestore.hxx>
 #include <V3d_View.hxx>
 
+#include "BooleanService.h"
+#include "DisplaySimplifier.h"
+#include "FaceIndex.h"
+#include "ImageDumper.h"
+#include "MaterialLibrary.h"
+#include "MeshStore.h"
+#include "PointCloudLayer.h"
+#include "ScalarField.h"
+#include "ShapeIndex.h"
+#include "TopologyGraph.h"
+
 
 class ModelView : public QWidget, protected AIS_ViewController
 {
@@ -69,13 +84,17 @@ public:
     /// \param theContext， 即AIS_InteractiveContext上下文
     /// \param with_viewcube，是否在viewer中显示ViewCube，也就是视角指示6面体
     /// \param parent，设置ModelView的父对象，用于方便操作父类使用
+    /// \param theMaster，同一上下文上的主视图，非空时共享其空间索引、材质库和图像导出等(见ViewLayout)
     /// \return Description for return value
-    ModelView(const Handle(AIS_InteractiveContext) & theContext, bool with_viewcube, QWidget *parent);
+    ModelView(const Handle(AIS_InteractiveContext) & theContext, bool with_viewcube, QWidget *parent,
+              ModelView *theMaster = NULL);
     ~ModelView();
 
     virtual void init();
 
     bool             dump(Standard_CString theFile);
+    int              dumpAsync(const QString &theFile);    /// \brief 异步导出图像，编码在后台线程中进行
+    bool             dumpTiled(const QString &theFile, int theWidth, int theHeight);    /// \brief 分块导出超过窗口尺寸的图像
     QList<QAction *> getViewActions();
     QList<QAction *> getRaytraceActions();
     QList<QAction *> getDisplaymodeActions();
@@ -98,6 +117,73 @@ public:
     bool IsReflectionsEnabled() const { return myIsReflectionsEnabled; }
     bool IsAntialiasingEnabled() const { return myIsAntialiasingEnabled; }
 
+    /// \brief 显示一个AIS_Shape，并同步加入空间索引
+    void displayShape(const Handle(AIS_Shape) & theShape, bool theToUpdate = true);
+
+    /// \brief 从上下文中移除displayShape显示的对象，同时移除索引、材质分配和标量场
+    void removeShape(const Handle(AIS_Shape) & theShape, bool theToUpdate = true);
+
+    /// \brief 给对象分配材质并按材质设置颜色和透明度，不更新视图
+    void assignMaterial(const Handle(AIS_InteractiveObject) & theObject, const QString &theName);
+
+    /// \brief 已显示对象的空间索引，用于近邻查询和干涉检查
+    inline ShapeIndex &getShapeIndex() { return myMaster != NULL ? myMaster->getShapeIndex() : myShapeIndex; }
+
+    /// \brief 已显示对象的面属性表，用于面选择过滤和相似面查询
+    inline FaceIndex &getFaceIndex() { return myMaster != NULL ? myMaster->getFaceIndex() : myFaceIndex; }
+
+    /// \brief 材质库及对象的材质分配
+    inline MaterialLibrary &getMaterials() { return myMaster != NULL ? myMaster->getMaterials() : myMaterials; }
+
+    /// \brief 三角网格外存存储，未启用时为NULL
+    inline MeshStore *getMeshStore() { return myMaster != NULL ? myMaster->getMeshStore() : myMeshStore; }
+
+    typedef NCollection_DataMap<Handle(AIS_Shape), Handle(ScalarField), TColStd_MapTransientHasher> ScalarFieldMap;
+
+    /// \brief 对象上显示的标量场(仿真结果)，显示标量场时对象本身被隐藏
+    inline ScalarFieldMap &getScalarFields() { return myMaster != NULL ? myMaster->getScalarFields() : myScalarFields; }
+
+    typedef NCollection_DataMap<Handle(AIS_Shape), Handle(TopologyGraph), TColStd_MapTransientHasher> TopologyMap;
+
+    /// \brief 对象形状的拓扑邻接图，第一次使用时构建，之后直到对象被移除都使用缓存
+    const Handle(TopologyGraph) & getTopology(const Handle(AIS_Shape) & theShape);
+
+    /// \brief 点云显示图层
+    inline PointCloudLayer *getPointCloud() { return myMaster != NULL ? myMaster->getPointCloud() : myPointCloud; }
+
+    /// \brief 启用三角网格外存存储，当前显示的对象全部加入存储
+    ///
+    /// \param theFile，存储文件
+    /// \param theBudget，常驻内存预算(字节)
+    bool enableMeshStore(const QString &theFile, qint64 theBudget);
+
+    /// \brief 停用外存存储，换入全部对象
+    void disableMeshStore();
+
+    /// \brief 共享数据的主视图，自身是主视图时为NULL
+    ///
+    /// 同一AIS_InteractiveContext上的多个视图(见ViewLayout)显示的是同一组对象，
+    /// 这些与对象相关的数据(包括材质库和图像导出的缓冲区)只在主视图中维护一份。
+    ModelView *getMaster() const { return myMaster; }
+
+    /// \brief 右键菜单开关，回放录制的输入时关闭(见InputReplayer)
+    void setPopupEnabled(bool isOn) { myIsPopupEnabled = isOn; }
+
+    /// \brief 异步图像导出，完成后发出imageDumped信号
+    inline ImageDumper *getDumper() { return myMaster != NULL ? myMaster->getDumper() : myDumper; }
+
+    /// \brief 后台布尔运算，结果替换输入对象
+    inline BooleanService *getBooleans() { return myMaster != NULL ? myMaster->getBooleans() : myBooleans; }
+
+    /// \brief 只用于显示的去特征简化，远景时代替精确形状显示
+    inline DisplaySimplifier &getSimplifier() { return myMaster != NULL ? myMaster->getSimplifier() : mySimplifier; }
+
+    /// \brief 将指定对象设为当前选择集，用于高亮查询结果
+    void highlightShapes(const std::vector<Handle(AIS_Shape)> &theShapes);
+
+    /// \brief 上下文中显示的全部AIS_Shape
+    std::vector<Handle(AIS_Shape)> displayedShapes() const;
+
     static QString GetMessages(int type, TopAbs_ShapeEnum aSubShapeType,
                                TopAbs_ShapeEnum aShapeType);
     static QString GetShapeType(TopAbs_ShapeEnum aShapeType);
@@ -149,12 +235,31 @@ public slots:
     //        void onMaterial(int);
     //        void onTransparency();    //配置透明度信息
     void onDelete();
+    void onClashCheck();     // 干涉检查，结果高亮显示
+    void onSelectNearby();   // 选择与当前对象距离在指定范围内的对象
+    void onAssignMaterial(); // 给被选择对象分配Material.json中的材质
+    void onSelectSimilar();  // 选择与当前选择面相似(曲面类型、面积、法向、材质)的全部面
+    void onFaceFilter();     // 按曲面类型过滤面选择
+    void onSamplePointCloud(); // 按SAMPLE_RESOLUTIONS采样被选择对象的表面，加入点云图层
+    void onClearPointCloud();
+    void onAbsorbedEnergy(); // 以被选择对象各面吸收能量的标量场代替其显示
+    void onClearScalarFields(); // 移除全部标量场，恢复源对象的显示
+    void onGrowSelection();  // 选择集中的面加上与其共边的相邻面
+    void onSelectTangent();  // 选择与当前选择面相切连续的全部面
+    void onFaceColor();      // 给被选择的面设置颜色(同一对象内按面区分样式，不拆分对象)
+    void onResetFaceColor(); // 取消被选择面的颜色
+    void onBoolean();        // 以第一个被选择的对象为对象、其余为工具做布尔运算(后台执行)
+    void onCancelBooleans();
+    void onSimplifyDisplay(); // 计算被选择对象的去特征简化形状，远景时代替显示
+    void onExactDisplay();    // 被选择对象取消简化显示
+    void onShareDuplicates(); // 被选择(或全部)对象中几何相同的实体共享同一份形状和三角网格
 
     void onToolAction();
 
 private slots:
     // todo 修改为onTransparencyChanged
     void onTransparency(int);
+    void onSelectionModeChange();
 
 
 protected:
@@ -164,6 +269,8 @@ protected:
     virtual void mouseReleaseEvent(QMouseEvent *) override;
     virtual void mouseMoveEvent(QMouseEvent *) override;
     virtual void wheelEvent(QWheelEvent *) override;
+    virtual void showEvent(QShowEvent *) override;
+    virtual void hideEvent(QHideEvent *) override;
     virtual void addItemInPopup(QMenu *);
 
     Handle(V3d_View) & getView();
@@ -191,21 +298,30 @@ protected:
     inline void OnSelectionChanged() { OnSelectionChanged(myContext, myV3dView); }
 
 private:
+    /// \brief 光标在第一次切换视图操作时才创建
     void initCursors();
     void initViewActions();
     void initRaytraceActions();
     void initDisplaymodeActions();
     void initSelectionModeActions();
 
+    /// \brief 被选择的面按对象分组，返回各对象中的面编号(见TopologyGraph)
+    std::map<AIS_Shape *, std::vector<Standard_Integer>> selectedFaces();
+
+    /// \brief 把对象中编号为theFaces(已排序)的面加入选择集，不更新视图
+    void selectFaces(const Handle(AIS_Shape) & theShape, const std::vector<Standard_Integer> &theFaces);
+
 private:
     bool myIsRaytracing;
     bool myIsShadowsEnabled;
     bool myIsReflectionsEnabled;
     bool myIsAntialiasingEnabled;
+    bool myIsPopupEnabled;
 
     // 当前页面所维护的V3dView
     Handle(V3d_View) myV3dView;
     Handle(AIS_InteractiveContext) myContext;
+    Handle(AIS_ViewCube) myViewCube;    ///< 第一帧之后显示，显示后置空
     //        NCollection_Vector<Handle(AIS_InteractiveObject)> myObjects;    ///< brief 用于构建View渲染图层的队列
     AIS_MouseGestureMap                myDefaultGestures;
     Graphic3d_Vec2i                    myClickPos;
@@ -215,6 +331,18 @@ private:
     QMap<RaytraceAction, QAction *>    myRaytraceActions;
     QMap<DisplaymodeAction, QAction *> myDisplaymodesActions;
     QMap<TopAbs_ShapeEnum, QAction *>  mySelectionModeActions;
+    ShapeIndex                         myShapeIndex;
+    FaceIndex                          myFaceIndex;
+    Handle(FaceIndexFilter)            myFaceFilter;
+    MaterialLibrary                    myMaterials;
+    ImageDumper *                      myDumper;
+    BooleanService *                   myBooleans;
+    DisplaySimplifier                  mySimplifier;
+    MeshStore *                        myMeshStore;
+    PointCloudLayer *                  myPointCloud;
+    ScalarFieldMap                     myScalarFields;
+    TopologyMap                        myTopologies;
+    ModelView *                        myMaster;
 
     // todo 等待被使用
     QMenu *myBackMenu;
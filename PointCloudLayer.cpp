@@ -0,0 +1,578 @@
+#include "PointCloudLayer.h"
+
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <cmath>
+
+#include <AIS_PointCloud.hxx>
+#include <BRepAdaptor_Surface.hxx>
+#include <BRepTools.hxx>
+#include <BRepTopAdaptor_FClass2d.hxx>
+#include <Graphic3d_ArrayOfPoints.hxx>
+#include <Graphic3d_AttribBuffer.hxx>
+#include <Graphic3d_Camera.hxx>
+#include <Graphic3d_Group.hxx>
+#include <OSD_Parallel.hxx>
+#include <Precision.hxx>
+#include <Prs3d_Presentation.hxx>
+#include <Prs3d_ShadingAspect.hxx>
+#include <TopExp.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
+#include <TopoDS.hxx>
+#include <V3d_View.hxx>
+#include <V3d_Viewer.hxx>
+
+namespace
+{
+    //! 相机停止移动后恢复全部点的延迟
+    const int THE_IDLE_MS = 200;
+
+    //! 每个参数方向上的最大采样数
+    const Standard_Integer THE_MAX_SAMPLES = 8192;
+
+    //! 抽稀级别：2为1/64的点，1为1/8的点(包含级别2)，0为其余的点
+    //!
+    //! 取序号乘法散列(Fibonacci hashing)的高位，选出的点在序号上均匀分布，
+    //! 不会像固定步长那样与UV采样网格的行宽同步而只留下几条线。
+    inline int levelOf(const Standard_Integer theIndex)
+    {
+        const unsigned int aHash = (unsigned int)theIndex * 2654435761u;
+        if ((aHash >> 26) == 0)
+            return 2;
+        return (aHash >> 29) == 0 ? 1 : 0;
+    }
+
+    Handle(Graphic3d_ArrayOfPoints) makeArray(const Standard_Integer theNb, const bool hasNormals)
+    {
+        Graphic3d_ArrayFlags aFlags = Graphic3d_ArrayFlags_VertexColor
+                                      | Graphic3d_ArrayFlags_AttribsMutable
+                                      | Graphic3d_ArrayFlags_AttribsDeinterleaved;
+        if (hasNormals)
+            aFlags |= Graphic3d_ArrayFlags_VertexNormal;
+        return new Graphic3d_ArrayOfPoints(theNb, aFlags);
+    }
+
+    //! 颜色属性在缓冲中的序号
+    Standard_Integer colorAttribute(const Handle(Graphic3d_ArrayOfPoints) & theArray)
+    {
+        const Handle(Graphic3d_Buffer) &aBuffer = theArray->Attributes();
+        for (Standard_Integer i = 0; i < aBuffer->NbAttributes; ++i)
+        {
+            if (aBuffer->Attribute(i).Id == Graphic3d_TOA_COLOR)
+                return i;
+        }
+        return -1;
+    }
+
+    inline Graphic3d_Vec4ub toColor(const unsigned char *theRGB)
+    {
+        return theRGB != NULL ? Graphic3d_Vec4ub(theRGB[0], theRGB[1], theRGB[2], 255)
+                              : Graphic3d_Vec4ub(160, 160, 160, 255);
+    }
+
+    //! 包围盒在屏幕上的投影面积(像素)，跨过相机平面时按整个视口计
+    double screenPixels(const Standard_Real theMin[3], const Standard_Real theMax[3],
+                        const Graphic3d_Mat4d &theViewProj, const Standard_Integer theWidth,
+                        const Standard_Integer theHeight)
+    {
+        double aMin[2] = {1.0, 1.0}, aMax[2] = {-1.0, -1.0};
+        for (int i = 0; i < 8; ++i)
+        {
+            const Graphic3d_Vec4d aCorner((i & 1) ? theMax[0] : theMin[0], (i & 2) ? theMax[1] : theMin[1],
+                                          (i & 4) ? theMax[2] : theMin[2], 1.0);
+            const Graphic3d_Vec4d aClip = theViewProj * aCorner;
+            if (aClip.w() <= Precision::Confusion())
+                return (double)theWidth * theHeight;
+
+            for (int k = 0; k < 2; ++k)
+            {
+                const double aNdc = aClip[k] / aClip.w();
+                aMin[k]           = std::min(aMin[k], aNdc);
+                aMax[k]           = std::max(aMax[k], aNdc);
+            }
+        }
+
+        const double aW = std::min(aMax[0], 1.0) - std::max(aMin[0], -1.0);
+        const double aH = std::min(aMax[1], 1.0) - std::max(aMin[1], -1.0);
+        if (aW <= 0.0 || aH <= 0.0)
+            return 0.0;
+        return aW * 0.5 * theWidth * aH * 0.5 * theHeight;
+    }
+
+    //! 一个面在参数域上的均匀采样
+    void sampleFace(const TopoDS_Face &theFace, const Standard_Real theResolution,
+                    std::vector<float> &theXYZ, std::vector<float> &theNormals)
+    {
+        Standard_Real u1, u2, v1, v2;
+        BRepTools::UVBounds(theFace, u1, u2, v1, v2);
+        if (Precision::IsInfinite(u1) || Precision::IsInfinite(u2) || Precision::IsInfinite(v1) || Precision::IsInfinite(v2))
+            return;
+
+        BRepAdaptor_Surface aSurf(theFace);
+
+        // 沿参数域中线的近似弧长(mm)
+        Standard_Real aLength[2] = {0.0, 0.0};
+        for (int d = 0; d < 2; ++d)
+        {
+            gp_Pnt aPrev;
+            for (int k = 0; k <= 8; ++k)
+            {
+                const Standard_Real t = k / 8.0;
+                const gp_Pnt aPnt = d == 0 ? aSurf.Value(u1 + (u2 - u1) * t, 0.5 * (v1 + v2))
+                                           : aSurf.Value(0.5 * (u1 + u2), v1 + (v2 - v1) * t);
+                if (k > 0)
+                    aLength[d] += aPrev.Distance(aPnt);
+                aPrev = aPnt;
+            }
+        }
+
+        // 分辨率为每米的采样点数
+        const Standard_Integer aNbU = std::min(THE_MAX_SAMPLES, std::max(2, (int)std::ceil(aLength[0] / 1000.0 * theResolution) + 1));
+        const Standard_Integer aNbV = std::min(THE_MAX_SAMPLES, std::max(2, (int)std::ceil(aLength[1] / 1000.0 * theResolution) + 1));
+
+        BRepTopAdaptor_FClass2d aClass(theFace, Precision::PConfusion());
+        const bool              isReversed = theFace.Orientation() == TopAbs_REVERSED;
+
+        theXYZ.reserve(theXYZ.size() + (size_t)aNbU * aNbV * 3);
+        theNormals.reserve(theNormals.size() + (size_t)aNbU * aNbV * 3);
+        for (Standard_Integer i = 0; i < aNbU; ++i)
+        {
+            const Standard_Real u = u1 + (u2 - u1) * i / (aNbU - 1);
+            for (Standard_Integer j = 0; j < aNbV; ++j)
+            {
+                const Standard_Real v = v1 + (v2 - v1) * j / (aNbV - 1);
+                if (aClass.Perform(gp_Pnt2d(u, v)) == TopAbs_OUT)
+                    continue;
+
+                gp_Pnt aPnt;
+                gp_Vec aDU, aDV;
+                aSurf.D1(u, v, aPnt, aDU, aDV);
+                gp_Vec aNorm = aDU.Crossed(aDV);
+                if (aNorm.SquareMagnitude() > gp::Resolution())
+                    aNorm.Normalize();
+                else
+                    aNorm = gp_Vec(0.0, 0.0, 1.0);
+                if (isReversed)
+                    aNorm.Reverse();
+
+                theXYZ.push_back((float)aPnt.X());
+                theXYZ.push_back((float)aPnt.Y());
+                theXYZ.push_back((float)aPnt.Z());
+                theNormals.push_back((float)aNorm.X());
+                theNormals.push_back((float)aNorm.Y());
+                theNormals.push_back((float)aNorm.Z());
+            }
+        }
+    }
+
+    //! 一块点，显示模式DM_Points为全部点，DM_Decimated + k为第k + 1级抽稀
+    class PointCloudChunk : public AIS_PointCloud
+    {
+        DEFINE_STANDARD_RTTI_INLINE(PointCloudChunk, AIS_PointCloud)
+
+    public:
+        enum
+        {
+            DM_Decimated = 3
+        };
+
+        void SetLevel(const int theLevel, const Handle(Graphic3d_ArrayOfPoints) & thePoints) { myLevels[theLevel] = thePoints; }
+
+        virtual Standard_Boolean AcceptDisplayMode(const Standard_Integer theMode) const Standard_OVERRIDE
+        {
+            return theMode == DM_Decimated || theMode == DM_Decimated + 1 || AIS_PointCloud::AcceptDisplayMode(theMode);
+        }
+
+    protected:
+        virtual void Compute(const Handle(PrsMgr_PresentationManager3d) & thePrsMgr,
+                             const Handle(Prs3d_Presentation) & thePrs,
+                             const Standard_Integer theMode) Standard_OVERRIDE
+        {
+            if (theMode != DM_Decimated && theMode != DM_Decimated + 1)
+            {
+                AIS_PointCloud::Compute(thePrsMgr, thePrs, theMode);
+                return;
+            }
+
+            const Handle(Graphic3d_ArrayOfPoints) &aPoints = myLevels[theMode - DM_Decimated];
+            if (aPoints.IsNull() || aPoints->VertexNumber() == 0)
+                return;
+
+            Handle(Graphic3d_Group) aGroup = thePrs->NewGroup();
+            aGroup->SetGroupPrimitivesAspect(myDrawer->ShadingAspect()->Aspect());
+            aGroup->AddPrimitiveArray(aPoints);
+        }
+
+    private:
+        Handle(Graphic3d_ArrayOfPoints) myLevels[2];
+    };
+}    // namespace
+
+struct PointCloudLayer::Chunk
+{
+    Handle(PointCloudChunk)         Prs;
+    Handle(Graphic3d_ArrayOfPoints) Arrays[3];     ///< 全部点与两级抽稀
+    std::vector<Standard_Integer>   Members[2];    ///< 抽稀级别中各点在块内的序号(递增)
+    qint64                          First;
+    Standard_Integer                Nb;
+    Standard_Integer                Level;         ///< 当前显示的级别
+    Standard_Real                   Min[3];
+    Standard_Real                   Max[3];
+};
+
+PointCloudLayer::PointCloudLayer(const Handle(AIS_InteractiveContext) & theContext, QObject *parent)
+    : QObject(parent)
+    , myContext(theContext)
+    , myPointsPerPixel(1.0)
+    , myIsMoving(false)
+{
+    myStats = Statistics();
+
+    myIdle.setSingleShot(true);
+    myIdle.setInterval(THE_IDLE_MS);
+    connect(&myIdle, SIGNAL(timeout()), this, SLOT(onIdle()));
+}
+
+PointCloudLayer::~PointCloudLayer()
+{
+    Clear();
+}
+
+void PointCloudLayer::Clear()
+{
+    if (myChunks.empty())
+        return;
+
+    for (size_t i = 0; i < myChunks.size(); ++i)
+    {
+        myContext->Remove(myChunks[i]->Prs, Standard_False);
+        delete myChunks[i];
+    }
+    myChunks.clear();
+    myViewStates.clear();
+    myIdle.stop();
+    myIsMoving = false;
+    myStats    = Statistics();
+    myContext->UpdateCurrentViewer();
+}
+
+qint64 PointCloudLayer::Add(const float *theXYZ, const float *theNormals, const unsigned char *theRGB, const qint64 theNb)
+{
+    const qint64 aFirst = myStats.NbPoints;
+    if (theXYZ == NULL || theNb <= 0)
+        return aFirst;
+
+    QElapsedTimer aTimer;
+    aTimer.start();
+
+    const Standard_Integer aNbChunks = (Standard_Integer)((theNb + THE_CHUNK_SIZE - 1) / THE_CHUNK_SIZE);
+    std::vector<Chunk *>   aChunks(aNbChunks);
+    for (Standard_Integer i = 0; i < aNbChunks; ++i)
+    {
+        aChunks[i]        = new Chunk();
+        aChunks[i]->First = aFirst + (qint64)i * THE_CHUNK_SIZE;
+        aChunks[i]->Nb    = (Standard_Integer)std::min<qint64>((qint64)THE_CHUNK_SIZE, theNb - (qint64)i * THE_CHUNK_SIZE);
+        aChunks[i]->Level = 0;
+    }
+
+    // 各块的顶点数组互不相关，并行填充
+    OSD_Parallel::For(0, aNbChunks, [&](const Standard_Integer i) {
+        Chunk &              aChunk = *aChunks[i];
+        const qint64         anOff  = (qint64)i * THE_CHUNK_SIZE;
+        const float *        aXYZ   = theXYZ + anOff * 3;
+        const float *        aNorm  = theNormals != NULL ? theNormals + anOff * 3 : NULL;
+        const unsigned char *aRGB   = theRGB != NULL ? theRGB + anOff * 3 : NULL;
+
+        for (Standard_Integer j = 0; j < aChunk.Nb; ++j)
+        {
+            const int aLevel = levelOf(j);
+            if (aLevel >= 1)
+                aChunk.Members[0].push_back(j);
+            if (aLevel >= 2)
+                aChunk.Members[1].push_back(j);
+        }
+
+        for (int k = 0; k < 3; ++k)
+        {
+            const Standard_Integer  aNb      = k == 0 ? aChunk.Nb : (Standard_Integer)aChunk.Members[k - 1].size();
+            const Standard_Integer *anIndex  = k == 0 ? NULL : aChunk.Members[k - 1].data();
+            aChunk.Arrays[k]                 = makeArray(std::max(aNb, 1), aNorm != NULL);
+            Graphic3d_ArrayOfPoints &anArray = *aChunk.Arrays[k];
+            for (Standard_Integer j = 0; j < aNb; ++j)
+            {
+                const Standard_Integer p = anIndex != NULL ? anIndex[j] : j;
+                const Standard_Integer v = anArray.AddVertex(aXYZ[p * 3], aXYZ[p * 3 + 1], aXYZ[p * 3 + 2]);
+                if (aNorm != NULL)
+                    anArray.SetVertexNormal(v, aNorm[p * 3], aNorm[p * 3 + 1], aNorm[p * 3 + 2]);
+                anArray.SetVertexColor(v, toColor(aRGB != NULL ? aRGB + p * 3 : NULL));
+            }
+        }
+
+        for (int d = 0; d < 3; ++d)
+        {
+            aChunk.Min[d] = RealLast();
+            aChunk.Max[d] = RealFirst();
+        }
+        for (Standard_Integer j = 0; j < aChunk.Nb; ++j)
+        {
+            for (int d = 0; d < 3; ++d)
+            {
+                aChunk.Min[d] = std::min(aChunk.Min[d], (Standard_Real)aXYZ[j * 3 + d]);
+                aChunk.Max[d] = std::max(aChunk.Max[d], (Standard_Real)aXYZ[j * 3 + d]);
+            }
+        }
+    });
+
+    // 显示对象在GUI线程中创建，点云只显示，不激活选择
+    for (Standard_Integer i = 0; i < aNbChunks; ++i)
+    {
+        Chunk &aChunk = *aChunks[i];
+        aChunk.Prs    = new PointCloudChunk();
+        aChunk.Prs->SetPoints(aChunk.Arrays[0]);
+        aChunk.Prs->SetLevel(0, aChunk.Arrays[1]);
+        aChunk.Prs->SetLevel(1, aChunk.Arrays[2]);
+        myContext->Display(aChunk.Prs, AIS_PointCloud::DM_Points, -1, Standard_False);
+
+        for (int k = 0; k < 3; ++k)
+            myStats.MemoryBytes += (qint64)aChunk.Arrays[k]->Attributes()->Size();
+        myChunks.push_back(aChunks[i]);
+    }
+    myContext->UpdateCurrentViewer();
+
+    myStats.NbPoints += theNb;
+    myStats.NbChunks = (Standard_Integer)myChunks.size();
+    myStats.BuildMs  = aTimer.nsecsElapsed() / 1.0e6;
+    LOG_INFO("PointCloud", "added " << theNb << " points in " << aNbChunks << " chunks, "
+                                    << myStats.MemoryBytes / 1048576 << " MB total, " << myStats.BuildMs << " ms");
+    return aFirst;
+}
+
+qint64 PointCloudLayer::Sample(const TopoDS_Shape &theShape, const Standard_Real theResolution,
+                               std::vector<float> &theXYZ, std::vector<float> &theNormals)
+{
+    TopTools_IndexedMapOfShape aFaces;
+    TopExp::MapShapes(theShape, TopAbs_FACE, aFaces);
+
+    std::vector<std::vector<float>> aXYZ(aFaces.Extent()), aNormals(aFaces.Extent());
+    OSD_Parallel::For(0, aFaces.Extent(), [&](const Standard_Integer i) {
+        sampleFace(TopoDS::Face(aFaces(i + 1)), theResolution, aXYZ[i], aNormals[i]);
+    });
+
+    const size_t aStart = theXYZ.size();
+    for (size_t i = 0; i < aXYZ.size(); ++i)
+    {
+        theXYZ.insert(theXYZ.end(), aXYZ[i].begin(), aXYZ[i].end());
+        theNormals.insert(theNormals.end(), aNormals[i].begin(), aNormals[i].end());
+    }
+    return (qint64)((theXYZ.size() - aStart) / 3);
+}
+
+qint64 PointCloudLayer::AddShape(const TopoDS_Shape &theShape, const Standard_Real theResolution)
+{
+    std::vector<float> aXYZ, aNormals;
+    const qint64       aNb = Sample(theShape, theResolution, aXYZ, aNormals);
+
+    // 法向映射到颜色
+    std::vector<unsigned char> aRGB(aNormals.size());
+    for (size_t i = 0; i < aNormals.size(); ++i)
+        aRGB[i] = (unsigned char)(127.5f + 127.5f * aNormals[i]);
+
+    return Add(aXYZ.data(), aNormals.data(), aRGB.data(), aNb);
+}
+
+void PointCloudLayer::SetColors(const qint64 theFirst, const qint64 theNb, const unsigned char *theRGB)
+{
+    const qint64 aLast = std::min(theFirst + theNb, myStats.NbPoints);
+    if (theRGB == NULL || theFirst < 0 || aLast <= theFirst)
+        return;
+
+    QElapsedTimer aTimer;
+    aTimer.start();
+
+    std::vector<Chunk *> aChunks;
+    for (size_t i = 0; i < myChunks.size(); ++i)
+    {
+        if (myChunks[i]->First < aLast && myChunks[i]->First + myChunks[i]->Nb > theFirst)
+            aChunks.push_back(myChunks[i]);
+    }
+
+    // 只改写颜色属性并标记失效的顶点范围，显示对象与其余属性不变
+    OSD_Parallel::For(0, (Standard_Integer)aChunks.size(), [&](const Standard_Integer i) {
+        Chunk &                aChunk = *aChunks[i];
+        const Standard_Integer aLower = (Standard_Integer)(std::max(theFirst, aChunk.First) - aChunk.First);
+        const Standard_Integer anUpper = (Standard_Integer)(std::min(aLast, aChunk.First + aChunk.Nb) - aChunk.First);
+        const unsigned char *  aRGB    = theRGB + (aChunk.First + aLower - theFirst) * 3;
+
+        for (int k = 0; k < 3; ++k)
+        {
+            Standard_Integer aFrom = aLower, aTo = anUpper;
+            if (k > 0)
+            {
+                const std::vector<Standard_Integer> &aMembers = aChunk.Members[k - 1];
+                aFrom = (Standard_Integer)(std::lower_bound(aMembers.begin(), aMembers.end(), aLower) - aMembers.begin());
+                aTo   = (Standard_Integer)(std::lower_bound(aMembers.begin(), aMembers.end(), anUpper) - aMembers.begin());
+            }
+            if (aFrom >= aTo)
+                continue;
+
+            Graphic3d_ArrayOfPoints &anArray = *aChunk.Arrays[k];
+            for (Standard_Integer j = aFrom; j < aTo; ++j)
+            {
+                const Standard_Integer p = k == 0 ? j : aChunk.Members[k - 1][j];
+                anArray.SetVertexColor(j + 1, toColor(aRGB + (p - aLower) * 3));
+            }
+
+            Handle(Graphic3d_AttribBuffer) aBuffer = Handle(Graphic3d_AttribBuffer)::DownCast(anArray.Attributes());
+            if (!aBuffer.IsNull())
+                aBuffer->Invalidate(colorAttribute(aChunk.Arrays[k]), aFrom, aTo - 1);
+        }
+    });
+
+    // 结构没有变化，视图不会自行失效
+    const Handle(V3d_Viewer) &aViewer = myContext->CurrentViewer();
+    for (V3d_ListOfView::Iterator anIter(aViewer->ActiveViews()); anIter.More(); anIter.Next())
+        anIter.Value()->Invalidate();
+    myContext->UpdateCurrentViewer();
+
+    myStats.LastColorMs = aTimer.nsecsElapsed() / 1.0e6;
+}
+
+bool PointCloudLayer::UpdateView()
+{
+    if (myChunks.empty())
+        return false;
+
+    std::vector<Graphic3d_Mat4d>              aViewProjs;
+    std::vector<Graphic3d_Vec2i>              aSizes;
+    std::vector<Graphic3d_WorldViewProjState> aStates;
+    const Handle(V3d_Viewer) &                aViewer = myContext->CurrentViewer();
+    for (V3d_ListOfView::Iterator anIter(aViewer->ActiveViews()); anIter.More(); anIter.Next())
+    {
+        const Handle(V3d_View) &aView = anIter.Value();
+        if (!aView->View()->IsActive() || aView->Window().IsNull())
+            continue;
+
+        const Handle(Graphic3d_Camera) &aCamera = aView->Camera();
+        Graphic3d_Vec2i                 aSize;
+        aView->Window()->Size(aSize.x(), aSize.y());
+        aViewProjs.push_back(aCamera->ProjectionMatrix() * aCamera->OrientationMatrix());
+        aSizes.push_back(aSize);
+        aStates.push_back(aCamera->WorldViewProjState());
+    }
+
+    bool isSame = aStates.size() == myViewStates.size();
+    for (size_t i = 0; isSame && i < aStates.size(); ++i)
+        isSame = !(aStates[i] != myViewStates[i]);
+    const bool isFirst = myViewStates.empty();
+    myViewStates       = aStates;
+    if (isSame || isFirst)
+        return false;
+
+    // 相机在移动：按投影面积为每块选择级别，直到停止THE_IDLE_MS后恢复
+    myIsMoving = true;
+    myIdle.start();
+
+    bool isChanged = false;
+    for (size_t i = 0; i < myChunks.size(); ++i)
+    {
+        Chunk &aChunk  = *myChunks[i];
+        double aPixels = 0.0;
+        for (size_t v = 0; v < aViewProjs.size(); ++v)
+            aPixels = std::max(aPixels, screenPixels(aChunk.Min, aChunk.Max, aViewProjs[v], aSizes[v].x(), aSizes[v].y()));
+
+        const double     aBudget = aPixels * myPointsPerPixel;
+        Standard_Integer aLevel  = 0;
+        if (aChunk.Nb > aBudget)
+            aLevel = aChunk.Members[0].size() > aBudget ? 2 : 1;
+        if (aLevel > 0)
+            ++myStats.NbDecimated;
+        isChanged = setLevel(aChunk, aLevel) || isChanged;
+    }
+    return isChanged;
+}
+
+void PointCloudLayer::onIdle()
+{
+    myIsMoving     = false;
+    bool isChanged = false;
+    for (size_t i = 0; i < myChunks.size(); ++i)
+        isChanged = setLevel(*myChunks[i], 0) || isChanged;
+
+    if (isChanged)
+    {
+        const Handle(V3d_Viewer) &aViewer = myContext->CurrentViewer();
+        for (V3d_ListOfView::Iterator anIter(aViewer->ActiveViews()); anIter.More(); anIter.Next())
+            anIter.Value()->Invalidate();
+        myContext->UpdateCurrentViewer();
+    }
+}
+
+void PointCloudLayer::SetLevel(const Standard_Integer theLevel)
+{
+    bool isChanged = false;
+    for (size_t i = 0; i < myChunks.size(); ++i)
+        isChanged = setLevel(*myChunks[i], theLevel) || isChanged;
+
+    if (isChanged)
+    {
+        const Handle(V3d_Viewer) &aViewer = myContext->CurrentViewer();
+        for (V3d_ListOfView::Iterator anIter(aViewer->ActiveViews()); anIter.More(); anIter.Next())
+            anIter.Value()->Invalidate();
+        myContext->UpdateCurrentViewer();
+    }
+}
+
+qint64 PointCloudLayer::NbShownPoints() const
+{
+    qint64 aNb = 0;
+    for (size_t i = 0; i < myChunks.size(); ++i)
+    {
+        const Chunk &aChunk = *myChunks[i];
+        aNb += aChunk.Level == 0 ? aChunk.Nb : (qint64)aChunk.Members[aChunk.Level - 1].size();
+    }
+    return aNb;
+}
+
+bool PointCloudLayer::PointColor(const qint64 thePoint, const Standard_Integer theLevel, unsigned char theRGB[3]) const
+{
+    for (size_t i = 0; i < myChunks.size(); ++i)
+    {
+        const Chunk &aChunk = *myChunks[i];
+        if (thePoint < aChunk.First || thePoint >= aChunk.First + aChunk.Nb)
+            continue;
+
+        Standard_Integer anIndex = (Standard_Integer)(thePoint - aChunk.First);
+        if (theLevel > 0)
+        {
+            const std::vector<Standard_Integer> &aMembers = aChunk.Members[theLevel - 1];
+            std::vector<Standard_Integer>::const_iterator aFound =
+                std::lower_bound(aMembers.begin(), aMembers.end(), anIndex);
+            if (aFound == aMembers.end() || *aFound != anIndex)
+                return false;
+            anIndex = (Standard_Integer)(aFound - aMembers.begin());
+        }
+
+        Graphic3d_Vec4ub aColor;
+        aChunk.Arrays[theLevel]->VertexColor(anIndex + 1, aColor);
+        theRGB[0] = aColor.r();
+        theRGB[1] = aColor.g();
+        theRGB[2] = aColor.b();
+        return true;
+    }
+    return false;
+}
+
+bool PointCloudLayer::setLevel(Chunk &theChunk, const Standard_Integer theLevel)
+{
+    if (theChunk.Level == theLevel)
+        return false;
+
+    // 切换显示模式只改变各级presentation的可见性，已上传的顶点缓冲保留
+    theChunk.Level = theLevel;
+    myContext->SetDisplayMode(theChunk.Prs,
+                              theLevel == 0 ? (Standard_Integer)AIS_PointCloud::DM_Points
+                                            : (Standard_Integer)PointCloudChunk::DM_Decimated + theLevel - 1,
+                              Standard_False);
+    return true;
+}
@@ -0,0 +1,110 @@
+#ifndef POINTCLOUDLAYER_H
+#define POINTCLOUDLAYER_H
+
+#include <vector>
+
+#include <QObject>
+#include <QTimer>
+
+#include <AIS_InteractiveContext.hxx>
+#include <Graphic3d_WorldViewProjState.hxx>
+#include <TopoDS_Shape.hxx>
+
+#include "Gglobal.h"
+
+/// \brief PointCloudLayer
+///
+/// 大规模点云(例如曲面的UV采样点)的显示图层。点按固定大小分块，每块是一个只显示不参与选择的
+/// AIS_PointCloud，顶点带法向和颜色：
+///
+/// - 分块后各块有自己的包围盒，视锥外的块由视图整体剔除，单个顶点缓冲也不会过大
+/// - 每块另外保存1/8和1/64两级抽稀的点集(按点序号的散列选取，分布均匀且与采样网格不同步)，
+///   作为额外的显示模式；相机移动期间按每块在屏幕上的投影面积选择级别，使每像素的点数不超过
+///   PointsPerPixel，相机停止一段时间后恢复全部点
+/// - 顶点数组使用可变(mutable)且按属性分开存放的缓冲，修改颜色只改写颜色属性并标记其范围失效，
+///   重绘时只上传颜色，不重新计算显示对象
+class PointCloudLayer : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Statistics
+    {
+        qint64           NbPoints;
+        Standard_Integer NbChunks;
+        qint64           MemoryBytes;        ///< 顶点数组(含抽稀级别)的大小
+        double           BuildMs;            ///< 最近一次Add的耗时
+        double           LastColorMs;        ///< 最近一次SetColors的耗时
+        qint64           NbDecimated;        ///< 相机移动期间以抽稀级别显示的块次数
+    };
+
+    //! 每块的点数
+    static const Standard_Integer THE_CHUNK_SIZE = 1 << 20;
+
+    PointCloudLayer(const Handle(AIS_InteractiveContext) & theContext, QObject *parent = nullptr);
+    ~PointCloudLayer();
+
+    /// \brief 移除全部点
+    void Clear();
+
+    /// \brief 追加点
+    ///
+    /// \param theXYZ，坐标，每点3个float
+    /// \param theNormals，法向，每点3个float，可以为NULL
+    /// \param theRGB，颜色，每点3个字节，为NULL时为灰色
+    /// \return 第一个点的序号，SetColors按此序号寻址
+    qint64 Add(const float *theXYZ, const float *theNormals, const unsigned char *theRGB, const qint64 theNb);
+
+    /// \brief 对形状的全部面在参数域上按theResolution(采样点数目/米)均匀采样，追加坐标与外法向
+    ///
+    /// 采样步长由面在参数方向上的近似弧长决定，面的裁剪范围之外的点被丢弃。
+    static qint64 Sample(const TopoDS_Shape &theShape, const Standard_Real theResolution,
+                         std::vector<float> &theXYZ, std::vector<float> &theNormals);
+
+    /// \brief 采样形状并追加，颜色按法向着色
+    qint64 AddShape(const TopoDS_Shape &theShape, const Standard_Real theResolution = SAMPLE_RESOLUTIONS);
+
+    /// \brief 改写[theFirst, theFirst + theNb)的点的颜色(每点3个字节)，不重建显示对象
+    void SetColors(const qint64 theFirst, const qint64 theNb, const unsigned char *theRGB);
+
+    /// \brief 每次重绘前调用(见ModelView::paintEvent)，相机变化时切换到抽稀显示
+    ///
+    /// \return 显示模式有变化，视图需要整体重绘
+    bool UpdateView();
+
+    /// \brief 相机移动期间每像素最多显示的点数
+    void SetPointsPerPixel(const double theDensity) { myPointsPerPixel = theDensity; }
+
+    /// \brief 全部块显示指定级别(0为全部点，1为1/8，2为1/64)，相机下一次移动或停止时恢复自动选择
+    void SetLevel(const Standard_Integer theLevel);
+
+    /// \brief 当前显示级别下可见的点数
+    qint64 NbShownPoints() const;
+
+    /// \brief 第thePoint个点在级别theLevel中的颜色，该点不属于该级别时返回false
+    bool PointColor(const qint64 thePoint, const Standard_Integer theLevel, unsigned char theRGB[3]) const;
+
+    qint64            NbPoints() const { return myStats.NbPoints; }
+    const Statistics &Stats() const { return myStats; }
+
+private slots:
+    /// \brief 相机停止移动，恢复全部点
+    void onIdle();
+
+private:
+    struct Chunk;
+
+    /// \brief 按显示模式切换，返回是否有变化
+    bool setLevel(Chunk &theChunk, const Standard_Integer theLevel);
+
+    Handle(AIS_InteractiveContext)            myContext;
+    std::vector<Chunk *>                      myChunks;
+    std::vector<Graphic3d_WorldViewProjState> myViewStates;
+    QTimer                                    myIdle;
+    double                                    myPointsPerPixel;
+    bool                                      myIsMoving;
+
+    Statistics myStats;
+};
+
+#endif    // POINTCLOUDLAYER_H
@@ -0,0 +1,323 @@
+#include "ScalarField.h"
+
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <cmath>
+
+#include <BRepMesh_IncrementalMesh.hxx>
+#include <BRepTools.hxx>
+#include <BRep_Tool.hxx>
+#include <Graphic3d_AspectFillArea3d.hxx>
+#include <Graphic3d_AttribBuffer.hxx>
+#include <Graphic3d_Group.hxx>
+#include <Graphic3d_Texture2Dmanual.hxx>
+#include <Image_PixMap.hxx>
+#include <OSD_Parallel.hxx>
+#include <Poly_Triangulation.hxx>
+#include <Precision.hxx>
+#include <Prs3d_Presentation.hxx>
+#include <Prs3d_ShadingAspect.hxx>
+#include <StdPrs_ToolTriangulatedShape.hxx>
+#include <TopExp.hxx>
+#include <TopoDS.hxx>
+#include <V3d_View.hxx>
+#include <V3d_Viewer.hxx>
+
+namespace
+{
+    //! 色表纹理的宽度
+    const int THE_COLORMAP_SIZE = 256;
+
+    //! 并行写纹理坐标的块大小
+    const Standard_Integer THE_BLOCK = 65536;
+
+    //! t∈[0, 1]处的色表颜色
+    void colormapValue(const ScalarField::Colormap theColormap, const double t, double theRGB[3])
+    {
+        switch (theColormap)
+        {
+        case ScalarField::Colormap_Jet:
+            theRGB[0] = std::min(1.0, std::max(0.0, 1.5 - std::abs(4.0 * t - 3.0)));
+            theRGB[1] = std::min(1.0, std::max(0.0, 1.5 - std::abs(4.0 * t - 2.0)));
+            theRGB[2] = std::min(1.0, std::max(0.0, 1.5 - std::abs(4.0 * t - 1.0)));
+            break;
+        case ScalarField::Colormap_Viridis:
+        {
+            // viridis的5个控制点之间线性插值
+            static const double aKeys[5][3] = {{0.267, 0.005, 0.329},
+                                               {0.229, 0.322, 0.546},
+                                               {0.128, 0.567, 0.551},
+                                               {0.369, 0.789, 0.383},
+                                               {0.993, 0.906, 0.144}};
+            const double s = t * 4.0;
+            const int    k = std::min(3, (int)s);
+            for (int c = 0; c < 3; ++c)
+                theRGB[c] = aKeys[k][c] + (aKeys[k + 1][c] - aKeys[k][c]) * (s - k);
+            break;
+        }
+        default:
+            theRGB[0] = theRGB[1] = theRGB[2] = t;
+            break;
+        }
+    }
+
+    Handle(Graphic3d_Texture2Dmanual) colormapTexture(const ScalarField::Colormap theColormap)
+    {
+        Handle(Image_PixMap) anImage = new Image_PixMap();
+        anImage->InitZero(Image_Format_RGB, THE_COLORMAP_SIZE, 1);
+        for (int x = 0; x < THE_COLORMAP_SIZE; ++x)
+        {
+            double aRGB[3];
+            colormapValue(theColormap, x / (THE_COLORMAP_SIZE - 1.0), aRGB);
+            Image_ColorRGB &aPixel = anImage->ChangeValue<Image_ColorRGB>(0, x);
+            aPixel.r()             = (Standard_Byte)(aRGB[0] * 255.0 + 0.5);
+            aPixel.g()             = (Standard_Byte)(aRGB[1] * 255.0 + 0.5);
+            aPixel.b()             = (Standard_Byte)(aRGB[2] * 255.0 + 0.5);
+        }
+
+        Handle(Graphic3d_Texture2Dmanual) aTexture = new Graphic3d_Texture2Dmanual(anImage);
+        aTexture->EnableModulate();
+        aTexture->DisableRepeat();
+        aTexture->GetParams()->SetFilter(Graphic3d_TOTF_BILINEAR);
+        return aTexture;
+    }
+}    // namespace
+
+ScalarField::ScalarField(const Handle(AIS_Shape) & theSource)
+    : mySource(theSource)
+    , myTexelAttribute(-1)
+    , myMin(0.0)
+    , myMax(1.0)
+    , myColormap(Colormap_Jet)
+    , myLastUpdateMs(0.0)
+{
+    // 颜色全部来自纹理，材质取白色，与光照相乘
+    Graphic3d_MaterialAspect aMaterial(Graphic3d_NOM_PLASTIC);
+    aMaterial.SetColor(Quantity_NOC_WHITE);
+
+    Handle(Graphic3d_AspectFillArea3d) anAspect = new Graphic3d_AspectFillArea3d();
+    anAspect->SetInteriorStyle(Aspect_IS_SOLID);
+    anAspect->SetInteriorColor(Quantity_NOC_WHITE);
+    anAspect->SetFrontMaterial(aMaterial);
+    anAspect->SetBackMaterial(aMaterial);
+    anAspect->SetTextureMap(colormapTexture(myColormap));
+    anAspect->SetTextureMapOn();
+
+    myDrawer->SetupOwnShadingAspect();
+    myDrawer->ShadingAspect()->SetAspect(anAspect);
+
+    if (mySource->HasTransformation())
+        SetLocalTransformation(mySource->LocalTransformation());
+
+    build();
+}
+
+void ScalarField::build()
+{
+    const TopoDS_Shape &aShape = mySource->Shape();
+    if (!BRepTools::Triangulation(aShape, Precision::Infinite()))
+    {
+        const Standard_Real aDeflection = StdPrs_ToolTriangulatedShape::GetDeflection(aShape, mySource->Attributes());
+        BRepMesh_IncrementalMesh(aShape, aDeflection, Standard_False, mySource->Attributes()->DeviationAngle(),
+                                 Standard_True);
+    }
+
+    TopExp::MapShapes(aShape, TopAbs_FACE, myFaces);
+
+    // 先统计每个面的顶点数，顶点数组一次分配
+    Standard_Integer aNbTriangles = 0;
+    myFaceFirst.assign(myFaces.Extent() + 1, 0);
+    for (Standard_Integer f = 1; f <= myFaces.Extent(); ++f)
+    {
+        TopLoc_Location                   aLoc;
+        const Handle(Poly_Triangulation) &aTri = BRep_Tool::Triangulation(TopoDS::Face(myFaces(f)), aLoc);
+        myFaceFirst[f] = myFaceFirst[f - 1] + (aTri.IsNull() ? 0 : aTri->NbNodes());
+        aNbTriangles += aTri.IsNull() ? 0 : aTri->NbTriangles();
+    }
+
+    const Standard_Integer aNbVertices = myFaceFirst.back();
+    myValues.assign(aNbVertices, 0.0f);
+    if (aNbVertices == 0)
+        return;
+
+    myTriangles = new Graphic3d_ArrayOfTriangles(aNbVertices, aNbTriangles * 3,
+                                                 Graphic3d_ArrayFlags_VertexNormal
+                                                     | Graphic3d_ArrayFlags_VertexTexel
+                                                     | Graphic3d_ArrayFlags_AttribsMutable
+                                                     | Graphic3d_ArrayFlags_AttribsDeinterleaved);
+
+    std::vector<gp_XYZ> aNormals;
+    for (Standard_Integer f = 1; f <= myFaces.Extent(); ++f)
+    {
+        const TopoDS_Face &               aFace = TopoDS::Face(myFaces(f));
+        TopLoc_Location                   aLoc;
+        const Handle(Poly_Triangulation) &aTri = BRep_Tool::Triangulation(aFace, aLoc);
+        if (aTri.IsNull())
+            continue;
+
+        const bool                   isReversed = aFace.Orientation() == TopAbs_REVERSED;
+        const gp_Trsf &              aTrsf      = aLoc.Transformation();
+        const TColgp_Array1OfPnt &   aNodes     = aTri->Nodes();
+        const Poly_Array1OfTriangle &aTris      = aTri->Triangles();
+        const Standard_Integer       anOffset   = myFaceFirst[f - 1];
+
+        // 按面积加权累加三角形法向
+        aNormals.assign(aTri->NbNodes(), gp_XYZ(0.0, 0.0, 0.0));
+        for (Standard_Integer t = aTris.Lower(); t <= aTris.Upper(); ++t)
+        {
+            Standard_Integer n1, n2, n3;
+            aTris(t).Get(n1, n2, n3);
+            if (isReversed)
+                std::swap(n2, n3);
+
+            const gp_XYZ p1     = aNodes(aNodes.Lower() + n1 - 1).Transformed(aTrsf).XYZ();
+            const gp_XYZ aCross = (aNodes(aNodes.Lower() + n2 - 1).Transformed(aTrsf).XYZ() - p1)
+                                      .Crossed(aNodes(aNodes.Lower() + n3 - 1).Transformed(aTrsf).XYZ() - p1);
+            aNormals[n1 - 1] += aCross;
+            aNormals[n2 - 1] += aCross;
+            aNormals[n3 - 1] += aCross;
+        }
+
+        for (Standard_Integer i = 0; i < aTri->NbNodes(); ++i)
+        {
+            const Standard_Real aLen = aNormals[i].Modulus();
+            const gp_XYZ        aN   = aLen > gp::Resolution() ? aNormals[i] / aLen : gp_XYZ(0.0, 0.0, 1.0);
+            const Standard_Integer v = myTriangles->AddVertex(aNodes(aNodes.Lower() + i).Transformed(aTrsf));
+            myTriangles->SetVertexNormal(v, aN.X(), aN.Y(), aN.Z());
+        }
+
+        // 顶点加入后再加入索引，面的节点n对应顶点anOffset + n
+        for (Standard_Integer t = aTris.Lower(); t <= aTris.Upper(); ++t)
+        {
+            Standard_Integer n1, n2, n3;
+            aTris(t).Get(n1, n2, n3);
+            if (isReversed)
+                std::swap(n2, n3);
+            myTriangles->AddEdges(anOffset + n1, anOffset + n2, anOffset + n3);
+        }
+    }
+
+    const Handle(Graphic3d_Buffer) &aBuffer = myTriangles->Attributes();
+    for (Standard_Integer i = 0; i < aBuffer->NbAttributes; ++i)
+    {
+        if (aBuffer->Attribute(i).Id == Graphic3d_TOA_UV)
+            myTexelAttribute = i;
+    }
+    writeTexels(0, aNbVertices);
+}
+
+void ScalarField::Compute(const Handle(PrsMgr_PresentationManager3d) &,
+                          const Handle(Prs3d_Presentation) & thePrs,
+                          const Standard_Integer theMode)
+{
+    if (theMode != 0 || myTriangles.IsNull())
+        return;
+
+    Handle(Graphic3d_Group) aGroup = thePrs->NewGroup();
+    aGroup->SetGroupPrimitivesAspect(myDrawer->ShadingAspect()->Aspect());
+    aGroup->AddPrimitiveArray(myTriangles);
+}
+
+void ScalarField::SetRange(const Standard_Real theMin, const Standard_Real theMax, const Standard_Boolean theToUpdateViewer)
+{
+    myMin = theMin;
+    myMax = theMax;
+    writeTexels(0, NbVertices());
+    if (theToUpdateViewer)
+        redraw();
+}
+
+void ScalarField::FitRange(const Standard_Boolean theToUpdateViewer)
+{
+    if (myValues.empty())
+        return;
+
+    const std::pair<std::vector<float>::const_iterator, std::vector<float>::const_iterator> aMinMax =
+        std::minmax_element(myValues.begin(), myValues.end());
+    SetRange(*aMinMax.first, *aMinMax.second, theToUpdateViewer);
+}
+
+void ScalarField::SetColormap(const Colormap theColormap)
+{
+    if (myColormap == theColormap)
+        return;
+
+    // 只替换纹理，显示对象不需要重新计算
+    myColormap = theColormap;
+    myDrawer->ShadingAspect()->Aspect()->SetTextureMap(colormapTexture(myColormap));
+    SynchronizeAspects();
+    redraw();
+}
+
+void ScalarField::SetVertexValues(const Standard_Integer theFirst, const Standard_Integer theNb, const float *theValues,
+                                  const Standard_Boolean theToUpdateViewer)
+{
+    const Standard_Integer aLast = std::min(theFirst + theNb, NbVertices());
+    if (theValues == NULL || theFirst < 0 || aLast <= theFirst)
+        return;
+
+    QElapsedTimer aTimer;
+    aTimer.start();
+
+    std::copy(theValues, theValues + (aLast - theFirst), myValues.begin() + theFirst);
+    writeTexels(theFirst, aLast);
+
+    myLastUpdateMs = aTimer.nsecsElapsed() / 1.0e6;
+    if (theToUpdateViewer)
+        redraw();
+}
+
+void ScalarField::SetFaceValues(const float *theValues, const Standard_Boolean theToUpdateViewer)
+{
+    if (theValues == NULL || myValues.empty())
+        return;
+
+    QElapsedTimer aTimer;
+    aTimer.start();
+
+    for (Standard_Integer f = 0; f < NbFaces(); ++f)
+        std::fill(myValues.begin() + myFaceFirst[f], myValues.begin() + myFaceFirst[f + 1], theValues[f]);
+    writeTexels(0, NbVertices());
+
+    myLastUpdateMs = aTimer.nsecsElapsed() / 1.0e6;
+    if (theToUpdateViewer)
+        redraw();
+}
+
+void ScalarField::writeTexels(const Standard_Integer theFirst, const Standard_Integer theLast)
+{
+    if (myTriangles.IsNull() || theLast <= theFirst)
+        return;
+
+    // 纹理坐标限制在首尾像素的中心，不会采样到边界之外
+    const Standard_Real aScale  = myMax - myMin > Precision::Confusion() ? 1.0 / (myMax - myMin) : 0.0;
+    const float         aLow    = 0.5f / THE_COLORMAP_SIZE;
+    const float         aHigh   = 1.0f - aLow;
+    const Standard_Integer aNbBlocks = (theLast - theFirst + THE_BLOCK - 1) / THE_BLOCK;
+    OSD_Parallel::For(0, aNbBlocks, [&](const Standard_Integer b) {
+        const Standard_Integer aFrom = theFirst + b * THE_BLOCK;
+        const Standard_Integer aTo   = std::min(theLast, aFrom + THE_BLOCK);
+        for (Standard_Integer i = aFrom; i < aTo; ++i)
+        {
+            const float t = (float)((myValues[i] - myMin) * aScale);
+            myTriangles->SetVertexTexel(i + 1, std::min(aHigh, std::max(aLow, t)), 0.5f);
+        }
+    });
+
+    Handle(Graphic3d_AttribBuffer) aBuffer = Handle(Graphic3d_AttribBuffer)::DownCast(myTriangles->Attributes());
+    if (!aBuffer.IsNull() && myTexelAttribute >= 0)
+        aBuffer->Invalidate(myTexelAttribute, theFirst, theLast - 1);
+}
+
+void ScalarField::redraw()
+{
+    if (!HasInteractiveContext())
+        return;
+
+    // 只有顶点缓冲内容变化，结构本身没有变化，视图不会自行失效
+    const Handle(V3d_Viewer) &aViewer = GetContext()->CurrentViewer();
+    for (V3d_ListOfView::Iterator anIter(aViewer->ActiveViews()); anIter.More(); anIter.Next())
+        anIter.Value()->Invalidate();
+    GetContext()->UpdateCurrentViewer();
+}
@@ -0,0 +1,104 @@
+#ifndef SCALARFIELD_H
+#define SCALARFIELD_H
+
+#include <vector>
+
+#include <AIS_InteractiveObject.hxx>
+#include <AIS_Shape.hxx>
+#include <Graphic3d_ArrayOfTriangles.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
+
+/// \brief ScalarField
+///
+/// 附着在一个AIS_Shape现有三角网格上的标量场显示(例如每个面吸收的能量)。
+/// 每个面的三角网格节点依次连续存放，标量值映射为一维纹理坐标，颜色由色表纹理查得：
+///
+/// - 值可以按顶点(SetVertexValues)或按面(SetFaceValues，面的全部顶点取同一值)给出
+/// - 顶点数组使用可变(mutable)且按属性分开存放的缓冲，更新值或值域只改写纹理坐标属性
+///   并标记其范围失效，不重新计算显示对象，可以在仿真运行中高频刷新
+/// - 更换色表只替换纹理并同步外观(SynchronizeAspects)
+///
+/// 网格取自对象的形状(含对象自身的变换)，缺少三角网格时先剖分；对象本身由调用者决定是否隐藏。
+class ScalarField : public AIS_InteractiveObject
+{
+public:
+    enum Colormap
+    {
+        Colormap_Jet,
+        Colormap_Viridis,
+        Colormap_Gray
+    };
+
+    explicit ScalarField(const Handle(AIS_Shape) & theSource);
+
+    const Handle(AIS_Shape) & Source() const { return mySource; }
+
+    Standard_Integer NbFaces() const { return myFaces.Extent(); }
+    Standard_Integer NbVertices() const { return (Standard_Integer)myValues.size(); }
+
+    /// \brief 面的序号(1..NbFaces)，不属于该对象时为0
+    Standard_Integer FaceIndex(const TopoDS_Shape &theFace) const { return myFaces.FindIndex(theFace); }
+    const TopoDS_Shape &Face(const Standard_Integer theIndex) const { return myFaces.FindKey(theIndex); }
+
+    /// \brief 面theIndex的顶点在顶点数组中的范围[First, First + Nb)
+    Standard_Integer FaceFirstVertex(const Standard_Integer theIndex) const { return myFaceFirst[theIndex - 1]; }
+    Standard_Integer FaceNbVertices(const Standard_Integer theIndex) const { return myFaceFirst[theIndex] - myFaceFirst[theIndex - 1]; }
+
+    /// \brief 色表两端对应的值，改变后重写全部纹理坐标
+    void SetRange(const Standard_Real theMin, const Standard_Real theMax, const Standard_Boolean theToUpdateViewer = Standard_True);
+    Standard_Real RangeMin() const { return myMin; }
+    Standard_Real RangeMax() const { return myMax; }
+
+    /// \brief 值域设为当前值的最小、最大值
+    void FitRange(const Standard_Boolean theToUpdateViewer = Standard_True);
+
+    void     SetColormap(const Colormap theColormap);
+    Colormap GetColormap() const { return myColormap; }
+
+    /// \brief 更新从theFirst开始的theNb个顶点的值
+    void SetVertexValues(const Standard_Integer theFirst, const Standard_Integer theNb, const float *theValues,
+                         const Standard_Boolean theToUpdateViewer = Standard_True);
+
+    /// \brief 更新全部面的值，theValues的长度为NbFaces
+    void SetFaceValues(const float *theValues, const Standard_Boolean theToUpdateViewer = Standard_True);
+
+    float Value(const Standard_Integer theVertex) const { return myValues[theVertex]; }
+
+    /// \brief 最近一次更新值的耗时(不含重绘)
+    double LastUpdateMs() const { return myLastUpdateMs; }
+
+    virtual Standard_Boolean AcceptDisplayMode(const Standard_Integer theMode) const Standard_OVERRIDE { return theMode == 0; }
+
+    DEFINE_STANDARD_RTTI_INLINE(ScalarField, AIS_InteractiveObject)
+
+protected:
+    virtual void Compute(const Handle(PrsMgr_PresentationManager3d) & thePrsMgr,
+                         const Handle(Prs3d_Presentation) & thePrs,
+                         const Standard_Integer theMode) Standard_OVERRIDE;
+
+    //! 标量场只用于显示，不参与选择
+    virtual void ComputeSelection(const Handle(SelectMgr_Selection) &, const Standard_Integer) Standard_OVERRIDE {}
+
+private:
+    void build();
+
+    /// \brief 把[theFirst, theLast)的值写成纹理坐标并标记失效
+    void writeTexels(const Standard_Integer theFirst, const Standard_Integer theLast);
+
+    void redraw();
+
+    Handle(AIS_Shape)                  mySource;
+    Handle(Graphic3d_ArrayOfTriangles) myTriangles;
+    Standard_Integer                   myTexelAttribute;
+    TopTools_IndexedMapOfShape         myFaces;
+    std::vector<Standard_Integer>      myFaceFirst;    ///< NbFaces + 1项，最后一项为顶点总数
+    std::vector<float>                 myValues;       ///< 每个顶点的值
+    Standard_Real                      myMin;
+    Standard_Real                      myMax;
+    Colormap                           myColormap;
+    double                             myLastUpdateMs;
+};
+
+DEFINE_STANDARD_HANDLE(ScalarField, AIS_InteractiveObject)
+
+#endif    // SCALARFIELD_H
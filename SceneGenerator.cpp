@@ -0,0 +1,180 @@
+#include "SceneGenerator.h"
+
+#include "Gglobal.h"
+
+#include <cmath>
+#include <random>
+
+#include <BRepAlgoAPI_Cut.hxx>
+#include <BRepAlgoAPI_Fuse.hxx>
+#include <BRepBuilderAPI_MakeFace.hxx>
+#include <BRepBuilderAPI_MakePolygon.hxx>
+#include <BRepBuilderAPI_Transform.hxx>
+#include <BRepFilletAPI_MakeFillet.hxx>
+#include <BRepPrimAPI_MakeBox.hxx>
+#include <BRepPrimAPI_MakeCylinder.hxx>
+#include <BRepPrimAPI_MakePrism.hxx>
+#include <BRep_Builder.hxx>
+#include <BinTools.hxx>
+#include <STEPControl_Writer.hxx>
+#include <TopExp.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
+#include <TopTools_ListOfShape.hxx>
+#include <TopoDS.hxx>
+#include <TopoDS_Compound.hxx>
+
+
+namespace
+{
+    //! [0, 1)区间的均匀随机数，只依赖mt19937的原始输出，保证跨平台可复现
+    Standard_Real uniform(std::mt19937 &theRng)
+    {
+        return theRng() / 4294967296.0;
+    }
+}    // namespace
+
+
+Handle(TopTools_HSequenceOfShape) SceneGenerator::Replicate(const TopoDS_Shape &theSample, const Options &theOptions)
+{
+    Handle(TopTools_HSequenceOfShape) aShapes = new TopTools_HSequenceOfShape;
+    if (theSample.IsNull() || theOptions.NbSolids <= 0)
+        return aShapes;
+
+    std::mt19937 aRng(theOptions.Seed);
+
+    const Standard_Integer aSide    = (Standard_Integer)std::ceil(std::cbrt((double)theOptions.NbSolids));
+    const Standard_Real    anExtent = aSide * theOptions.Spacing;
+
+    for (Standard_Integer i = 0; i < theOptions.NbSolids; ++i)
+    {
+        gp_Vec aPos;
+        if (theOptions.Placement == Layout_Grid)
+        {
+            aPos.SetCoord((i % aSide) * theOptions.Spacing,
+                          ((i / aSide) % aSide) * theOptions.Spacing,
+                          (i / (aSide * aSide)) * theOptions.Spacing);
+        }
+        else
+        {
+            const Standard_Real x = uniform(aRng) * anExtent;
+            const Standard_Real y = uniform(aRng) * anExtent;
+            const Standard_Real z = uniform(aRng) * anExtent;
+            aPos.SetCoord(x, y, z);
+        }
+
+        gp_Trsf aTrsf;
+        if (theOptions.MaxRotation > 0.0)
+            aTrsf.SetRotation(gp::OZ(), (2.0 * uniform(aRng) - 1.0) * theOptions.MaxRotation);
+
+        gp_Trsf aMove;
+        aMove.SetTranslation(aPos);
+        aTrsf.PreMultiply(aMove);
+
+        if (theOptions.ToCopy)
+            aShapes->Append(BRepBuilderAPI_Transform(theSample, aTrsf, Standard_True).Shape());
+        else
+            aShapes->Append(theSample.Moved(TopLoc_Location(aTrsf)));
+    }
+    return aShapes;
+}
+
+TopoDS_Shape SceneGenerator::Fuse(const Handle(TopTools_HSequenceOfShape) & theShapes)
+{
+    if (theShapes->IsEmpty())
+        return TopoDS_Shape();
+    if (theShapes->Length() == 1)
+        return theShapes->First();
+
+    TopTools_ListOfShape anArgs, aTools;
+    anArgs.Append(theShapes->First());
+    for (Standard_Integer i = 2; i <= theShapes->Length(); ++i)
+        aTools.Append(theShapes->Value(i));
+
+    BRepAlgoAPI_Fuse aFuse;
+    aFuse.SetArguments(anArgs);
+    aFuse.SetTools(aTools);
+    aFuse.SetRunParallel(Standard_True);
+    aFuse.Build();
+    if (!aFuse.IsDone())
+    {
+        dbgFunTrace("场景融合失败");
+        return MakeCompound(theShapes);
+    }
+    return aFuse.Shape();
+}
+
+TopoDS_Shape SceneGenerator::MakeCompound(const Handle(TopTools_HSequenceOfShape) & theShapes)
+{
+    BRep_Builder    aBuilder;
+    TopoDS_Compound aCompound;
+    aBuilder.MakeCompound(aCompound);
+    for (Standard_Integer i = 1; i <= theShapes->Length(); ++i)
+        aBuilder.Add(aCompound, theShapes->Value(i));
+    return aCompound;
+}
+
+TopoDS_Shape SceneGenerator::MakeGround(const Standard_Real W, const Standard_Real H, const Standard_Real theDepth)
+{
+    BRepBuilderAPI_MakePolygon aPoly(gp_Pnt(-W / 2, -H / 2, 0), gp_Pnt(W / 2, -H / 2, 0),
+                                     gp_Pnt(W / 2, H / 2, 0), gp_Pnt(-W / 2, H / 2, 0), Standard_True);
+    TopoDS_Face aFace = BRepBuilderAPI_MakeFace(aPoly.Wire());
+    return BRepPrimAPI_MakePrism(aFace, gp_Vec(0, 0, theDepth));
+}
+
+TopoDS_Shape SceneGenerator::MakeFastener(const Standard_Real theRadius, const Standard_Real theLength)
+{
+    TopoDS_Shape aHead =
+        BRepPrimAPI_MakeCylinder(gp_Ax2(gp_Pnt(0, 0, theLength), gp::DZ()), 2.0 * theRadius, 1.25 * theRadius);
+    TopoDS_Shape aShank = BRepPrimAPI_MakeCylinder(theRadius, theLength);
+    return BRepAlgoAPI_Fuse(aHead, aShank).Shape();
+}
+
+TopoDS_Shape SceneGenerator::MakeBracket(const Standard_Real theFillet, const Standard_Real theHoleRadius)
+{
+    const Standard_Real L = 60.0, W = 40.0, T = 8.0;
+
+    const TopoDS_Shape         aBox = BRepPrimAPI_MakeBox(L, W, T).Shape();
+    TopTools_IndexedMapOfShape anEdges;
+    TopExp::MapShapes(aBox, TopAbs_EDGE, anEdges);
+    BRepFilletAPI_MakeFillet aFillet(aBox);
+    for (Standard_Integer i = 1; i <= anEdges.Extent(); ++i)
+        aFillet.Add(theFillet, TopoDS::Edge(anEdges(i)));
+
+    // 四角各一个通孔
+    TopTools_ListOfShape aHoles;
+    const Standard_Real  anInset = 3.0 * theHoleRadius;
+    const Standard_Real  aXs[]   = { anInset, L - anInset };
+    const Standard_Real  aYs[]   = { anInset, W - anInset };
+    for (int i = 0; i < 2; ++i)
+    {
+        for (int j = 0; j < 2; ++j)
+            aHoles.Append(
+                BRepPrimAPI_MakeCylinder(gp_Ax2(gp_Pnt(aXs[i], aYs[j], -1.0), gp::DZ()), theHoleRadius, T + 2.0).Shape());
+    }
+
+    TopTools_ListOfShape anArgs;
+    anArgs.Append(aFillet.Shape());
+    BRepAlgoAPI_Cut aCut;
+    aCut.SetArguments(anArgs);
+    aCut.SetTools(aHoles);
+    aCut.Build();
+    return aCut.Shape();
+}
+
+bool SceneGenerator::WriteStep(const TopoDS_Shape &theShape, const TCollection_AsciiString &theFile)
+{
+    STEPControl_Writer aWriter;
+    if (aWriter.Transfer(theShape, STEPControl_AsIs) != IFSelect_RetDone)
+        return false;
+    return aWriter.Write(theFile.ToCString()) == IFSelect_RetDone;
+}
+
+bool SceneGenerator::WriteSnapshot(const TopoDS_Shape &theShape, const TCollection_AsciiString &theFile)
+{
+    return BinTools::Write(theShape, theFile.ToCString()) == Standard_True;
+}
+
+bool SceneGenerator::ReadSnapshot(const TCollection_AsciiString &theFile, TopoDS_Shape &theShape)
+{
+    return BinTools::Read(theShape, theFile.ToCString()) == Standard_True;
+}
@@ -0,0 +1,69 @@
+#ifndef SCENEGENERATOR_H
+#define SCENEGENERATOR_H
+
+#include <TCollection_AsciiString.hxx>
+#include <TopTools_HSequenceOfShape.hxx>
+#include <TopoDS_Shape.hxx>
+
+/// \brief SceneGenerator
+///
+/// 用于伸缩性测试的程序化场景生成器。可以复制、变换、融合样例几何(如res/cube101010.step)，
+/// 或者像test_geom中load_ground那样构造参数化的棱柱，生成1到1M个实体的场景，
+/// 并写出为STEP和二进制快照(BinTools)文件。
+///
+/// 相同的参数与种子总是生成完全相同的场景：随机数只使用std::mt19937的原始输出，
+/// 不依赖标准库中实现相关的分布类。
+class SceneGenerator
+{
+public:
+    enum Layout
+    {
+        Layout_Grid,      ///< 立方网格排列
+        Layout_Random     ///< 在网格所占的空间内随机分布
+    };
+
+    struct Options
+    {
+        Standard_Integer NbSolids;
+        Standard_Real    Spacing;        ///< 相邻副本之间的距离(mm)
+        Layout           Placement;
+        Standard_Real    MaxRotation;    ///< 绕Z轴随机旋转的最大角度(弧度)，0表示不旋转
+        Standard_Boolean ToCopy;         ///< true:深拷贝几何；false:共享TShape，只改变Location(适合百万级实体)
+        unsigned int     Seed;
+
+        Options()
+            : NbSolids(1)
+            , Spacing(20.0)
+            , Placement(Layout_Grid)
+            , MaxRotation(0.0)
+            , ToCopy(Standard_False)
+            , Seed(20211018)
+        {
+        }
+    };
+
+    /// \brief 按照theOptions复制样例几何
+    static Handle(TopTools_HSequenceOfShape) Replicate(const TopoDS_Shape &theSample, const Options &theOptions);
+
+    /// \brief 将全部形状融合为一个形状(BRepAlgoAPI_Fuse，并行模式)
+    static TopoDS_Shape Fuse(const Handle(TopTools_HSequenceOfShape) & theShapes);
+
+    /// \brief 将全部形状放入一个TopoDS_Compound
+    static TopoDS_Shape MakeCompound(const Handle(TopTools_HSequenceOfShape) & theShapes);
+
+    /// \brief 参数化的地面棱柱，W×H的矩形面沿Z轴拉伸theDepth
+    static TopoDS_Shape MakeGround(const Standard_Real W, const Standard_Real H, const Standard_Real theDepth = 100.0);
+
+    /// \brief 简化的螺栓：头部与螺杆两个圆柱融合
+    static TopoDS_Shape MakeFastener(const Standard_Real theRadius = 4.0, const Standard_Real theLength = 30.0);
+
+    /// \brief 60×40×8的安装板，全部棱边倒圆角，四角各一个通孔，用于去特征简化
+    static TopoDS_Shape MakeBracket(const Standard_Real theFillet = 1.0, const Standard_Real theHoleRadius = 2.5);
+
+    static bool WriteStep(const TopoDS_Shape &theShape, const TCollection_AsciiString &theFile);
+    /// \brief BinTools二进制快照，文件扩展名用.bbrep，与文本格式的.brep区分
+    static bool WriteSnapshot(const TopoDS_Shape &theShape, const TCollection_AsciiString &theFile);
+    static bool ReadSnapshot(const TCollection_AsciiString &theFile, TopoDS_Shape &theShape);
+};
+
+#endif    // SCENEGENERATOR_H
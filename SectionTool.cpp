@@ -0,0 +1,540 @@
+#include "SectionTool.h"
+#include "Gglobal.h"
+#include "ShapeUtils.h"
+
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QRunnable>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <AIS_InteractiveObject.hxx>
+#include <BRepAdaptor_Curve.hxx>
+#include <BRepAlgoAPI_Section.hxx>
+#include <BRepBndLib.hxx>
+#include <BRep_Tool.hxx>
+#include <Bnd_Box.hxx>
+#include <GCPnts_TangentialDeflection.hxx>
+#include <Graphic3d_ArrayOfSegments.hxx>
+#include <Graphic3d_Group.hxx>
+#include <Graphic3d_SequenceOfHClipPlane.hxx>
+#include <OSD_Parallel.hxx>
+#include <Poly_Triangulation.hxx>
+#include <Precision.hxx>
+#include <Prs3d_LineAspect.hxx>
+#include <Prs3d_Presentation.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopoDS.hxx>
+#include <V3d_View.hxx>
+#include <V3d_Viewer.hxx>
+#include <gp_Pln.hxx>
+
+
+namespace
+{
+    //! 拖动停止后开始计算精确截线的延迟
+    const int THE_DEBOUNCE_MS = 150;
+
+    gp_Pln axisPlane(const int theAxis, const double theOffset)
+    {
+        gp_XYZ aDir(0.0, 0.0, 0.0);
+        aDir.SetCoord(theAxis + 1, 1.0);
+        return gp_Pln(gp_Pnt(aDir * theOffset), gp_Dir(aDir));
+    }
+
+    //! 三角网格与平面coord(theAxis) == theOffset求交，线段端点依次追加到theSegments
+    void meshSection(const TopoDS_Shape &theShape, const int theAxis, const double theOffset,
+                     std::vector<float> &theSegments)
+    {
+        for (TopExp_Explorer anExp(theShape, TopAbs_FACE); anExp.More(); anExp.Next())
+        {
+            TopLoc_Location                   aLoc;
+            const Handle(Poly_Triangulation) &aTris = BRep_Tool::Triangulation(TopoDS::Face(anExp.Current()), aLoc);
+            if (aTris.IsNull())
+                continue;
+
+            const gp_Trsf &aTrsf = aLoc.Transformation();
+            for (Standard_Integer t = 1; t <= aTris->NbTriangles(); ++t)
+            {
+                Standard_Integer n[3];
+                aTris->Triangle(t).Get(n[0], n[1], n[2]);
+
+                gp_Pnt p[3];
+                double d[3];
+                for (int k = 0; k < 3; ++k)
+                {
+                    p[k] = aTris->Node(n[k]).Transformed(aTrsf);
+                    d[k] = p[k].Coord(theAxis + 1) - theOffset;
+                }
+                if ((d[0] > 0.0) == (d[1] > 0.0) && (d[1] > 0.0) == (d[2] > 0.0))
+                    continue;
+
+                int aNbHits = 0;
+                for (int k = 0; k < 3 && aNbHits < 2; ++k)
+                {
+                    const int k1 = (k + 1) % 3;
+                    if ((d[k] > 0.0) == (d[k1] > 0.0))
+                        continue;
+
+                    const double t1 = d[k] / (d[k] - d[k1]);
+                    const gp_XYZ aHit = p[k].XYZ() + (p[k1].XYZ() - p[k].XYZ()) * t1;
+                    theSegments.push_back((float)aHit.X());
+                    theSegments.push_back((float)aHit.Y());
+                    theSegments.push_back((float)aHit.Z());
+                    ++aNbHits;
+                }
+                if (aNbHits == 1)
+                    theSegments.resize(theSegments.size() - 3);
+            }
+        }
+    }
+
+    //! 精确截线，离散为线段
+    void exactSection(const TopoDS_Shape &theShape, const gp_Pln &thePlane, const double theDeflection,
+                      std::vector<float> &theSegments)
+    {
+        BRepAlgoAPI_Section aSection(theShape, thePlane, Standard_False);
+        aSection.ComputePCurveOn1(Standard_False);
+        aSection.Approximation(Standard_False);
+        aSection.Build();
+        if (!aSection.IsDone())
+            return;
+
+        for (TopExp_Explorer anExp(aSection.Shape(), TopAbs_EDGE); anExp.More(); anExp.Next())
+        {
+            BRepAdaptor_Curve           aCurve(TopoDS::Edge(anExp.Current()));
+            GCPnts_TangentialDeflection aPoints(aCurve, 0.2, theDeflection);
+            for (Standard_Integer i = 1; i < aPoints.NbPoints(); ++i)
+            {
+                const gp_Pnt p1 = aPoints.Value(i);
+                const gp_Pnt p2 = aPoints.Value(i + 1);
+                theSegments.push_back((float)p1.X());
+                theSegments.push_back((float)p1.Y());
+                theSegments.push_back((float)p1.Z());
+                theSegments.push_back((float)p2.X());
+                theSegments.push_back((float)p2.Y());
+                theSegments.push_back((float)p2.Z());
+            }
+        }
+    }
+
+    //! 截线显示对象，线段顶点直接放入一个Graphic3d_ArrayOfSegments
+    class SectionPrs : public AIS_InteractiveObject
+    {
+    public:
+        SectionPrs()
+        {
+            // 截线本身不参与裁剪，否则位于平面上的线会被部分裁掉
+            Handle(Graphic3d_SequenceOfHClipPlane) aPlanes = new Graphic3d_SequenceOfHClipPlane();
+            aPlanes->SetOverrideGlobal(Standard_True);
+            SetClipPlanes(aPlanes);
+            myDrawer->SetLineAspect(new Prs3d_LineAspect(Quantity_NOC_RED, Aspect_TOL_SOLID, 2.0));
+        }
+
+        void SetSegments(const std::vector<float> &theSegments, const bool isExact)
+        {
+            mySegments = theSegments;
+            myDrawer->LineAspect()->SetColor(isExact ? Quantity_NOC_RED : Quantity_NOC_ORANGE);
+            SetToUpdate();
+        }
+
+        virtual Standard_Boolean AcceptDisplayMode(const Standard_Integer theMode) const Standard_OVERRIDE
+        {
+            return theMode == 0;
+        }
+
+        virtual void Compute(const Handle(PrsMgr_PresentationManager3d) &,
+                             const Handle(Prs3d_Presentation) & thePrs,
+                             const Standard_Integer) Standard_OVERRIDE
+        {
+            const Standard_Integer aNbVerts = (Standard_Integer)(mySegments.size() / 3);
+            if (aNbVerts < 2)
+                return;
+
+            Handle(Graphic3d_ArrayOfSegments) anArray = new Graphic3d_ArrayOfSegments(aNbVerts);
+            for (Standard_Integer i = 0; i < aNbVerts; ++i)
+                anArray->AddVertex(mySegments[i * 3], mySegments[i * 3 + 1], mySegments[i * 3 + 2]);
+
+            Handle(Graphic3d_Group) aGroup = thePrs->NewGroup();
+            aGroup->SetGroupPrimitivesAspect(myDrawer->LineAspect()->Aspect());
+            aGroup->AddPrimitiveArray(anArray);
+        }
+
+        virtual void ComputeSelection(const Handle(SelectMgr_Selection) &, const Standard_Integer) Standard_OVERRIDE
+        {
+        }
+
+        DEFINE_STANDARD_RTTI_INLINE(SectionPrs, AIS_InteractiveObject)
+
+    private:
+        std::vector<float> mySegments;
+    };
+}    // namespace
+
+
+/// \brief 精确截线的后台任务，每个实体一个OSD_Parallel子任务
+class SectionTask : public QRunnable
+{
+public:
+    SectionTask(SectionTool *theTool, const int theGeneration, const qint64 theKey,
+                const int theAxis, const double theOffset, const double theDeflection)
+        : SceneStamp(0)
+        , myTool(theTool)
+        , myGeneration(theGeneration)
+        , myKey(theKey)
+        , myAxis(theAxis)
+        , myOffset(theOffset)
+        , myDeflection(theDeflection)
+    {
+    }
+
+    size_t                    SceneStamp;
+    std::vector<TopoDS_Shape> Shapes;
+
+    virtual void run() override
+    {
+        QElapsedTimer aTimer;
+        aTimer.start();
+
+        const gp_Pln                    aPlane = axisPlane(myAxis, myOffset);
+        std::vector<std::vector<float>> aParts(Shapes.size());
+        std::atomic<bool>               isStale(false);
+        OSD_Parallel::For(0, (Standard_Integer)Shapes.size(), [&](const Standard_Integer theIndex) {
+            if (isStale.load(std::memory_order_relaxed))
+                return;
+            if (myTool->myGeneration.load() != myGeneration)
+            {
+                isStale = true;
+                return;
+            }
+            exactSection(Shapes[theIndex], aPlane, myDeflection, aParts[theIndex]);
+        });
+
+        // 中途放弃的结果不完整，不能放入缓存
+        if (isStale)
+        {
+            QMetaObject::invokeMethod(myTool, "onExactReady", Qt::QueuedConnection, Q_ARG(bool, false));
+            return;
+        }
+
+        SectionTool::Result aResult;
+        aResult.Key        = myKey;
+        aResult.Generation = myGeneration;
+        aResult.SceneStamp = SceneStamp;
+        for (size_t i = 0; i < aParts.size(); ++i)
+            aResult.Segments.insert(aResult.Segments.end(), aParts[i].begin(), aParts[i].end());
+        aResult.Ms = aTimer.elapsed();
+
+        {
+            QMutexLocker aLock(&myTool->myReadyMutex);
+            myTool->myReady.push_back(aResult);
+        }
+        QMetaObject::invokeMethod(myTool, "onExactReady", Qt::QueuedConnection, Q_ARG(bool, true));
+    }
+
+private:
+    SectionTool *myTool;
+    int          myGeneration;
+    qint64       myKey;
+    int          myAxis;
+    double       myOffset;
+    double       myDeflection;
+};
+
+
+SectionTool::SectionTool(const Handle(AIS_InteractiveContext) & theContext, QObject *parent)
+    : QObject(parent)
+    , myContext(theContext)
+    , myAxis(Axis_Z)
+    , myOffset(0.0)
+    , myQuantum(1.0e-3)
+    , myDeflection(0.1)
+    , mySceneStamp(0)
+    , myCache(128 * 1024)
+    , myGeneration(0)
+{
+    memset(&myStats, 0, sizeof(myStats));
+    for (int i = 0; i < 3; ++i)
+    {
+        mySceneMin[i] = 0.0;
+        mySceneMax[i] = 0.0;
+    }
+
+    myDebounce.setSingleShot(true);
+    myDebounce.setInterval(THE_DEBOUNCE_MS);
+    connect(&myDebounce, SIGNAL(timeout()), this, SLOT(startExact()));
+
+    // 同一时刻只需要最新位置的结果，任务串行执行，过期任务会很快退出
+    myPool.setMaxThreadCount(1);
+}
+
+SectionTool::~SectionTool()
+{
+    ++myGeneration;
+    myPool.waitForDone();
+}
+
+void SectionTool::SetEnabled(const bool isOn)
+{
+    if (isOn == IsEnabled())
+        return;
+
+    const Handle(V3d_Viewer) &aViewer = myContext->CurrentViewer();
+    if (isOn)
+    {
+        myPlane = new Graphic3d_ClipPlane(axisPlane(myAxis, myOffset));
+        myPlane->SetCapping(Standard_True);
+        myPlane->SetUseObjectMaterial(Standard_True);
+        myPrs = new SectionPrs();
+        myContext->Display(myPrs, 0, -1, Standard_False);
+
+        // 只加上裁剪平面，截线由随后的SetPlane计算，避免在即将被替换的位置上启动精确任务
+        for (V3d_ListOfView::Iterator anIter(aViewer->ActiveViews()); anIter.More(); anIter.Next())
+            anIter.Value()->AddClipPlane(myPlane);
+        myContext->UpdateCurrentViewer();
+        return;
+    }
+
+    ++myGeneration;
+    myDebounce.stop();
+    for (V3d_ListOfView::Iterator anIter(aViewer->ActiveViews()); anIter.More(); anIter.Next())
+        anIter.Value()->RemoveClipPlane(myPlane);
+    myContext->Remove(myPrs, Standard_False);
+    myPlane.Nullify();
+    myPrs.Nullify();
+    myContext->UpdateCurrentViewer();
+
+    LOG_INFO("SectionTool", "剖切: cache " << myStats.CacheHits << " hits/" << myStats.CacheMisses << " misses, "
+                                           << myStats.Jobs << " jobs, " << myStats.Cancelled << " cancelled");
+}
+
+void SectionTool::SetPlane(const Axis theAxis, const double theOffset, const bool isDragging)
+{
+    myAxis   = theAxis;
+    myOffset = theOffset;
+    if (!IsEnabled())
+        return;
+
+    refresh();
+
+    // 视口布局变化后新建的视图也要加上裁剪平面
+    myPlane->SetEquation(axisPlane(myAxis, myOffset));
+    const Handle(V3d_Viewer) &aViewer = myContext->CurrentViewer();
+    for (V3d_ListOfView::Iterator anIter(aViewer->ActiveViews()); anIter.More(); anIter.Next())
+    {
+        const Handle(Graphic3d_SequenceOfHClipPlane) &aPlanes = anIter.Value()->ClipPlanes();
+        if (aPlanes.IsNull() || !aPlanes->Contains(myPlane))
+            anIter.Value()->AddClipPlane(myPlane);
+    }
+
+    // 新位置使正在进行的任务过期
+    ++myGeneration;
+
+    const std::vector<float> *aCached = myCache.object(cacheKey());
+    if (aCached != NULL)
+    {
+        ++myStats.CacheHits;
+        myDebounce.stop();
+        showSegments(*aCached, true);
+        emit sectionUpdated(true, (int)(aCached->size() / 6), 0.0);
+        return;
+    }
+
+    ++myStats.CacheMisses;
+    computeMesh();
+    if (isDragging)
+        myDebounce.start();
+    else
+        startExact();
+}
+
+bool SectionTool::Range(const Axis theAxis, double &theMin, double &theMax)
+{
+    refresh();
+    if (mySolids.empty())
+        return false;
+
+    theMin = mySceneMin[theAxis];
+    theMax = mySceneMax[theAxis];
+    return true;
+}
+
+void SectionTool::refresh()
+{
+    AIS_ListOfInteractive aList;
+    myContext->DisplayedObjects(AIS_KOI_Shape, -1, aList);
+
+    size_t aStamp = aList.Extent();
+    for (AIS_ListOfInteractive::Iterator anIter(aList); anIter.More(); anIter.Next())
+        aStamp = aStamp * 31 + (size_t)anIter.Value().get();
+    if (aStamp == mySceneStamp && !mySolids.empty())
+        return;
+
+    mySceneStamp = aStamp;
+    myCache.clear();
+
+    NCollection_DataMap<Handle(AIS_Shape), std::vector<Solid>, TColStd_MapTransientHasher> aParts;
+    for (AIS_ListOfInteractive::Iterator anIter(aList); anIter.More(); anIter.Next())
+    {
+        const Handle(AIS_Shape) aShape = Handle(AIS_Shape)::DownCast(anIter.Value());
+        if (aShape.IsNull() || aParts.IsBound(aShape))
+            continue;
+
+        std::vector<Solid> *anOld = myParts.ChangeSeek(aShape);
+        if (anOld != NULL)
+        {
+            aParts.Bind(aShape, *anOld);
+            continue;
+        }
+
+        // 组合体按实体拆开，每个实体一个截面任务；没有实体时(壳、面)整体计算
+        std::vector<Solid> aSolids;
+        auto               addSolid = [&aSolids](const TopoDS_Shape &theSolid) {
+            Bnd_Box aBox;
+            BRepBndLib::Add(theSolid, aBox, Standard_True);
+            if (aBox.IsVoid())
+                return;
+
+            Solid aSolid;
+            aSolid.Shape = theSolid;
+            aBox.Get(aSolid.Min[0], aSolid.Min[1], aSolid.Min[2], aSolid.Max[0], aSolid.Max[1], aSolid.Max[2]);
+            aSolids.push_back(aSolid);
+        };
+
+        const TopoDS_Shape aWorld = ShapeUtils::WorldShape(aShape);
+        for (TopExp_Explorer anExp(aWorld, TopAbs_SOLID); anExp.More(); anExp.Next())
+            addSolid(anExp.Current());
+        if (aSolids.empty())
+            addSolid(aWorld);
+        aParts.Bind(aShape, aSolids);
+    }
+    myParts.Exchange(aParts);
+
+    mySolids.clear();
+    for (NCollection_DataMap<Handle(AIS_Shape), std::vector<Solid>, TColStd_MapTransientHasher>::Iterator anIter(myParts);
+         anIter.More(); anIter.Next())
+    {
+        for (size_t i = 0; i < anIter.Value().size(); ++i)
+            mySolids.push_back(&anIter.Value()[i]);
+    }
+
+    for (int k = 0; k < 3; ++k)
+    {
+        mySceneMin[k] = RealLast();
+        mySceneMax[k] = RealFirst();
+        for (size_t i = 0; i < mySolids.size(); ++i)
+        {
+            mySceneMin[k] = std::min(mySceneMin[k], mySolids[i]->Min[k]);
+            mySceneMax[k] = std::max(mySceneMax[k], mySolids[i]->Max[k]);
+        }
+    }
+
+    if (!mySolids.empty())
+    {
+        const double aDiag = gp_Pnt(mySceneMin[0], mySceneMin[1], mySceneMin[2])
+                                 .Distance(gp_Pnt(mySceneMax[0], mySceneMax[1], mySceneMax[2]));
+        myQuantum    = std::max(aDiag * 1.0e-5, Precision::Confusion());
+        myDeflection = std::max(aDiag * 1.0e-4, Precision::Confusion());
+    }
+}
+
+void SectionTool::candidates(std::vector<const Solid *> &theSolids) const
+{
+    for (size_t i = 0; i < mySolids.size(); ++i)
+    {
+        if (mySolids[i]->Min[myAxis] <= myOffset && mySolids[i]->Max[myAxis] >= myOffset)
+            theSolids.push_back(mySolids[i]);
+    }
+}
+
+void SectionTool::computeMesh()
+{
+    QElapsedTimer aTimer;
+    aTimer.start();
+
+    std::vector<const Solid *> aSolids;
+    candidates(aSolids);
+
+    const int                       anAxis   = myAxis;
+    const double                    anOffset = myOffset;
+    std::vector<std::vector<float>> aParts(aSolids.size());
+    OSD_Parallel::For(0, (Standard_Integer)aSolids.size(), [&](const Standard_Integer theIndex) {
+        meshSection(aSolids[theIndex]->Shape, anAxis, anOffset, aParts[theIndex]);
+    });
+
+    std::vector<float> aSegments;
+    for (size_t i = 0; i < aParts.size(); ++i)
+        aSegments.insert(aSegments.end(), aParts[i].begin(), aParts[i].end());
+
+    myStats.LastMeshMs = aTimer.elapsed();
+    showSegments(aSegments, false);
+    emit sectionUpdated(false, (int)(aSegments.size() / 6), myStats.LastMeshMs);
+}
+
+void SectionTool::startExact()
+{
+    if (!IsEnabled())
+        return;
+
+    SectionTask *aTask = new SectionTask(this, myGeneration.load(), cacheKey(), myAxis, myOffset, myDeflection);
+    aTask->SceneStamp  = mySceneStamp;
+
+    std::vector<const Solid *> aSolids;
+    candidates(aSolids);
+    for (size_t i = 0; i < aSolids.size(); ++i)
+        aTask->Shapes.push_back(aSolids[i]->Shape);
+
+    ++myStats.Jobs;
+    myPool.start(aTask);
+}
+
+void SectionTool::onExactReady(bool isDone)
+{
+    if (!isDone)
+    {
+        ++myStats.Cancelled;
+        return;
+    }
+
+    std::vector<Result> aResults;
+    {
+        QMutexLocker aLock(&myReadyMutex);
+        aResults.swap(myReady);
+    }
+
+    for (size_t i = 0; i < aResults.size(); ++i)
+    {
+        const Result &aResult = aResults[i];
+
+        // 任务排队后场景已经改变(对象增删)，截线可能含有已删除的实体，既不显示也不缓存
+        if (aResult.SceneStamp != mySceneStamp)
+            continue;
+
+        const int  aNbSegments = (int)(aResult.Segments.size() / 6);
+        const bool isCurrent   = IsEnabled() && aResult.Generation == myGeneration.load();
+        myStats.LastExactMs    = aResult.Ms;
+        if (isCurrent)
+            showSegments(aResult.Segments, true);
+
+        // 即使位置已经改变，结果仍然放入缓存，拖回来时可以直接使用
+        const int aCost = std::max(1, (int)(aResult.Segments.size() * sizeof(float) / 1024));
+        myCache.insert(aResult.Key, new std::vector<float>(aResult.Segments), aCost);
+
+        if (isCurrent)
+            emit sectionUpdated(true, aNbSegments, aResult.Ms);
+    }
+}
+
+void SectionTool::showSegments(const std::vector<float> &theSegments, const bool isExact)
+{
+    Handle(SectionPrs)::DownCast(myPrs)->SetSegments(theSegments, isExact);
+    myContext->Redisplay(myPrs, Standard_False);
+    myContext->UpdateCurrentViewer();
+}
+
+qint64 SectionTool::cacheKey() const
+{
+    return (qint64)std::floor(myOffset / myQuantum + 0.5) * 4 + myAxis;
+}
@@ -0,0 +1,141 @@
+#ifndef SECTIONTOOL_H
+#define SECTIONTOOL_H
+
+#include <atomic>
+#include <vector>
+
+#include <QCache>
+#include <QMutex>
+#include <QObject>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <AIS_InteractiveContext.hxx>
+#include <AIS_Shape.hxx>
+#include <Graphic3d_ClipPlane.hxx>
+#include <NCollection_DataMap.hxx>
+#include <TColStd_MapTransientHasher.hxx>
+#include <TopoDS_Shape.hxx>
+
+/// \brief SectionTool
+///
+/// 与坐标轴垂直的剖切平面。剖切由视图的裁剪平面(Graphic3d_ClipPlane)完成并绘制封口，
+/// 截面轮廓线按两级精度显示：
+///
+/// - 拖动过程中用三角网格与平面求交，在GUI线程中并行计算，结果立即显示
+/// - 停止拖动后在后台用BRepAlgoAPI_Section逐个实体(OSD_Parallel)计算精确截线，
+///   完成后替换网格求交的结果；新的位置会使尚未完成的旧任务提前结束
+///
+/// 精确截线按(轴, 量化后的位置)缓存在QCache中(LRU，按字节计)，来回拖动经过的位置直接命中缓存。
+/// 显示对象集合变化时缓存失效。
+class SectionTool : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Axis
+    {
+        Axis_X,
+        Axis_Y,
+        Axis_Z
+    };
+
+    struct Statistics
+    {
+        qint64 CacheHits;
+        qint64 CacheMisses;
+        qint64 Jobs;            ///< 启动的精确截线任务数
+        qint64 Cancelled;       ///< 被更新的位置打断的任务数
+        double LastMeshMs;      ///< 最近一次网格求交耗时
+        double LastExactMs;     ///< 最近一次完成的精确截线耗时
+    };
+
+    SectionTool(const Handle(AIS_InteractiveContext) & theContext, QObject *parent = nullptr);
+    ~SectionTool();
+
+    /// \brief 打开/关闭剖切，关闭时移除裁剪平面与截线
+    ///
+    /// 打开时只在当前位置加上裁剪平面，不计算截线；调用者随后以实际位置调用SetPlane
+    void SetEnabled(const bool isOn);
+    bool IsEnabled() const { return !myPlane.IsNull(); }
+
+    /// \brief 移动剖切平面
+    ///
+    /// \param isDragging，为true时先显示网格求交结果，停止移动一段时间后再计算精确截线
+    void SetPlane(const Axis theAxis, const double theOffset, const bool isDragging);
+
+    /// \brief 当前显示对象在theAxis方向上的范围，用于剖切位置的滑块
+    bool Range(const Axis theAxis, double &theMin, double &theMax);
+
+    /// \brief 精确截线缓存的容量(MB)
+    void SetCacheSize(const int theMBytes) { myCache.setMaxCost(theMBytes * 1024); }
+
+    const Statistics &Stats() const { return myStats; }
+
+    /// \brief 等待后台任务结束
+    void waitForDone() { myPool.waitForDone(); }
+
+signals:
+    /// \brief 截线已更新，isExact为false时是网格求交的近似结果
+    void sectionUpdated(bool isExact, int theNbSegments, double theMs);
+
+private slots:
+    void startExact();
+    void onExactReady(bool isDone);
+
+private:
+    struct Result
+    {
+        qint64             Key;
+        int                Generation;
+        size_t             SceneStamp;    ///< 任务排队时的场景标记，场景改变后结果作废
+        double             Ms;
+        std::vector<float> Segments;
+    };
+
+    struct Solid
+    {
+        TopoDS_Shape  Shape;     ///< 世界坐标
+        Standard_Real Min[3];
+        Standard_Real Max[3];
+    };
+
+    /// \brief 更新显示对象的实体列表，对象集合变化时清空缓存
+    void refresh();
+
+    /// \brief 与当前平面相交的实体
+    void candidates(std::vector<const Solid *> &theSolids) const;
+
+    void computeMesh();
+    void showSegments(const std::vector<float> &theSegments, const bool isExact);
+
+    qint64 cacheKey() const;
+
+    friend class SectionTask;
+
+    Handle(AIS_InteractiveContext) myContext;
+    Handle(Graphic3d_ClipPlane)    myPlane;
+    Handle(AIS_InteractiveObject)  myPrs;      ///< 截线显示对象
+    Axis                           myAxis;
+    double                         myOffset;
+    double                         myQuantum;  ///< 缓存键的位置量化步长
+    double                         myDeflection;
+
+    NCollection_DataMap<Handle(AIS_Shape), std::vector<Solid>, TColStd_MapTransientHasher> myParts;
+    std::vector<const Solid *>                                                             mySolids;
+    size_t                                                                                 mySceneStamp;
+    Standard_Real                                                                          mySceneMin[3];
+    Standard_Real                                                                          mySceneMax[3];
+
+    QCache<qint64, std::vector<float>> myCache;    ///< 代价为KB
+    QTimer                             myDebounce;
+    QThreadPool                        myPool;
+    std::atomic<int>                   myGeneration;
+
+    QMutex              myReadyMutex;    ///< 保护后台任务交回的结果
+    std::vector<Result> myReady;
+
+    Statistics myStats;
+};
+
+#endif    // SECTIONTOOL_H
@@ -0,0 +1,352 @@
+#include "ShapeHealer.h"
+
+#include "Gglobal.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <BRepBuilderAPI_Sewing.hxx>
+#include <BRepCheck_Analyzer.hxx>
+#include <BRepTools_ReShape.hxx>
+#include <BRep_Builder.hxx>
+#include <BRep_Tool.hxx>
+#include <BinTools.hxx>
+#include <OSD_Parallel.hxx>
+#include <ShapeExtend_Status.hxx>
+#include <ShapeFix_FixSmallFace.hxx>
+#include <ShapeFix_Shape.hxx>
+#include <ShapeFix_Wireframe.hxx>
+#include <Standard_Failure.hxx>
+#include <TopExp.hxx>
+#include <TopTools_IndexedDataMapOfShapeListOfShape.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
+#include <TopoDS.hxx>
+#include <TopoDS_Compound.hxx>
+#include <TopoDS_Iterator.hxx>
+
+
+namespace
+{
+    //! 缓存格式变化时修改，旧的缓存自然失效
+    const char *const THE_CACHE_VERSION = "heal-1";
+
+    //! 装配中同一个部件的多个实例共享TShape，只修复一次
+    struct Unique
+    {
+        TopoDS_Shape        Input;    //!< 去掉位置和方向后的形状
+        TopoDS_Shape        Output;
+        ShapeHealer::Report Report;
+    };
+
+    struct Part
+    {
+        int                 Root;
+        int                 Unique;    //!< 在Unique数组中的序号
+        TopoDS_Shape        Input;
+        TopoDS_Shape        Output;
+        ShapeHealer::Report Report;
+    };
+
+    Standard_Integer count(const TopoDS_Shape &theShape, const TopAbs_ShapeEnum theType)
+    {
+        TopTools_IndexedMapOfShape aMap;
+        TopExp::MapShapes(theShape, theType, aMap);
+        return aMap.Extent();
+    }
+
+    //! 只属于一个面的边，不计退化边和同一个面上的缝合边
+    Standard_Integer freeEdges(const TopoDS_Shape &theShape)
+    {
+        TopTools_IndexedDataMapOfShapeListOfShape anEdgeFaces;
+        TopExp::MapShapesAndUniqueAncestors(theShape, TopAbs_EDGE, TopAbs_FACE, anEdgeFaces);
+
+        Standard_Integer aNb = 0;
+        for (Standard_Integer i = 1; i <= anEdgeFaces.Extent(); ++i)
+        {
+            const TopTools_ListOfShape &aFaces = anEdgeFaces(i);
+            const TopoDS_Edge &         anEdge = TopoDS::Edge(anEdgeFaces.FindKey(i));
+            if (aFaces.Extent() != 1 || BRep_Tool::Degenerated(anEdge))
+                continue;
+            if (!BRep_Tool::IsClosed(anEdge, TopoDS::Face(aFaces.First())))
+                ++aNb;
+        }
+        return aNb;
+    }
+
+    TopoDS_Shape healPart(const TopoDS_Shape &theInput, const ShapeHealer::Options &theOptions,
+                          ShapeHealer::Report &theReport)
+    {
+        const Standard_Integer aNbEdges = count(theInput, TopAbs_EDGE);
+        const Standard_Integer aNbFaces = count(theInput, TopAbs_FACE);
+        theReport.IsValidBefore         = BRepCheck_Analyzer(theInput).IsValid() == Standard_True;
+        theReport.FreeEdgesBefore       = freeEdges(theInput);
+
+        TopoDS_Shape aShape = theInput;
+        if (theOptions.ToSew && aShape.ShapeType() != TopAbs_SOLID && aShape.ShapeType() != TopAbs_COMPSOLID)
+        {
+            BRepBuilderAPI_Sewing aSewing(theOptions.Tolerance);
+            aSewing.Add(aShape);
+            aSewing.Perform();
+            if (!aSewing.SewedShape().IsNull())
+            {
+                theReport.IsSewn = !aSewing.SewedShape().IsSame(aShape);
+                aShape           = aSewing.SewedShape();
+            }
+        }
+
+        Handle(ShapeFix_Shape) aFix = new ShapeFix_Shape(aShape);
+        aFix->SetPrecision(theOptions.Tolerance);
+        aFix->SetMaxTolerance(10.0 * theOptions.Tolerance);
+        aFix->Perform();
+        theReport.IsFixed = aFix->Status(ShapeExtend_DONE) == Standard_True;
+        aShape            = aFix->Shape();
+
+        if (theOptions.ToFixSmall)
+        {
+            Handle(ShapeFix_Wireframe) aWire = new ShapeFix_Wireframe(aShape);
+            aWire->SetPrecision(theOptions.Tolerance);
+            aWire->ModeDropSmallEdges() = Standard_True;
+            aWire->FixWireGaps();
+            aWire->FixSmallEdges();
+            aShape = aWire->Shape();
+
+            ShapeFix_FixSmallFace aSmallFaces;
+            aSmallFaces.Init(aShape);
+            aSmallFaces.SetPrecision(theOptions.Tolerance);
+            aSmallFaces.Perform();
+            if (!aSmallFaces.Shape().IsNull())
+                aShape = aSmallFaces.Shape();
+        }
+
+        theReport.IsValidAfter   = BRepCheck_Analyzer(aShape).IsValid() == Standard_True;
+        theReport.FreeEdgesAfter = freeEdges(aShape);
+        theReport.EdgesRemoved   = aNbEdges - count(aShape, TopAbs_EDGE);
+        theReport.FacesRemoved   = aNbFaces - count(aShape, TopAbs_FACE);
+        return aShape;
+    }
+
+    QJsonObject toJson(const ShapeHealer::Report &theReport)
+    {
+        QJsonObject anObj;
+        anObj["root"]              = theReport.Root;
+        anObj["part"]              = theReport.Part;
+        anObj["ms"]                = theReport.Ms;
+        anObj["valid_before"]      = theReport.IsValidBefore;
+        anObj["valid_after"]       = theReport.IsValidAfter;
+        anObj["sewn"]              = theReport.IsSewn;
+        anObj["fixed"]             = theReport.IsFixed;
+        anObj["free_edges_before"] = theReport.FreeEdgesBefore;
+        anObj["free_edges_after"]  = theReport.FreeEdgesAfter;
+        anObj["edges_removed"]     = theReport.EdgesRemoved;
+        anObj["faces_removed"]     = theReport.FacesRemoved;
+        return anObj;
+    }
+
+    ShapeHealer::Report fromJson(const QJsonObject &theObj)
+    {
+        ShapeHealer::Report aReport;
+        aReport.Root            = theObj.value("root").toInt();
+        aReport.Part            = theObj.value("part").toInt();
+        aReport.Ms              = theObj.value("ms").toDouble();
+        aReport.IsValidBefore   = theObj.value("valid_before").toBool();
+        aReport.IsValidAfter    = theObj.value("valid_after").toBool();
+        aReport.IsSewn          = theObj.value("sewn").toBool();
+        aReport.IsFixed         = theObj.value("fixed").toBool();
+        aReport.FreeEdgesBefore = theObj.value("free_edges_before").toInt();
+        aReport.FreeEdgesAfter  = theObj.value("free_edges_after").toInt();
+        aReport.EdgesRemoved    = theObj.value("edges_removed").toInt();
+        aReport.FacesRemoved    = theObj.value("faces_removed").toInt();
+        return aReport;
+    }
+}    // namespace
+
+
+QString ShapeHealer::Report::ToString() const
+{
+    return QString("root %1 part %2: %3 ms, valid %4->%5, free edges %6->%7, %8 edges/%9 faces removed%10%11")
+        .arg(Root)
+        .arg(Part)
+        .arg(Ms, 0, 'f', 1)
+        .arg(IsValidBefore ? "yes" : "no")
+        .arg(IsValidAfter ? "yes" : "no")
+        .arg(FreeEdgesBefore)
+        .arg(FreeEdgesAfter)
+        .arg(EdgesRemoved)
+        .arg(FacesRemoved)
+        .arg(IsSewn ? ", sewn" : "")
+        .arg(IsFixed ? ", fixed" : "");
+}
+
+void ShapeHealer::Heal(const Handle(TopTools_HSequenceOfShape) & theShapes, std::vector<Report> &theReports) const
+{
+    // 每个实体是一个部件，没有实体的根形状整体作为一个部件
+    std::vector<Part>          aParts;
+    std::vector<Unique>        aUniques;
+    TopTools_IndexedMapOfShape aUniqueMap;
+    for (int i = 1; i <= theShapes->Length(); ++i)
+    {
+        TopTools_IndexedMapOfShape aSolids;
+        TopExp::MapShapes(theShapes->Value(i), TopAbs_SOLID, aSolids);
+        if (aSolids.IsEmpty())
+            aSolids.Add(theShapes->Value(i));
+
+        for (int j = 1; j <= aSolids.Extent(); ++j)
+        {
+            Part aPart;
+            aPart.Root        = i;
+            aPart.Input       = aSolids(j);
+            aPart.Report      = Report();
+            aPart.Report.Root = i;
+            aPart.Report.Part = j;
+
+            const TopoDS_Shape aBase = aPart.Input.Located(TopLoc_Location()).Oriented(TopAbs_FORWARD);
+            aPart.Unique             = aUniqueMap.Add(aBase) - 1;
+            if (aPart.Unique == (int)aUniques.size())
+            {
+                Unique aUnique;
+                aUnique.Input  = aBase;
+                aUnique.Report = Report();
+                aUniques.push_back(aUnique);
+            }
+            aParts.push_back(aPart);
+        }
+    }
+
+    // 每个TShape只由一个线程修复，同一部件的实例之间没有数据竞争
+    OSD_Parallel::For(0, (Standard_Integer)aUniques.size(), [&](const Standard_Integer theIndex) {
+        Unique &      aUnique = aUniques[theIndex];
+        QElapsedTimer aTimer;
+        aTimer.start();
+        try
+        {
+            aUnique.Output = healPart(aUnique.Input, myOptions, aUnique.Report);
+        }
+        catch (const Standard_Failure &)
+        {
+            // 修复失败的部件保持原样
+            aUnique.Output = aUnique.Input;
+        }
+        aUnique.Report.Ms = aTimer.nsecsElapsed() / 1.0e6;
+    });
+
+    // 修复结果按各实例的位置和方向放回，耗时只计在第一个实例上
+    std::vector<bool> isReported(aUniques.size(), false);
+    for (size_t i = 0; i < aParts.size(); ++i)
+    {
+        Part &        aPart   = aParts[i];
+        const Unique &aUnique = aUniques[aPart.Unique];
+        const int     aRoot   = aPart.Report.Root;
+        const int     aNumber = aPart.Report.Part;
+        aPart.Output          = aUnique.Output.Moved(aPart.Input.Location()).Composed(aPart.Input.Orientation());
+        aPart.Report          = aUnique.Report;
+        aPart.Report.Root     = aRoot;
+        aPart.Report.Part     = aNumber;
+        if (isReported[aPart.Unique])
+            aPart.Report.Ms = 0.0;
+        isReported[aPart.Unique] = true;
+    }
+
+    // 修复后的部件替换回根形状
+    for (size_t i = 0; i < aParts.size();)
+    {
+        const int                 aRoot    = aParts[i].Root;
+        Handle(BRepTools_ReShape) aReShape = new BRepTools_ReShape();
+        bool                      isWhole  = false;
+        for (; i < aParts.size() && aParts[i].Root == aRoot; ++i)
+        {
+            theReports.push_back(aParts[i].Report);
+            isWhole = aParts[i].Input.IsSame(theShapes->Value(aRoot));
+            if (isWhole)
+                theShapes->SetValue(aRoot, aParts[i].Output);
+            else
+                aReShape->Replace(aParts[i].Input, aParts[i].Output);
+        }
+        if (!isWhole)
+            theShapes->SetValue(aRoot, aReShape->Apply(theShapes->Value(aRoot)));
+    }
+}
+
+QString ShapeHealer::cacheBase(const QString &theFile) const
+{
+    if (myOptions.CacheDir.isEmpty())
+        return QString();
+
+    QFile aFile(theFile);
+    if (!aFile.open(QIODevice::ReadOnly))
+        return QString();
+
+    QCryptographicHash aHash(QCryptographicHash::Sha1);
+    aHash.addData(&aFile);
+    aHash.addData(QString("%1|%2|%3|%4")
+                      .arg(THE_CACHE_VERSION)
+                      .arg(myOptions.Tolerance, 0, 'g', 17)
+                      .arg(myOptions.ToSew)
+                      .arg(myOptions.ToFixSmall)
+                      .toUtf8());
+    return QDir(myOptions.CacheDir).filePath(QString::fromLatin1(aHash.result().toHex()));
+}
+
+bool ShapeHealer::LoadCached(const QString &theFile, const Handle(TopTools_HSequenceOfShape) & theShapes,
+                             std::vector<Report> &theReports) const
+{
+    const QString aBase = cacheBase(theFile);
+    if (aBase.isEmpty() || !QFileInfo::exists(aBase + ".bbrep"))
+        return false;
+
+    QFile aJson(aBase + ".json");
+    if (!aJson.open(QIODevice::ReadOnly))
+        return false;
+
+    TopoDS_Shape aCompound;
+    if (!BinTools::Read(aCompound, (aBase + ".bbrep").toUtf8().data()) || aCompound.IsNull())
+        return false;
+
+    for (TopoDS_Iterator anIter(aCompound); anIter.More(); anIter.Next())
+        theShapes->Append(anIter.Value());
+    foreach (const QJsonValue &aReport, QJsonDocument::fromJson(aJson.readAll()).array())
+        theReports.push_back(fromJson(aReport.toObject()));
+    return true;
+}
+
+void ShapeHealer::StoreCached(const QString &theFile, const Handle(TopTools_HSequenceOfShape) & theShapes,
+                              const std::vector<Report> &theReports) const
+{
+    const QString aBase = cacheBase(theFile);
+    if (aBase.isEmpty() || !QDir().mkpath(myOptions.CacheDir))
+        return;
+
+    TopoDS_Compound aCompound;
+    BRep_Builder    aBuilder;
+    aBuilder.MakeCompound(aCompound);
+    for (int i = 1; i <= theShapes->Length(); ++i)
+        aBuilder.Add(aCompound, theShapes->Value(i));
+
+    QJsonArray aReports;
+    for (size_t i = 0; i < theReports.size(); ++i)
+        aReports.append(toJson(theReports[i]));
+
+    // 诊断先写，形状文件最后改名就位，读取时以形状文件为准
+    QFile aJson(aBase + ".json");
+    if (!aJson.open(QIODevice::WriteOnly | QIODevice::Truncate)
+        || aJson.write(QJsonDocument(aReports).toJson(QJsonDocument::Compact)) < 0)
+    {
+        LOG_WARN("ShapeHealer", "cannot write " << aJson.fileName().toStdString());
+        return;
+    }
+    aJson.close();
+
+    const QString aTemp = aBase + ".bbrep.tmp";
+    if (!BinTools::Write(aCompound, aTemp.toUtf8().data()))
+    {
+        LOG_WARN("ShapeHealer", "cannot write " << aTemp.toStdString());
+        return;
+    }
+    QFile::remove(aBase + ".bbrep");
+    QFile::rename(aTemp, aBase + ".bbrep");
+}
@@ -0,0 +1,90 @@
+#ifndef SHAPEHEALER_H
+#define SHAPEHEALER_H
+
+#include <vector>
+
+#include <QString>
+
+#include <TopTools_HSequenceOfShape.hxx>
+
+/// \brief ShapeHealer
+///
+/// 导入后的形状修复。供应商的STEP文件常有缝隙、微小的边和面、未缝合的面片，
+/// 不修复会使后续的剖分和选择变慢甚至失败。修复以实体为单位并行(OSD_Parallel)进行，
+/// 没有实体的根形状(面片、壳)整体作为一个部件。装配中共享TShape的多个实例只修复一次，
+/// 结果再按各实例的位置放回：
+///
+/// 1. 非实体部件先缝合(BRepBuilderAPI_Sewing)
+/// 2. ShapeFix_Shape修复线框、面、壳和实体的方向
+/// 3. ShapeFix_Wireframe闭合线框缝隙、合并微小的边
+/// 4. ShapeFix_FixSmallFace移除退化为点或线的微小面
+///
+/// 修复后的部件替换回原来的根形状，装配结构保持不变。
+///
+/// 修复结果按输入文件内容与修复参数的哈希缓存(BinTools格式，附带各部件的诊断)，
+/// 再次打开同一文件时直接读取缓存，跳过STEP转换和修复(见ShapeLoader::ReadStep)。
+class ShapeHealer
+{
+public:
+    struct Options
+    {
+        double  Tolerance;     ///< 修复与缝合的容差(mm)
+        bool    ToSew;
+        bool    ToFixSmall;    ///< 合并微小的边、移除微小的面
+        QString CacheDir;      ///< 缓存目录，为空时不缓存
+
+        Options()
+            : Tolerance(1.0e-3)
+            , ToSew(true)
+            , ToFixSmall(true)
+        {
+        }
+    };
+
+    /// \brief 一个部件的修复诊断
+    struct Report
+    {
+        int    Root;               ///< 所在根形状的序号(从1开始)
+        int    Part;               ///< 在根形状中的序号(从1开始)
+        double Ms;
+        bool   IsValidBefore;      ///< BRepCheck_Analyzer的检查结果
+        bool   IsValidAfter;
+        bool   IsSewn;             ///< 缝合改变了形状
+        bool   IsFixed;            ///< ShapeFix_Shape做了修改
+        int    FreeEdgesBefore;    ///< 只属于一个面的边(缝隙、未缝合的边界)
+        int    FreeEdgesAfter;
+        int    EdgesRemoved;       ///< 修复前后的边数之差
+        int    FacesRemoved;
+
+        /// \brief 一行文字描述，用于日志
+        QString ToString() const;
+    };
+
+    explicit ShapeHealer(const Options &theOptions = Options())
+        : myOptions(theOptions)
+    {
+    }
+
+    const Options &GetOptions() const { return myOptions; }
+
+    /// \brief 修复theShapes中的全部根形状(原位替换)
+    ///
+    /// \param theReports，每个部件的诊断
+    void Heal(const Handle(TopTools_HSequenceOfShape) & theShapes, std::vector<Report> &theReports) const;
+
+    /// \brief 读取theFile的缓存的修复结果，未启用缓存或没有缓存时返回false
+    bool LoadCached(const QString &theFile, const Handle(TopTools_HSequenceOfShape) & theShapes,
+                    std::vector<Report> &theReports) const;
+
+    /// \brief 保存theFile的修复结果
+    void StoreCached(const QString &theFile, const Handle(TopTools_HSequenceOfShape) & theShapes,
+                     const std::vector<Report> &theReports) const;
+
+private:
+    /// \brief 缓存文件的路径(不含扩展名)，由文件内容与修复参数的哈希决定；不缓存时为空
+    QString cacheBase(const QString &theFile) const;
+
+    Options myOptions;
+};
+
+#endif    // SHAPEHEALER_H
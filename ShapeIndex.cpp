@@ -0,0 +1,501 @@
+#include "ShapeIndex.h"
+#include "ShapeUtils.h"
+
+#include <algorithm>
+
+#include <BRepBndLib.hxx>
+#include <BRepExtrema_OverlapTool.hxx>
+#include <BRepMesh_IncrementalMesh.hxx>
+#include <BRep_Tool.hxx>
+#include <OSD_Parallel.hxx>
+#include <StdPrs_ToolTriangulatedShape.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopoDS.hxx>
+
+
+namespace
+{
+    //! AABB的半表面积，作为插入时的代价函数
+    Standard_Real halfArea(const Standard_Real theMin[3], const Standard_Real theMax[3])
+    {
+        const Standard_Real dx = theMax[0] - theMin[0];
+        const Standard_Real dy = theMax[1] - theMin[1];
+        const Standard_Real dz = theMax[2] - theMin[2];
+        return dx * dy + dy * dz + dz * dx;
+    }
+
+    Standard_Real unionArea(const Standard_Real theMinA[3], const Standard_Real theMaxA[3],
+                            const Standard_Real theMinB[3], const Standard_Real theMaxB[3])
+    {
+        Standard_Real aMin[3], aMax[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            aMin[i] = std::min(theMinA[i], theMinB[i]);
+            aMax[i] = std::max(theMaxA[i], theMaxB[i]);
+        }
+        return halfArea(aMin, aMax);
+    }
+
+    bool overlaps(const Standard_Real theMinA[3], const Standard_Real theMaxA[3],
+                  const Standard_Real theMinB[3], const Standard_Real theMaxB[3])
+    {
+        return theMinA[0] <= theMaxB[0] && theMaxA[0] >= theMinB[0]
+               && theMinA[1] <= theMaxB[1] && theMaxA[1] >= theMinB[1]
+               && theMinA[2] <= theMaxB[2] && theMaxA[2] >= theMinB[2];
+    }
+}    // namespace
+
+
+ShapeIndex::ShapeIndex()
+    : myRoot(-1)
+{
+}
+
+void ShapeIndex::Add(const Handle(AIS_Shape) & theShape)
+{
+    if (theShape.IsNull())
+        return;
+
+    if (myLeaves.IsBound(theShape))
+    {
+        Update(theShape);
+        return;
+    }
+
+    Standard_Integer anObject;
+    if (!myFreeObjects.empty())
+    {
+        anObject = myFreeObjects.back();
+        myFreeObjects.pop_back();
+    }
+    else
+    {
+        anObject = (Standard_Integer)myObjects.size();
+        myObjects.push_back(Entry());
+    }
+
+    Bnd_Box aBox;
+    BRepBndLib::Add(ShapeUtils::WorldShape(theShape), aBox);
+
+    const Standard_Integer aLeaf = allocateNode();
+    setBox(myNodes[aLeaf], aBox, 0.0);
+    myNodes[aLeaf].Object = anObject;
+
+    Entry &anEntry = myObjects[anObject];
+    anEntry.Shape  = theShape;
+    anEntry.Leaf   = aLeaf;
+    anEntry.Triangles.Nullify();
+
+    insertLeaf(aLeaf);
+    myLeaves.Bind(theShape, anObject);
+}
+
+void ShapeIndex::Remove(const Handle(AIS_Shape) & theShape)
+{
+    Standard_Integer anObject = -1;
+    if (theShape.IsNull() || !myLeaves.Find(theShape, anObject))
+        return;
+
+    Entry &anEntry = myObjects[anObject];
+    removeLeaf(anEntry.Leaf);
+    freeNode(anEntry.Leaf);
+
+    anEntry.Shape.Nullify();
+    anEntry.Triangles.Nullify();
+    anEntry.Leaf = -1;
+    myFreeObjects.push_back(anObject);
+    myLeaves.UnBind(theShape);
+}
+
+void ShapeIndex::Update(const Handle(AIS_Shape) & theShape)
+{
+    Standard_Integer anObject = -1;
+    if (theShape.IsNull() || !myLeaves.Find(theShape, anObject))
+        return;
+
+    Entry &anEntry = myObjects[anObject];
+    anEntry.Triangles.Nullify();
+
+    Bnd_Box aBox;
+    BRepBndLib::Add(ShapeUtils::WorldShape(theShape), aBox);
+
+    removeLeaf(anEntry.Leaf);
+    setBox(myNodes[anEntry.Leaf], aBox, 0.0);
+    insertLeaf(anEntry.Leaf);
+}
+
+void ShapeIndex::Clear()
+{
+    myNodes.clear();
+    myFreeNodes.clear();
+    myObjects.clear();
+    myFreeObjects.clear();
+    myLeaves.Clear();
+    myRoot = -1;
+}
+
+void ShapeIndex::Query(const Bnd_Box &theBox, std::vector<Handle(AIS_Shape)> &theResult) const
+{
+    if (theBox.IsVoid() || myRoot < 0)
+        return;
+
+    Standard_Real aMin[3], aMax[3];
+    theBox.Get(aMin[0], aMin[1], aMin[2], aMax[0], aMax[1], aMax[2]);
+
+    std::vector<Standard_Integer> anObjects;
+    queryNode(aMin, aMax, anObjects);
+    for (size_t i = 0; i < anObjects.size(); ++i)
+        theResult.push_back(myObjects[anObjects[i]].Shape);
+}
+
+std::vector<Handle(AIS_Shape)> ShapeIndex::Proximity(const Handle(AIS_Shape) & theShape,
+                                                     const Standard_Real theDistance)
+{
+    std::vector<Handle(AIS_Shape)> aResult;
+
+    Standard_Integer anObject = -1;
+    if (theShape.IsNull() || !myLeaves.Find(theShape, anObject))
+        return aResult;
+
+    const Node &aLeaf = myNodes[myObjects[anObject].Leaf];
+    Standard_Real aMin[3], aMax[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        aMin[i] = aLeaf.Min[i] - theDistance;
+        aMax[i] = aLeaf.Max[i] + theDistance;
+    }
+
+    std::vector<Standard_Integer> aCandidates;
+    queryNode(aMin, aMax, aCandidates);
+
+    std::vector<std::pair<Standard_Integer, Standard_Integer>> aPairs;
+    for (size_t i = 0; i < aCandidates.size(); ++i)
+    {
+        if (aCandidates[i] != anObject)
+            aPairs.push_back(std::make_pair(anObject, aCandidates[i]));
+    }
+
+    std::vector<ClashPair> aClashes = narrowPhase(aPairs, theDistance);
+    for (size_t i = 0; i < aClashes.size(); ++i)
+        aResult.push_back(aClashes[i].Second);
+    return aResult;
+}
+
+std::vector<ShapeIndex::ClashPair> ShapeIndex::Clashes(const Standard_Real theTolerance)
+{
+    // 粗筛：每个叶节点在树中查询一次，只保留(i < j)的候选对
+    std::vector<std::pair<Standard_Integer, Standard_Integer>> aPairs;
+    std::vector<Standard_Integer>                              aCandidates;
+    for (size_t anObject = 0; anObject < myObjects.size(); ++anObject)
+    {
+        if (myObjects[anObject].Leaf < 0)
+            continue;
+
+        const Node &  aLeaf = myNodes[myObjects[anObject].Leaf];
+        Standard_Real aMin[3], aMax[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            aMin[i] = aLeaf.Min[i] - theTolerance;
+            aMax[i] = aLeaf.Max[i] + theTolerance;
+        }
+
+        aCandidates.clear();
+        queryNode(aMin, aMax, aCandidates);
+        for (size_t i = 0; i < aCandidates.size(); ++i)
+        {
+            if (aCandidates[i] > (Standard_Integer)anObject)
+                aPairs.push_back(std::make_pair((Standard_Integer)anObject, aCandidates[i]));
+        }
+    }
+
+    return narrowPhase(aPairs, theTolerance);
+}
+
+// =======================================================================
+// function : narrowPhase
+// purpose  : 三角形级别的检测，各候选对之间相互独立，可以直接并行
+// =======================================================================
+std::vector<ShapeIndex::ClashPair> ShapeIndex::narrowPhase(
+    const std::vector<std::pair<Standard_Integer, Standard_Integer>> &thePairs,
+    const Standard_Real theTolerance)
+{
+    std::vector<ClashPair> aResult;
+    if (thePairs.empty())
+        return aResult;
+
+    std::vector<Standard_Integer> anInvolved;
+    for (size_t i = 0; i < thePairs.size(); ++i)
+    {
+        anInvolved.push_back(thePairs[i].first);
+        anInvolved.push_back(thePairs[i].second);
+    }
+    std::sort(anInvolved.begin(), anInvolved.end());
+    anInvolved.erase(std::unique(anInvolved.begin(), anInvolved.end()), anInvolved.end());
+    prepareTriangles(anInvolved);
+
+    std::vector<Standard_Integer> aNbFaces1(thePairs.size(), 0);
+    std::vector<Standard_Integer> aNbFaces2(thePairs.size(), 0);
+    const std::vector<Entry> &    anObjects = myObjects;
+
+    OSD_Parallel::For(0, (Standard_Integer)thePairs.size(), [&](const Standard_Integer theIndex) {
+        const Entry &anEntry1 = anObjects[thePairs[theIndex].first];
+        const Entry &anEntry2 = anObjects[thePairs[theIndex].second];
+        if (anEntry1.Triangles.IsNull() || anEntry2.Triangles.IsNull())
+            return;
+
+        BRepExtrema_OverlapTool aTool(anEntry1.Triangles, anEntry2.Triangles);
+        aTool.Perform(theTolerance);
+        if (aTool.IsDone())
+        {
+            aNbFaces1[theIndex] = aTool.OverlapSubShapes1().Extent();
+            aNbFaces2[theIndex] = aTool.OverlapSubShapes2().Extent();
+        }
+    });
+
+    for (size_t i = 0; i < thePairs.size(); ++i)
+    {
+        if (aNbFaces1[i] == 0 && aNbFaces2[i] == 0)
+            continue;
+
+        ClashPair aPair;
+        aPair.First    = myObjects[thePairs[i].first].Shape;
+        aPair.Second   = myObjects[thePairs[i].second].Shape;
+        aPair.NbFaces1 = aNbFaces1[i];
+        aPair.NbFaces2 = aNbFaces2[i];
+        aResult.push_back(aPair);
+    }
+    return aResult;
+}
+
+void ShapeIndex::prepareTriangles(const std::vector<Standard_Integer> &theObjects)
+{
+    std::vector<Standard_Integer> aMissing;
+    for (size_t i = 0; i < theObjects.size(); ++i)
+    {
+        if (myObjects[theObjects[i]].Triangles.IsNull())
+            aMissing.push_back(theObjects[i]);
+    }
+    if (aMissing.empty())
+        return;
+
+    // 没有三角网格的形状先串行剖分(BRepMesh内部已经并行)，
+    // 避免多个对象共享同一个TShape时并发写三角网格
+    for (size_t i = 0; i < aMissing.size(); ++i)
+    {
+        const Handle(AIS_Shape) & aShape = myObjects[aMissing[i]].Shape;
+        for (TopExp_Explorer anExp(aShape->Shape(), TopAbs_FACE); anExp.More(); anExp.Next())
+        {
+            TopLoc_Location aLoc;
+            if (BRep_Tool::Triangulation(TopoDS::Face(anExp.Current()), aLoc).IsNull())
+            {
+                const Standard_Real aDeflection =
+                    StdPrs_ToolTriangulatedShape::GetDeflection(aShape->Shape(), aShape->Attributes());
+                BRepMesh_IncrementalMesh(aShape->Shape(), aDeflection, Standard_False,
+                                         aShape->Attributes()->DeviationAngle(), Standard_True);
+                break;
+            }
+        }
+    }
+
+    std::vector<Entry> &anObjects = myObjects;
+    OSD_Parallel::For(0, (Standard_Integer)aMissing.size(), [&](const Standard_Integer theIndex) {
+        Entry &anEntry = anObjects[aMissing[theIndex]];
+
+        BRepExtrema_ShapeList aFaces;
+        for (TopExp_Explorer anExp(ShapeUtils::WorldShape(anEntry.Shape), TopAbs_FACE); anExp.More(); anExp.Next())
+            aFaces.Append(TopoDS::Face(anExp.Current()));
+
+        Handle(BRepExtrema_TriangleSet) aSet = new BRepExtrema_TriangleSet(aFaces);
+        // BVH是惰性构建的，并非线程安全，这里提前在各自线程中构建好
+        aSet->BVH();
+        anEntry.Triangles = aSet;
+    });
+}
+
+// =======================================================================
+// 动态AABB树
+// =======================================================================
+Standard_Integer ShapeIndex::allocateNode()
+{
+    Standard_Integer aNode;
+    if (!myFreeNodes.empty())
+    {
+        aNode = myFreeNodes.back();
+        myFreeNodes.pop_back();
+    }
+    else
+    {
+        aNode = (Standard_Integer)myNodes.size();
+        myNodes.push_back(Node());
+    }
+
+    Node &n  = myNodes[aNode];
+    n.Parent = -1;
+    n.Child1 = -1;
+    n.Child2 = -1;
+    n.Object = -1;
+    return aNode;
+}
+
+void ShapeIndex::freeNode(Standard_Integer theNode)
+{
+    myFreeNodes.push_back(theNode);
+}
+
+void ShapeIndex::setBox(Node &theNode, const Bnd_Box &theBox, const Standard_Real theMargin) const
+{
+    if (theBox.IsVoid())
+    {
+        for (int i = 0; i < 3; ++i)
+            theNode.Min[i] = theNode.Max[i] = 0.0;
+        return;
+    }
+
+    theBox.Get(theNode.Min[0], theNode.Min[1], theNode.Min[2],
+               theNode.Max[0], theNode.Max[1], theNode.Max[2]);
+    for (int i = 0; i < 3; ++i)
+    {
+        theNode.Min[i] -= theMargin;
+        theNode.Max[i] += theMargin;
+    }
+}
+
+void ShapeIndex::refit(Standard_Integer theNode)
+{
+    while (theNode >= 0)
+    {
+        Node &      n  = myNodes[theNode];
+        const Node &c1 = myNodes[n.Child1];
+        const Node &c2 = myNodes[n.Child2];
+        for (int i = 0; i < 3; ++i)
+        {
+            n.Min[i] = std::min(c1.Min[i], c2.Min[i]);
+            n.Max[i] = std::max(c1.Max[i], c2.Max[i]);
+        }
+        theNode = n.Parent;
+    }
+}
+
+// 按表面积启发式(SAH)寻找代价最小的兄弟节点后插入
+void ShapeIndex::insertLeaf(Standard_Integer theLeaf)
+{
+    if (myRoot < 0)
+    {
+        myRoot                  = theLeaf;
+        myNodes[theLeaf].Parent = -1;
+        return;
+    }
+
+    const Standard_Real *aMin = myNodes[theLeaf].Min;
+    const Standard_Real *aMax = myNodes[theLeaf].Max;
+
+    Standard_Integer anIndex = myRoot;
+    while (!myNodes[anIndex].IsLeaf())
+    {
+        const Node &        n           = myNodes[anIndex];
+        const Standard_Real anArea      = halfArea(n.Min, n.Max);
+        const Standard_Real aCombined   = unionArea(n.Min, n.Max, aMin, aMax);
+        const Standard_Real aCost       = 2.0 * aCombined;
+        const Standard_Real anInherited = 2.0 * (aCombined - anArea);
+
+        Standard_Real aChildCost[2];
+        const Standard_Integer aChildren[2] = {n.Child1, n.Child2};
+        for (int i = 0; i < 2; ++i)
+        {
+            const Node &c = myNodes[aChildren[i]];
+            aChildCost[i] = unionArea(c.Min, c.Max, aMin, aMax) + anInherited;
+            if (!c.IsLeaf())
+                aChildCost[i] -= halfArea(c.Min, c.Max);
+        }
+
+        if (aCost < aChildCost[0] && aCost < aChildCost[1])
+            break;
+
+        anIndex = aChildCost[0] < aChildCost[1] ? aChildren[0] : aChildren[1];
+    }
+
+    const Standard_Integer aSibling    = anIndex;
+    const Standard_Integer anOldParent = myNodes[aSibling].Parent;
+    const Standard_Integer aNewParent  = allocateNode();
+
+    myNodes[aNewParent].Parent = anOldParent;
+    myNodes[aNewParent].Child1 = aSibling;
+    myNodes[aNewParent].Child2 = theLeaf;
+    myNodes[aSibling].Parent   = aNewParent;
+    myNodes[theLeaf].Parent    = aNewParent;
+
+    if (anOldParent < 0)
+    {
+        myRoot = aNewParent;
+    }
+    else if (myNodes[anOldParent].Child1 == aSibling)
+    {
+        myNodes[anOldParent].Child1 = aNewParent;
+    }
+    else
+    {
+        myNodes[anOldParent].Child2 = aNewParent;
+    }
+
+    refit(aNewParent);
+}
+
+void ShapeIndex::removeLeaf(Standard_Integer theLeaf)
+{
+    if (theLeaf == myRoot)
+    {
+        myRoot = -1;
+        return;
+    }
+
+    const Standard_Integer aParent      = myNodes[theLeaf].Parent;
+    const Standard_Integer aGrandParent = myNodes[aParent].Parent;
+    const Standard_Integer aSibling =
+        myNodes[aParent].Child1 == theLeaf ? myNodes[aParent].Child2 : myNodes[aParent].Child1;
+
+    if (aGrandParent < 0)
+    {
+        myRoot                   = aSibling;
+        myNodes[aSibling].Parent = -1;
+    }
+    else
+    {
+        if (myNodes[aGrandParent].Child1 == aParent)
+            myNodes[aGrandParent].Child1 = aSibling;
+        else
+            myNodes[aGrandParent].Child2 = aSibling;
+        myNodes[aSibling].Parent = aGrandParent;
+        refit(aGrandParent);
+    }
+
+    freeNode(aParent);
+    myNodes[theLeaf].Parent = -1;
+}
+
+void ShapeIndex::queryNode(const Standard_Real theMin[3], const Standard_Real theMax[3],
+                           std::vector<Standard_Integer> &theObjects) const
+{
+    if (myRoot < 0)
+        return;
+
+    std::vector<Standard_Integer> aStack;
+    aStack.push_back(myRoot);
+    while (!aStack.empty())
+    {
+        const Node &n = myNodes[aStack.back()];
+        aStack.pop_back();
+
+        if (!overlaps(n.Min, n.Max, theMin, theMax))
+            continue;
+
+        if (n.IsLeaf())
+        {
+            theObjects.push_back(n.Object);
+        }
+        else
+        {
+            aStack.push_back(n.Child1);
+            aStack.push_back(n.Child2);
+        }
+    }
+}
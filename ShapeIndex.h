@@ -0,0 +1,106 @@
+#ifndef SHAPEINDEX_H
+#define SHAPEINDEX_H
+
+#include <vector>
+
+#include <AIS_Shape.hxx>
+#include <BRepExtrema_TriangleSet.hxx>
+#include <Bnd_Box.hxx>
+#include <NCollection_DataMap.hxx>
+#include <TColStd_MapTransientHasher.hxx>
+
+/// \brief ShapeIndex
+///
+/// 已显示AIS_Shape的空间索引，用于近邻查询("距离该零件X mm以内的零件")以及干涉检查。
+///
+/// 粗筛(broad phase)采用动态AABB树(BVH)，显示/删除对象时增量插入、移除叶节点，
+/// 不需要重建整棵树；细筛(narrow phase)基于三角网格(BRepExtrema_OverlapTool)，
+/// 对候选对并行(OSD_Parallel)检测三角形之间是否在容差范围内相交。
+class ShapeIndex
+{
+public:
+    /// \brief 一对相互干涉(或在给定距离内)的对象
+    struct ClashPair
+    {
+        Handle(AIS_Shape) First;
+        Handle(AIS_Shape) Second;
+        Standard_Integer  NbFaces1;    ///< First中参与干涉的面数目
+        Standard_Integer  NbFaces2;    ///< Second中参与干涉的面数目
+    };
+
+    ShapeIndex();
+
+    /// \brief 加入一个已显示的对象，若已经存在则更新其包围盒
+    void Add(const Handle(AIS_Shape) & theShape);
+
+    /// \brief 从索引中移除对象，不存在时直接返回
+    void Remove(const Handle(AIS_Shape) & theShape);
+
+    /// \brief 对象几何或位置改变后调用，重新计算包围盒，并丢弃缓存的三角形集合
+    void Update(const Handle(AIS_Shape) & theShape);
+
+    void Clear();
+
+    Standard_Boolean Contains(const Handle(AIS_Shape) & theShape) const { return myLeaves.IsBound(theShape); }
+    Standard_Integer Size() const { return myLeaves.Extent(); }
+
+    /// \brief 粗筛：返回包围盒与theBox相交的全部对象
+    void Query(const Bnd_Box &theBox, std::vector<Handle(AIS_Shape)> &theResult) const;
+
+    /// \brief 返回与theShape距离小于theDistance(mm)的全部对象(不含theShape本身)
+    std::vector<Handle(AIS_Shape)> Proximity(const Handle(AIS_Shape) & theShape,
+                                             const Standard_Real theDistance);
+
+    /// \brief 干涉检查：返回所有在theTolerance内重叠的对象对
+    ///
+    /// \param theTolerance，容差(mm)，0表示只检查真正相交的三角形
+    std::vector<ClashPair> Clashes(const Standard_Real theTolerance);
+
+private:
+    struct Node
+    {
+        Standard_Real    Min[3];
+        Standard_Real    Max[3];
+        Standard_Integer Parent;
+        Standard_Integer Child1;    ///< 叶节点时为-1
+        Standard_Integer Child2;
+        Standard_Integer Object;    ///< 叶节点对应的myObjects下标
+
+        bool IsLeaf() const { return Child1 < 0; }
+    };
+
+    struct Entry
+    {
+        Handle(AIS_Shape)              Shape;
+        Handle(BRepExtrema_TriangleSet) Triangles;    ///< 细筛用的三角形集合，按需构建
+        Standard_Integer               Leaf;
+    };
+
+    Standard_Integer allocateNode();
+    void             freeNode(Standard_Integer theNode);
+    void             insertLeaf(Standard_Integer theLeaf);
+    void             removeLeaf(Standard_Integer theLeaf);
+    void             refit(Standard_Integer theNode);
+    void             setBox(Node &theNode, const Bnd_Box &theBox, const Standard_Real theMargin) const;
+
+    void queryNode(const Standard_Real theMin[3], const Standard_Real theMax[3],
+                   std::vector<Standard_Integer> &theObjects) const;
+
+    /// \brief 并行构建theObjects中尚未构建的三角形集合
+    void prepareTriangles(const std::vector<Standard_Integer> &theObjects);
+
+    /// \brief 对候选对象对并行执行三角形级别的重叠检测
+    std::vector<ClashPair> narrowPhase(const std::vector<std::pair<Standard_Integer, Standard_Integer>> &thePairs,
+                                       const Standard_Real theTolerance);
+
+private:
+    std::vector<Node>             myNodes;
+    std::vector<Standard_Integer> myFreeNodes;
+    std::vector<Entry>            myObjects;
+    std::vector<Standard_Integer> myFreeObjects;
+    Standard_Integer              myRoot;
+
+    NCollection_DataMap<Handle(AIS_Shape), Standard_Integer, TColStd_MapTransientHasher> myLeaves;
+};
+
+#endif    // SHAPEINDEX_H
@@ -0,0 +1,66 @@
+#include "ShapeLoader.h"
+
+#include "Gglobal.h"
+
+#include <QElapsedTimer>
+
+#include <IFSelect_ReturnStatus.hxx>
+#include <STEPControl_Reader.hxx>
+
+
+bool ShapeLoader::ReadStep(const TCollection_AsciiString &theFile,
+                           const Handle(TopTools_HSequenceOfShape) & theShapes,
+                           const ShapeHealer *                       theHealer,
+                           std::vector<ShapeHealer::Report> *        theReports,
+                           bool *                                    isCached)
+{
+    if (isCached != NULL)
+        *isCached = false;
+
+    const QString                    aFile = QString::fromUtf8(theFile.ToCString());
+    std::vector<ShapeHealer::Report> aReports;
+    if (theHealer != NULL && theHealer->LoadCached(aFile, theShapes, aReports))
+    {
+        LOG_INFO("ShapeLoader", "heal cache hit: " << theFile.ToCString());
+        if (isCached != NULL)
+            *isCached = true;
+        if (theReports != NULL)
+            theReports->insert(theReports->end(), aReports.begin(), aReports.end());
+        return true;
+    }
+
+    STEPControl_Reader    aReader;
+    IFSelect_ReturnStatus aStatus = aReader.ReadFile(theFile.ToCString());
+    if (aStatus != IFSelect_RetDone)
+    {
+        dbgFunTrace("STEP文件读取失败: " << theFile.ToCString());
+        return false;
+    }
+
+    // 转换全部根对象，每个根对象对应一个形状
+    const Standard_Integer            aNbRoots = aReader.TransferRoots();
+    Handle(TopTools_HSequenceOfShape) aShapes  = new TopTools_HSequenceOfShape();
+    for (Standard_Integer i = 1; i <= aReader.NbShapes(); i++)
+        aShapes->Append(aReader.Shape(i));
+
+    if (theHealer != NULL && aNbRoots > 0)
+    {
+        QElapsedTimer aTimer;
+        aTimer.start();
+        theHealer->Heal(aShapes, aReports);
+        LOG_INFO("ShapeLoader", "healed " << aReports.size() << " parts in " << aTimer.elapsed() << " ms: "
+                                          << theFile.ToCString());
+        for (size_t i = 0; i < aReports.size(); ++i)
+        {
+            if (!aReports[i].IsValidAfter)
+                LOG_WARN("ShapeLoader", aReports[i].ToString().toStdString());
+        }
+
+        theHealer->StoreCached(aFile, aShapes, aReports);
+        if (theReports != NULL)
+            theReports->insert(theReports->end(), aReports.begin(), aReports.end());
+    }
+
+    theShapes->Append(aShapes);
+    return aNbRoots > 0;
+}
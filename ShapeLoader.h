@@ -0,0 +1,33 @@
+#ifndef SHAPELOADER_H
+#define SHAPELOADER_H
+
+#include <vector>
+
+#include <TCollection_AsciiString.hxx>
+#include <TopTools_HSequenceOfShape.hxx>
+
+#include "ShapeHealer.h"
+
+/// \brief ShapeLoader
+///
+/// 几何文件导入的统一入口，目前支持STEP。
+/// 界面、测试、benchmark都通过这里导入，便于在导入后追加统一的处理步骤。
+class ShapeLoader
+{
+public:
+    /// \brief 读取STEP文件
+    ///
+    /// \param theFile，STEP文件路径(UTF-8)
+    /// \param theShapes，读取到的根形状依次追加到该序列中
+    /// \param theHealer，不为空时修复读取到的形状；启用了缓存时优先读取缓存
+    /// \param theReports，不为空时追加各部件的修复诊断
+    /// \param isCached，不为空时返回是否命中了修复缓存
+    /// \return 文件读取并转换成功时返回true
+    static bool ReadStep(const TCollection_AsciiString &theFile,
+                         const Handle(TopTools_HSequenceOfShape) & theShapes,
+                         const ShapeHealer *                       theHealer  = NULL,
+                         std::vector<ShapeHealer::Report> *        theReports = NULL,
+                         bool *                                    isCached   = NULL);
+};
+
+#endif    // SHAPELOADER_H
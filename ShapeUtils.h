@@ -0,0 +1,24 @@
+#ifndef SHAPEUTILS_H
+#define SHAPEUTILS_H
+
+#include <AIS_Shape.hxx>
+#include <TopLoc_Location.hxx>
+#include <TopoDS_Shape.hxx>
+
+/// \brief ShapeUtils
+///
+/// 各模块共用的形状辅助函数。
+class ShapeUtils
+{
+public:
+    /// \brief 对象在世界坐标系下的形状(考虑AIS对象自身的变换)
+    static TopoDS_Shape WorldShape(const Handle(AIS_Shape) & theShape)
+    {
+        if (!theShape->HasTransformation())
+            return theShape->Shape();
+
+        return theShape->Shape().Moved(TopLoc_Location(theShape->LocalTransformation()));
+    }
+};
+
+#endif // SHAPEUTILS_H
@@ -0,0 +1,62 @@
+#include "StartupTrace.h"
+#include "Gglobal.h"
+
+#include <algorithm>
+
+std::mutex                       StartupTrace::ourMutex;
+QElapsedTimer                    StartupTrace::ourClock;
+std::vector<StartupTrace::Stage> StartupTrace::ourStages;
+double                           StartupTrace::ourFirstFrameMs = -1.0;
+
+void StartupTrace::Start()
+{
+    std::lock_guard<std::mutex> aLock(ourMutex);
+    ourStages.clear();
+    ourFirstFrameMs = -1.0;
+    ourClock.start();
+}
+
+void StartupTrace::Mark(const char *theStage)
+{
+    std::lock_guard<std::mutex> aLock(ourMutex);
+    if (!ourClock.isValid() || ourFirstFrameMs >= 0.0)
+        return;
+
+    Stage aStage;
+    aStage.Name = theStage;
+    aStage.Ms   = ourClock.nsecsElapsed() / 1.0e6;
+    ourStages.push_back(aStage);
+}
+
+void StartupTrace::FirstFrame()
+{
+    std::vector<Stage> aStages;
+    {
+        std::lock_guard<std::mutex> aLock(ourMutex);
+        if (!ourClock.isValid() || ourFirstFrameMs >= 0.0)
+            return;
+
+        ourFirstFrameMs = ourClock.nsecsElapsed() / 1.0e6;
+        aStages         = ourStages;
+    }
+
+    // 阶段可能来自不同线程，耗时按完成时间排序后相邻相减
+    std::sort(aStages.begin(), aStages.end(), [](const Stage &a, const Stage &b) { return a.Ms < b.Ms; });
+    double aPrev = 0.0;
+    for (size_t i = 0; i < aStages.size(); ++i)
+    {
+        LOG_INFO("Startup", aStages[i].Name << ": " << aStages[i].Ms << " ms (+" << aStages[i].Ms - aPrev << ")");
+        aPrev = aStages[i].Ms;
+    }
+
+    if (ourFirstFrameMs > THE_TARGET_MS)
+        LOG_WARN("Startup", "first frame: " << ourFirstFrameMs << " ms, target " << THE_TARGET_MS << " ms");
+    else
+        LOG_INFO("Startup", "first frame: " << ourFirstFrameMs << " ms");
+}
+
+double StartupTrace::FirstFrameMs()
+{
+    std::lock_guard<std::mutex> aLock(ourMutex);
+    return ourFirstFrameMs;
+}
@@ -0,0 +1,44 @@
+#ifndef STARTUPTRACE_H
+#define STARTUPTRACE_H
+
+#include <mutex>
+#include <vector>
+
+#include <QElapsedTimer>
+
+/// \brief StartupTrace
+///
+/// 启动过程的时间线。main()开始时调用Start，各阶段调用Mark记录相对时间(可以在任意线程调用)，
+/// 主视图绘制完第一帧时调用FirstFrame，整条时间线与各阶段耗时写入日志(分类"Startup")。
+/// 首帧时间超过目标(THE_TARGET_MS)时以WARN级别输出。
+class StartupTrace
+{
+public:
+    //! 首帧时间目标(毫秒)
+    static const int THE_TARGET_MS = 300;
+
+    static void Start();
+
+    /// \brief 记录阶段theStage的完成时间，theStage必须是字符串常量
+    static void Mark(const char *theStage);
+
+    /// \brief 第一帧绘制完成，只有第一次调用有效
+    static void FirstFrame();
+
+    /// \brief 自Start起到第一帧的时间(毫秒)，尚未绘制第一帧时为-1
+    static double FirstFrameMs();
+
+private:
+    struct Stage
+    {
+        const char *Name;
+        double      Ms;
+    };
+
+    static std::mutex         ourMutex;
+    static QElapsedTimer      ourClock;
+    static std::vector<Stage> ourStages;
+    static double             ourFirstFrameMs;
+};
+
+#endif    // STARTUPTRACE_H
@@ -0,0 +1,309 @@
+#include "StepExporter.h"
+
+#include "Gglobal.h"
+#include "MaterialLibrary.h"
+
+#include <fstream>
+#include <mutex>
+
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QRunnable>
+
+#include <AIS_Shape.hxx>
+#include <Graphic3d_MaterialAspect.hxx>
+#include <OSD_OpenStream.hxx>
+#include <STEPCAFControl_Controller.hxx>
+#include <STEPCAFControl_Writer.hxx>
+#include <StepData_Protocol.hxx>
+#include <StepData_StepModel.hxx>
+#include <StepData_StepWriter.hxx>
+#include <TCollection_HAsciiString.hxx>
+#include <TDataStd_Name.hxx>
+#include <TDocStd_Document.hxx>
+#include <XCAFApp_Application.hxx>
+#include <XCAFDoc_ColorTool.hxx>
+#include <XCAFDoc_DocumentTool.hxx>
+#include <XCAFDoc_MaterialTool.hxx>
+#include <XCAFDoc_ShapeTool.hxx>
+#include <XSControl_WorkSession.hxx>
+
+#include <zlib.h>
+
+
+namespace
+{
+    //! XCAFApp_Application是全局单例，创建/关闭文档需要串行
+    std::mutex documentMutex;
+
+    //! STEP转换过程会读写Interface_Static中的全局参数，这里串行执行；
+    //! 序列化和写文件(耗时的主要部分)在各线程中并发进行
+    std::mutex transferMutex;
+
+    //! 直接写出gzip文件的streambuf，不产生未压缩的中间文件
+    class GzipStreamBuf : public std::streambuf
+    {
+    public:
+        explicit GzipStreamBuf(const char *theFile)
+            : myFile(gzopen(theFile, "wb6"))
+            , myTotal(0)
+        {
+            if (myFile != NULL)
+                gzbuffer(myFile, 1 << 18);
+            setp(myBuffer, myBuffer + sizeof(myBuffer));
+        }
+
+        ~GzipStreamBuf() { Close(); }
+
+        bool   IsOpen() const { return myFile != NULL; }
+        qint64 Total() const { return myTotal; }
+
+        bool Close()
+        {
+            if (myFile == NULL)
+                return false;
+
+            const bool isOk     = flushBuffer() >= 0;
+            const bool isClosed = gzclose(myFile) == Z_OK;
+            myFile              = NULL;
+            return isOk && isClosed;
+        }
+
+    protected:
+        virtual int_type overflow(int_type theChar) override
+        {
+            if (flushBuffer() < 0)
+                return traits_type::eof();
+
+            if (!traits_type::eq_int_type(theChar, traits_type::eof()))
+            {
+                *pptr() = traits_type::to_char_type(theChar);
+                pbump(1);
+            }
+            return traits_type::not_eof(theChar);
+        }
+
+        virtual int sync() override { return flushBuffer() < 0 ? -1 : 0; }
+
+    private:
+        int flushBuffer()
+        {
+            const int aSize = int(pptr() - pbase());
+            if (aSize > 0 && (myFile == NULL || gzwrite(myFile, pbase(), (unsigned)aSize) != aSize))
+                return -1;
+
+            myTotal += aSize;
+            pbump(-aSize);
+            return aSize;
+        }
+
+        gzFile myFile;
+        qint64 myTotal;
+        char   myBuffer[1 << 16];
+    };
+
+    class ExportTask : public QRunnable
+    {
+    public:
+        ExportTask(StepExporter *theExporter, const StepExporter::Document &theDocument)
+            : myExporter(theExporter)
+            , myDocument(theDocument)
+        {
+        }
+
+        virtual void run() override
+        {
+            const StepExporter::Report aReport = StepExporter::Write(myDocument);
+            QMetaObject::invokeMethod(myExporter, "documentExported", Qt::QueuedConnection,
+                                      Q_ARG(QString, aReport.File),
+                                      Q_ARG(bool, aReport.IsOk),
+                                      Q_ARG(qint64, aReport.Bytes),
+                                      Q_ARG(double, aReport.Throughput()));
+        }
+
+    private:
+        StepExporter *         myExporter;
+        StepExporter::Document myDocument;
+    };
+}    // namespace
+
+
+StepExporter::StepExporter(QObject *parent)
+    : QObject(parent)
+{
+    // 静态初始化放在GUI线程中完成，避免工作线程中首次初始化时竞争
+    STEPCAFControl_Controller::Init();
+}
+
+StepExporter::~StepExporter()
+{
+    myPool.waitForDone();
+}
+
+StepExporter::Document StepExporter::Collect(const Handle(AIS_InteractiveContext) & theContext,
+                                             const MaterialLibrary &theMaterials,
+                                             const QString &        theFile)
+{
+    Document aDoc;
+    aDoc.File = theFile;
+
+    // 被删除的对象已经从视图中擦除，只导出当前显示的对象
+    AIS_ListOfInteractive aList;
+    theContext->DisplayedObjects(aList);
+    for (AIS_ListOfInteractive::Iterator anIter(aList); anIter.More(); anIter.Next())
+    {
+        Handle(AIS_Shape) aShape = Handle(AIS_Shape)::DownCast(anIter.Value());
+        if (aShape.IsNull())
+            continue;
+
+        Part aPart;
+        aPart.Shape = aShape->Shape();
+        if (aShape->HasTransformation())
+            aPart.Shape.Move(TopLoc_Location(aShape->LocalTransformation()));
+        aPart.Name     = QString("Part_%1").arg(aDoc.Parts.size() + 1);
+        aPart.HasColor = aShape->HasColor();
+        if (aPart.HasColor)
+            aShape->Color(aPart.Color);
+
+        const QString aMatName = theMaterials.Assigned(aShape);
+        if (!aMatName.isEmpty() && theMaterials.Contains(aMatName))
+        {
+            const MaterialLibrary::Material aMat = theMaterials.Value(aMatName);
+            aPart.Material    = aMatName;
+            aPart.Description = QString("Absorptivity=%1;Reflectivity=%2;Refractivity=%3;Transmissivity=%4")
+                                    .arg(aMat.Absorptivity)
+                                    .arg(aMat.Reflectivity)
+                                    .arg(aMat.Refractivity)
+                                    .arg(aMat.Transmissivity);
+            if (!aPart.HasColor)
+            {
+                aPart.Color    = aMat.Color();
+                aPart.HasColor = true;
+            }
+        }
+        else if (aShape->HasMaterial())
+        {
+            aPart.Material = QString::fromLatin1(Graphic3d_MaterialAspect(aShape->Material()).StringName());
+        }
+
+        aDoc.Parts.append(aPart);
+    }
+    return aDoc;
+}
+
+void StepExporter::Export(const QList<Document> &theDocuments)
+{
+    foreach (const Document &aDoc, theDocuments)
+        myPool.start(new ExportTask(this, aDoc));
+}
+
+void StepExporter::waitForDone()
+{
+    myPool.waitForDone();
+}
+
+StepExporter::Report StepExporter::Write(const Document &theDocument)
+{
+    Report aReport;
+    aReport.File       = theDocument.File;
+    aReport.IsOk       = false;
+    aReport.Bytes      = 0;
+    aReport.FileBytes  = 0;
+    aReport.TransferMs = 0.0;
+    aReport.WriteMs    = 0.0;
+
+    Handle(XCAFApp_Application) anApp = XCAFApp_Application::GetApplication();
+    Handle(TDocStd_Document) aDoc;
+    {
+        std::lock_guard<std::mutex> aLock(documentMutex);
+        anApp->NewDocument("MDTV-XCAF", aDoc);
+    }
+
+    QElapsedTimer aTimer;
+    aTimer.start();
+
+    Handle(XCAFDoc_ShapeTool)    aShapeTool = XCAFDoc_DocumentTool::ShapeTool(aDoc->Main());
+    Handle(XCAFDoc_ColorTool)    aColorTool = XCAFDoc_DocumentTool::ColorTool(aDoc->Main());
+    Handle(XCAFDoc_MaterialTool) aMatTool   = XCAFDoc_DocumentTool::MaterialTool(aDoc->Main());
+    QMap<QString, TDF_Label>     aMatLabels;
+
+    foreach (const Part &aPart, theDocument.Parts)
+    {
+        const TDF_Label aLabel = aShapeTool->AddShape(aPart.Shape, Standard_False);
+        TDataStd_Name::Set(aLabel, TCollection_ExtendedString(aPart.Name.toUtf8().data(), Standard_True));
+
+        if (aPart.HasColor)
+            aColorTool->SetColor(aLabel, aPart.Color, XCAFDoc_ColorGen);
+
+        if (!aPart.Material.isEmpty())
+        {
+            if (!aMatLabels.contains(aPart.Material))
+            {
+                aMatLabels[aPart.Material] = aMatTool->AddMaterial(
+                    new TCollection_HAsciiString(aPart.Material.toUtf8().data()),
+                    new TCollection_HAsciiString(aPart.Description.toUtf8().data()),
+                    0.0,
+                    new TCollection_HAsciiString("density"),
+                    new TCollection_HAsciiString("POSITIVE_RATIO_MEASURE"));
+            }
+            aMatTool->SetMaterial(aLabel, aMatLabels[aPart.Material]);
+        }
+    }
+
+    STEPCAFControl_Writer aWriter;
+    aWriter.SetColorMode(Standard_True);
+    aWriter.SetNameMode(Standard_True);
+    aWriter.SetMaterialMode(Standard_True);
+    {
+        std::lock_guard<std::mutex> aLock(transferMutex);
+        aReport.IsOk = aWriter.Transfer(aDoc, STEPControl_AsIs) == Standard_True;
+    }
+    aReport.TransferMs = aTimer.nsecsElapsed() / 1.0e6;
+
+    if (aReport.IsOk)
+    {
+        aTimer.restart();
+
+        Handle(XSControl_WorkSession) aWS    = aWriter.ChangeWriter().WS();
+        Handle(StepData_StepModel)    aModel = Handle(StepData_StepModel)::DownCast(aWS->Model());
+        Handle(StepData_Protocol)     aProto = Handle(StepData_Protocol)::DownCast(aWS->Protocol());
+
+        StepData_StepWriter aStepWriter(aModel);
+        aStepWriter.SendModel(aProto);
+
+        const QByteArray aPath = theDocument.File.toUtf8();
+        if (theDocument.File.endsWith(".gz", Qt::CaseInsensitive))
+        {
+            GzipStreamBuf aBuf(aPath.constData());
+            std::ostream  aStream(&aBuf);
+            aReport.IsOk  = aBuf.IsOpen() && aStepWriter.Print(aStream);
+            aReport.IsOk  = aBuf.Close() && aReport.IsOk;
+            aReport.Bytes = aBuf.Total();
+        }
+        else
+        {
+            std::ofstream aStream;
+            OSD_OpenStream(aStream, aPath.constData(), std::ios::out | std::ios::binary);
+            aReport.IsOk = aStream.is_open() && aStepWriter.Print(aStream) && aStream.good();
+
+            // 打开或写入失败时tellp返回-1，不能当作文件大小
+            const std::streamoff aPos = aReport.IsOk ? static_cast<std::streamoff>(aStream.tellp()) : -1;
+            aReport.IsOk              = aReport.IsOk && aPos >= 0;
+            aReport.Bytes             = aReport.IsOk ? static_cast<qint64>(aPos) : 0;
+            aStream.close();
+            aReport.IsOk = aReport.IsOk && !aStream.fail();
+        }
+
+        aReport.WriteMs   = aTimer.nsecsElapsed() / 1.0e6;
+        aReport.FileBytes = QFileInfo(theDocument.File).size();
+    }
+
+    {
+        std::lock_guard<std::mutex> aLock(documentMutex);
+        anApp->Close(aDoc);
+    }
+
+    LOG_INFO("StepExporter", "STEP导出 " << theDocument.File.toStdString() << ": " << aReport.Bytes << " bytes, "
+                                         << aReport.Throughput() << " MB/s");
+    return aReport;
+}
@@ -0,0 +1,83 @@
+#ifndef STEPEXPORTER_H
+#define STEPEXPORTER_H
+
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+
+#include <AIS_InteractiveContext.hxx>
+#include <Quantity_Color.hxx>
+#include <TopoDS_Shape.hxx>
+
+class MaterialLibrary;
+
+/// \brief StepExporter
+///
+/// 把处理后的场景(已删除的对象不导出，保留颜色与材质分配)写回STEP文件。
+///
+/// 场景内容在GUI线程中收集(Collect)，之后的XCAF文档构建、转换和写文件全部在
+/// 工作线程中完成，多个文档可以同时导出；文件名以.gz结尾时直接以gzip流写出。
+/// 每个文档完成后发出documentExported信号，给出输出字节数与吞吐率。
+class StepExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Part
+    {
+        TopoDS_Shape   Shape;
+        QString        Name;
+        Quantity_Color Color;
+        bool           HasColor;
+        QString        Material;        ///< MaterialLibrary中的材质名称，或者OCCT材质名称
+        QString        Description;     ///< 材质属性描述，写入STEP的material description
+    };
+
+    struct Document
+    {
+        QList<Part> Parts;
+        QString     File;
+    };
+
+    struct Report
+    {
+        QString File;
+        bool    IsOk;
+        qint64  Bytes;            ///< 未压缩的STEP数据大小
+        qint64  FileBytes;        ///< 实际写入磁盘的大小(压缩时小于Bytes)
+        double  TransferMs;       ///< 形状转换为STEP实体的耗时
+        double  WriteMs;          ///< 序列化与写文件(含压缩)的耗时
+
+        /// \brief 吞吐率(MB/s)，按未压缩数据量计算
+        double Throughput() const { return WriteMs > 0.0 ? Bytes / 1048576.0 / (WriteMs / 1000.0) : 0.0; }
+    };
+
+    explicit StepExporter(QObject *parent = nullptr);
+    ~StepExporter();
+
+    /// \brief 在GUI线程中收集当前显示的AIS_Shape
+    static Document Collect(const Handle(AIS_InteractiveContext) & theContext,
+                            const MaterialLibrary &theMaterials,
+                            const QString &        theFile);
+
+    /// \brief 异步导出，每个文档一个任务，并发写出
+    void Export(const QList<Document> &theDocuments);
+
+    /// \brief 同步导出一个文档，工作线程中调用
+    static Report Write(const Document &theDocument);
+
+    /// \brief 等待全部导出任务结束
+    void waitForDone();
+
+    /// \brief 同时进行的导出任务数，默认为CPU核心数
+    void setMaxConcurrency(int theCount) { myPool.setMaxThreadCount(theCount); }
+
+signals:
+    void documentExported(QString theFile, bool isOk, qint64 theBytes, double theThroughput);
+
+private:
+    QThreadPool myPool;
+};
+
+#endif    // STEPEXPORTER_H
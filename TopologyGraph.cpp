@@ -0,0 +1,250 @@
+#include "TopologyGraph.h"
+
+#include <QElapsedTimer>
+
+#include <algorithm>
+
+#include <BRepLib.hxx>
+#include <BRep_Tool.hxx>
+#include <OSD_Parallel.hxx>
+#include <Standard_Failure.hxx>
+#include <TopExp.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopoDS.hxx>
+#include <TopoDS_Vertex.hxx>
+
+
+namespace
+{
+    //! 并行生成每一行(去重并排序)，再按行拼接为CSR数组
+    template <typename RowFunctor>
+    void buildRows(const Standard_Integer theNbRows, const RowFunctor &theRow,
+                   std::vector<Standard_Integer> &theOffsets, std::vector<Standard_Integer> &theTargets)
+    {
+        std::vector<std::vector<Standard_Integer>> aRows(theNbRows);
+        OSD_Parallel::For(0, theNbRows, [&](const Standard_Integer theIndex) {
+            std::vector<Standard_Integer> &aRow = aRows[theIndex];
+            theRow(theIndex, aRow);
+            std::sort(aRow.begin(), aRow.end());
+            aRow.erase(std::unique(aRow.begin(), aRow.end()), aRow.end());
+        });
+
+        theOffsets.assign(theNbRows + 1, 0);
+        for (Standard_Integer i = 0; i < theNbRows; ++i)
+            theOffsets[i + 1] = theOffsets[i] + (Standard_Integer)aRows[i].size();
+
+        theTargets.resize(theOffsets[theNbRows]);
+        OSD_Parallel::For(0, theNbRows, [&](const Standard_Integer theIndex) {
+            std::copy(aRows[theIndex].begin(), aRows[theIndex].end(), theTargets.begin() + theOffsets[theIndex]);
+        });
+    }
+}    // namespace
+
+
+TopologyGraph::TopologyGraph(const TopoDS_Shape &theShape, const Standard_Real theAngularTol)
+    : myShape(theShape)
+    , myBuildMs(0.0)
+{
+    QElapsedTimer aTimer;
+    aTimer.start();
+
+    TopExp::MapShapes(theShape, TopAbs_FACE, myFaces);
+    TopExp::MapShapes(theShape, TopAbs_EDGE, myEdges);
+    TopExp::MapShapes(theShape, TopAbs_VERTEX, myVertices);
+
+    // 缝合边在同一个面中出现两次，按行去重
+    buildRows(NbFaces(),
+              [this](const Standard_Integer theFace, std::vector<Standard_Integer> &theRow) {
+                  for (TopExp_Explorer anExp(Face(theFace), TopAbs_EDGE); anExp.More(); anExp.Next())
+                      theRow.push_back(EdgeId(anExp.Current()));
+              },
+              myFaceEdges.Offsets, myFaceEdges.Targets);
+
+    buildRows(NbEdges(),
+              [this](const Standard_Integer theEdge, std::vector<Standard_Integer> &theRow) {
+                  TopoDS_Vertex aFirst, aLast;
+                  TopExp::Vertices(TopoDS::Edge(Edge(theEdge)), aFirst, aLast);
+                  if (!aFirst.IsNull())
+                      theRow.push_back(VertexId(aFirst));
+                  if (!aLast.IsNull())
+                      theRow.push_back(VertexId(aLast));
+              },
+              myEdgeVertices.Offsets, myEdgeVertices.Targets);
+
+    transpose(myFaceEdges, NbEdges(), myEdgeFaces);
+    transpose(myEdgeVertices, NbVertices(), myVertexEdges);
+
+    buildRows(NbFaces(),
+              [this](const Standard_Integer theFace, std::vector<Standard_Integer> &theRow) {
+                  for (const Standard_Integer anEdge : FaceEdges(theFace))
+                  {
+                      for (const Standard_Integer anOther : EdgeFaces(anEdge))
+                      {
+                          if (anOther != theFace)
+                              theRow.push_back(anOther);
+                      }
+                  }
+              },
+              myFaceFaces.Offsets, myFaceFaces.Targets);
+
+    computeTangency(theAngularTol);
+
+    myBuildMs = aTimer.nsecsElapsed() / 1.0e6;
+}
+
+void TopologyGraph::transpose(const Adjacency &theAdj, const Standard_Integer theNbTargets, Adjacency &theResult)
+{
+    const Standard_Integer aNbRows = (Standard_Integer)theAdj.Offsets.size() - 1;
+
+    // 计数排序：按行号顺序填入，每一行的目标自然有序
+    theResult.Offsets.assign(theNbTargets + 1, 0);
+    for (size_t i = 0; i < theAdj.Targets.size(); ++i)
+        ++theResult.Offsets[theAdj.Targets[i] + 1];
+    for (Standard_Integer i = 0; i < theNbTargets; ++i)
+        theResult.Offsets[i + 1] += theResult.Offsets[i];
+
+    theResult.Targets.resize(theAdj.Targets.size());
+    std::vector<Standard_Integer> aNext(theResult.Offsets.begin(), theResult.Offsets.end() - 1);
+    for (Standard_Integer aRow = 0; aRow < aNbRows; ++aRow)
+    {
+        for (Standard_Integer i = theAdj.Offsets[aRow]; i < theAdj.Offsets[aRow + 1]; ++i)
+            theResult.Targets[aNext[theAdj.Targets[i]]++] = aRow;
+    }
+}
+
+void TopologyGraph::computeTangency(const Standard_Real theAngularTol)
+{
+    myIsTangent.assign(NbEdges(), 0);
+    OSD_Parallel::For(0, NbEdges(), [&](const Standard_Integer theEdge) {
+        const Neighbors aFaces = EdgeFaces(theEdge);
+        if (aFaces.Size() != 2)
+            return;
+
+        const TopoDS_Edge &anEdge = TopoDS::Edge(Edge(theEdge));
+        if (BRep_Tool::Degenerated(anEdge))
+            return;
+
+        const TopoDS_Face &aFace1 = TopoDS::Face(Face(aFaces[0]));
+        const TopoDS_Face &aFace2 = TopoDS::Face(Face(aFaces[1]));
+        try
+        {
+            // 导入的模型一般没有编码连续性，此时按两个面在边上的法向计算
+            const GeomAbs_Shape aCont = BRep_Tool::HasContinuity(anEdge, aFace1, aFace2)
+                                            ? BRep_Tool::Continuity(anEdge, aFace1, aFace2)
+                                            : BRepLib::ContinuityOfFaces(anEdge, aFace1, aFace2, theAngularTol);
+            myIsTangent[theEdge] = aCont >= GeomAbs_G1 ? 1 : 0;
+        }
+        catch (const Standard_Failure &)
+        {
+            // 缺少参数曲线等情况按不相切处理
+        }
+    });
+}
+
+std::vector<Standard_Integer> TopologyGraph::Grow(const std::vector<Standard_Integer> &theFaces,
+                                                  const Standard_Integer theRings) const
+{
+    std::vector<unsigned char>    aVisited(NbFaces(), 0);
+    std::vector<Standard_Integer> aFront, aResult;
+    for (size_t i = 0; i < theFaces.size(); ++i)
+    {
+        if (theFaces[i] >= 0 && theFaces[i] < NbFaces() && !aVisited[theFaces[i]])
+        {
+            aVisited[theFaces[i]] = 1;
+            aFront.push_back(theFaces[i]);
+        }
+    }
+    aResult = aFront;
+
+    for (Standard_Integer aRing = 0; aRing < theRings && !aFront.empty(); ++aRing)
+    {
+        std::vector<Standard_Integer> aNext;
+        for (size_t i = 0; i < aFront.size(); ++i)
+        {
+            for (const Standard_Integer anOther : FaceFaces(aFront[i]))
+            {
+                if (!aVisited[anOther])
+                {
+                    aVisited[anOther] = 1;
+                    aNext.push_back(anOther);
+                }
+            }
+        }
+        aResult.insert(aResult.end(), aNext.begin(), aNext.end());
+        aFront.swap(aNext);
+    }
+
+    std::sort(aResult.begin(), aResult.end());
+    return aResult;
+}
+
+std::vector<Standard_Integer> TopologyGraph::TangentChain(const Standard_Integer theFace) const
+{
+    std::vector<Standard_Integer> aResult;
+    if (theFace < 0 || theFace >= NbFaces())
+        return aResult;
+
+    std::vector<unsigned char> aVisited(NbFaces(), 0);
+    aVisited[theFace] = 1;
+    aResult.push_back(theFace);
+    for (size_t i = 0; i < aResult.size(); ++i)
+    {
+        for (const Standard_Integer anEdge : FaceEdges(aResult[i]))
+        {
+            if (!myIsTangent[anEdge])
+                continue;
+            for (const Standard_Integer anOther : EdgeFaces(anEdge))
+            {
+                if (!aVisited[anOther])
+                {
+                    aVisited[anOther] = 1;
+                    aResult.push_back(anOther);
+                }
+            }
+        }
+    }
+
+    std::sort(aResult.begin(), aResult.end());
+    return aResult;
+}
+
+Standard_Integer TopologyGraph::Components(std::vector<Standard_Integer> &theLabels) const
+{
+    theLabels.assign(NbFaces(), -1);
+
+    Standard_Integer              aNbComponents = 0;
+    std::vector<Standard_Integer> aStack;
+    for (Standard_Integer aSeed = 0; aSeed < NbFaces(); ++aSeed)
+    {
+        if (theLabels[aSeed] >= 0)
+            continue;
+
+        theLabels[aSeed] = aNbComponents;
+        aStack.push_back(aSeed);
+        while (!aStack.empty())
+        {
+            const Standard_Integer aFace = aStack.back();
+            aStack.pop_back();
+            for (const Standard_Integer anOther : FaceFaces(aFace))
+            {
+                if (theLabels[anOther] < 0)
+                {
+                    theLabels[anOther] = aNbComponents;
+                    aStack.push_back(anOther);
+                }
+            }
+        }
+        ++aNbComponents;
+    }
+    return aNbComponents;
+}
+
+size_t TopologyGraph::MemorySize() const
+{
+    const Adjacency *anAdjs[] = { &myFaceEdges, &myEdgeFaces, &myEdgeVertices, &myVertexEdges, &myFaceFaces };
+
+    size_t aSize = myIsTangent.size();
+    for (size_t i = 0; i < sizeof(anAdjs) / sizeof(anAdjs[0]); ++i)
+        aSize += (anAdjs[i]->Offsets.size() + anAdjs[i]->Targets.size()) * sizeof(Standard_Integer);
+    return aSize;
+}
@@ -0,0 +1,128 @@
+#ifndef TOPOLOGYGRAPH_H
+#define TOPOLOGYGRAPH_H
+
+#include <vector>
+
+#include <Standard_Transient.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
+#include <TopoDS_Shape.hxx>
+
+/// \brief TopologyGraph
+///
+/// 一个形状的拓扑邻接关系，构建一次后供"扩展选择"、相切链选择、连通分量分析等查询使用，
+/// 查询时不再用TopExp_Explorer遍历整个形状。
+///
+/// - 面、边、顶点的编号为其在TopExp::MapShapes结果中的序号(从0开始)，同一形状多次构建的编号相同
+/// - 邻接表按CSR(compressed sparse row)存放：每种关系一个偏移数组和一个连续的目标数组，
+///   取某个元素的邻居是O(度数)的，不做任何分配
+/// - 面→边、边→顶点并行(OSD_Parallel)生成，边→面、顶点→边由其转置得到，
+///   面→面(共边)再由前两者并行合成
+/// - 边两侧的面在角度容差内G1连续时记为相切边，相切链沿相切边扩展
+class TopologyGraph : public Standard_Transient
+{
+public:
+    /// \brief 一行邻居，即CSR目标数组中的一段
+    class Neighbors
+    {
+    public:
+        Neighbors(const Standard_Integer *theBegin, const Standard_Integer *theEnd)
+            : myBegin(theBegin)
+            , myEnd(theEnd)
+        {
+        }
+
+        const Standard_Integer *begin() const { return myBegin; }
+        const Standard_Integer *end() const { return myEnd; }
+        Standard_Integer        Size() const { return (Standard_Integer)(myEnd - myBegin); }
+        Standard_Integer        operator[](const Standard_Integer theIndex) const { return myBegin[theIndex]; }
+
+    private:
+        const Standard_Integer *myBegin;
+        const Standard_Integer *myEnd;
+    };
+
+    /// \brief 构建theShape的邻接关系
+    ///
+    /// \param theAngularTol，判断相切边的角度容差(弧度)
+    explicit TopologyGraph(const TopoDS_Shape &theShape, const Standard_Real theAngularTol = 0.0175);
+
+    const TopoDS_Shape &Shape() const { return myShape; }
+
+    Standard_Integer NbFaces() const { return myFaces.Extent(); }
+    Standard_Integer NbEdges() const { return myEdges.Extent(); }
+    Standard_Integer NbVertices() const { return myVertices.Extent(); }
+
+    const TopoDS_Shape &Face(const Standard_Integer theId) const { return myFaces(theId + 1); }
+    const TopoDS_Shape &Edge(const Standard_Integer theId) const { return myEdges(theId + 1); }
+    const TopoDS_Shape &Vertex(const Standard_Integer theId) const { return myVertices(theId + 1); }
+
+    /// \brief 子形状的编号，不属于该形状时返回-1
+    Standard_Integer FaceId(const TopoDS_Shape &theFace) const { return myFaces.FindIndex(theFace) - 1; }
+    Standard_Integer EdgeId(const TopoDS_Shape &theEdge) const { return myEdges.FindIndex(theEdge) - 1; }
+    Standard_Integer VertexId(const TopoDS_Shape &theVertex) const { return myVertices.FindIndex(theVertex) - 1; }
+
+    Neighbors FaceEdges(const Standard_Integer theFace) const { return row(myFaceEdges, theFace); }
+    Neighbors EdgeFaces(const Standard_Integer theEdge) const { return row(myEdgeFaces, theEdge); }
+    Neighbors EdgeVertices(const Standard_Integer theEdge) const { return row(myEdgeVertices, theEdge); }
+    Neighbors VertexEdges(const Standard_Integer theVertex) const { return row(myVertexEdges, theVertex); }
+
+    /// \brief 与theFace有公共边的面
+    Neighbors FaceFaces(const Standard_Integer theFace) const { return row(myFaceFaces, theFace); }
+
+    /// \brief 边恰好连接两个不同的面，且两个面在边上G1连续
+    bool IsTangentEdge(const Standard_Integer theEdge) const { return myIsTangent[theEdge] != 0; }
+
+    /// \brief 扩展选择：theFaces加上theRings圈共边的相邻面，结果按编号排序
+    std::vector<Standard_Integer> Grow(const std::vector<Standard_Integer> &theFaces,
+                                       const Standard_Integer theRings = 1) const;
+
+    /// \brief 从theFace出发，沿相切边能到达的全部面(含theFace)，结果按编号排序
+    std::vector<Standard_Integer> TangentChain(const Standard_Integer theFace) const;
+
+    /// \brief 按共边关系划分连通分量
+    ///
+    /// \param theLabels，输出每个面所属分量的编号[0, 返回值)
+    /// \return 分量数目
+    Standard_Integer Components(std::vector<Standard_Integer> &theLabels) const;
+
+    double BuildMs() const { return myBuildMs; }
+
+    /// \brief 邻接数组占用的字节数
+    size_t MemorySize() const;
+
+    DEFINE_STANDARD_RTTI_INLINE(TopologyGraph, Standard_Transient)
+
+private:
+    struct Adjacency
+    {
+        std::vector<Standard_Integer> Offsets;    ///< 行数 + 1项
+        std::vector<Standard_Integer> Targets;
+    };
+
+    static Neighbors row(const Adjacency &theAdj, const Standard_Integer theRow)
+    {
+        const Standard_Integer *aData = theAdj.Targets.data();
+        return Neighbors(aData + theAdj.Offsets[theRow], aData + theAdj.Offsets[theRow + 1]);
+    }
+
+    /// \brief 由theAdj(行数任意，目标在[0, theNbTargets)内)生成转置
+    static void transpose(const Adjacency &theAdj, const Standard_Integer theNbTargets, Adjacency &theResult);
+
+    void computeTangency(const Standard_Real theAngularTol);
+
+    TopoDS_Shape               myShape;
+    TopTools_IndexedMapOfShape myFaces;
+    TopTools_IndexedMapOfShape myEdges;
+    TopTools_IndexedMapOfShape myVertices;
+    Adjacency                  myFaceEdges;
+    Adjacency                  myEdgeFaces;
+    Adjacency                  myEdgeVertices;
+    Adjacency                  myVertexEdges;
+    Adjacency                  myFaceFaces;
+    std::vector<unsigned char> myIsTangent;
+    double                     myBuildMs;
+};
+
+DEFINE_STANDARD_HANDLE(TopologyGraph, Standard_Transient)
+
+#endif    // TOPOLOGYGRAPH_H
@@ -0,0 +1,80 @@
+#include "ViewLayout.h"
+
+#include "ModelView.h"
+
+#include <QGridLayout>
+
+
+ViewLayout::ViewLayout(const Handle(AIS_InteractiveContext) & theContext, QWidget *parent)
+    : QWidget(parent)
+    , myContext(theContext)
+    , myLayout(Layout_Single)
+{
+    myGrid = new QGridLayout(this);
+    myGrid->setMargin(0);
+    myGrid->setSpacing(2);
+
+    myMainView = new ModelView(myContext, true, this);
+    myGrid->addWidget(myMainView, 0, 0, 2, 2);
+    connect(myMainView, SIGNAL(selectionChanged()), this, SIGNAL(selectionChanged()));
+}
+
+QList<ModelView *> ViewLayout::views() const
+{
+    QList<ModelView *> aViews;
+    if (myLayout == Layout_Quad)
+        aViews = mySideViews;
+    aViews.append(myMainView);
+    return aViews;
+}
+
+void ViewLayout::setViewLayout(Layout theLayout)
+{
+    if (theLayout == myLayout)
+        return;
+
+    myLayout = theLayout;
+    myGrid->removeWidget(myMainView);
+    if (myLayout == Layout_Quad)
+    {
+        if (mySideViews.isEmpty())
+            createSideViews();
+
+        // 前视 | 顶视
+        // 右视 | 主视图
+        myGrid->addWidget(mySideViews[0], 0, 0);
+        myGrid->addWidget(mySideViews[1], 0, 1);
+        myGrid->addWidget(mySideViews[2], 1, 0);
+        myGrid->addWidget(myMainView, 1, 1);
+        foreach (ModelView *aView, mySideViews)
+        {
+            aView->show();
+            aView->fitAll();
+        }
+    }
+    else
+    {
+        // 辅助视图只隐藏不销毁，再次切换时保留各自的相机
+        foreach (ModelView *aView, mySideViews)
+        {
+            myGrid->removeWidget(aView);
+            aView->hide();
+        }
+        myGrid->addWidget(myMainView, 0, 0, 2, 2);
+    }
+}
+
+void ViewLayout::createSideViews()
+{
+    // ViewCube已经由主视图显示在上下文中，辅助视图中同样可见，这里不再重复创建
+    for (int i = 0; i < 3; ++i)
+    {
+        ModelView *aView = new ModelView(myContext, false, this, myMainView);
+        connect(aView, SIGNAL(selectionChanged()), this, SIGNAL(selectionChanged()));
+        mySideViews.append(aView);
+    }
+
+    mySideViews[0]->front();
+    mySideViews[1]->top();
+    mySideViews[2]->right();
+}
@@ -0,0 +1,62 @@
+#ifndef VIEWLAYOUT_H
+#define VIEWLAYOUT_H
+
+#include <QList>
+#include <QWidget>
+
+#include <AIS_InteractiveContext.hxx>
+
+class QGridLayout;
+class ModelView;
+
+/// \brief ViewLayout
+///
+/// 多视口布局。所有ModelView建立在同一个AIS_InteractiveContext(同一个V3d_Viewer和
+/// OpenGl_GraphicDriver)之上，网格、显示对象和GL资源在各视图之间共享，每个视图只有
+/// 自己的相机和窗口。
+///
+/// - Layout_Single：只显示主视图
+/// - Layout_Quad：前视、顶视、右视和主视图(轴测)四个视口，辅助视图在第一次切换时创建
+///
+/// 重绘由AIS_ViewController按视图的失效状态进行，只有相机或内容变化的视图才会重绘；
+/// 隐藏或最小化的视图被停用(见ModelView::hideEvent)，不再参与重绘。
+class ViewLayout : public QWidget
+{
+    Q_OBJECT
+
+public:
+    enum Layout
+    {
+        Layout_Single,
+        Layout_Quad
+    };
+
+    ViewLayout(const Handle(AIS_InteractiveContext) & theContext, QWidget *parent);
+
+    /// \brief 主视图，带ViewCube，工具栏操作都作用在主视图上
+    inline ModelView *mainView() { return myMainView; }
+
+    /// \brief 当前布局中全部视图，主视图在最后
+    QList<ModelView *> views() const;
+
+    Layout viewLayout() const { return myLayout; }
+    void   setViewLayout(Layout theLayout);
+
+public slots:
+    void toggleQuad(bool theToQuad) { setViewLayout(theToQuad ? Layout_Quad : Layout_Single); }
+
+signals:
+    /// \brief 任一视图的选择集发生变化
+    void selectionChanged();
+
+private:
+    void createSideViews();
+
+    Handle(AIS_InteractiveContext) myContext;
+    QGridLayout *      myGrid;
+    ModelView *        myMainView;
+    QList<ModelView *> mySideViews;
+    Layout             myLayout;
+};
+
+#endif    // VIEWLAYOUT_H
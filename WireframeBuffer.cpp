@@ -0,0 +1,293 @@
+#include "WireframeBuffer.h"
+#include "ShapeUtils.h"
+
+#include <QElapsedTimer>
+
+#include <BRepAdaptor_Curve.hxx>
+#include <BRep_Tool.hxx>
+#include <GCPnts_TangentialDeflection.hxx>
+#include <Graphic3d_AspectLine3d.hxx>
+#include <Graphic3d_AttribBuffer.hxx>
+#include <Graphic3d_Group.hxx>
+#include <OSD_Parallel.hxx>
+#include <Poly_PolygonOnTriangulation.hxx>
+#include <Poly_Polygon3D.hxx>
+#include <Poly_Triangulation.hxx>
+#include <Prs3d_LineAspect.hxx>
+#include <Prs3d_Presentation.hxx>
+#include <Select3D_SensitiveCurve.hxx>
+#include <SelectMgr_Selection.hxx>
+#include <StdPrs_ToolTriangulatedShape.hxx>
+#include <TColgp_Array1OfPnt.hxx>
+#include <TopExp.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopoDS.hxx>
+#include <V3d_View.hxx>
+#include <V3d_Viewer.hxx>
+
+namespace
+{
+    inline Graphic3d_Vec4ub toColor(const Quantity_Color &theColor)
+    {
+        return Graphic3d_Vec4ub((Standard_Byte)(theColor.Red() * 255.0), (Standard_Byte)(theColor.Green() * 255.0),
+                                (Standard_Byte)(theColor.Blue() * 255.0), 255);
+    }
+
+    //! 边的离散点：依次尝试三维多边形、三角网格上的多边形，都没有时按曲线离散
+    void discretize(const TopoDS_Edge &theEdge, const Standard_Real theDeflection, const Standard_Real theAngle,
+                    std::vector<gp_Pnt> &thePoints)
+    {
+        if (BRep_Tool::Degenerated(theEdge))
+            return;
+
+        TopLoc_Location               aLoc;
+        const Handle(Poly_Polygon3D) &aPolygon = BRep_Tool::Polygon3D(theEdge, aLoc);
+        if (!aPolygon.IsNull())
+        {
+            const TColgp_Array1OfPnt &aNodes = aPolygon->Nodes();
+            for (Standard_Integer i = aNodes.Lower(); i <= aNodes.Upper(); ++i)
+                thePoints.push_back(aNodes(i).Transformed(aLoc.Transformation()));
+            return;
+        }
+
+        Handle(Poly_PolygonOnTriangulation) aPolyOnTri;
+        Handle(Poly_Triangulation)          aTri;
+        BRep_Tool::PolygonOnTriangulation(theEdge, aPolyOnTri, aTri, aLoc);
+        if (!aPolyOnTri.IsNull() && !aTri.IsNull())
+        {
+            const TColStd_Array1OfInteger &anIndices = aPolyOnTri->Nodes();
+            const TColgp_Array1OfPnt &     aNodes    = aTri->Nodes();
+            for (Standard_Integer i = anIndices.Lower(); i <= anIndices.Upper(); ++i)
+                thePoints.push_back(aNodes(anIndices(i)).Transformed(aLoc.Transformation()));
+            return;
+        }
+
+        if (!BRep_Tool::IsGeometric(theEdge))
+            return;
+
+        BRepAdaptor_Curve           aCurve(theEdge);
+        GCPnts_TangentialDeflection aDiscret(aCurve, theAngle, theDeflection);
+        for (Standard_Integer i = 1; i <= aDiscret.NbPoints(); ++i)
+            thePoints.push_back(aDiscret.Value(i));
+    }
+}    // namespace
+
+WireframeBuffer::WireframeBuffer(const std::vector<Handle(AIS_Shape)> &theSources)
+    : mySources(theSources)
+    , myColorAttribute(-1)
+    , myHovered(0)
+    , myHoverColor(Quantity_NOC_CYAN1)
+{
+    SetAutoHilight(Standard_False);
+    build();
+}
+
+Standard_Integer WireframeBuffer::CountGroups(const Handle(PrsMgr_PresentableObject) & theObject)
+{
+    Standard_Integer aNbGroups = 0;
+    for (PrsMgr_Presentations::Iterator anIter(theObject->Presentations()); anIter.More(); anIter.Next())
+    {
+        if (anIter.Value()->IsDisplayed())
+            aNbGroups += anIter.Value()->Groups().Size();
+    }
+    return aNbGroups;
+}
+
+void WireframeBuffer::build()
+{
+    QElapsedTimer aTimer;
+    aTimer.start();
+
+    myStats           = Stats();
+    myStats.NbSources = (Standard_Integer)mySources.size();
+    myStats.NbGroups  = 1;
+
+    // 对象自身的变换并入形状的位置，不同位置的同一条边分别绘制
+    std::vector<Standard_Real> aDeflections;
+    for (size_t i = 0; i < mySources.size(); ++i)
+    {
+        const Handle(AIS_Shape) &aSource = mySources[i];
+        const TopoDS_Shape       aShape  = ShapeUtils::WorldShape(aSource);
+        const Standard_Real aDeflection = StdPrs_ToolTriangulatedShape::GetDeflection(aShape, aSource->Attributes());
+
+        for (TopExp_Explorer aFaceIter(aShape, TopAbs_FACE); aFaceIter.More(); aFaceIter.Next())
+        {
+            for (TopExp_Explorer anEdgeIter(aFaceIter.Current(), TopAbs_EDGE); anEdgeIter.More(); anEdgeIter.Next())
+                ++myStats.NbEdgeUses;
+        }
+
+        // 不属于任何面的边也要显示；新加入的边使用该对象的离散精度
+        TopExp::MapShapes(aShape, TopAbs_EDGE, myEdges);
+        aDeflections.resize(myEdges.Extent(), aDeflection);
+    }
+    myStats.NbEdges = myEdges.Extent();
+
+    const Standard_Real anAngle = myDrawer->DeviationAngle();
+    std::vector<std::vector<gp_Pnt>> aPoints(myEdges.Extent());
+    OSD_Parallel::For(0, myEdges.Extent(), [&](const Standard_Integer theIndex) {
+        discretize(TopoDS::Edge(myEdges(theIndex + 1)), aDeflections[theIndex], anAngle, aPoints[theIndex]);
+    });
+
+    Standard_Integer aNbSegments = 0;
+    myEdgeFirst.assign(myEdges.Extent() + 1, 0);
+    for (Standard_Integer e = 0; e < myEdges.Extent(); ++e)
+    {
+        const Standard_Integer aNb = (Standard_Integer)aPoints[e].size();
+        myEdgeFirst[e + 1]         = myEdgeFirst[e] + aNb;
+        aNbSegments += aNb > 1 ? aNb - 1 : 0;
+    }
+    myStats.NbSegments = aNbSegments;
+
+    // 顶点共享，线段用索引描述；颜色属性单独存放以便高亮时只改写颜色
+    const Standard_Integer aNbVertices = myEdgeFirst.back();
+    mySegments = new Graphic3d_ArrayOfSegments(aNbVertices, 2 * aNbSegments,
+                                               Graphic3d_ArrayFlags_VertexColor
+                                                   | Graphic3d_ArrayFlags_AttribsMutable
+                                                   | Graphic3d_ArrayFlags_AttribsDeinterleaved);
+    const Graphic3d_Vec4ub aColor = toColor(myDrawer->WireAspect()->Aspect()->Color());
+    for (Standard_Integer e = 0; e < myEdges.Extent(); ++e)
+    {
+        for (size_t i = 0; i < aPoints[e].size(); ++i)
+        {
+            const Standard_Integer v = mySegments->AddVertex(aPoints[e][i]);
+            mySegments->SetVertexColor(v, aColor);
+        }
+    }
+    for (Standard_Integer e = 0; e < myEdges.Extent(); ++e)
+    {
+        for (Standard_Integer v = myEdgeFirst[e] + 1; v < myEdgeFirst[e + 1]; ++v)
+            mySegments->AddEdges(v, v + 1);
+    }
+
+    const Handle(Graphic3d_Buffer) &aBuffer = mySegments->Attributes();
+    for (Standard_Integer i = 0; i < aBuffer->NbAttributes; ++i)
+    {
+        if (aBuffer->Attribute(i).Id == Graphic3d_TOA_COLOR)
+            myColorAttribute = i;
+    }
+
+    myIsSelected.assign(myEdges.Extent() + 1, 0);
+    myStats.BuildMs = aTimer.nsecsElapsed() / 1.0e6;
+}
+
+void WireframeBuffer::Compute(const Handle(PrsMgr_PresentationManager3d) &,
+                              const Handle(Prs3d_Presentation) & thePrs,
+                              const Standard_Integer theMode)
+{
+    if (theMode != 0 || mySegments.IsNull() || mySegments->VertexNumber() == 0)
+        return;
+
+    Handle(Graphic3d_Group) aGroup = thePrs->NewGroup();
+    aGroup->SetGroupPrimitivesAspect(myDrawer->WireAspect()->Aspect());
+    aGroup->AddPrimitiveArray(mySegments);
+}
+
+void WireframeBuffer::ComputeSelection(const Handle(SelectMgr_Selection) & theSelection, const Standard_Integer theMode)
+{
+    if (theMode != 0 || mySegments.IsNull())
+        return;
+
+    for (Standard_Integer e = 1; e <= myEdges.Extent(); ++e)
+    {
+        const Standard_Integer aNb = EdgeNbVertices(e);
+        if (aNb < 2)
+            continue;
+
+        TColgp_Array1OfPnt aPoints(1, aNb);
+        for (Standard_Integer i = 1; i <= aNb; ++i)
+            aPoints(i) = mySegments->Vertice(EdgeFirstVertex(e) + i);
+
+        Handle(WireframeEdgeOwner) anOwner = new WireframeEdgeOwner(this, e);
+        theSelection->Add(new Select3D_SensitiveCurve(anOwner, aPoints));
+    }
+}
+
+void WireframeBuffer::HilightSelected(const Handle(PrsMgr_PresentationManager3d) &,
+                                      const SelectMgr_SequenceOfOwner &theOwners)
+{
+    for (SelectMgr_SequenceOfOwner::Iterator anIter(theOwners); anIter.More(); anIter.Next())
+    {
+        Handle(WireframeEdgeOwner) anOwner = Handle(WireframeEdgeOwner)::DownCast(anIter.Value());
+        if (anOwner.IsNull() || myIsSelected[anOwner->EdgeIndex()])
+            continue;
+
+        myIsSelected[anOwner->EdgeIndex()] = 1;
+        writeColor(anOwner->EdgeIndex());
+    }
+    redraw();
+}
+
+void WireframeBuffer::ClearSelected()
+{
+    for (Standard_Integer e = 1; e <= myEdges.Extent(); ++e)
+    {
+        if (!myIsSelected[e])
+            continue;
+
+        myIsSelected[e] = 0;
+        writeColor(e);
+    }
+    redraw();
+}
+
+void WireframeBuffer::HilightOwnerWithColor(const Handle(PrsMgr_PresentationManager3d) &,
+                                            const Handle(Prs3d_Drawer) & theStyle,
+                                            const Handle(SelectMgr_EntityOwner) & theOwner)
+{
+    Handle(WireframeEdgeOwner) anOwner = Handle(WireframeEdgeOwner)::DownCast(theOwner);
+    if (anOwner.IsNull() || anOwner->EdgeIndex() == myHovered)
+        return;
+
+    const Standard_Integer aPrevious = myHovered;
+    myHovered                        = anOwner->EdgeIndex();
+    myHoverColor                     = theStyle->Color();
+    if (aPrevious != 0)
+        writeColor(aPrevious);
+    writeColor(myHovered);
+
+    // 预选高亮只重绘即时层，线段缓冲在主层中，需要整个视图重绘
+    redraw();
+    if (HasInteractiveContext())
+        GetContext()->CurrentViewer()->Redraw();
+}
+
+void WireframeBuffer::ClearDynamicHighlight(const Handle(PrsMgr_PresentationManager3d) &)
+{
+    if (myHovered == 0)
+        return;
+
+    const Standard_Integer aPrevious = myHovered;
+    myHovered                        = 0;
+    writeColor(aPrevious);
+    redraw();
+}
+
+void WireframeBuffer::writeColor(const Standard_Integer theEdge)
+{
+    Quantity_Color aColor = myDrawer->WireAspect()->Aspect()->Color();
+    if (theEdge == myHovered)
+        aColor = myHoverColor;
+    else if (myIsSelected[theEdge] && HasInteractiveContext())
+        aColor = GetContext()->HighlightStyle(Prs3d_TypeOfHighlight_LocalSelected)->Color();
+
+    const Graphic3d_Vec4ub aValue = toColor(aColor);
+    const Standard_Integer aFirst = EdgeFirstVertex(theEdge);
+    const Standard_Integer aNb    = EdgeNbVertices(theEdge);
+    for (Standard_Integer i = 1; i <= aNb; ++i)
+        mySegments->SetVertexColor(aFirst + i, aValue);
+
+    Handle(Graphic3d_AttribBuffer) aBuffer = Handle(Graphic3d_AttribBuffer)::DownCast(mySegments->Attributes());
+    if (!aBuffer.IsNull() && myColorAttribute >= 0 && aNb > 0)
+        aBuffer->Invalidate(myColorAttribute, aFirst, aFirst + aNb - 1);
+}
+
+void WireframeBuffer::redraw()
+{
+    if (!HasInteractiveContext())
+        return;
+
+    // 只有顶点缓冲内容变化，结构本身没有变化，视图不会自行失效；重绘由上下文完成
+    const Handle(V3d_Viewer) &aViewer = GetContext()->CurrentViewer();
+    for (V3d_ListOfView::Iterator anIter(aViewer->ActiveViews()); anIter.More(); anIter.Next())
+        anIter.Value()->Invalidate();
+}
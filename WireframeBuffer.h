@@ -0,0 +1,117 @@
+#ifndef WIREFRAMEBUFFER_H
+#define WIREFRAMEBUFFER_H
+
+#include <vector>
+
+#include <AIS_InteractiveObject.hxx>
+#include <AIS_Shape.hxx>
+#include <Graphic3d_ArrayOfSegments.hxx>
+#include <SelectMgr_EntityOwner.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
+
+/// \brief WireframeBuffer
+///
+/// 一组AIS_Shape(一个装配)的合并线框显示。AIS_WireFrame模式下每个对象各自生成边的显示，
+/// 对象多时图元组和绘制调用的数目随对象数增长；这里把全部边并行离散后放入一个线段缓冲，
+/// 整个装配只有一个图元组：
+///
+/// - 边按TopoDS_Edge(含位置)去重，相邻面共用的边只画一次
+/// - 已有Poly_Polygon3D时直接使用，否则按切线偏差离散，精度与Prs3d默认的偏差系数一致
+/// - 每条边是一个选择实体(WireframeEdgeOwner)，选中和预选高亮只改写该边顶点的颜色属性
+///   (可变、按属性分开存放的缓冲)，不重新计算显示
+///
+/// 源对象由调用者决定是否隐藏，Sources()返回构造时的对象。
+class WireframeBuffer : public AIS_InteractiveObject
+{
+public:
+    struct Stats
+    {
+        Standard_Integer NbSources;     ///< 源对象数
+        Standard_Integer NbEdgeUses;    ///< 去重前各对象的边数之和(按面遍历，共用边计多次)
+        Standard_Integer NbEdges;       ///< 去重后的边数
+        Standard_Integer NbSegments;
+        Standard_Integer NbGroups;      ///< 合并后的图元组数，总是1
+        double           BuildMs;
+    };
+
+    explicit WireframeBuffer(const std::vector<Handle(AIS_Shape)> &theSources);
+
+    const std::vector<Handle(AIS_Shape)> &Sources() const { return mySources; }
+
+    const Stats &GetStats() const { return myStats; }
+
+    Standard_Integer    NbEdges() const { return myEdges.Extent(); }
+    const TopoDS_Shape &Edge(const Standard_Integer theIndex) const { return myEdges.FindKey(theIndex); }
+
+    /// \brief 边theIndex(1..NbEdges)的顶点在线段缓冲中的范围[First, First + Nb)
+    Standard_Integer EdgeFirstVertex(const Standard_Integer theIndex) const { return myEdgeFirst[theIndex - 1]; }
+    Standard_Integer EdgeNbVertices(const Standard_Integer theIndex) const { return myEdgeFirst[theIndex] - myEdgeFirst[theIndex - 1]; }
+
+    /// \brief 对象当前全部显示中的图元组数，即逐对象显示时的绘制调用数
+    static Standard_Integer CountGroups(const Handle(PrsMgr_PresentableObject) & theObject);
+
+    virtual Standard_Boolean AcceptDisplayMode(const Standard_Integer theMode) const Standard_OVERRIDE { return theMode == 0; }
+
+    //! 高亮由颜色属性实现
+    virtual void HilightSelected(const Handle(PrsMgr_PresentationManager3d) & thePrsMgr,
+                                 const SelectMgr_SequenceOfOwner &theOwners) Standard_OVERRIDE;
+    virtual void ClearSelected() Standard_OVERRIDE;
+    virtual void HilightOwnerWithColor(const Handle(PrsMgr_PresentationManager3d) & thePrsMgr,
+                                       const Handle(Prs3d_Drawer) & theStyle,
+                                       const Handle(SelectMgr_EntityOwner) & theOwner) Standard_OVERRIDE;
+    virtual void ClearDynamicHighlight(const Handle(PrsMgr_PresentationManager3d) & thePrsMgr) Standard_OVERRIDE;
+
+    DEFINE_STANDARD_RTTI_INLINE(WireframeBuffer, AIS_InteractiveObject)
+
+protected:
+    virtual void Compute(const Handle(PrsMgr_PresentationManager3d) & thePrsMgr,
+                         const Handle(Prs3d_Presentation) & thePrs,
+                         const Standard_Integer theMode) Standard_OVERRIDE;
+
+    virtual void ComputeSelection(const Handle(SelectMgr_Selection) & theSelection,
+                                  const Standard_Integer theMode) Standard_OVERRIDE;
+
+private:
+    void build();
+
+    /// \brief 按边的状态改写其顶点颜色并标记失效
+    void writeColor(const Standard_Integer theEdge);
+
+    void redraw();
+
+    std::vector<Handle(AIS_Shape)>     mySources;
+    Handle(Graphic3d_ArrayOfSegments)  mySegments;
+    Standard_Integer                   myColorAttribute;
+    TopTools_IndexedMapOfShape         myEdges;
+    std::vector<Standard_Integer>      myEdgeFirst;    ///< NbEdges + 1项，最后一项为顶点总数
+    std::vector<unsigned char>         myIsSelected;
+    Standard_Integer                   myHovered;      ///< 预选高亮的边，没有时为0
+    Quantity_Color                     myHoverColor;
+    Stats                              myStats;
+};
+
+DEFINE_STANDARD_HANDLE(WireframeBuffer, AIS_InteractiveObject)
+
+/// \brief WireframeEdgeOwner
+///
+/// WireframeBuffer中一条边的选择实体。
+class WireframeEdgeOwner : public SelectMgr_EntityOwner
+{
+public:
+    WireframeEdgeOwner(const Handle(SelectMgr_SelectableObject) & theSelectable, const Standard_Integer theEdge)
+        : SelectMgr_EntityOwner(theSelectable)
+        , myEdge(theEdge)
+    {
+    }
+
+    Standard_Integer EdgeIndex() const { return myEdge; }
+
+    DEFINE_STANDARD_RTTI_INLINE(WireframeEdgeOwner, SelectMgr_EntityOwner)
+
+private:
+    Standard_Integer myEdge;
+};
+
+DEFINE_STANDARD_HANDLE(WireframeEdgeOwner, SelectMgr_EntityOwner)
+
+#endif    // WIREFRAMEBUFFER_H
@@ -0,0 +1,760 @@
+/// \brief bench_occt.cpp
+///
+/// 性能基准测试程序。构造可复现的合成场景和文件场景，分别统计
+/// 冷启动首帧、STEP导入、网格剖分、显示、拾取、重绘帧率、选择处理、图像导出(同步与异步)、距离场、标量场更新、线框显示、按面着色、去特征简化显示、拓扑邻接图、重复实体查找以及日志的耗时，
+/// 结果以JSON格式输出，并可以与保存的基线结果比较，用于发现性能回退。
+///
+/// 用法:
+///   bench_occt [--cubes N] [--fasteners N] [--brackets N] [--frames N] [--picks N]
+///              [--output result.json] [--baseline baseline.json] [--tolerance 0.2]
+///              [--write-baseline] [--write-scenes dir]
+///
+/// 存在性能回退时返回值为1。
+
+#include "DistanceField.h"
+#include "DuplicateFinder.h"
+#include "FaceStyler.h"
+#include "ImageDumper.h"
+#include "Logger.h"
+#include "ModelView.h"
+#include "ScalarField.h"
+#include "SceneGenerator.h"
+#include "ShapeLoader.h"
+#include "StartupTrace.h"
+#include "TopologyGraph.h"
+#include "WireframeBuffer.h"
+#include "mainwindow.h"
+
+#include <cmath>
+#include <iostream>
+#include <random>
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QSysInfo>
+#include <QThread>
+
+#include <AIS_ColoredShape.hxx>
+#include <AIS_Shape.hxx>
+#include <BRepBndLib.hxx>
+#include <BRepMesh_IncrementalMesh.hxx>
+#include <BRepTools.hxx>
+#include <BRep_Builder.hxx>
+#include <BRep_Tool.hxx>
+#include <Poly_Triangulation.hxx>
+#include <Standard_Version.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopoDS.hxx>
+#include <TopoDS_Compound.hxx>
+#include <V3d_View.hxx>
+#include <V3d_Viewer.hxx>
+
+#ifndef OCCT_RES_DIR
+#define OCCT_RES_DIR "res"
+#endif
+
+
+namespace
+{
+    struct BenchOptions
+    {
+        int     NbCubes;
+        int     NbFasteners;
+        int     NbBrackets;
+        int     NbFrames;
+        int     NbPicks;
+        double  Tolerance;
+        bool    ToWriteBaseline;
+        QString Output;
+        QString Baseline;
+        QString SceneDir;
+    };
+
+    double elapsedMs(const QElapsedTimer &theTimer)
+    {
+        return theTimer.nsecsElapsed() / 1.0e6;
+    }
+
+    Standard_Integer nbTriangles(const Handle(TopTools_HSequenceOfShape) & theShapes)
+    {
+        Standard_Integer aNb = 0;
+        for (int i = 1; i <= theShapes->Length(); ++i)
+        {
+            for (TopExp_Explorer anExp(theShapes->Value(i), TopAbs_FACE); anExp.More(); anExp.Next())
+            {
+                TopLoc_Location                  aLoc;
+                const Handle(Poly_Triangulation) &aTri = BRep_Tool::Triangulation(TopoDS::Face(anExp.Current()), aLoc);
+                if (!aTri.IsNull())
+                    aNb += aTri->NbTriangles();
+            }
+        }
+        return aNb;
+    }
+
+    /// \brief 单个场景的测量过程
+    class SceneBench
+    {
+    public:
+        SceneBench(MainWindow &theWindow, const BenchOptions &theOptions)
+            : myWindow(theWindow)
+            , myOptions(theOptions)
+        {
+            myView = myWindow.getV3dViewer()->ActiveViewIterator().Value();
+        }
+
+        QJsonObject Run(const Handle(TopTools_HSequenceOfShape) & theShapes, const double theImportMs)
+        {
+            clear();
+
+            QJsonObject aResult;
+            if (theImportMs >= 0.0)
+                aResult["import_ms"] = theImportMs;
+            aResult["shapes"]       = theShapes->Length();
+            aResult["mesh_ms"]      = mesh(theShapes);
+            aResult["triangles"]    = nbTriangles(theShapes);
+            aResult["display_ms"]   = display(theShapes);
+            aResult["pick_ms"]      = pick();
+            aResult["fps"]          = redraw();
+            aResult["selection_ms"] = selection();
+            aResult["dump_ms"]      = dump();
+            dumpBurst(aResult);
+            distanceField(theShapes, aResult);
+            scalarField(aResult);
+            wireframe(aResult);
+            faceStyle(aResult);
+            simplify(aResult);
+            topology(theShapes, aResult);
+            duplicates(theShapes, aResult);
+            return aResult;
+        }
+
+    private:
+        void clear()
+        {
+            // 与删除选中对象走同一条路径，面索引、材质、网格外存、简化代理和拓扑缓存不会带到下一个场景
+            Handle(AIS_InteractiveContext) aCtx = myWindow.getContext();
+            AIS_ListOfInteractive          aList;
+            aCtx->ObjectsInside(aList, AIS_KOI_Shape, -1);
+            for (AIS_ListOfInteractive::Iterator anIter(aList); anIter.More(); anIter.Next())
+            {
+                const Handle(AIS_Shape) aShape = Handle(AIS_Shape)::DownCast(anIter.Value());
+                if (!aShape.IsNull())
+                    myWindow.getModelView()->removeShape(aShape, false);
+            }
+            aCtx->UpdateCurrentViewer();
+        }
+
+        double mesh(const Handle(TopTools_HSequenceOfShape) & theShapes)
+        {
+            for (int i = 1; i <= theShapes->Length(); ++i)
+                BRepTools::Clean(theShapes->Value(i));
+
+            QElapsedTimer aTimer;
+            aTimer.start();
+            for (int i = 1; i <= theShapes->Length(); ++i)
+                BRepMesh_IncrementalMesh(theShapes->Value(i), 0.1, Standard_False, 0.5, Standard_True);
+            return elapsedMs(aTimer);
+        }
+
+        double display(const Handle(TopTools_HSequenceOfShape) & theShapes)
+        {
+            Handle(AIS_InteractiveContext) aCtx = myWindow.getContext();
+
+            QElapsedTimer aTimer;
+            aTimer.start();
+            for (int i = 1; i <= theShapes->Length(); ++i)
+            {
+                Handle(AIS_Shape) aShape = new AIS_ColoredShape(theShapes->Value(i));
+                aShape->SetDisplayMode(AIS_Shaded);
+                myWindow.getModelView()->displayShape(aShape, false);
+            }
+            myView->FitAll();
+            aCtx->UpdateCurrentViewer();
+            return elapsedMs(aTimer);
+        }
+
+        //! 在视图中按网格依次做动态拾取并选择，返回总耗时
+        double pick()
+        {
+            Handle(AIS_InteractiveContext) aCtx = myWindow.getContext();
+            Standard_Integer               aW = 0, aH = 0;
+            myView->Window()->Size(aW, aH);
+
+            const int     aSide = (int)std::ceil(std::sqrt((double)myOptions.NbPicks));
+            QElapsedTimer aTimer;
+            aTimer.start();
+            for (int i = 0; i < myOptions.NbPicks; ++i)
+            {
+                const Standard_Integer x = (i % aSide + 1) * aW / (aSide + 1);
+                const Standard_Integer y = (i / aSide + 1) * aH / (aSide + 1);
+                aCtx->MoveTo(x, y, myView, Standard_False);
+                if (aCtx->HasDetected())
+                    aCtx->Select(Standard_False);
+            }
+            const double aMs = elapsedMs(aTimer);
+
+            aCtx->ClearSelected(Standard_False);
+            return aMs;
+        }
+
+        //! 连续重绘，返回平均帧率
+        double redraw()
+        {
+            QElapsedTimer aTimer;
+            aTimer.start();
+            for (int i = 0; i < myOptions.NbFrames; ++i)
+            {
+                myView->Invalidate();
+                myView->Redraw();
+            }
+            const double aMs = elapsedMs(aTimer);
+            return aMs > 0.0 ? myOptions.NbFrames * 1000.0 / aMs : 0.0;
+        }
+
+        //! 选中全部对象后重复处理选择变化，DEBUG日志在运行期关闭，用于确认日志不增加选择路径的开销
+        double selection()
+        {
+            Handle(AIS_InteractiveContext) aCtx = myWindow.getContext();
+            AIS_ListOfInteractive          aList;
+            aCtx->DisplayedObjects(AIS_KOI_Shape, -1, aList);
+            aCtx->ClearSelected(Standard_False);
+            for (AIS_ListOfInteractive::Iterator anIter(aList); anIter.More(); anIter.Next())
+                aCtx->AddOrRemoveSelected(anIter.Value(), Standard_False);
+
+            QElapsedTimer aTimer;
+            aTimer.start();
+            for (int i = 0; i < 100; ++i)
+                myWindow.onSelectionChanged();
+            const double aMs = elapsedMs(aTimer);
+
+            aCtx->ClearSelected(Standard_False);
+            return aMs;
+        }
+
+        double dump()
+        {
+            const QString                 aFile = QDir::temp().filePath("bench_occt_dump.png");
+            const TCollection_AsciiString anUtf8Path(aFile.toUtf8().data());
+
+            QElapsedTimer aTimer;
+            aTimer.start();
+            myView->Dump(anUtf8Path.ToCString());
+            const double aMs = elapsedMs(aTimer);
+
+            QFile::remove(aFile);
+            return aMs;
+        }
+
+        //! 连续异步导出，分别统计GUI线程占用时间与全部编码完成的时间
+        void dumpBurst(QJsonObject &theResult)
+        {
+            const int   aNbDumps = 10;
+            ImageDumper aDumper;
+
+            QElapsedTimer aTimer;
+            aTimer.start();
+            for (int i = 0; i < aNbDumps; ++i)
+                aDumper.Dump(myView, QDir::temp().filePath(QString("bench_occt_dump_%1.png").arg(i)));
+            theResult["dump_async_gui_ms"] = elapsedMs(aTimer);
+
+            aDumper.waitForDone();
+            theResult["dump_async_total_ms"] = elapsedMs(aTimer);
+
+            for (int i = 0; i < aNbDumps; ++i)
+                QFile::remove(QDir::temp().filePath(QString("bench_occt_dump_%1.png").arg(i)));
+        }
+
+        //! 距离场：建立耗时与内存，以及场景包围盒内100万个随机点的批量查询吞吐率
+        void distanceField(const Handle(TopTools_HSequenceOfShape) & theShapes, QJsonObject &theResult)
+        {
+            DistanceField aField;
+            if (aField.Build(myWindow.getContext()) == 0)
+                return;
+
+            Bnd_Box aBox;
+            for (int i = 1; i <= theShapes->Length(); ++i)
+                BRepBndLib::Add(theShapes->Value(i), aBox, Standard_True);
+            Standard_Real aMin[3], aMax[3];
+            aBox.Get(aMin[0], aMin[1], aMin[2], aMax[0], aMax[1], aMax[2]);
+
+            const int          aNb = 1000000;
+            std::vector<float> x(aNb), y(aNb), z(aNb), d(aNb);
+            std::mt19937       aRandom(20240601);
+            std::uniform_real_distribution<float> u(0.0f, 1.0f);
+            for (int i = 0; i < aNb; ++i)
+            {
+                x[i] = (float)(aMin[0] + (aMax[0] - aMin[0]) * u(aRandom));
+                y[i] = (float)(aMin[1] + (aMax[1] - aMin[1]) * u(aRandom));
+                z[i] = (float)(aMin[2] + (aMax[2] - aMin[2]) * u(aRandom));
+            }
+            aField.Query(x.data(), y.data(), z.data(), aNb, d.data());
+
+            const DistanceField::Statistics &aStats = aField.Stats();
+            theResult["sdf_build_ms"]     = aStats.BuildMs;
+            theResult["sdf_memory_mb"]    = aStats.MemoryBytes / 1048576.0;
+            theResult["sdf_query_ms"]     = aStats.QueryMs;
+            theResult["sdf_queries_per_s"] = aStats.Throughput();
+            theResult["sdf_exact_ratio"]  = (double)aStats.NbExact / aStats.NbQueries;
+        }
+
+        //! 标量场：已显示对象的按顶点值整体更新一次的耗时(不含重绘)
+        void scalarField(QJsonObject &theResult)
+        {
+            AIS_ListOfInteractive aList;
+            myWindow.getContext()->DisplayedObjects(AIS_KOI_Shape, -1, aList);
+
+            qint64 aNbVertices = 0;
+            double aMs         = 0.0;
+            for (AIS_ListOfInteractive::Iterator anIter(aList); anIter.More(); anIter.Next())
+            {
+                Handle(ScalarField) aField = new ScalarField(Handle(AIS_Shape)::DownCast(anIter.Value()));
+                std::vector<float>  aValues(aField->NbVertices());
+                for (size_t i = 0; i < aValues.size(); ++i)
+                    aValues[i] = (float)(i % 1024);
+                aField->SetVertexValues(0, aField->NbVertices(), aValues.data(), Standard_False);
+                aNbVertices += aField->NbVertices();
+                aMs += aField->LastUpdateMs();
+            }
+            theResult["scalar_vertices"]  = (double)aNbVertices;
+            theResult["scalar_update_ms"] = aMs;
+        }
+
+        //! 线框显示：逐对象AIS_WireFrame与合并的WireframeBuffer，比较构建时间、图元组数和帧时间
+        void wireframe(QJsonObject &theResult)
+        {
+            Handle(AIS_InteractiveContext) aCtx = myWindow.getContext();
+            AIS_ListOfInteractive          aList;
+            aCtx->DisplayedObjects(AIS_KOI_Shape, -1, aList);
+
+            std::vector<Handle(AIS_Shape)> aShapes;
+            for (AIS_ListOfInteractive::Iterator anIter(aList); anIter.More(); anIter.Next())
+                aShapes.push_back(Handle(AIS_Shape)::DownCast(anIter.Value()));
+
+            QElapsedTimer aTimer;
+            aTimer.start();
+            for (size_t i = 0; i < aShapes.size(); ++i)
+                aCtx->SetDisplayMode(aShapes[i], AIS_WireFrame, Standard_False);
+            aCtx->UpdateCurrentViewer();
+            theResult["wireframe_ms"] = elapsedMs(aTimer);
+
+            Standard_Integer aNbGroups = 0;
+            for (size_t i = 0; i < aShapes.size(); ++i)
+                aNbGroups += WireframeBuffer::CountGroups(aShapes[i]);
+            theResult["wireframe_groups"]   = aNbGroups;
+            theResult["wireframe_frame_ms"] = 1000.0 / std::max(1.0e-3, redraw());
+
+            aTimer.restart();
+            Handle(WireframeBuffer) aBuffer = new WireframeBuffer(aShapes);
+            for (size_t i = 0; i < aShapes.size(); ++i)
+                aCtx->Erase(aShapes[i], Standard_False);
+            aCtx->Display(aBuffer, 0, 0, Standard_False);
+            aCtx->UpdateCurrentViewer();
+            theResult["wireframe_merged_ms"]       = elapsedMs(aTimer);
+            theResult["wireframe_merged_groups"]   = WireframeBuffer::CountGroups(aBuffer);
+            theResult["wireframe_merged_edges"]    = aBuffer->GetStats().NbEdges;
+            theResult["wireframe_merged_frame_ms"] = 1000.0 / std::max(1.0e-3, redraw());
+
+            aCtx->Remove(aBuffer, Standard_False);
+            for (size_t i = 0; i < aShapes.size(); ++i)
+                aCtx->Display(aShapes[i], AIS_Shaded, 0, Standard_False);
+            aCtx->UpdateCurrentViewer();
+        }
+
+        //! 按面着色：每个对象隔一个面着色，对比对象内的面样式(首次设置与再次改色)和拆分为每个面一个AIS_Shape
+        void faceStyle(QJsonObject &theResult)
+        {
+            Handle(AIS_InteractiveContext) aCtx = myWindow.getContext();
+            AIS_ListOfInteractive          aList;
+            aCtx->DisplayedObjects(AIS_KOI_Shape, -1, aList);
+
+            std::vector<Handle(AIS_ColoredShape)>  aShapes;
+            std::vector<std::vector<TopoDS_Shape>> aFaces;
+            Standard_Integer                       aNbFaces = 0;
+            for (AIS_ListOfInteractive::Iterator anIter(aList); anIter.More(); anIter.Next())
+            {
+                Handle(AIS_ColoredShape) aShape = Handle(AIS_ColoredShape)::DownCast(anIter.Value());
+                if (aShape.IsNull())
+                    continue;
+
+                aShapes.push_back(aShape);
+                aFaces.push_back(std::vector<TopoDS_Shape>());
+                Standard_Integer i = 0;
+                for (TopExp_Explorer anExp(aShape->Shape(), TopAbs_FACE); anExp.More(); anExp.Next(), ++i)
+                {
+                    if (i % 2 == 0)
+                        aFaces.back().push_back(anExp.Current());
+                }
+                aNbFaces += (Standard_Integer)aFaces.back().size();
+            }
+            if (aShapes.empty())
+                return;
+
+            QElapsedTimer aTimer;
+            aTimer.start();
+            for (size_t i = 0; i < aShapes.size(); ++i)
+                FaceStyler::Apply(aCtx, aShapes[i], aFaces[i], Quantity_NOC_RED, 0.0);
+            aCtx->UpdateCurrentViewer();
+            theResult["face_style_faces"] = aNbFaces;
+            theResult["face_style_ms"]    = elapsedMs(aTimer);
+
+            aTimer.restart();
+            for (size_t i = 0; i < aShapes.size(); ++i)
+                FaceStyler::Apply(aCtx, aShapes[i], aFaces[i], Quantity_NOC_BLUE1, 0.0);
+            aCtx->UpdateCurrentViewer();
+            theResult["face_style_update_ms"] = elapsedMs(aTimer);
+            theResult["face_style_frame_ms"]  = 1000.0 / std::max(1.0e-3, redraw());
+
+            for (size_t i = 0; i < aShapes.size(); ++i)
+                FaceStyler::Reset(aCtx, aShapes[i], aFaces[i]);
+
+            // 拆分：源对象隐藏，每个面一个对象
+            std::vector<Handle(AIS_Shape)> anExploded;
+            aTimer.restart();
+            for (size_t i = 0; i < aShapes.size(); ++i)
+            {
+                aCtx->Erase(aShapes[i], Standard_False);
+                Standard_Integer j = 0;
+                for (TopExp_Explorer anExp(aShapes[i]->Shape(), TopAbs_FACE); anExp.More(); anExp.Next(), ++j)
+                {
+                    Handle(AIS_Shape) aFace = new AIS_Shape(anExp.Current());
+                    aFace->SetLocalTransformation(aShapes[i]->LocalTransformation());
+                    if (j % 2 == 0)
+                        aFace->SetColor(Quantity_NOC_RED);
+                    aCtx->Display(aFace, AIS_Shaded, 0, Standard_False);
+                    anExploded.push_back(aFace);
+                }
+            }
+            aCtx->UpdateCurrentViewer();
+            theResult["face_explode_objects"]  = (double)anExploded.size();
+            theResult["face_explode_ms"]       = elapsedMs(aTimer);
+            theResult["face_explode_frame_ms"] = 1000.0 / std::max(1.0e-3, redraw());
+
+            for (size_t i = 0; i < anExploded.size(); ++i)
+                aCtx->Remove(anExploded[i], Standard_False);
+            for (size_t i = 0; i < aShapes.size(); ++i)
+                aCtx->Display(aShapes[i], AIS_Shaded, 0, Standard_False);
+            aCtx->UpdateCurrentViewer();
+        }
+
+        //! 去特征简化显示：简化(去特征与剖分)耗时、三角形数，以及全部以简化形状显示时的帧率(与fps比较)
+        void simplify(QJsonObject &theResult)
+        {
+            Handle(AIS_InteractiveContext) aCtx = myWindow.getContext();
+            AIS_ListOfInteractive          aList;
+            aCtx->DisplayedObjects(AIS_KOI_Shape, -1, aList);
+            std::vector<Handle(AIS_Shape)> aShapes;
+            for (AIS_ListOfInteractive::Iterator anIter(aList); anIter.More(); anIter.Next())
+            {
+                Handle(AIS_Shape) aShape = Handle(AIS_Shape)::DownCast(anIter.Value());
+                if (!aShape.IsNull())
+                    aShapes.push_back(aShape);
+            }
+
+            DisplaySimplifier &aSimplifier = myWindow.getModelView()->getSimplifier();
+            aSimplifier.Add(aShapes);
+            const DisplaySimplifier::Statistics &aStats = aSimplifier.Stats();
+            theResult["simplify_ms"]              = aStats.BuildMs;
+            theResult["simplify_objects"]         = aStats.NbObjects;
+            theResult["simplify_faces_removed"]   = aStats.NbFacesRemoved;
+            theResult["simplify_triangles_exact"] = (double)aStats.TrianglesExact;
+            theResult["simplify_triangles"]       = (double)aStats.TrianglesSimplified;
+
+            aSimplifier.SetMode(DisplaySimplifier::Mode_Simplified);
+            aSimplifier.UpdateView();
+            theResult["simplify_fps"] = redraw();
+
+            aSimplifier.SetMode(DisplaySimplifier::Mode_Auto);
+            aSimplifier.Clear();
+            aCtx->UpdateCurrentViewer();
+        }
+
+        //! 重复实体查找：指纹与校验耗时、重复组数与实体数，以及共享后可释放的三角网格(MB)
+        void duplicates(const Handle(TopTools_HSequenceOfShape) & theShapes, QJsonObject &theResult)
+        {
+            std::vector<TopoDS_Shape> aShapes;
+            for (int i = 1; i <= theShapes->Length(); ++i)
+                aShapes.push_back(theShapes->Value(i));
+
+            DuplicateFinder aFinder;
+            aFinder.Perform(aShapes);
+            const DuplicateFinder::Statistics &aStats = aFinder.Stats();
+            theResult["dedupe_fingerprint_ms"] = aStats.FingerprintMs;
+            theResult["dedupe_verify_ms"]      = aStats.VerifyMs;
+            theResult["dedupe_groups"]         = aStats.NbGroups;
+            theResult["dedupe_duplicates"]     = aStats.NbDuplicates;
+            theResult["dedupe_saved_mb"]       = aStats.SavedBytes / (1024.0 * 1024.0);
+        }
+
+        //! 拓扑邻接图：全部形状(复合体)的构建耗时与内存，以及逐面遍历共边邻居和连通分量分析的耗时
+        void topology(const Handle(TopTools_HSequenceOfShape) & theShapes, QJsonObject &theResult)
+        {
+            TopoDS_Compound aCompound;
+            BRep_Builder    aBuilder;
+            aBuilder.MakeCompound(aCompound);
+            for (int i = 1; i <= theShapes->Length(); ++i)
+                aBuilder.Add(aCompound, theShapes->Value(i));
+
+            Handle(TopologyGraph) aGraph = new TopologyGraph(aCompound);
+
+            QElapsedTimer aTimer;
+            aTimer.start();
+            qint64 aNbNeighbors = 0;
+            for (Standard_Integer f = 0; f < aGraph->NbFaces(); ++f)
+                aNbNeighbors += aGraph->FaceFaces(f).Size();
+            std::vector<Standard_Integer> aLabels;
+            const Standard_Integer        aNbComponents = aGraph->Components(aLabels);
+
+            theResult["topology_build_ms"]   = aGraph->BuildMs();
+            theResult["topology_faces"]      = aGraph->NbFaces();
+            theResult["topology_memory_mb"]  = aGraph->MemorySize() / 1048576.0;
+            theResult["topology_degree"]     = aGraph->NbFaces() > 0 ? (double)aNbNeighbors / aGraph->NbFaces() : 0.0;
+            theResult["topology_components"] = aNbComponents;
+            theResult["topology_query_ms"]   = elapsedMs(aTimer);
+        }
+
+    private:
+        MainWindow &        myWindow;
+        const BenchOptions &myOptions;
+        Handle(V3d_View) myView;
+    };
+
+    //! 日志开销：运行期关闭时调用100万次的耗时，以及开启时写入10万条的耗时(不含写线程)
+    QJsonObject logging()
+    {
+        Logger &  aLogger = Logger::Instance();
+        const int aLevel  = aLogger.Level();
+
+        QJsonObject   aResult;
+        QElapsedTimer aTimer;
+        // 运行期关闭的日志：直接用LOG_AT，不受编译期级别影响(Release中LOG_DEBUG展开为空语句)；
+        // 每次循环写volatile计数，循环不会被整体优化掉
+        aLogger.SetLevel(LOG_LEVEL_INFO);
+        volatile int aCalls = 0;
+        aTimer.start();
+        for (int i = 0; i < 1000000; ++i)
+        {
+            LOG_AT(LOG_LEVEL_DEBUG, "bench", "disabled " << i << " " << std::sqrt((double)i));
+            aCalls = aCalls + 1;
+        }
+        aResult["log_off_ms"]    = elapsedMs(aTimer);
+        aResult["log_off_calls"] = (int)aCalls;
+
+        // 分批写入，每批之后等待写线程写完，避免缓冲区满时丢弃
+        aLogger.SetLevel(LOG_LEVEL_DEBUG);
+        double aMs = 0.0;
+        for (int aBatch = 0; aBatch < 25; ++aBatch)
+        {
+            aTimer.restart();
+            for (int i = 0; i < 4000; ++i)
+                LOG_AT(LOG_LEVEL_DEBUG, "bench", "enabled " << i << " " << std::sqrt((double)i));
+            aMs += elapsedMs(aTimer);
+            aLogger.Flush();
+        }
+        aResult["log_on_ms"]   = aMs;
+        aResult["log_dropped"] = (double)aLogger.Dropped();
+
+        aLogger.SetLevel(aLevel);
+        return aResult;
+    }
+
+    //! 与基线比较，"_ms"结尾的指标越小越好，fps越大越好
+    QJsonArray compare(const QJsonObject &theScenes, const QJsonObject &theBaseline, const double theTolerance)
+    {
+        QJsonArray aRegressions;
+        for (QJsonObject::const_iterator aScene = theScenes.begin(); aScene != theScenes.end(); ++aScene)
+        {
+            const QJsonObject aBase = theBaseline.value(aScene.key()).toObject();
+            const QJsonObject aCur  = aScene.value().toObject();
+            for (QJsonObject::const_iterator aMetric = aCur.begin(); aMetric != aCur.end(); ++aMetric)
+            {
+                if (!aBase.contains(aMetric.key()))
+                    continue;
+
+                const double aOld = aBase.value(aMetric.key()).toDouble();
+                const double aNew = aMetric.value().toDouble();
+                bool         isRegressed = false;
+                if (aMetric.key().endsWith("_ms"))
+                    isRegressed = aNew > aOld * (1.0 + theTolerance);
+                else if (aMetric.key() == "fps")
+                    isRegressed = aNew < aOld * (1.0 - theTolerance);
+
+                if (isRegressed)
+                {
+                    QJsonObject aItem;
+                    aItem["scene"]    = aScene.key();
+                    aItem["metric"]   = aMetric.key();
+                    aItem["baseline"] = aOld;
+                    aItem["current"]  = aNew;
+                    aRegressions.append(aItem);
+                }
+            }
+        }
+        return aRegressions;
+    }
+}    // namespace
+
+
+int main(int argc, char **argv)
+{
+    QApplication a(argc, argv);
+
+    QCommandLineParser aParser;
+    aParser.setApplicationDescription("OpenCASCADE benchmark");
+    aParser.addHelpOption();
+    aParser.addOption(QCommandLineOption("cubes", "number of cube101010.step copies", "N", "1000"));
+    aParser.addOption(QCommandLineOption("fasteners", "number of fasteners", "N", "400"));
+    aParser.addOption(QCommandLineOption("brackets", "number of filleted brackets", "N", "100"));
+    aParser.addOption(QCommandLineOption("frames", "frames for redraw FPS", "N", "100"));
+    aParser.addOption(QCommandLineOption("picks", "number of pick positions", "N", "100"));
+    aParser.addOption(QCommandLineOption("output", "write JSON results to file", "file"));
+    aParser.addOption(QCommandLineOption("baseline", "baseline JSON file", "file",
+                                         QString(OCCT_RES_DIR) + "/bench_baseline.json"));
+    aParser.addOption(QCommandLineOption("tolerance", "allowed relative regression", "ratio", "0.2"));
+    aParser.addOption(QCommandLineOption("write-baseline", "store the results as the new baseline"));
+    aParser.addOption(QCommandLineOption("write-scenes", "write synthetic scenes as STEP and snapshot", "dir"));
+    aParser.process(a);
+
+    BenchOptions anOptions;
+    anOptions.NbCubes         = aParser.value("cubes").toInt();
+    anOptions.NbFasteners     = aParser.value("fasteners").toInt();
+    anOptions.NbBrackets      = aParser.value("brackets").toInt();
+    anOptions.NbFrames        = aParser.value("frames").toInt();
+    anOptions.NbPicks         = aParser.value("picks").toInt();
+    anOptions.Tolerance       = aParser.value("tolerance").toDouble();
+    anOptions.ToWriteBaseline = aParser.isSet("write-baseline");
+    anOptions.Output          = aParser.value("output");
+    anOptions.Baseline        = aParser.value("baseline");
+    anOptions.SceneDir        = aParser.value("write-scenes");
+
+    // 日志只写文件，标准输出保留给JSON结果
+    const QString aLogConf = QDir::temp().filePath("bench_occt_log.conf");
+    QFile         aLogConfFile(aLogConf);
+    if (aLogConfFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        aLogConfFile.write("log4cpp.rootCategory=INFO, file\n"
+                           "log4cpp.appender.file=FileAppender\n"
+                           "log4cpp.appender.file.append=false\n"
+                           "log4cpp.appender.file.fileName=" + QDir::temp().filePath("bench_occt.log").toUtf8() + "\n");
+        aLogConfFile.close();
+        Logger::Instance().Configure(aLogConf);
+    }
+
+    // 冷启动：从创建图形驱动到主视图绘制出第一帧
+    StartupTrace::Start();
+    MainWindow::PrepareGraphicDriver();
+    MainWindow w;
+    w.show();
+    QElapsedTimer aFirstFrameTimer;
+    aFirstFrameTimer.start();
+    while (StartupTrace::FirstFrameMs() < 0.0 && aFirstFrameTimer.elapsed() < 5000)
+        a.processEvents(QEventLoop::AllEvents, 10);
+    a.processEvents();
+
+    SceneBench  aBench(w, anOptions);
+    QJsonObject aScenes;
+
+    QJsonObject aStartup;
+    aStartup["first_frame_ms"] = StartupTrace::FirstFrameMs();
+    aScenes["startup"]         = aStartup;
+
+    // 文件场景：直接导入res/cube101010.step
+    Handle(TopTools_HSequenceOfShape) aCube = new TopTools_HSequenceOfShape;
+    QElapsedTimer                     aTimer;
+    aTimer.start();
+    if (!ShapeLoader::ReadStep(OCCT_RES_DIR "/cube101010.step", aCube) || aCube->IsEmpty())
+    {
+        std::cerr << "cannot read " << OCCT_RES_DIR << "/cube101010.step" << std::endl;
+        return 2;
+    }
+    aScenes["step_cube"] = aBench.Run(aCube, elapsedMs(aTimer));
+
+    // 合成场景，由SceneGenerator按固定种子生成
+    SceneGenerator::Options aCubeOptions;
+    aCubeOptions.NbSolids = anOptions.NbCubes;
+    aCubeOptions.Spacing  = 20.0;
+    aCubeOptions.ToCopy   = Standard_True;
+
+    SceneGenerator::Options aFastenerOptions;
+    aFastenerOptions.NbSolids    = anOptions.NbFasteners;
+    aFastenerOptions.Spacing     = 25.0;
+    aFastenerOptions.Placement   = SceneGenerator::Layout_Random;
+    aFastenerOptions.MaxRotation = M_PI;
+    aFastenerOptions.ToCopy      = Standard_True;
+
+    SceneGenerator::Options aBracketOptions;
+    aBracketOptions.NbSolids = anOptions.NbBrackets;
+    aBracketOptions.Spacing  = 80.0;
+    aBracketOptions.ToCopy   = Standard_True;
+
+    Handle(TopTools_HSequenceOfShape) aGround = new TopTools_HSequenceOfShape;
+    aGround->Append(SceneGenerator::MakeGround(1000, 1000));
+
+    QMap<QString, Handle(TopTools_HSequenceOfShape)> aSynthetic;
+    aSynthetic["cubes"]        = SceneGenerator::Replicate(aCube->Value(1), aCubeOptions);
+    aSynthetic["ground_prism"] = aGround;
+    aSynthetic["fasteners"]    = SceneGenerator::Replicate(SceneGenerator::MakeFastener(), aFastenerOptions);
+    aSynthetic["brackets"]     = SceneGenerator::Replicate(SceneGenerator::MakeBracket(), aBracketOptions);
+
+    for (QMap<QString, Handle(TopTools_HSequenceOfShape)>::const_iterator anIter = aSynthetic.begin();
+         anIter != aSynthetic.end(); ++anIter)
+    {
+        aScenes[anIter.key()] = aBench.Run(anIter.value(), -1.0);
+
+        if (!anOptions.SceneDir.isEmpty())
+        {
+            const TopoDS_Shape aCompound = SceneGenerator::MakeCompound(anIter.value());
+            const QString      aBase     = QDir(anOptions.SceneDir).filePath(anIter.key());
+            SceneGenerator::WriteStep(aCompound, TCollection_AsciiString((aBase + ".step").toUtf8().data()));
+            SceneGenerator::WriteSnapshot(aCompound, TCollection_AsciiString((aBase + ".bbrep").toUtf8().data()));
+        }
+    }
+
+    aScenes["logging"] = logging();
+
+    QJsonObject aMachine;
+    aMachine["os"]      = QSysInfo::prettyProductName();
+    aMachine["cpu"]     = QSysInfo::currentCpuArchitecture();
+    aMachine["threads"] = QThread::idealThreadCount();
+    aMachine["occt"]    = OCC_VERSION_COMPLETE;
+
+    QJsonObject aResult;
+    aResult["machine"] = aMachine;
+    aResult["scenes"]  = aScenes;
+
+    bool  isRegressed = false;
+    QFile aBaselineFile(anOptions.Baseline);
+    if (!anOptions.ToWriteBaseline && aBaselineFile.open(QIODevice::ReadOnly))
+    {
+        const QJsonObject aBaseline = QJsonDocument::fromJson(aBaselineFile.readAll()).object();
+        const QJsonArray  aRegressions =
+            compare(aScenes, aBaseline.value("scenes").toObject(), anOptions.Tolerance);
+        aResult["regressions"] = aRegressions;
+        isRegressed            = !aRegressions.isEmpty();
+    }
+
+    const QByteArray aJson = QJsonDocument(aResult).toJson();
+    std::cout << aJson.toStdString() << std::endl;
+
+    if (!anOptions.Output.isEmpty())
+    {
+        QFile anOut(anOptions.Output);
+        if (anOut.open(QIODevice::WriteOnly))
+            anOut.write(aJson);
+    }
+
+    if (anOptions.ToWriteBaseline)
+    {
+        QFile anOut(anOptions.Baseline);
+        if (anOut.open(QIODevice::WriteOnly))
+            anOut.write(aJson);
+    }
+
+    return isRegressed ? 1 : 0;
+}
@@ -1,12 +1,47 @@
+#include "CommandServer.h"
+#include "Logger.h"
+#include "StartupTrace.h"
 #include "mainwindow.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
 #include<AIS_Axis.hxx>
 
 int main(int argc, char *argv[])
 {
+    StartupTrace::Start();
     QApplication a(argc, argv);
+    StartupTrace::Mark("application");
+
+    // 图形驱动在后台创建，与日志配置和界面构建重叠
+    MainWindow::PrepareGraphicDriver();
+
+    // 日志配置随程序发布，日志文件写在当前工作目录下
+    Logger::Instance().Configure(":/data/res/log4cpp.conf");
+    StartupTrace::Mark("logger");
+
+    // --server: 常驻模式，通过本地套接字接收命令(见CommandServer、occt_client)
+    QCommandLineParser aParser;
+    aParser.addHelpOption();
+    aParser.addOption(QCommandLineOption("server", "run as a persistent command server"));
+    aParser.addOption(QCommandLineOption("name", "local socket name of the server", "name", CommandServer::THE_DEFAULT_NAME));
+    aParser.process(a);
+
     MainWindow w;
     w.show();
-    return a.exec();
+    StartupTrace::Mark("window shown");
+
+    if (aParser.isSet("server"))
+    {
+        CommandServer *aServer = new CommandServer(w.getContext(), w.getModelView(), &w);
+        if (!aServer->Listen(aParser.value("name")))
+        {
+            Logger::Instance().Shutdown();
+            return 1;
+        }
+    }
+    const int ret = a.exec();
+
+    Logger::Instance().Shutdown();
+    return ret;
 }
@@ -1,19 +1,28 @@
 #include "mainwindow.h"
 
 #include "Gglobal.h"
+#include "GltfExporter.h"
+#include "InputReplay.h"
 #include "ModelView.h"
-
-#include <iostream>
+#include "SectionTool.h"
+#include "StartupTrace.h"
+#include "StepExporter.h"
+#include "ViewLayout.h"
 
 #include <QApplication>
 #include <QColor>
 #include <QColorDialog>
+#include <QComboBox>
 #include <QDir>
 #include <QFile>
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QFrame>
+#include <QIcon>
+#include <QInputDialog>
 #include <QMessageBox>
+#include <QSlider>
+#include <QStatusBar>
 #include <QToolBar>
 #include <QVBoxLayout>
 
@@ -27,13 +36,46 @@
 #include <TCollection_AsciiString.hxx>
 #include <TopExp_Explorer.hxx>
 
+#include <future>
+
+
+namespace
+{
+    //! 打开显示连接并加载OpenGL库，不依赖Qt，可以在后台线程中执行
+    Handle(OpenGl_GraphicDriver) createGraphicDriver()
+    {
+        Handle(Aspect_DisplayConnection) aDisplayConnection;
+#if !defined(_WIN32) && !defined(__WIN32__) && (!defined(__APPLE__) || defined(MACOSX_USE_GLX))
+        aDisplayConnection = new Aspect_DisplayConnection(OSD_Environment("DISPLAY").Value());
+#endif
+        Handle(OpenGl_GraphicDriver) aDriver = new OpenGl_GraphicDriver(aDisplayConnection);
+        StartupTrace::Mark("graphic driver created");
+        return aDriver;
+    }
+
+    std::future<Handle(OpenGl_GraphicDriver)> ourDriverFuture;
+}    // namespace
 
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
+    , myStepExporter(new StepExporter(this))
+    , mySectionTool(NULL)
+    , mySectionAxis(NULL)
+    , mySectionSlider(NULL)
+    , myRecorder(NULL)
 {
     resize(720, 540);
 
+    // 不依赖图形驱动的界面先构建，与后台的驱动创建(PrepareGraphicDriver)重叠
+    QFrame *     vb     = new QFrame(this);
+    QVBoxLayout *layout = new QVBoxLayout(vb);
+    layout->setMargin(0);
+    vb->setFrameStyle(QFrame::StyledPanel | QFrame::Sunken);
+    setCentralWidget(vb);
+    createFileActions();
+    StartupTrace::Mark("main window frame");
+
     // 获取3D渲染的Context
     TCollection_ExtendedString a3Dname("Visu3D");
 
@@ -46,23 +88,30 @@ MainWindow::MainWindow(QWidget *parent)
 
     // 记录myV3dViewer的context信息
     myContext = new AIS_InteractiveContext(myV3dViewer);
+    mySectionTool = new SectionTool(myContext, this);
 
-    // 初始化一个内部界面布局
-    QFrame *     vb     = new QFrame(this);
-    QVBoxLayout *layout = new QVBoxLayout(vb);
-    layout->setMargin(0);
-    vb->setFrameStyle(QFrame::StyledPanel | QFrame::Sunken);
-    setCentralWidget(vb);
+    // 初始化多视口布局，其中的主视图myView带有viewcube
+    myViewLayout = new ViewLayout(myContext, vb);
+    myView       = myViewLayout->mainView();
+    layout->addWidget(myViewLayout);
+    connect(myViewLayout, SIGNAL(selectionChanged()), this, SLOT(onSelectionChanged()));
+
+    connect(myStepExporter, SIGNAL(documentExported(QString, bool, qint64, double)),
+            this, SLOT(onStepExported(QString, bool, qint64, double)));
+    connect(myView->getDumper(), SIGNAL(imageDumped(int, QString, bool, double, double, double)),
+            this, SLOT(onImageDumped(int, QString, bool, double, double, double)));
+    connect(myView->getBooleans(), SIGNAL(progress(int, double)), this, SLOT(onBooleanProgress(int, double)));
+    connect(myView->getBooleans(), SIGNAL(finished(int, bool, QString, double)),
+            this, SLOT(onBooleanFinished(int, bool, QString, double)));
+    myRecorder = new InputRecorder(myView, this);
 
-    // 初始化带有viewcube的myView
-    myView = new ModelView(myContext, true, vb);
-    layout->addWidget(myView);
-    connect(myView, SIGNAL(selectionChanged()), this, SLOT(onSelectionChanged()));
+    StartupTrace::Mark("views");
 
     // 初始化View、RayTrace控制相关的Toolbar
     createDisplaymodeActions();
     createViewActions();
     createRaytraceActions();
+    StartupTrace::Mark("toolbars");
 
     setStatusTip(tr("鼠标按键: 左键-旋转，Alt+左键-框选, 中键-平移，右键-缩放"));
 }
@@ -90,24 +139,221 @@ void MainWindow::dump()
     QString file((ret == QDialog::Accepted && !fileNames.isEmpty()) ? fileNames[0] : nullptr);
     if (!file.isNull())
     {
-        //更新鼠标指针状态
-        QApplication::setOverrideCursor(Qt::WaitCursor);
         if (!QFileInfo(file).completeSuffix().length())
             file += QString(".bmp");
 
-        const TCollection_AsciiString anUtf8Path(file.toUtf8().data());
+        // GUI线程只读回帧缓冲，图像编码在后台完成，结果由onImageDumped处理
+        if (myView->dumpAsync(file) < 0)
+        {
+            LOG_ERROR("MainWindow", tr("图像导出错误").toStdString());
+        }
+    }
+}
+
+void MainWindow::dumpTiled()
+{
+    bool      ok    = false;
+    const int width = QInputDialog::getInt(this, tr("高分辨率导出"), tr("图像宽度(像素):"), 16384, 256, 65536, 256, &ok);
+    if (!ok)
+        return;
+
+    QString file = QFileDialog::getSaveFileName(this, QObject::tr("导出数据"), QString(), "Images Files (*.png *.ppm)");
+    if (file.isEmpty())
+        return;
+
+    if (!QFileInfo(file).completeSuffix().length())
+        file += QString(".png");
+
+    // 高度按当前窗口的宽高比计算
+    const int height = qMax(1, qRound(double(width) * myView->height() / qMax(1, myView->width())));
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const bool res = myView->dumpTiled(file, width, height);
+    QApplication::restoreOverrideCursor();
+
+    if (!res)
+    {
+        LOG_ERROR("MainWindow", tr("图像导出错误").toStdString());
+    }
+}
 
-        bool res = myView->dump(anUtf8Path.ToCString());
-        QApplication::restoreOverrideCursor();
+void MainWindow::onImageDumped(int theId, QString theFile, bool isOk, double theReadbackMs, double theQueueMs,
+                               double theEncodeMs)
+{
+    if (!isOk)
+    {
+        LOG_ERROR("MainWindow", tr("图像导出错误: %1").arg(theFile).toStdString());
+        return;
+    }
 
+    LOG_INFO("MainWindow", tr("图像导出完成[%1]: %2, readback %3 ms, queue %4 ms, encode %5 ms")
+                               .arg(theId)
+                               .arg(theFile)
+                               .arg(theReadbackMs, 0, 'f', 1)
+                               .arg(theQueueMs, 0, 'f', 1)
+                               .arg(theEncodeMs, 0, 'f', 1)
+                               .toStdString());
+}
 
-        if (!res)
+void MainWindow::onBooleanProgress(int theId, double theFraction)
+{
+    statusBar()->showMessage(tr("布尔运算[%1]: %2%").arg(theId).arg((int)(theFraction * 100.0)));
+}
+
+void MainWindow::onBooleanFinished(int theId, bool isOk, QString theMessage, double theMs)
+{
+    statusBar()->clearMessage();
+    if (!isOk)
+    {
+        LOG_WARN("MainWindow", tr("布尔运算[%1]失败: %2").arg(theId).arg(theMessage).toStdString());
+        return;
+    }
+
+    LOG_INFO("MainWindow", tr("布尔运算[%1]完成: %2 ms").arg(theId).arg(theMs, 0, 'f', 1).toStdString());
+}
+
+void MainWindow::exportStep()
+{
+    QString file = QFileDialog::getSaveFileName(this, QObject::tr("导出STEP"), QString(),
+                                                "STEP Files (*.step *.stp *.step.gz *.stp.gz)");
+    if (file.isEmpty())
+        return;
+
+    if (!QFileInfo(file).completeSuffix().length())
+        file += QString(".step");
+
+    // 在GUI线程中收集当前场景，转换与写文件在后台线程中完成
+    QList<StepExporter::Document> docs;
+    docs.append(StepExporter::Collect(myContext, myView->getMaterials(), file));
+    myStepExporter->Export(docs);
+}
+
+void MainWindow::exportGltf()
+{
+    QString file = QFileDialog::getSaveFileName(this, QObject::tr("导出glTF"), QString(), "glTF Binary (*.glb)");
+    if (file.isEmpty())
+        return;
+
+    if (!QFileInfo(file).completeSuffix().length())
+        file += QString(".glb");
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    GltfExporter::Statistics stats;
+    bool                     res = false;
+    {
+        // 导出读取形状的三角网格，换出的对象先换入
+        MeshStorePin pin(myView->getMeshStore(), myView->displayedShapes());
+        res = GltfExporter().Export(myContext, myView->getMaterials(), file, &stats);
+    }
+    QApplication::restoreOverrideCursor();
+
+    if (!res)
+    {
+        LOG_ERROR("MainWindow", tr("glTF导出错误: %1").arg(file).toStdString());
+        return;
+    }
+
+    LOG_INFO("MainWindow", tr("glTF导出完成: %1, %2 nodes, %3 meshes, %4 triangles, %5/%6 vertices, %7 KB, "
+                           "mesh %8 ms, encode %9 ms, write %10 ms")
+                               .arg(file)
+                               .arg(stats.NbNodes)
+                               .arg(stats.NbMeshes)
+                               .arg(stats.NbTriangles)
+                               .arg(stats.NbVertices)
+                               .arg(stats.NbRawVertices)
+                               .arg(stats.Bytes / 1024)
+                               .arg(stats.MeshMs, 0, 'f', 1)
+                               .arg(stats.EncodeMs, 0, 'f', 1)
+                               .arg(stats.WriteMs, 0, 'f', 1)
+                               .toStdString());
+}
+
+void MainWindow::toggleMeshStore(bool isOn)
+{
+    if (!isOn)
+    {
+        myView->disableMeshStore();
+        return;
+    }
+
+    bool      ok     = false;
+    const int budget = QInputDialog::getInt(this, tr("网格外存存储"), tr("常驻内存预算(MB):"), 512, 16, 65536, 64, &ok);
+    if (ok && !myView->enableMeshStore(QDir::temp().filePath("occt_meshstore.bin"), budget * 1048576LL))
+    {
+        LOG_ERROR("MainWindow", tr("网格外存存储启用失败").toStdString());
+        ok = false;
+    }
+    if (!ok)
+    {
+        QAction *a = qobject_cast<QAction *>(sender());
+        if (a != nullptr)
         {
-            std::cout << tr("图像导出错误").toStdString() << std::endl;
+            a->blockSignals(true);
+            a->setChecked(false);
+            a->blockSignals(false);
         }
     }
 }
 
+void MainWindow::toggleSection(bool isOn)
+{
+    mySectionAxis->setEnabled(isOn);
+    mySectionSlider->setEnabled(isOn);
+    mySectionTool->SetEnabled(isOn);
+    if (isOn)
+        onSectionMoved();
+}
+
+void MainWindow::toggleRecording(bool isOn)
+{
+    if (!isOn)
+    {
+        myRecorder->Stop();
+        return;
+    }
+
+    const QString file = QFileDialog::getSaveFileName(this, QObject::tr("录制输入"), QString(), "Input Recordings (*.rec)");
+    if (file.isEmpty() || !myRecorder->Start(file))
+    {
+        QAction *a = qobject_cast<QAction *>(sender());
+        if (a != nullptr)
+        {
+            a->blockSignals(true);
+            a->setChecked(false);
+            a->blockSignals(false);
+        }
+    }
+}
+
+void MainWindow::onSectionMoved()
+{
+    if (!mySectionTool->IsEnabled())
+        return;
+
+    const SectionTool::Axis anAxis = (SectionTool::Axis)mySectionAxis->currentIndex();
+    double                  aMin = 0.0, aMax = 0.0;
+    if (!mySectionTool->Range(anAxis, aMin, aMax))
+        return;
+
+    const double aPos = aMin + (aMax - aMin) * mySectionSlider->value() / mySectionSlider->maximum();
+    mySectionTool->SetPlane(anAxis, aPos, mySectionSlider->isSliderDown());
+}
+
+void MainWindow::onStepExported(QString theFile, bool isOk, qint64 theBytes, double theThroughput)
+{
+    if (!isOk)
+    {
+        LOG_ERROR("MainWindow", tr("STEP导出错误: %1").arg(theFile).toStdString());
+        return;
+    }
+
+    LOG_INFO("MainWindow", tr("STEP导出完成: %1, %2 MB, %3 MB/s")
+                               .arg(theFile)
+                               .arg(theBytes / 1048576.0, 0, 'f', 1)
+                               .arg(theThroughput, 0, 'f', 1)
+                               .toStdString());
+}
+
 void MainWindow::onSelectionChanged()
 {
     updateDisplaymodeActionEnableStat(myContext->NbSelected());
@@ -116,11 +362,21 @@ void MainWindow::onSelectionChanged()
     for (myContext->InitSelected(); myContext->MoreSelected(); myContext->NextSelected())
     {
         Handle_AIS_Shape shape = Handle_AIS_Shape::DownCast(myContext->SelectedInteractive());
-        std::cout << QString("面%1被选择").arg(shape->Shape().HashCode(SHAPE_MAXHASHCODE)).toStdString();
+        if (shape.IsNull())
+            continue;
+
+        // DEBUG级别关闭时不计算哈希，也不格式化消息
+        LOG_DEBUG("MainWindow", "面" << shape->Shape().HashCode(SHAPE_MAXHASHCODE) << "被选择");
     }
 
 }
 
+void MainWindow::PrepareGraphicDriver()
+{
+    if (!ourDriverFuture.valid())
+        ourDriverFuture = std::async(std::launch::async, createGraphicDriver);
+}
+
 Handle(V3d_Viewer) MainWindow::Viewer(const Standard_ExtString    theName,
                                       const Standard_CString      theDomain,
                                       const Standard_Real         theViewSize,
@@ -133,11 +389,9 @@ Handle(V3d_Viewer) MainWindow::Viewer(const Standard_ExtString    theName,
 
     if (aGraphicDriver.IsNull())
     {
-        Handle(Aspect_DisplayConnection) aDisplayConnection;
-#if !defined(_WIN32) && !defined(__WIN32__) && (!defined(__APPLE__) || defined(MACOSX_USE_GLX))
-        aDisplayConnection = new Aspect_DisplayConnection(OSD_Environment("DISPLAY").Value());
-#endif
-        aGraphicDriver = new OpenGl_GraphicDriver(aDisplayConnection);
+        // 优先使用PrepareGraphicDriver在后台创建的驱动
+        aGraphicDriver = ourDriverFuture.valid() ? ourDriverFuture.get() : createGraphicDriver();
+        StartupTrace::Mark("graphic driver");
     }
 
     Handle(V3d_Viewer) aViewer = new V3d_Viewer(aGraphicDriver);
@@ -179,12 +433,90 @@ void MainWindow::updateDisplaymodeActionEnableStat(const int nSels)
     }
 }
 
+void MainWindow::createFileActions()
+{
+    QToolBar *aToolbar = addToolBar(tr("File Operations"));
+
+    QAction *a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/document.png")), tr("Export STEP"), this);
+    a->setToolTip(tr("Export STEP"));
+    a->setStatusTip(tr("Export STEP"));
+    connect(a, SIGNAL(triggered()), this, SLOT(exportStep()));
+    aToolbar->addAction(a);
+
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/cascade.png")), tr("Export glTF"), this);
+    a->setToolTip(tr("Export glTF"));
+    a->setStatusTip(tr("Export glTF"));
+    connect(a, SIGNAL(triggered()), this, SLOT(exportGltf()));
+    aToolbar->addAction(a);
+
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/tile.png")), tr("Dump Image"), this);
+    a->setToolTip(tr("Dump Image"));
+    a->setStatusTip(tr("Dump Image"));
+    connect(a, SIGNAL(triggered()), this, SLOT(dump()));
+    aToolbar->addAction(a);
+
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/view_fitarea.png")), tr("Dump Large Image"), this);
+    a->setToolTip(tr("Dump Large Image"));
+    a->setStatusTip(tr("Dump Large Image"));
+    connect(a, SIGNAL(triggered()), this, SLOT(dumpTiled()));
+    aToolbar->addAction(a);
+
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/new.png")), tr("Out-of-core Meshes"), this);
+    a->setToolTip(tr("Out-of-core Meshes"));
+    a->setStatusTip(tr("Out-of-core Meshes"));
+    a->setCheckable(true);
+    connect(a, SIGNAL(toggled(bool)), this, SLOT(toggleMeshStore(bool)));
+    aToolbar->addAction(a);
+}
+
 void MainWindow::createViewActions()
 {
     // populate a tool bar with some actions
     QToolBar *aToolBar = addToolBar(tr("View Operations"));
     aToolBar->addActions(myView->getViewActions());
 
+    // 四视口布局切换
+    QAction *a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/view_comp_on.png")), tr("Quad View"), this);
+    a->setToolTip(tr("Quad View"));
+    a->setStatusTip(tr("Quad View"));
+    a->setCheckable(true);
+    connect(a, SIGNAL(toggled(bool)), myViewLayout, SLOT(toggleQuad(bool)));
+    aToolBar->addSeparator();
+    aToolBar->addAction(a);
+
+    // 剖切平面：轴向与位置，拖动滑块时平面跟随移动
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/view_comp_off.png")), tr("Section"), this);
+    a->setToolTip(tr("Section"));
+    a->setStatusTip(tr("Section"));
+    a->setCheckable(true);
+    connect(a, SIGNAL(toggled(bool)), this, SLOT(toggleSection(bool)));
+    aToolBar->addAction(a);
+
+    mySectionAxis = new QComboBox(aToolBar);
+    mySectionAxis->addItems(QStringList() << "X" << "Y" << "Z");
+    mySectionAxis->setCurrentIndex(SectionTool::Axis_Z);
+    mySectionAxis->setEnabled(false);
+    connect(mySectionAxis, SIGNAL(currentIndexChanged(int)), this, SLOT(onSectionMoved()));
+    aToolBar->addWidget(mySectionAxis);
+
+    mySectionSlider = new QSlider(Qt::Horizontal, aToolBar);
+    mySectionSlider->setRange(0, 1000);
+    mySectionSlider->setValue(500);
+    mySectionSlider->setMaximumWidth(160);
+    mySectionSlider->setEnabled(false);
+    connect(mySectionSlider, SIGNAL(valueChanged(int)), this, SLOT(onSectionMoved()));
+    connect(mySectionSlider, SIGNAL(sliderReleased()), this, SLOT(onSectionMoved()));
+    aToolBar->addWidget(mySectionSlider);
+
+    // 录制鼠标输入和视图操作，用InputReplayer回放做交互性能测试
+    a = new QAction(QIcon(QString::fromUtf8(":/common/res/common/lamp.png")), tr("Record Input"), this);
+    a->setToolTip(tr("Record Input"));
+    a->setStatusTip(tr("Record Input"));
+    a->setCheckable(true);
+    connect(a, SIGNAL(toggled(bool)), this, SLOT(toggleRecording(bool)));
+    aToolBar->addSeparator();
+    aToolBar->addAction(a);
+
     aToolBar->toggleViewAction()->setVisible(false);
     myView->getViewAction(ModelView::ViewHlrOffId)->setChecked(true);
 }
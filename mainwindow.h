@@ -8,7 +8,13 @@
 #include <Standard_Handle.hxx>
 #include <V3d_View.hxx>
 
+class InputRecorder;
 class ModelView;
+class QComboBox;
+class QSlider;
+class SectionTool;
+class StepExporter;
+class ViewLayout;
 
 
 class MainWindow : public QMainWindow
@@ -23,11 +29,28 @@ public:
     inline Handle(AIS_InteractiveContext) getContext() { return myContext; }
     /// \brief 获取ModelView
     inline Handle(V3d_Viewer) & getV3dViewer() { return myV3dViewer; }
+    /// \brief 获取主渲染窗口
+    inline ModelView *getModelView() { return myView; }
+
+    /// \brief 在后台线程中提前创建图形驱动(显示连接与OpenGL库加载)，与Qt界面的构建重叠。
+    /// 在QApplication创建之后、MainWindow构造之前调用；不调用时由构造函数同步创建
+    static void PrepareGraphicDriver();
 
 
 public slots:
     void dump();
+    void dumpTiled();
+    void exportStep();
+    void exportGltf();
+    void toggleMeshStore(bool isOn);
+    void toggleSection(bool isOn);
+    void toggleRecording(bool isOn);
+    void onSectionMoved();
     void onSelectionChanged();
+    void onImageDumped(int theId, QString theFile, bool isOk, double theReadbackMs, double theQueueMs, double theEncodeMs);
+    void onStepExported(QString theFile, bool isOk, qint64 theBytes, double theThroughput);
+    void onBooleanProgress(int theId, double theFraction);
+    void onBooleanFinished(int theId, bool isOk, QString theMessage, double theMs);
 
 
 private:
@@ -42,12 +65,19 @@ private:
     void updateDisplaymodeActionEnableStat(const int nSels);
 
 protected:
+    void createFileActions();
     void createViewActions();
     void createRaytraceActions();
     void createDisplaymodeActions();
     Handle(V3d_Viewer) myV3dViewer;
     Handle(AIS_InteractiveContext) myContext;    /// \brief AIS绘图上下文
 
-    ModelView *myView;
+    ModelView *   myView;            /// \brief 主视图
+    ViewLayout *  myViewLayout;      /// \brief 多视口布局，共享myContext
+    StepExporter *myStepExporter;    /// \brief 后台STEP导出
+    SectionTool * mySectionTool;     /// \brief 剖切平面
+    QComboBox *   mySectionAxis;
+    QSlider *     mySectionSlider;
+    InputRecorder *myRecorder;       /// \brief 输入录制，回放见InputReplayer
 };
 #endif    // MAINWINDOW_H
@@ -0,0 +1,185 @@
+/// \brief occt_client.cpp
+///
+/// 常驻模式(OpenCascade_Learn --server)的命令行客户端与吞吐量测试。
+///
+/// 用法:
+///   occt_client [--server name] ['{"cmd": "load", "file": "a.step"}' ...]
+///       发送命令行中的请求(没有时逐行读取标准输入)，请求全部连续发出(流水线)，
+///       应答按顺序逐行输出。缺少id的请求按顺序编号。任一请求失败时返回值为1。
+///
+///   occt_client [--server name] --bench N [--depth D] [--request json]
+///       吞吐量测试：发送N个请求(默认ping)，先逐个等待应答，再保持D个请求在途，
+///       以JSON格式输出两种方式的请求速率和延迟分位数。
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalSocket>
+#include <QTextStream>
+
+
+namespace
+{
+    //! 与CommandServer::THE_DEFAULT_NAME一致；客户端只依赖QtNetwork
+    const char *const THE_DEFAULT_NAME = "occt_learn";
+    const int         THE_TIMEOUT_MS   = 600000;
+
+    //! 读取一行应答，连接断开或超时返回false
+    bool readReply(QLocalSocket &theSocket, QJsonObject &theReply)
+    {
+        while (!theSocket.canReadLine())
+        {
+            if (!theSocket.waitForReadyRead(THE_TIMEOUT_MS))
+                return false;
+        }
+        theReply = QJsonDocument::fromJson(theSocket.readLine()).object();
+        return true;
+    }
+
+    double percentile(std::vector<double> &theValues, const double p)
+    {
+        if (theValues.empty())
+            return 0.0;
+
+        std::sort(theValues.begin(), theValues.end());
+        const size_t anIndex = (size_t)std::max(0.0, std::ceil(p * theValues.size()) - 1.0);
+        return theValues[std::min(anIndex, theValues.size() - 1)];
+    }
+
+    //! 发送theNb个请求，最多theDepth个在途
+    QJsonObject bench(QLocalSocket &theSocket, const QJsonObject &theRequest, const int theNb, const int theDepth)
+    {
+        std::vector<QElapsedTimer> aSent(theNb);
+        std::vector<double>        aLatency;
+        aLatency.reserve(theNb);
+
+        QElapsedTimer aTotal;
+        aTotal.start();
+        int aNbSent = 0, aNbFailed = 0;
+        while ((int)aLatency.size() < theNb)
+        {
+            QByteArray aBatch;
+            while (aNbSent < theNb && aNbSent - (int)aLatency.size() < theDepth)
+            {
+                QJsonObject aRequest = theRequest;
+                aRequest["id"]       = aNbSent;
+                aBatch += QJsonDocument(aRequest).toJson(QJsonDocument::Compact) + '\n';
+                aSent[aNbSent++].start();
+            }
+            if (!aBatch.isEmpty())
+            {
+                theSocket.write(aBatch);
+                theSocket.flush();
+            }
+
+            QJsonObject aReply;
+            if (!readReply(theSocket, aReply))
+                break;
+
+            const int anId = aReply.value("id").toInt();
+            if (anId >= 0 && anId < aNbSent)
+                aLatency.push_back(aSent[anId].nsecsElapsed() / 1.0e6);
+            if (!aReply.value("ok").toBool())
+                ++aNbFailed;
+        }
+        const double aTotalMs = aTotal.nsecsElapsed() / 1.0e6;
+
+        QJsonObject aResult;
+        aResult["requests"] = (int)aLatency.size();
+        aResult["failed"]   = aNbFailed;
+        aResult["depth"]    = theDepth;
+        aResult["total_ms"] = aTotalMs;
+        aResult["rps"]      = aTotalMs > 0.0 ? aLatency.size() * 1000.0 / aTotalMs : 0.0;
+        aResult["p50_ms"]   = percentile(aLatency, 0.50);
+        aResult["p99_ms"]   = percentile(aLatency, 0.99);
+        return aResult;
+    }
+}    // namespace
+
+
+int main(int argc, char **argv)
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser aParser;
+    aParser.setApplicationDescription("OpenCascade_Learn server client");
+    aParser.addHelpOption();
+    aParser.addOption(QCommandLineOption("server", "local socket name", "name", THE_DEFAULT_NAME));
+    aParser.addOption(QCommandLineOption("bench", "throughput test with N requests", "N"));
+    aParser.addOption(QCommandLineOption("depth", "requests in flight during the throughput test", "D", "32"));
+    aParser.addOption(QCommandLineOption("request", "request used by the throughput test", "json", "{\"cmd\": \"ping\"}"));
+    aParser.addPositionalArgument("requests", "JSON requests, read from stdin when omitted");
+    aParser.process(a);
+
+    QLocalSocket aSocket;
+    aSocket.connectToServer(aParser.value("server"));
+    if (!aSocket.waitForConnected(5000))
+    {
+        std::cerr << "cannot connect to " << aParser.value("server").toStdString() << ": "
+                  << aSocket.errorString().toStdString() << std::endl;
+        return 2;
+    }
+
+    if (aParser.isSet("bench"))
+    {
+        const QJsonObject aRequest = QJsonDocument::fromJson(aParser.value("request").toUtf8()).object();
+        const int         aNb      = aParser.value("bench").toInt();
+
+        QJsonObject aResult;
+        aResult["sequential"] = bench(aSocket, aRequest, aNb, 1);
+        aResult["pipelined"]  = bench(aSocket, aRequest, aNb, std::max(1, aParser.value("depth").toInt()));
+        std::cout << QJsonDocument(aResult).toJson().toStdString() << std::endl;
+        return 0;
+    }
+
+    QStringList aLines = aParser.positionalArguments();
+    if (aLines.isEmpty())
+    {
+        QTextStream anInput(stdin);
+        while (!anInput.atEnd())
+        {
+            const QString aLine = anInput.readLine().trimmed();
+            if (!aLine.isEmpty())
+                aLines.append(aLine);
+        }
+    }
+
+    // 请求全部发出后再依次读取应答
+    QByteArray aBatch;
+    for (int i = 0; i < aLines.size(); ++i)
+    {
+        QJsonParseError anError;
+        QJsonObject     aRequest = QJsonDocument::fromJson(aLines[i].toUtf8(), &anError).object();
+        if (anError.error != QJsonParseError::NoError)
+        {
+            std::cerr << "invalid request: " << aLines[i].toStdString() << std::endl;
+            return 2;
+        }
+        if (!aRequest.contains("id"))
+            aRequest["id"] = i + 1;
+        aBatch += QJsonDocument(aRequest).toJson(QJsonDocument::Compact) + '\n';
+    }
+    aSocket.write(aBatch);
+    aSocket.flush();
+
+    bool isOk = true;
+    for (int i = 0; i < aLines.size(); ++i)
+    {
+        QJsonObject aReply;
+        if (!readReply(aSocket, aReply))
+        {
+            std::cerr << "connection closed" << std::endl;
+            return 2;
+        }
+        isOk = isOk && aReply.value("ok").toBool();
+        std::cout << QJsonDocument(aReply).toJson(QJsonDocument::Compact).toStdString() << std::endl;
+    }
+    return isOk ? 0 : 1;
+}
@@ -1,9 +1,31 @@
 #ifndef TEST_GEOM_CPP
 #define TEST_GEOM_CPP
 
+#include "BooleanService.h"
+#include "CommandServer.h"
+#include "DisplaySimplifier.h"
+#include "DistanceField.h"
+#include "DuplicateFinder.h"
+#include "FaceIndex.h"
+#include "FaceStyler.h"
+#include "ImageDumper.h"
+#include "ModelView.h"
+#include "PointCloudLayer.h"
+#include "ScalarField.h"
+#include "SceneGenerator.h"
+#include "SectionTool.h"
+#include "ShapeHealer.h"
+#include "ShapeLoader.h"
+#include "TopologyGraph.h"
+#include "WireframeBuffer.h"
 #include "mainwindow.h"
 
 #include <QApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonObject>
 
 #include <cppunit/extensions/HelperMacros.h>
 #include <cppunit/extensions/TestFactoryRegistry.h>
@@ -14,26 +36,36 @@
 #include <Eigen/Core>
 #include <Eigen/StdList>
 
+#include <BRep_Builder.hxx>
 #include <BRep_Tool.hxx>               //用于从TopoDS_Shape数据转化为Geom_Surface数据
 #include <GCPnts_AbscissaPoint.hxx>    //用于计算Curve的长度
 #include <GeomAPI_IntCS.hxx>           //用于计算Curve和Surface的交点
 //#include <GeomLProp.hxx>            //用于计算3维目标物体的局部特征，比如法线和曲率
 #include <AIS_Shape.hxx>
+#include <BRepAdaptor_Surface.hxx>
 #include <BRepBuilderAPI.hxx>
 #include <BRepBuilderAPI_MakeEdge.hxx>
 #include <BRepBuilderAPI_MakeFace.hxx>
+#include <BRepGProp.hxx>
+#include <BRepFilletAPI_MakeFillet.hxx>
+#include <BRepMesh_IncrementalMesh.hxx>
+#include <BRepPrimAPI_MakeBox.hxx>
 #include <BRepPrimAPI_MakePrism.hxx>
 #include <BRepTools.hxx>
 #include <GeomAdaptor_Curve.hxx>
+#include <GProp_GProps.hxx>
 #include <GeomLProp_SLProps.hxx>    //专门用于计算目标物体的局部法向量
 #include <GeomTools.hxx>            //Geom的相关工具
 #include <Geom_Line.hxx>
 #include <Geom_Plane.hxx>
 #include <Geom_Surface.hxx>
 #include <STEPControl_Reader.hxx>
+#include <TopExp.hxx>
 #include <TopExp_Explorer.hxx>
 #include <TopTools_HSequenceOfShape.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
 #include <TopoDS.hxx>
+#include <TopoDS_Compound.hxx>
 #include <TopoDS_Edge.hxx>
 #include <TopoDS_Shape.hxx>
 
@@ -44,6 +76,22 @@ class t_brepbuild : public CppUnit::TestFixture
 {
     CPPUNIT_TEST_SUITE(t_brepbuild);
     CPPUNIT_TEST(t_surface);
+    CPPUNIT_TEST(t_clash);
+    CPPUNIT_TEST(t_scene);
+    CPPUNIT_TEST(t_dump_tiled);
+    CPPUNIT_TEST(t_face_index);
+    CPPUNIT_TEST(t_section);
+    CPPUNIT_TEST(t_distance_field);
+    CPPUNIT_TEST(t_point_cloud);
+    CPPUNIT_TEST(t_scalar_field);
+    CPPUNIT_TEST(t_command_server);
+    CPPUNIT_TEST(t_wireframe_buffer);
+    CPPUNIT_TEST(t_topology_graph);
+    CPPUNIT_TEST(t_face_styler);
+    CPPUNIT_TEST(t_boolean_service);
+    CPPUNIT_TEST(t_shape_healer);
+    CPPUNIT_TEST(t_display_simplifier);
+    CPPUNIT_TEST(t_duplicate_finder);
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -58,13 +106,14 @@ public:
     {
         Handle_AIS_InteractiveContext ctx    = m.getContext();
         Handle_V3d_Viewer             viewer = m.getV3dViewer();
+        ModelView *                   view   = m.getModelView();
 
         // 获取Shape的选择模式，默认使用的是Face模式
         const int aSubShapeSelMode = AIS_Shape::SelectionMode(TopAbs_FACE);
         for (int i = 1; i <= aSequence->Size(); i++)
         {
             Handle_AIS_Shape aShape = new AIS_Shape(aSequence->Value(i));
-            ctx->Display(aShape, false);
+            view->displayShape(aShape, false);
             ctx->SetDisplayMode(aShape, AIS_Shaded, false);    /// > brief 配置shape的显示模式为shaded，也就是有表面
             ctx->Activate(aShape, aSubShapeSelMode);           ///< brief 激活shape的子对象选择模式
         }
@@ -107,6 +156,598 @@ public:
         redraw();
     }
 
+    /// \brief 空间索引：两个相交的立方体应当被检出干涉，远处的立方体不应被检出
+    void t_clash()
+    {
+        aSequence->Clear();
+        aSequence->Append(BRepPrimAPI_MakeBox(gp_Pnt(0, 0, 0), 10, 10, 10).Shape());
+        aSequence->Append(BRepPrimAPI_MakeBox(gp_Pnt(5, 5, 5), 10, 10, 10).Shape());
+        aSequence->Append(BRepPrimAPI_MakeBox(gp_Pnt(100, 0, 0), 10, 10, 10).Shape());
+        redraw();
+
+        ShapeIndex &index = m.getModelView()->getShapeIndex();
+        CPPUNIT_ASSERT(index.Size() >= 3);
+
+        std::vector<ShapeIndex::ClashPair> clashes = index.Clashes(0.0);
+        CPPUNIT_ASSERT_EQUAL((size_t)1, clashes.size());
+
+        // 第三个立方体与第二个相距85mm，与第一个相距90mm
+        std::vector<Handle(AIS_Shape)> all;
+        Bnd_Box                        box;
+        box.Update(-1000, -1000, -1000, 1000, 1000, 1000);
+        index.Query(box, all);
+
+        Handle(AIS_Shape) far;
+        for (size_t i = 0; i < all.size(); ++i)
+        {
+            if (all[i]->Shape().IsSame(aSequence->Value(3)))
+                far = all[i];
+        }
+        CPPUNIT_ASSERT(!far.IsNull());
+        CPPUNIT_ASSERT(index.Proximity(far, 50.0).empty());
+        CPPUNIT_ASSERT_EQUAL((size_t)1, index.Proximity(far, 88.0).size());
+    }
+
+    /// \brief 场景生成器：相同种子生成相同场景，快照文件可以完整读回
+    void t_scene()
+    {
+        SceneGenerator::Options opt;
+        opt.NbSolids    = 64;
+        opt.Placement   = SceneGenerator::Layout_Random;
+        opt.MaxRotation = M_PI / 4;
+
+        TopoDS_Shape                      cube = BRepPrimAPI_MakeBox(10, 10, 10).Shape();
+        Handle(TopTools_HSequenceOfShape) s1   = SceneGenerator::Replicate(cube, opt);
+        Handle(TopTools_HSequenceOfShape) s2   = SceneGenerator::Replicate(cube, opt);
+        CPPUNIT_ASSERT_EQUAL(64, s1->Length());
+        // 每次Replicate都新建TopLoc_Datum3D，Location的==只比较datum，只能比较变换本身
+        for (int i = 1; i <= s1->Length(); i++)
+        {
+            const gp_Trsf t1 = s1->Value(i).Location().Transformation();
+            const gp_Trsf t2 = s2->Value(i).Location().Transformation();
+            for (int row = 1; row <= 3; row++)
+            {
+                for (int col = 1; col <= 4; col++)
+                    CPPUNIT_ASSERT_DOUBLES_EQUAL(t1.Value(row, col), t2.Value(row, col), 1.0e-9);
+            }
+        }
+
+        const QString file = QDir::temp().filePath("t_scene.bbrep");
+        TopoDS_Shape  snapshot;
+        CPPUNIT_ASSERT(SceneGenerator::WriteSnapshot(SceneGenerator::MakeCompound(s1), file.toUtf8().data()));
+        CPPUNIT_ASSERT(SceneGenerator::ReadSnapshot(file.toUtf8().data(), snapshot));
+
+        int nSolids = 0;
+        for (TopExp_Explorer exp(snapshot, TopAbs_SOLID); exp.More(); exp.Next())
+            nSolids++;
+        CPPUNIT_ASSERT_EQUAL(64, nSolids);
+        QFile::remove(file);
+    }
+
+    /// \brief 分块导出：小分块与小内存预算下得到多个条带，输出尺寸与请求一致
+    void t_dump_tiled()
+    {
+        aSequence->Clear();
+        aSequence->Append(BRepPrimAPI_MakeBox(10, 10, 10).Shape());
+        redraw();
+
+        const QString            file = QDir::temp().filePath("t_dump_tiled.ppm");
+        ImageDumper::TiledReport report;
+        CPPUNIT_ASSERT(ImageDumper::DumpTiled(m.getV3dViewer()->ActiveViews().First(), file, 3000, 1000, 1024,
+                                              3000 * 3 * 256, &report));
+        CPPUNIT_ASSERT_EQUAL(3 * 4, (int)report.NbTiles);
+        CPPUNIT_ASSERT_EQUAL((qint64)sizeof("P6\n3000 1000\n255\n") - 1 + 3000 * 1000 * 3, QFileInfo(file).size());
+        QFile::remove(file);
+    }
+
+    /// \brief 面属性表：相似面只匹配面积与法向都相同的面，包围盒条件只命中范围内的对象
+    void t_face_index()
+    {
+        Handle(AIS_Shape) box1 = new AIS_Shape(BRepPrimAPI_MakeBox(10, 10, 10).Shape());
+        Handle(AIS_Shape) box2 = new AIS_Shape(BRepPrimAPI_MakeBox(gp_Pnt(100, 0, 0), 20, 10, 10).Shape());
+
+        FaceIndex index;
+        index.Add(box1);
+        index.Add(box2);
+        index.Update();
+        CPPUNIT_ASSERT_EQUAL(12, index.Size());
+
+        FaceIndex::Query planes;
+        planes.SurfaceType = GeomAbs_Plane;
+        CPPUNIT_ASSERT_EQUAL((size_t)12, index.Find(planes).size());
+
+        int sample = -1;
+        for (TopExp_Explorer exp(box1->Shape(), TopAbs_FACE); exp.More() && sample < 0; exp.Next())
+        {
+            const int row = index.Row(box1, exp.Current());
+            if (row >= 0 && std::fabs(index.Normal(row).Z()) > 0.9)
+                sample = row;
+        }
+        CPPUNIT_ASSERT(sample >= 0);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(100.0, index.Area(sample), 1.0e-3);
+
+        // box2的X向面积也是100，但法向不同
+        std::vector<Standard_Integer> similar = index.Find(FaceIndex::Query::Similar(index, sample));
+        CPPUNIT_ASSERT_EQUAL((size_t)2, similar.size());
+        for (size_t i = 0; i < similar.size(); ++i)
+            CPPUNIT_ASSERT(index.Object(similar[i]) == box1);
+
+        FaceIndex::Query near2;
+        near2.Box.Update(90, -1, -1, 130, 11, 11);
+        CPPUNIT_ASSERT_EQUAL((size_t)6, index.Find(near2).size());
+
+        // 移动box1后包围盒在下一次查询前重新计算
+        gp_Trsf move;
+        move.SetTranslation(gp_Vec(100, 0, 0));
+        box1->SetLocalTransformation(move);
+        CPPUNIT_ASSERT_EQUAL((size_t)12, index.Find(near2).size());
+
+        index.Remove(box1);
+        CPPUNIT_ASSERT_EQUAL(6, index.Size());
+        CPPUNIT_ASSERT(index.Object(0) == box2);
+    }
+
+    /// \brief 剖切：精确截线完成后放入缓存，回到同一位置时命中缓存
+    void t_section()
+    {
+        aSequence->Clear();
+        aSequence->Append(BRepPrimAPI_MakeBox(gp_Pnt(0, 0, 0), 10, 10, 10).Shape());
+        redraw();
+
+        SectionTool tool(m.getContext());
+        tool.SetEnabled(true);
+
+        double zmin = 0.0, zmax = 0.0;
+        CPPUNIT_ASSERT(tool.Range(SectionTool::Axis_Z, zmin, zmax));
+        CPPUNIT_ASSERT(zmin <= 0.0 && zmax >= 10.0);
+
+        tool.SetPlane(SectionTool::Axis_Z, 5.0, false);
+        tool.waitForDone();
+        QApplication::processEvents();
+        CPPUNIT_ASSERT_EQUAL((qint64)1, tool.Stats().Jobs);
+
+        tool.SetPlane(SectionTool::Axis_Z, 7.0, true);
+        tool.SetPlane(SectionTool::Axis_Z, 5.0, false);
+        CPPUNIT_ASSERT_EQUAL((qint64)1, tool.Stats().CacheHits);
+        tool.SetEnabled(false);
+    }
+
+    /// \brief 距离场：立方体中心在内部，表面附近的符号由精确分类确定，网格外返回MaxDistance
+    void t_distance_field()
+    {
+        TopoDS_Shape box = BRepPrimAPI_MakeBox(10, 10, 10).Shape();
+        BRepMesh_IncrementalMesh(box, 0.1);
+
+        TopTools_ListOfShape solids;
+        solids.Append(box);
+        DistanceField field;
+        CPPUNIT_ASSERT_EQUAL(1, field.Build(solids));
+        CPPUNIT_ASSERT(field.Stats().NbFineBricks > 0);
+        CPPUNIT_ASSERT(field.Stats().NbFineBricks < field.Stats().NbBricks);
+
+        // 中心所在的块只有块中心距离，误差不超过块的半对角线
+        CPPUNIT_ASSERT(field.IsInside(gp_Pnt(5, 5, 5)));
+        CPPUNIT_ASSERT(field.Distance(gp_Pnt(5, 5, 5)) < -2.5);
+
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(0.2, field.Distance(gp_Pnt(10.2, 5, 5)), 0.1);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(-0.2, field.Distance(gp_Pnt(9.8, 5, 5)), 0.1);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(field.GetOptions().MaxDistance, field.Distance(gp_Pnt(100, 5, 5)), 1.0e-6);
+        CPPUNIT_ASSERT(field.Stats().NbExact >= 2);
+    }
+
+    /// \brief 点云：1m立方体每面按SAMPLE_RESOLUTIONS采样11x11个点；跨块改写颜色
+    void t_point_cloud()
+    {
+        PointCloudLayer *cloud = m.getModelView()->getPointCloud();
+        cloud->Clear();
+
+        std::vector<float> xyz, normals;
+        const qint64       nb = PointCloudLayer::Sample(BRepPrimAPI_MakeBox(1000, 1000, 1000).Shape(),
+                                                  SAMPLE_RESOLUTIONS, xyz, normals);
+        CPPUNIT_ASSERT(nb >= 6 * 9 * 9 && nb <= 6 * 11 * 11);
+        CPPUNIT_ASSERT_EQUAL((size_t)nb * 3, normals.size());
+
+        const qint64 n = PointCloudLayer::THE_CHUNK_SIZE + 10;
+        xyz.assign(n * 3, 0.0f);
+        for (qint64 i = 0; i < n; ++i)
+            xyz[i * 3] = (float)i * 0.001f;
+        CPPUNIT_ASSERT_EQUAL((qint64)0, cloud->Add(xyz.data(), NULL, NULL, n));
+        CPPUNIT_ASSERT_EQUAL(2, cloud->Stats().NbChunks);
+        CPPUNIT_ASSERT_EQUAL(n, cloud->NbPoints());
+
+        // 跨块改写颜色：范围内各级别的点都是新颜色，范围外仍为默认的灰色
+        const qint64               first = PointCloudLayer::THE_CHUNK_SIZE - 100;
+        std::vector<unsigned char> rgb(200 * 3);
+        for (int i = 0; i < 200; ++i)
+        {
+            rgb[i * 3]     = (unsigned char)i;
+            rgb[i * 3 + 1] = 10;
+            rgb[i * 3 + 2] = 20;
+        }
+        cloud->SetColors(first, 200, rgb.data());
+        CPPUNIT_ASSERT_EQUAL(2, cloud->Stats().NbChunks);
+
+        unsigned char color[3];
+        CPPUNIT_ASSERT(cloud->PointColor(first - 1, 0, color));
+        CPPUNIT_ASSERT_EQUAL(160, (int)color[0]);
+        CPPUNIT_ASSERT(cloud->PointColor(first + 199, 0, color));
+        CPPUNIT_ASSERT_EQUAL(199, (int)color[0]);
+        CPPUNIT_ASSERT(cloud->PointColor(first + 200, 0, color));
+        CPPUNIT_ASSERT_EQUAL(160, (int)color[0]);
+        for (int level = 1; level <= 2; ++level)
+        {
+            for (qint64 p = first; p < first + 200; ++p)
+            {
+                if (!cloud->PointColor(p, level, color))
+                    continue;
+                CPPUNIT_ASSERT_EQUAL((int)(p - first), (int)color[0]);
+                CPPUNIT_ASSERT_EQUAL(20, (int)color[2]);
+            }
+        }
+
+        // 抽稀级别按块内序号的散列选取，与PointCloudLayer中的规则相同
+        qint64 expected[3] = { n, 0, 0 };
+        for (qint64 i = 0; i < n; ++i)
+        {
+            const unsigned int hash = (unsigned int)(i % PointCloudLayer::THE_CHUNK_SIZE) * 2654435761u;
+            if ((hash >> 29) == 0)
+                ++expected[1];
+            if ((hash >> 26) == 0)
+                ++expected[2];
+        }
+        CPPUNIT_ASSERT(expected[1] > n / 10 && expected[1] < n / 6);
+        CPPUNIT_ASSERT(expected[2] > n / 80 && expected[2] < n / 48);
+        for (int level = 2; level >= 0; --level)
+        {
+            cloud->SetLevel(level);
+            CPPUNIT_ASSERT_EQUAL(expected[level], cloud->NbShownPoints());
+        }
+
+        cloud->Clear();
+        CPPUNIT_ASSERT_EQUAL((qint64)0, cloud->NbPoints());
+    }
+
+    /// \brief 标量场：按面的值填满面的全部顶点，按顶点的更新只改变指定范围
+    void t_scalar_field()
+    {
+        Handle(AIS_Shape) box = new AIS_Shape(BRepPrimAPI_MakeBox(10, 10, 10).Shape());
+        Handle(ScalarField) field = new ScalarField(box);
+        CPPUNIT_ASSERT_EQUAL(6, field->NbFaces());
+        CPPUNIT_ASSERT(field->NbVertices() >= 24);
+
+        std::vector<float> values;
+        for (int f = 0; f < field->NbFaces(); ++f)
+            values.push_back((float)f);
+        field->SetFaceValues(values.data(), Standard_False);
+        field->FitRange(Standard_False);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(0.0, field->RangeMin(), 1.0e-9);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(5.0, field->RangeMax(), 1.0e-9);
+        CPPUNIT_ASSERT_EQUAL(3.0f, field->Value(field->FaceFirstVertex(4)));
+
+        const float v = 7.0f;
+        field->SetVertexValues(field->FaceFirstVertex(2), 1, &v, Standard_False);
+        CPPUNIT_ASSERT_EQUAL(7.0f, field->Value(field->FaceFirstVertex(2)));
+        CPPUNIT_ASSERT_EQUAL(1.0f, field->Value(field->FaceFirstVertex(2) + 1));
+
+        m.getContext()->Display(field, 0, -1, Standard_True);
+        field->SetColormap(ScalarField::Colormap_Viridis);
+        m.getContext()->Remove(field, Standard_True);
+    }
+
+    /// \brief 常驻模式命令：同一文件第二次导入使用缓存的形状，未知对象和材质返回错误
+    void t_command_server()
+    {
+        const QString file = QDir::temp().filePath("t_command_server.step");
+        CPPUNIT_ASSERT(SceneGenerator::WriteStep(BRepPrimAPI_MakeBox(10, 10, 10).Shape(), file.toUtf8().data()));
+
+        CommandServer server(m.getContext(), m.getModelView());
+        QJsonObject   load;
+        load["cmd"]  = "load";
+        load["file"] = file;
+        load["id"]   = 7;
+        const QJsonObject r1 = server.Execute(load);
+        const QJsonObject r2 = server.Execute(load);
+        CPPUNIT_ASSERT(r1.value("ok").toBool());
+        CPPUNIT_ASSERT_EQUAL(7, r1.value("id").toInt());
+        CPPUNIT_ASSERT_EQUAL(2, server.NbObjects());
+
+        QJsonObject props;
+        props["cmd"] = "props";
+        props["object"] = r2.value("ids").toArray().at(0);
+        props["id"]     = 8;
+        const QJsonObject p = server.Execute(props);
+        CPPUNIT_ASSERT_EQUAL(8, p.value("id").toInt());
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(1000.0, p.value("volume").toDouble(), 1.0e-6);
+        CPPUNIT_ASSERT_EQUAL(6, p.value("faces").toInt());
+
+        QJsonObject mesh;
+        mesh["cmd"] = "mesh";
+        CPPUNIT_ASSERT_EQUAL(1, server.Execute(mesh).value("shapes").toInt());
+
+        QJsonObject material;
+        material["cmd"]  = "material";
+        material["name"] = "no such material";
+        CPPUNIT_ASSERT(!server.Execute(material).value("ok").toBool());
+        props["object"] = 1000;
+        CPPUNIT_ASSERT(!server.Execute(props).value("ok").toBool());
+
+        QJsonObject clear;
+        clear["cmd"] = "clear";
+        CPPUNIT_ASSERT(server.Execute(clear).value("ok").toBool());
+        CPPUNIT_ASSERT_EQUAL(0, server.NbObjects());
+        QFile::remove(file);
+    }
+
+    /// \brief 合并线框：同一位置的共用边只画一次，不同位置的实例分别绘制
+    void t_wireframe_buffer()
+    {
+        const TopoDS_Shape box = BRepPrimAPI_MakeBox(10, 10, 10).Shape();
+        Handle(AIS_Shape)  a   = new AIS_Shape(box);
+        Handle(AIS_Shape)  b   = new AIS_Shape(box);
+
+        std::vector<Handle(AIS_Shape)> sources(2, a);
+        Handle(WireframeBuffer) merged = new WireframeBuffer(sources);
+        CPPUNIT_ASSERT_EQUAL(48, merged->GetStats().NbEdgeUses);
+        CPPUNIT_ASSERT_EQUAL(12, merged->NbEdges());
+        CPPUNIT_ASSERT_EQUAL(12, merged->GetStats().NbSegments);
+        CPPUNIT_ASSERT_EQUAL(2, merged->EdgeNbVertices(12));
+
+        gp_Trsf move;
+        move.SetTranslation(gp_Vec(20, 0, 0));
+        b->SetLocalTransformation(move);
+        sources[1] = b;
+        merged     = new WireframeBuffer(sources);
+        CPPUNIT_ASSERT_EQUAL(24, merged->NbEdges());
+
+        m.getContext()->Display(merged, 0, 0, Standard_True);
+        CPPUNIT_ASSERT_EQUAL(1, WireframeBuffer::CountGroups(merged));
+        m.getContext()->Remove(merged, Standard_True);
+    }
+
+    /// \brief 拓扑邻接图：长方体的邻接度数，倒圆角后的相切链，复合体的连通分量
+    void t_topology_graph()
+    {
+        const TopoDS_Shape box = BRepPrimAPI_MakeBox(10, 10, 10).Shape();
+        TopologyGraph      graph(box);
+        CPPUNIT_ASSERT_EQUAL(6, graph.NbFaces());
+        CPPUNIT_ASSERT_EQUAL(12, graph.NbEdges());
+        CPPUNIT_ASSERT_EQUAL(8, graph.NbVertices());
+        for (int f = 0; f < graph.NbFaces(); ++f)
+        {
+            CPPUNIT_ASSERT_EQUAL(4, graph.FaceEdges(f).Size());
+            CPPUNIT_ASSERT_EQUAL(4, graph.FaceFaces(f).Size());
+            CPPUNIT_ASSERT_EQUAL(f, graph.FaceId(graph.Face(f)));
+        }
+        for (int e = 0; e < graph.NbEdges(); ++e)
+        {
+            CPPUNIT_ASSERT_EQUAL(2, graph.EdgeFaces(e).Size());
+            CPPUNIT_ASSERT_EQUAL(2, graph.EdgeVertices(e).Size());
+            CPPUNIT_ASSERT(!graph.IsTangentEdge(e));
+        }
+        for (int v = 0; v < graph.NbVertices(); ++v)
+            CPPUNIT_ASSERT_EQUAL(3, graph.VertexEdges(v).Size());
+
+        CPPUNIT_ASSERT_EQUAL((size_t)5, graph.Grow(std::vector<Standard_Integer>(1, 0)).size());
+        CPPUNIT_ASSERT_EQUAL((size_t)6, graph.Grow(std::vector<Standard_Integer>(1, 0), 2).size());
+        CPPUNIT_ASSERT_EQUAL((size_t)1, graph.TangentChain(0).size());
+
+        // 圆角面与两侧的平面相切
+        BRepFilletAPI_MakeFillet fillet(box);
+        fillet.Add(2.0, TopoDS::Edge(graph.Edge(0)));
+        TopologyGraph rounded(fillet.Shape());
+        CPPUNIT_ASSERT_EQUAL(7, rounded.NbFaces());
+        int cylinder = -1;
+        for (int f = 0; f < rounded.NbFaces(); ++f)
+        {
+            if (BRepAdaptor_Surface(TopoDS::Face(rounded.Face(f))).GetType() == GeomAbs_Cylinder)
+                cylinder = f;
+        }
+        CPPUNIT_ASSERT(cylinder >= 0);
+        CPPUNIT_ASSERT_EQUAL((size_t)3, rounded.TangentChain(cylinder).size());
+
+        TopoDS_Compound compound;
+        BRep_Builder    builder;
+        builder.MakeCompound(compound);
+        builder.Add(compound, box);
+        builder.Add(compound, BRepPrimAPI_MakeBox(gp_Pnt(20, 0, 0), 5, 5, 5).Shape());
+        std::vector<Standard_Integer> labels;
+        CPPUNIT_ASSERT_EQUAL(2, TopologyGraph(compound).Components(labels));
+        CPPUNIT_ASSERT_EQUAL((size_t)12, labels.size());
+        CPPUNIT_ASSERT(labels[0] != labels[11]);
+    }
+
+    /// \brief 按面着色：样式相同的面共享一个外观，新的样式分组需要重新计算，已有样式改色只同步外观
+    void t_face_styler()
+    {
+        Handle(AIS_InteractiveContext) ctx   = m.getContext();
+        Handle(AIS_ColoredShape)       shape = new AIS_ColoredShape(BRepPrimAPI_MakeBox(10, 10, 10).Shape());
+        ctx->Display(shape, AIS_Shaded, 0, Standard_False);
+
+        std::vector<TopoDS_Shape> faces;
+        for (TopExp_Explorer exp(shape->Shape(), TopAbs_FACE); exp.More() && faces.size() < 4; exp.Next())
+            faces.push_back(exp.Current());
+        const TopoDS_Shape last = faces.back();
+        faces.pop_back();
+
+        CPPUNIT_ASSERT(FaceStyler::Apply(ctx, shape, faces, Quantity_NOC_RED));
+        CPPUNIT_ASSERT_EQUAL(3, FaceStyler::NbStyled(shape));
+        CPPUNIT_ASSERT_EQUAL(1, FaceStyler::NbDrawers(shape));
+        CPPUNIT_ASSERT(!FaceStyler::Apply(ctx, shape, faces, Quantity_NOC_BLUE1));
+        CPPUNIT_ASSERT(FaceStyler::Apply(ctx, shape, faces, Quantity_NOC_BLUE1, 0.5));
+        CPPUNIT_ASSERT_EQUAL(1, FaceStyler::NbDrawers(shape));
+
+        // 另一次调用设置相同的样式，加入已有的分组
+        CPPUNIT_ASSERT(FaceStyler::Apply(ctx, shape, std::vector<TopoDS_Shape>(1, last), Quantity_NOC_BLUE1, 0.5));
+        CPPUNIT_ASSERT_EQUAL(4, FaceStyler::NbStyled(shape));
+        CPPUNIT_ASSERT_EQUAL(1, FaceStyler::NbDrawers(shape));
+
+        FaceStyler::Reset(ctx, shape, std::vector<TopoDS_Shape>(1, faces[0]));
+        CPPUNIT_ASSERT_EQUAL(3, FaceStyler::NbStyled(shape));
+        ctx->Remove(shape, Standard_True);
+    }
+
+    /// \brief 后台布尔运算：结果替换对象与工具，取消的任务不改变场景
+    void t_boolean_service()
+    {
+        ModelView *     view    = m.getModelView();
+        BooleanService *service = view->getBooleans();
+
+        Handle(AIS_Shape) ground = new AIS_Shape(SceneGenerator::MakeGround(100, 100, 10));
+        Handle(AIS_Shape) box    = new AIS_Shape(BRepPrimAPI_MakeBox(gp_Pnt(-5, -5, -5), 10, 10, 10).Shape());
+        view->displayShape(ground, false);
+        view->displayShape(box, false);
+
+        BooleanService::Request cut;
+        cut.Op     = BooleanService::Operation_Cut;
+        cut.Object = ground;
+        cut.Tools.append(box);
+
+        const int cancelled = service->Submit(cut);
+        service->Cancel(cancelled);
+        service->waitForDone();
+        CPPUNIT_ASSERT(service->Output(cancelled).IsNull());
+        CPPUNIT_ASSERT(m.getContext()->IsDisplayed(ground));
+
+        const int id = service->Submit(cut);
+        service->waitForDone();
+        CPPUNIT_ASSERT_EQUAL(0, service->NbPending());
+        const Handle(AIS_Shape) result = service->Output(id);
+        CPPUNIT_ASSERT(!result.IsNull());
+        CPPUNIT_ASSERT(service->Output(id).IsNull());
+        CPPUNIT_ASSERT(!m.getContext()->IsDisplayed(ground));
+        CPPUNIT_ASSERT(!m.getContext()->IsDisplayed(box));
+
+        GProp_GProps props;
+        BRepGProp::VolumeProperties(result->Shape(), props);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(100.0 * 100.0 * 10.0 - 500.0, props.Mass(), 1.0e-3);
+        view->removeShape(result, true);
+    }
+
+    /// \brief 导入修复：两个未缝合的相邻面缝合成壳，第二次导入命中缓存
+    void t_shape_healer()
+    {
+        TopoDS_Compound patches;
+        BRep_Builder    builder;
+        builder.MakeCompound(patches);
+        builder.Add(patches, BRepBuilderAPI_MakeFace(gp_Pln(), 0, 10, 0, 10).Face());
+        builder.Add(patches, BRepBuilderAPI_MakeFace(gp_Pln(), 10, 20, 0, 10).Face());
+
+        const QString file = QDir::temp().filePath("t_shape_healer.step");
+        CPPUNIT_ASSERT(SceneGenerator::WriteStep(patches, file.toUtf8().data()));
+
+        ShapeHealer::Options options;
+        options.CacheDir = QDir::temp().filePath("t_shape_healer_cache");
+        QDir(options.CacheDir).removeRecursively();
+        const ShapeHealer healer(options);
+
+        Handle(TopTools_HSequenceOfShape) healed  = new TopTools_HSequenceOfShape;
+        std::vector<ShapeHealer::Report>  reports;
+        bool                              isCached = true;
+        CPPUNIT_ASSERT(ShapeLoader::ReadStep(file.toUtf8().data(), healed, &healer, &reports, &isCached));
+        CPPUNIT_ASSERT(!isCached);
+        CPPUNIT_ASSERT_EQUAL(1, healed->Length());
+        CPPUNIT_ASSERT_EQUAL(size_t(1), reports.size());
+        CPPUNIT_ASSERT(reports[0].IsSewn);
+        CPPUNIT_ASSERT_EQUAL(8, reports[0].FreeEdgesBefore);
+        CPPUNIT_ASSERT_EQUAL(6, reports[0].FreeEdgesAfter);
+
+        Handle(TopTools_HSequenceOfShape) cached = new TopTools_HSequenceOfShape;
+        std::vector<ShapeHealer::Report>  cachedReports;
+        CPPUNIT_ASSERT(ShapeLoader::ReadStep(file.toUtf8().data(), cached, &healer, &cachedReports, &isCached));
+        CPPUNIT_ASSERT(isCached);
+        CPPUNIT_ASSERT_EQUAL(1, cached->Length());
+        CPPUNIT_ASSERT_EQUAL(6, cachedReports[0].FreeEdgesAfter);
+
+        TopTools_IndexedMapOfShape edges;
+        TopExp::MapShapes(cached->Value(1), TopAbs_EDGE, edges);
+        CPPUNIT_ASSERT_EQUAL(7, edges.Extent());
+    }
+
+    /// \brief 去特征简化：圆角和孔被移除；选中的对象显示精确形状，移除对象时代理随之移除
+    void t_display_simplifier()
+    {
+        const TopoDS_Shape bracket = SceneGenerator::MakeBracket(1.0, 2.5);
+        Standard_Integer   removed = 0;
+        const TopoDS_Shape simple  = DisplaySimplifier::Simplify(bracket, 3.0, removed);
+        CPPUNIT_ASSERT(removed > 0);
+
+        TopTools_IndexedMapOfShape before, after;
+        TopExp::MapShapes(bracket, TopAbs_FACE, before);
+        TopExp::MapShapes(simple, TopAbs_FACE, after);
+        CPPUNIT_ASSERT(after.Extent() < before.Extent());
+
+        GProp_GProps exact, simplified;
+        BRepGProp::VolumeProperties(bracket, exact);
+        BRepGProp::VolumeProperties(simple, simplified);
+        CPPUNIT_ASSERT(simplified.Mass() > exact.Mass());
+
+        // 特征尺寸以下没有可移除的面时形状不变
+        CPPUNIT_ASSERT(DisplaySimplifier::Simplify(bracket, 0.5, removed).IsSame(bracket));
+        CPPUNIT_ASSERT_EQUAL(0, removed);
+
+        ModelView *        view       = m.getModelView();
+        DisplaySimplifier &simplifier = view->getSimplifier();
+        Handle(AIS_Shape)  shape      = new AIS_Shape(bracket);
+        view->displayShape(shape, false);
+        simplifier.SetFeatureSize(3.0);
+        simplifier.Add(std::vector<Handle(AIS_Shape)>(1, shape));
+        CPPUNIT_ASSERT(simplifier.Contains(shape));
+        CPPUNIT_ASSERT(simplifier.Stats().TrianglesSimplified < simplifier.Stats().TrianglesExact);
+
+        simplifier.SetMode(DisplaySimplifier::Mode_Simplified);
+        CPPUNIT_ASSERT(simplifier.UpdateView());
+        CPPUNIT_ASSERT_EQUAL(1, simplifier.NbShown());
+
+        m.getContext()->AddOrRemoveSelected(shape, Standard_False);
+        simplifier.UpdateView();
+        CPPUNIT_ASSERT_EQUAL(0, simplifier.NbShown());
+        m.getContext()->ClearSelected(Standard_False);
+
+        simplifier.SetMode(DisplaySimplifier::Mode_Auto);
+        view->removeShape(shape, true);
+        CPPUNIT_ASSERT(!simplifier.Contains(shape));
+    }
+
+    /// \brief 重复实体：旋转的深拷贝被识别为一组，共享后与代表实体是同一个TShape且位置不变
+    void t_duplicate_finder()
+    {
+        // 深拷贝并绕Z轴随机旋转的螺栓几何相同但不共享TShape
+        SceneGenerator::Options options;
+        options.NbSolids    = 4;
+        options.MaxRotation = M_PI;
+        options.ToCopy      = Standard_True;
+        Handle(TopTools_HSequenceOfShape) fasteners =
+            SceneGenerator::Replicate(SceneGenerator::MakeFastener(), options);
+
+        std::vector<TopoDS_Shape> shapes;
+        for (int i = 1; i <= fasteners->Length(); ++i)
+            shapes.push_back(fasteners->Value(i));
+        shapes.push_back(SceneGenerator::MakeBracket());
+        shapes.push_back(BRepPrimAPI_MakeBox(10, 20, 30).Shape());
+
+        DuplicateFinder finder;
+        finder.Perform(shapes);
+        CPPUNIT_ASSERT_EQUAL(6, finder.NbSolids());
+        CPPUNIT_ASSERT_EQUAL(3, finder.Stats().NbDuplicates);
+        CPPUNIT_ASSERT_EQUAL(1, finder.Stats().NbGroups);
+
+        for (Standard_Integer i = 0; i < finder.NbSolids(); ++i)
+        {
+            const Standard_Integer rep = finder.Representative(i);
+            if (rep == i)
+                continue;
+
+            // 共享后与代表实体是同一个TShape，位置即校验得到的变换
+            const TopoDS_Shape shared = finder.Share(finder.ShapeOf(i));
+            CPPUNIT_ASSERT(shared.IsPartner(finder.Solid(rep)));
+
+            GProp_GProps before, after;
+            BRepGProp::VolumeProperties(shapes[finder.ShapeOf(i)], before);
+            BRepGProp::VolumeProperties(shared, after);
+            CPPUNIT_ASSERT(before.CentreOfMass().Distance(after.CentreOfMass()) < 1.0e-3);
+        }
+    }
+
 private:
     MainWindow m;
 
@@ -0,0 +1,214 @@
+/// \brief test_replay.cpp
+///
+/// 交互性能回归测试。在固定的合成场景(res/cube101010.step按网格复制)上依次回放res/replay中的
+/// 输入录像(*.rec，由InputRecorder录制或按同样格式编写)，统计每个录像的帧时间分位数与掉帧数，
+/// 以JSON格式输出，并与基线比较。
+///
+/// 用法(无显示器时在Xvfb下运行，例如 xvfb-run -a test_replay):
+///   test_replay [--cubes N] [--scenarios dir] [--output result.json]
+///               [--baseline baseline.json] [--tolerance 0.5] [--write-baseline]
+///
+/// 存在性能回退时返回值为1；基线文件不存在或其场景规模(cubes)不同时返回3，不能当作通过(ctest记为跳过)。
+/// 基线须在参考机器上用--write-baseline录制后提交。
+
+#include "InputReplay.h"
+#include "Logger.h"
+#include "ModelView.h"
+#include "SceneGenerator.h"
+#include "ShapeLoader.h"
+#include "mainwindow.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <AIS_Shape.hxx>
+#include <BRepMesh_IncrementalMesh.hxx>
+
+#ifndef OCCT_RES_DIR
+#define OCCT_RES_DIR "res"
+#endif
+
+
+namespace
+{
+    //! 与基线比较，"_ms"结尾的指标越小越好；掉帧数按同样的容差比较，基线为0时允许1帧
+    QJsonArray compare(const QJsonObject &theScenarios, const QJsonObject &theBaseline, const double theTolerance)
+    {
+        QJsonArray aRegressions;
+        for (QJsonObject::const_iterator aScenario = theScenarios.begin(); aScenario != theScenarios.end(); ++aScenario)
+        {
+            const QJsonObject aBase = theBaseline.value(aScenario.key()).toObject();
+            const QJsonObject aCur  = aScenario.value().toObject();
+            for (QJsonObject::const_iterator aMetric = aCur.begin(); aMetric != aCur.end(); ++aMetric)
+            {
+                if (!aBase.contains(aMetric.key()))
+                    continue;
+
+                const double aOld        = aBase.value(aMetric.key()).toDouble();
+                const double aNew        = aMetric.value().toDouble();
+                bool         isRegressed = false;
+                if (aMetric.key().endsWith("_ms"))
+                    isRegressed = aNew > aOld * (1.0 + theTolerance);
+                else if (aMetric.key() == "dropped")
+                    isRegressed = aNew > std::max(aOld * (1.0 + theTolerance), aOld + 1.0);
+
+                if (isRegressed)
+                {
+                    QJsonObject aItem;
+                    aItem["scenario"] = aScenario.key();
+                    aItem["metric"]   = aMetric.key();
+                    aItem["baseline"] = aOld;
+                    aItem["current"]  = aNew;
+                    aRegressions.append(aItem);
+                }
+            }
+        }
+        return aRegressions;
+    }
+}    // namespace
+
+
+int main(int argc, char **argv)
+{
+    QApplication a(argc, argv);
+
+    QCommandLineParser aParser;
+    aParser.setApplicationDescription("ModelView interaction replay");
+    aParser.addHelpOption();
+    aParser.addOption(QCommandLineOption("cubes", "number of cube101010.step copies", "N", "125"));
+    aParser.addOption(QCommandLineOption("scenarios", "directory of *.rec recordings", "dir",
+                                         QString(OCCT_RES_DIR) + "/replay"));
+    aParser.addOption(QCommandLineOption("output", "write JSON results to file", "file"));
+    aParser.addOption(QCommandLineOption("baseline", "baseline JSON file", "file",
+                                         QString(OCCT_RES_DIR) + "/replay_baseline.json"));
+    aParser.addOption(QCommandLineOption("tolerance", "allowed relative regression", "ratio", "0.5"));
+    aParser.addOption(QCommandLineOption("write-baseline", "store the results as the new baseline"));
+    aParser.process(a);
+
+    // 日志只写文件，标准输出保留给JSON结果
+    const QString aLogConf = QDir::temp().filePath("test_replay_log.conf");
+    QFile         aLogConfFile(aLogConf);
+    if (aLogConfFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        aLogConfFile.write("log4cpp.rootCategory=INFO, file\n"
+                           "log4cpp.appender.file=FileAppender\n"
+                           "log4cpp.appender.file.append=false\n"
+                           "log4cpp.appender.file.fileName=" + QDir::temp().filePath("test_replay.log").toUtf8() + "\n");
+        aLogConfFile.close();
+        Logger::Instance().Configure(aLogConf);
+    }
+
+    MainWindow w;
+    w.resize(1280, 800);
+    w.show();
+    a.processEvents();
+
+    // 固定的场景，与bench_occt的cubes场景相同
+    Handle(TopTools_HSequenceOfShape) aCube = new TopTools_HSequenceOfShape;
+    if (!ShapeLoader::ReadStep(OCCT_RES_DIR "/cube101010.step", aCube) || aCube->IsEmpty())
+    {
+        std::cerr << "cannot read " << OCCT_RES_DIR << "/cube101010.step" << std::endl;
+        return 2;
+    }
+
+    SceneGenerator::Options aCubeOptions;
+    aCubeOptions.NbSolids = aParser.value("cubes").toInt();
+    aCubeOptions.Spacing  = 20.0;
+    aCubeOptions.ToCopy   = Standard_True;
+    Handle(TopTools_HSequenceOfShape) aShapes = SceneGenerator::Replicate(aCube->Value(1), aCubeOptions);
+
+    ModelView *aView = w.getModelView();
+    for (int i = 1; i <= aShapes->Length(); ++i)
+    {
+        BRepMesh_IncrementalMesh(aShapes->Value(i), 0.1, Standard_False, 0.5, Standard_True);
+        Handle(AIS_Shape) aShape = new AIS_Shape(aShapes->Value(i));
+        aShape->SetDisplayMode(AIS_Shaded);
+        aView->displayShape(aShape, false);
+    }
+    w.getContext()->UpdateCurrentViewer();
+
+    // 每个录像从相同的相机开始
+    const QDir        aDir(aParser.value("scenarios"));
+    const QStringList aFiles = aDir.entryList(QStringList() << "*.rec", QDir::Files, QDir::Name);
+    if (aFiles.isEmpty())
+    {
+        std::cerr << "no recordings in " << aDir.path().toStdString() << std::endl;
+        return 2;
+    }
+
+    QJsonObject aScenarios;
+    foreach (const QString &aFile, aFiles)
+    {
+        InputReplayer aReplayer;
+        if (!aReplayer.Load(aDir.filePath(aFile)))
+            return 2;
+
+        aView->getViewAction(ModelView::ViewAxoId)->trigger();
+        aView->getViewAction(ModelView::ViewFitAllId)->trigger();
+        a.processEvents();
+
+        aScenarios[QFileInfo(aFile).completeBaseName()] = aReplayer.Run(aView).ToJson();
+    }
+
+    QJsonObject aResult;
+    aResult["cubes"]     = aCubeOptions.NbSolids;
+    aResult["scenarios"] = aScenarios;
+
+    // 没有基线时无从比较，返回3(ctest记为跳过)，避免在什么都没检查时报告通过
+    int   aStatus = 0;
+    QFile aBaselineFile(aParser.value("baseline"));
+    if (!aParser.isSet("write-baseline"))
+    {
+        if (!aBaselineFile.open(QIODevice::ReadOnly))
+        {
+            std::cerr << "missing baseline " << aBaselineFile.fileName().toStdString()
+                      << ", record it with --write-baseline" << std::endl;
+            aStatus = 3;
+        }
+        else
+        {
+            const QJsonObject aBaseline = QJsonDocument::fromJson(aBaselineFile.readAll()).object();
+            if (aBaseline.value("cubes").toInt() != aCubeOptions.NbSolids)
+            {
+                std::cerr << "baseline was recorded with " << aBaseline.value("cubes").toInt() << " cubes, not "
+                          << aCubeOptions.NbSolids << std::endl;
+                aStatus = 3;
+            }
+            else
+            {
+                const QJsonArray aRegressions = compare(aScenarios, aBaseline.value("scenarios").toObject(),
+                                                        aParser.value("tolerance").toDouble());
+                aResult["regressions"] = aRegressions;
+                aStatus                = aRegressions.isEmpty() ? 0 : 1;
+            }
+        }
+    }
+
+    const QByteArray aJson = QJsonDocument(aResult).toJson();
+    std::cout << aJson.toStdString() << std::endl;
+
+    if (!aParser.value("output").isEmpty())
+    {
+        QFile anOut(aParser.value("output"));
+        if (anOut.open(QIODevice::WriteOnly))
+            anOut.write(aJson);
+    }
+
+    if (aParser.isSet("write-baseline"))
+    {
+        QFile anOut(aParser.value("baseline"));
+        if (anOut.open(QIODevice::WriteOnly))
+            anOut.write(aJson);
+    }
+
+    return aStatus;
+}